@@ -1,13 +1,21 @@
 // pcap-aut-diff - gets a pair of NFAs A1 and A2 and a set of network packets P
 // in the pcap format, and tests how many packets from P lie in the symmetric
 // difference of the languages of A1 and A2
+//
+// In the product mode (-x), the tool does not run A1 and A2 separately on
+// every packet but lazily builds the product of their subset constructions;
+// every product state is labelled with one of the four outcomes (accepted by
+// both, only by A1, only by A2, by neither), so every payload is scanned only
+// once and, after the product warms up, without any allocation.
 
 #include <vata2/util.hh>
 #include <vata2/nfa.hh>
 
 #include <chrono>
+#include <cstring>
 #include <iostream>
 #include <fstream>
+#include <limits>
 
 // PCAP-related headers
 #include <pcap.h>
@@ -20,6 +28,8 @@
 #include <netinet/tcp.h>
 #include <netinet/udp.h>
 
+#include "metrics.hh"
+
 #ifdef __APPLE__
 #define ETH_ALEN    6       /* Octets in one ethernet addr   */
 #define iphdr ip
@@ -46,40 +56,271 @@ using TimePoint = std::chrono::time_point<std::chrono::high_resolution_clock>;
 void packetHandler(u_char *userData, const pcap_pkthdr* pkthdr, const u_char* packet);
 
 // GLOBAL VARIABLES
-size_t total_packets = 0;
-size_t payloaded_packets = 0;
-size_t vlan_packets = 0;
-size_t ipv4_packets = 0;
-size_t ipv6_packets = 0;
-size_t tcp_packets = 0;
-size_t udp_packets = 0;
-size_t ipip_packets = 0;
-size_t esp_packets = 0;
-size_t icmp_packets = 0;
-size_t gre_packets = 0;
-size_t icmp6_packets = 0;
-size_t v6_fragment_packets = 0;
-size_t ip6_in_ip4_packets = 0;
-size_t pim_packets = 0;
-size_t other_l3_packets = 0;
-size_t other_l4_packets = 0;
-size_t incons_packets = 0;
-size_t accepted_aut1 = 0;
-size_t accepted_aut2 = 0;
-size_t accepted_aut1_not_aut2 = 0;
-size_t accepted_aut2_not_aut1 = 0;
+MetricsRegistry metrics;
+MetricsReporter* reporter = nullptr;
+Counter& total_packets = metrics.counter("packets", "Packets read.");
+Counter& total_bytes = metrics.counter("bytes", "Bytes of packets read.");
+Counter& payloaded_packets = metrics.counter("payload_packets", "Packets with payload.");
+Counter& payload_bytes = metrics.counter("payload_bytes", "Bytes of payloads.");
+Counter& vlan_packets = metrics.counter("vlan_packets", "Packets with VLAN.");
+Counter& ipv4_packets = metrics.counter("ipv4_packets", "Packets with IPv4.");
+Counter& ipv6_packets = metrics.counter("ipv6_packets", "Packets with IPv6.");
+Counter& tcp_packets = metrics.counter("tcp_packets", "Packets with TCP.");
+Counter& udp_packets = metrics.counter("udp_packets", "Packets with UDP.");
+Counter& ipip_packets = metrics.counter("ipip_packets", "Packets with IPv4-in-IPv4.");
+Counter& esp_packets = metrics.counter("esp_packets", "Packets with ESP.");
+Counter& icmp_packets = metrics.counter("icmp_packets", "Packets with ICMP.");
+Counter& gre_packets = metrics.counter("gre_packets", "Packets with GRE (not processed).");
+Counter& icmp6_packets = metrics.counter("icmp6_packets", "Packets with ICMPv6.");
+Counter& v6_fragment_packets = metrics.counter("v6_fragment_packets", "Packets with IPv6 fragment.");
+Counter& ip6_in_ip4_packets = metrics.counter("ip6_in_ip4_packets", "Packets with IPv6-in-IPv4.");
+Counter& pim_packets = metrics.counter("pim_packets", "Packets with PIM (not processed).");
+Counter& other_l3_packets = metrics.counter("other_l3_packets", "Packets with other L3 (not processed).");
+Counter& other_l4_packets = metrics.counter("other_l4_packets", "Packets with other L4 (not processed).");
+Counter& incons_packets = metrics.counter("incons_packets", "Inconsistent packets.");
+Counter& accepted_aut1 = metrics.counter("accepted_aut1", "Accepted in Aut1.");
+Counter& accepted_aut2 = metrics.counter("accepted_aut2", "Accepted in Aut2.");
+Counter& accepted_aut1_not_aut2 = metrics.counter("accepted_aut1_not_aut2", "Accepted in Aut1 but not in Aut2.");
+Counter& accepted_aut2_not_aut1 = metrics.counter("accepted_aut2_not_aut1", "Accepted in Aut2 but not in Aut1.");
+Histogram& match_latency = metrics.histogram("match_latency_ns",
+	"Time of matching a payload against both automata (in ns).");
 bool prefix_acceptance = false;
+bool product_mode = false;
 Nfa aut1;
 Nfa aut2;
 
+/// the outcome of classifying a payload by the pair of automata
+enum Outcome : uint8_t
+{
+	OUTCOME_NEITHER = 0,
+	OUTCOME_ONLY_AUT1 = 1,
+	OUTCOME_ONLY_AUT2 = 2,
+	OUTCOME_BOTH = 3
+};
+
+const char* const OUTCOME_NAMES[] = { "neither", "only-aut1", "only-aut2", "both" };
+
+/// representative packets dumped for every outcome (if requested)
+pcap_t* dump_descr = nullptr;
+pcap_dumper_t* dumpers[4] = { nullptr, nullptr, nullptr, nullptr };
+size_t dumped_cnt[4] = { 0, 0, 0, 0 };
+size_t dump_max = 10;
+
+
+/**
+ * @brief  Lazily constructed product of the subset constructions of two NFAs
+ *
+ * States of the product are pairs of macrostates (one for each automaton),
+ * which are hash-consed, so that every pair is represented by a dense number.
+ * Transitions of the product are computed on demand and cached in a dense
+ * table with one row of 256 entries (one per byte) for every product state.
+ * Every product state carries the outcome (i.e., which automata accept) in
+ * a separate array, so the scan of a payload is only a sequence of table
+ * lookups.  When the number of product states exceeds @p max_states, the
+ * cache is flushed and the construction starts again from the current state.
+ */
+class LazyProduct
+{
+private:
+
+	using ProdState = uint32_t;
+	using MacroId = uint32_t;
+
+	static const ProdState UNKNOWN = std::numeric_limits<ProdState>::max();
+	static const size_t ALPHABET_SIZE = 256;
+
+	const Nfa& lhs;
+	const Nfa& rhs;
+	size_t max_states;
+
+	// hash-consed macrostates of each of the automata
+	SubsetMap lhs_macro_map = { };
+	SubsetMap rhs_macro_map = { };
+	std::vector<const StateSet*> lhs_macros = { };
+	std::vector<const StateSet*> rhs_macros = { };
+
+	// hash-consed product states
+	std::unordered_map<std::pair<MacroId, MacroId>, ProdState> prod_map = { };
+	std::vector<std::pair<MacroId, MacroId>> prod_states = { };
+
+	// the transition table and the outcomes of product states
+	std::vector<ProdState> delta = { };
+	std::vector<uint8_t> outcome = { };
+
+	ProdState init_state = UNKNOWN;
+	size_t flushes = 0;
+
+private:
+
+	LazyProduct(const LazyProduct&);
+	LazyProduct& operator=(const LazyProduct&);
+
+	static MacroId get_macro(
+		SubsetMap*                     macro_map,
+		std::vector<const StateSet*>*  macros,
+		const StateSet&                macro)
+	{ // {{{
+		auto it_ins = macro_map->insert({macro, static_cast<State>(macros->size())});
+		if (it_ins.second) { macros->push_back(&it_ins.first->first); }
+		return static_cast<MacroId>(it_ins.first->second);
+	} // get_macro }}}
+
+	ProdState get_prod_state(const StateSet& lhs_macro, const StateSet& rhs_macro)
+	{ // {{{
+		MacroId lhs_id = get_macro(&this->lhs_macro_map, &this->lhs_macros, lhs_macro);
+		MacroId rhs_id = get_macro(&this->rhs_macro_map, &this->rhs_macros, rhs_macro);
+
+		auto it_ins = this->prod_map.insert({{lhs_id, rhs_id},
+			static_cast<ProdState>(this->prod_states.size())});
+		if (it_ins.second)
+		{ // a new product state
+			this->prod_states.push_back({lhs_id, rhs_id});
+			this->delta.resize(this->delta.size() + ALPHABET_SIZE, UNKNOWN);
+
+			uint8_t res = OUTCOME_NEITHER;
+			if (!Vata2::util::are_disjoint(lhs_macro, this->lhs.finalstates))
+			{
+				res |= OUTCOME_ONLY_AUT1;
+			}
+			if (!Vata2::util::are_disjoint(rhs_macro, this->rhs.finalstates))
+			{
+				res |= OUTCOME_ONLY_AUT2;
+			}
+			this->outcome.push_back(res);
+		}
+
+		return it_ins.first->second;
+	} // get_prod_state }}}
+
+	/// removes all cached states and keeps only @p keep (returns its new number)
+	ProdState flush(ProdState keep)
+	{ // {{{
+		++this->flushes;
+
+		StateSet lhs_macro = *this->lhs_macros[this->prod_states[keep].first];
+		StateSet rhs_macro = *this->rhs_macros[this->prod_states[keep].second];
+
+		this->lhs_macro_map.clear();
+		this->rhs_macro_map.clear();
+		this->lhs_macros.clear();
+		this->rhs_macros.clear();
+		this->prod_map.clear();
+		this->prod_states.clear();
+		this->delta.clear();
+		this->outcome.clear();
+
+		this->init_state = this->get_prod_state(this->lhs.initialstates,
+			this->rhs.initialstates);
+		return this->get_prod_state(lhs_macro, rhs_macro);
+	} // flush }}}
+
+	/// computes a missing transition of the product
+	ProdState compute_succ(ProdState* state, uint8_t symb)
+	{ // {{{
+		assert(nullptr != state);
+
+		if (this->prod_states.size() >= this->max_states)
+		{
+			*state = this->flush(*state);
+		}
+
+		const std::pair<MacroId, MacroId>& macros = this->prod_states[*state];
+		StateSet lhs_post = this->lhs.post(*this->lhs_macros[macros.first], symb);
+		StateSet rhs_post = this->rhs.post(*this->rhs_macros[macros.second], symb);
+
+		ProdState succ = this->get_prod_state(lhs_post, rhs_post);
+		this->delta[*state * ALPHABET_SIZE + symb] = succ;
+		return succ;
+	} // compute_succ }}}
+
+	bool is_lhs_sink(ProdState state) const
+	{ return this->lhs_macros[this->prod_states[state].first]->empty(); }
+	bool is_rhs_sink(ProdState state) const
+	{ return this->rhs_macros[this->prod_states[state].second]->empty(); }
+
+public:
+
+	LazyProduct(const Nfa& lhs, const Nfa& rhs, size_t max_states) :
+		lhs(lhs), rhs(rhs), max_states(std::max(max_states, static_cast<size_t>(2)))
+	{
+		this->init_state = this->get_prod_state(lhs.initialstates, rhs.initialstates);
+	}
+
+	/// number of product states currently in the cache
+	size_t num_states() const { return this->prod_states.size(); }
+
+	/// number of times the cache was flushed
+	size_t num_flushes() const { return this->flushes; }
+
+	/**
+	 * @brief  Classifies a payload using a single scan
+	 *
+	 * If @p prefix is @p true, an automaton accepts the payload if it accepts
+	 * some of its prefixes.
+	 */
+	Outcome classify(const u_char* begin, const u_char* end, bool prefix)
+	{ // {{{
+		ProdState state = this->init_state;
+		uint8_t sticky = prefix? this->outcome[state] : static_cast<uint8_t>(OUTCOME_NEITHER);
+
+		for (const u_char* it = begin; it != end; ++it)
+		{
+			if (prefix && (OUTCOME_BOTH == sticky)) { break; }
+
+			ProdState succ = this->delta[state * ALPHABET_SIZE + *it];
+			if (UNKNOWN == succ)
+			{
+				succ = this->compute_succ(&state, *it);
+			}
+
+			state = succ;
+
+			if (prefix)
+			{
+				sticky |= this->outcome[state];
+				if (((sticky & OUTCOME_ONLY_AUT1) || this->is_lhs_sink(state)) &&
+					((sticky & OUTCOME_ONLY_AUT2) || this->is_rhs_sink(state)))
+				{ // no further change is possible
+					break;
+				}
+			}
+			else if (this->is_lhs_sink(state) && this->is_rhs_sink(state))
+			{
+				break;
+			}
+		}
+
+		if (prefix) { return static_cast<Outcome>(sticky); }
+		return static_cast<Outcome>(this->outcome[state]);
+	} // classify }}}
+}; // LazyProduct
+
+const LazyProduct::ProdState LazyProduct::UNKNOWN;
+const size_t LazyProduct::ALPHABET_SIZE;
+
+LazyProduct* product = nullptr;
+size_t product_max_states = 100000;
+
 
 
 void print_usage(const char* prog_name)
 {
-	std::cout << "usage: " << prog_name << " [-p] aut1.vtf aut2.vtf packets.pcap\n";
+	std::cout << "usage: " << prog_name << " [-p] [-x [--max-states N]] [--dump PREFIX [--dump-max N]]"
+		" aut1.vtf aut2.vtf packets.pcap\n";
 	std::cout << "\n";
 	std::cout << "Options:\n";
-	std::cout << "  -p    prefix acceptance\n";
+	std::cout << "  -p               prefix acceptance\n";
+	std::cout << "  -x               product mode: scan every payload only once using a lazily\n";
+	std::cout << "                   constructed product of the automata\n";
+	std::cout << "  --max-states N   bound on the number of cached product states (default: "
+		<< product_max_states << ")\n";
+	std::cout << "  --dump PREFIX    dump representative packets of every outcome into\n";
+	std::cout << "                   PREFIX-<outcome>.pcap\n";
+	std::cout << "  --dump-max N     the number of dumped packets per outcome (default: "
+		<< dump_max << ")\n";
+	std::cout << "  --metrics DEST   periodically write metrics to DEST (a file or unix:PATH)\n";
+	std::cout << "  --metrics-format FORMAT     'json' (default) or 'prometheus'\n";
+	std::cout << "  --metrics-interval SECONDS  time between snapshots of metrics (default 1)\n";
 }
 
 Nfa load_aut(const std::string& file_name)
@@ -101,31 +342,65 @@ Nfa load_aut(const std::string& file_name)
 int main(int argc, char** argv)
 {
 	// PARSING COMMAND LINE ARGUMENTS
-	size_t param_start = 1;
-	if (argc != 4 && argc != 5)
+	MetricsConfig metrics_config;
+	try
 	{
-		print_usage(argv[0]);
+		argc = extract_metrics_options(argc, argv, &metrics_config);
+	}
+	catch (const std::exception& ex)
+	{
+		std::cerr << "Error: " << ex.what() << "\n";
 		return EXIT_FAILURE;
 	}
 
-	if (std::to_string(argv[1]) == "-p")
+	std::string dump_prefix;
+	int param_start = 1;
+	while (param_start < argc && argv[param_start][0] == '-')
 	{
-		prefix_acceptance = true;
-		param_start = 2;
-
-		if (argc != 5)
+		std::string opt = argv[param_start];
+		if ("-p" == opt)
 		{
-			print_usage(argv[0]);
-			return EXIT_FAILURE;
+			prefix_acceptance = true;
 		}
-	}
-	else
-	{
-		if (argc != 4)
+		else if ("-x" == opt)
+		{
+			product_mode = true;
+		}
+		else if (("--max-states" == opt || "--dump" == opt || "--dump-max" == opt) &&
+			(param_start + 1 < argc))
+		{
+			++param_start;
+			if ("--dump" == opt)
+			{
+				dump_prefix = argv[param_start];
+			}
+			else
+			{
+				std::istringstream stream(argv[param_start]);
+				size_t value = 0;
+				if (!(stream >> value))
+				{
+					std::cerr << "Invalid number provided to " << opt << "!\n";
+					return EXIT_FAILURE;
+				}
+
+				if ("--max-states" == opt) { product_max_states = value; }
+				else { dump_max = value; }
+			}
+		}
+		else
 		{
 			print_usage(argv[0]);
 			return EXIT_FAILURE;
 		}
+
+		++param_start;
+	}
+
+	if (argc - param_start != 3)
+	{
+		print_usage(argv[0]);
+		return EXIT_FAILURE;
 	}
 
 	// LOADING INPUTS
@@ -155,6 +430,31 @@ int main(int argc, char** argv)
 		return EXIT_FAILURE;
 	}
 
+	if (!dump_prefix.empty())
+	{
+		dump_descr = descr;
+		for (size_t i = 0; i < 4; ++i)
+		{
+			std::string dump_file = dump_prefix + "-" + OUTCOME_NAMES[i] + ".pcap";
+			dumpers[i] = pcap_dump_open(descr, dump_file.c_str());
+			if (nullptr == dumpers[i])
+			{
+				std::cout << "pcap_dump_open() failed: " << pcap_geterr(descr);
+				return EXIT_FAILURE;
+			}
+		}
+	}
+
+	if (product_mode)
+	{
+		product = new LazyProduct(aut1, aut2, product_max_states);
+	}
+
+	if (!metrics_config.destination.empty())
+	{
+		reporter = new MetricsReporter(metrics, metrics_config);
+	}
+
 	TimePoint startTime = std::chrono::high_resolution_clock::now();
 
 	// start packet processing loop, just like live capture
@@ -167,38 +467,61 @@ int main(int argc, char** argv)
 	TimePoint finishTime = std::chrono::high_resolution_clock::now();
   std::chrono::duration<double> opTime = finishTime - startTime;
 
+	for (pcap_dumper_t* dumper : dumpers)
+	{
+		if (nullptr != dumper) { pcap_dump_close(dumper); }
+	}
+
 	std::cout << "\n";
-	std::cout << "Total packets in " << packets_file << ": " << total_packets << "\n";
-	std::cout << "Packets with VLAN: " << vlan_packets << "\n";
-	std::cout << "Packets with IPv4: " << ipv4_packets << "\n";
-	std::cout << "Packets with IPv6: " << ipv6_packets << "\n";
-	std::cout << "Packets with other L3 (not processed): " << other_l3_packets << "\n";
-	std::cout << "Packets with TCP: " << tcp_packets << "\n";
-	std::cout << "Packets with UDP: " << udp_packets << "\n";
-	std::cout << "Packets with IPv4-in-IPv4: " << ipip_packets << "\n";
-	std::cout << "Packets with ESP: " << esp_packets << "\n";
-	std::cout << "Packets with ICMP: " << icmp_packets << "\n";
-	std::cout << "Packets with GRE (not processed): " << gre_packets << "\n";
-	std::cout << "Packets with ICMPv6: " << icmp6_packets << "\n";
-	std::cout << "Packets with IPv6 fragment: " << v6_fragment_packets << "\n";
-	std::cout << "Packets with IPv6-in-IPv4: " << ip6_in_ip4_packets << "\n";
-	std::cout << "Packets with PIM (not processed): " << pim_packets << "\n";
-	std::cout << "Packets with other L4 (not processed): " << other_l4_packets << "\n";
-	std::cout << "Packets with payload: " << payloaded_packets << "\n";
-	std::cout << "Accepted in Aut1: " << accepted_aut1 << "\n";
-	std::cout << "Accepted in Aut2: " << accepted_aut2 << "\n";
-	std::cout << "Accepted in Aut1 but not in Aut2: " << accepted_aut1_not_aut2 << "\n";
-	std::cout << "Accepted in Aut2 but not in Aut1: " << accepted_aut2_not_aut1 << "\n";
-	std::cout << "Inconsistent packets: " << incons_packets << "\n";
+	std::cout << "Total packets in " << packets_file << ": " << total_packets.get() << "\n";
+	std::cout << "Packets with VLAN: " << vlan_packets.get() << "\n";
+	std::cout << "Packets with IPv4: " << ipv4_packets.get() << "\n";
+	std::cout << "Packets with IPv6: " << ipv6_packets.get() << "\n";
+	std::cout << "Packets with other L3 (not processed): " << other_l3_packets.get() << "\n";
+	std::cout << "Packets with TCP: " << tcp_packets.get() << "\n";
+	std::cout << "Packets with UDP: " << udp_packets.get() << "\n";
+	std::cout << "Packets with IPv4-in-IPv4: " << ipip_packets.get() << "\n";
+	std::cout << "Packets with ESP: " << esp_packets.get() << "\n";
+	std::cout << "Packets with ICMP: " << icmp_packets.get() << "\n";
+	std::cout << "Packets with GRE (not processed): " << gre_packets.get() << "\n";
+	std::cout << "Packets with ICMPv6: " << icmp6_packets.get() << "\n";
+	std::cout << "Packets with IPv6 fragment: " << v6_fragment_packets.get() << "\n";
+	std::cout << "Packets with IPv6-in-IPv4: " << ip6_in_ip4_packets.get() << "\n";
+	std::cout << "Packets with PIM (not processed): " << pim_packets.get() << "\n";
+	std::cout << "Packets with other L4 (not processed): " << other_l4_packets.get() << "\n";
+	std::cout << "Packets with payload: " << payloaded_packets.get() << "\n";
+	std::cout << "Accepted in Aut1: " << accepted_aut1.get() << "\n";
+	std::cout << "Accepted in Aut2: " << accepted_aut2.get() << "\n";
+	std::cout << "Accepted in Aut1 but not in Aut2: " << accepted_aut1_not_aut2.get() << "\n";
+	std::cout << "Accepted in Aut2 but not in Aut1: " << accepted_aut2_not_aut1.get() << "\n";
+	std::cout << "Inconsistent packets: " << incons_packets.get() << "\n";
+	if (nullptr != product)
+	{
+		std::cout << "Product states: " << product->num_states() << "\n";
+		std::cout << "Product cache flushes: " << product->num_flushes() << "\n";
+		delete product;
+	}
 	std::cout << "Time: " <<
 		std::chrono::duration_cast<std::chrono::nanoseconds>(opTime).count() * 1e-9
 		<< "\n";
 
+	if (nullptr != reporter)
+	{
+		reporter->snapshot();
+		delete reporter;
+	}
+
 	return EXIT_SUCCESS;
 }
 
 
-Word get_payload(
+/**
+ * @brief  Finds the payload of a packet
+ *
+ * Returns the offset of the payload in @p packet, or 0 if the packet has no
+ * payload that could be processed.
+ */
+size_t get_payload_offset(
 	const pcap_pkthdr* pkthdr,
 	const u_char* packet)
 {
@@ -210,7 +533,7 @@ Word get_payload(
 	uint16_t ether_type = ntohs(eth_hdr->ether_type);
 	if (ETHERTYPE_VLAN == ether_type)
 	{
-		++vlan_packets;
+		vlan_packets.inc();
 
 		offset = sizeof(vlan_ethhdr);
 		const vlan_ethhdr* vlan_hdr = reinterpret_cast<const vlan_ethhdr*>(packet);
@@ -225,7 +548,7 @@ Word get_payload(
 
 	if (ETHERTYPE_IP == ether_type)
 	{
-		++ipv4_packets;
+		ipv4_packets.inc();
 
 		const ip* ip_hdr = reinterpret_cast<const ip*>(packet + offset);
 		offset += sizeof(ip);
@@ -233,7 +556,7 @@ Word get_payload(
 	}
 	else if (ETHERTYPE_IPV6 == ether_type)
 	{
-		++ipv6_packets;
+		ipv6_packets.inc();
 
 		const ip6_hdr* ip_hdr = reinterpret_cast<const ip6_hdr*>(packet + offset);
 		offset += sizeof(ip6_hdr);
@@ -241,8 +564,8 @@ Word get_payload(
 	}
 	else
 	{
-		++other_l3_packets;
-		return Word();
+		other_l3_packets.inc();
+		return 0;
 	}
 
 	bool ip_in_ip = false;
@@ -253,19 +576,19 @@ Word get_payload(
 		processing = false;
 		if (IPPROTO_TCP == l4_proto)
 		{
-			++tcp_packets;
+			tcp_packets.inc();
 			const tcphdr* tcp_hdr = reinterpret_cast<const tcphdr*>(packet + offset);
 			size_t tcp_hdr_size = tcp_hdr->th_off * 4;
 			offset += tcp_hdr_size;
 		}
 		else if (IPPROTO_UDP == l4_proto)
 		{
-			++udp_packets;
+			udp_packets.inc();
 			offset += sizeof(udphdr);
 		}
 		else if (IPPROTO_IPIP == l4_proto)
 		{
-			++ipip_packets;
+			ipip_packets.inc();
 
 			if (ip_in_ip) { assert(false); }
 
@@ -279,30 +602,30 @@ Word get_payload(
 		}
 		else if (IPPROTO_ESP == l4_proto)
 		{
-			++esp_packets;
+			esp_packets.inc();
 			offset += 8;
 		}
 		else if (IPPROTO_ICMP == l4_proto)
 		{
-			++icmp_packets;
+			icmp_packets.inc();
 
 			offset += sizeof(icmphdr);
 		}
 		else if (IPPROTO_GRE == l4_proto)
 		{
-			++gre_packets;
+			gre_packets.inc();
 
-			return Word();
+			return 0;
 		}
 		else if (IPPROTO_ICMPV6 == l4_proto)
 		{
-			++icmp6_packets;
+			icmp6_packets.inc();
 
 			offset += sizeof(icmp6_hdr);
 		}
 		else if (IPPROTO_FRAGMENT == l4_proto)
 		{
-			++v6_fragment_packets;
+			v6_fragment_packets.inc();
 
 			const ip6_frag* ip_hdr = reinterpret_cast<const ip6_frag*>(packet + offset);
 			offset += sizeof(ip6_frag);
@@ -312,7 +635,7 @@ Word get_payload(
 		}
 		else if (IPPROTO_IPV6 == l4_proto)
 		{
-			++ip6_in_ip4_packets;
+			ip6_in_ip4_packets.inc();
 
 			const ip6_hdr* ip_hdr = reinterpret_cast<const ip6_hdr*>(packet + offset);
 			offset += sizeof(ip6_hdr);
@@ -320,21 +643,32 @@ Word get_payload(
 		}
 		else if (IPPROTO_PIM == l4_proto)
 		{
-			++pim_packets;
+			pim_packets.inc();
 
-			return Word();
+			return 0;
 		}
 		else
 		{
 			std::cout << "L4 protocol over IPv4: " << l4_proto << "\n";
-			++other_l4_packets;
+			other_l4_packets.inc();
 			// std::cout << std::hex << static_cast<unsigned>(ip_hdr->ip_p) << std::dec << "\n";
 			// std::cout << static_cast<unsigned>(ip_hdr->ip_p) << "\n";
 
-			return Word();
+			return 0;
 		}
 	}
 
+	return offset;
+}
+
+
+Word get_payload(
+	const pcap_pkthdr* pkthdr,
+	const u_char* packet)
+{
+	size_t offset = get_payload_offset(pkthdr, packet);
+	if (0 == offset) { return Word(); }
+
 	return Word(packet + offset, packet + std::max(static_cast<size_t>(pkthdr->len), offset));
 	// return Word(packet + offset, packet + pkthdr->len);
 }
@@ -347,46 +681,80 @@ void packetHandler(
 	assert(nullptr != pkthdr);
 	assert(nullptr != packet);
 
-	++total_packets;
+	total_packets.inc();
+	total_bytes.add(pkthdr->len);
+	if (nullptr != reporter) { reporter->tick(); }
+
+	bool in_aut1;
+	bool in_aut2;
+	TimePoint match_start;
 
-	Word payload = get_payload(pkthdr, packet);
-	if (payload.empty())
+	if (nullptr != product)
 	{
-		return;
+		size_t offset = get_payload_offset(pkthdr, packet);
+		size_t payload_end = std::max(static_cast<size_t>(pkthdr->len), offset);
+		if (0 == offset || offset == payload_end)
+		{
+			return;
+		}
+
+		payloaded_packets.inc();
+		payload_bytes.add(payload_end - offset);
+
+		if (nullptr != reporter) { match_start = std::chrono::high_resolution_clock::now(); }
+
+		Outcome res = product->classify(packet + offset, packet + payload_end,
+			prefix_acceptance);
+		in_aut1 = (res & OUTCOME_ONLY_AUT1);
+		in_aut2 = (res & OUTCOME_ONLY_AUT2);
 	}
+	else
+	{
+		Word payload = get_payload(pkthdr, packet);
+		if (payload.empty())
+		{
+			return;
+		}
 
-	++payloaded_packets;
+		payloaded_packets.inc();
+		payload_bytes.add(payload.size());
 
-	// std::cout << std::to_string(payload);
+		if (nullptr != reporter) { match_start = std::chrono::high_resolution_clock::now(); }
 
-	bool in_aut1;
-	bool in_aut2;
+		// std::cout << std::to_string(payload);
 
-	if (prefix_acceptance)
-	{
-		in_aut1 = is_prfx_in_lang(aut1, payload);
-		in_aut2 = is_prfx_in_lang(aut2, payload);
+		if (prefix_acceptance)
+		{
+			in_aut1 = is_prfx_in_lang(aut1, payload);
+			in_aut2 = is_prfx_in_lang(aut2, payload);
+		}
+		else
+		{
+			in_aut1 = is_in_lang(aut1, payload);
+			in_aut2 = is_in_lang(aut2, payload);
+		}
 	}
-	else
+
+	if (nullptr != reporter)
 	{
-		in_aut1 = is_in_lang(aut1, payload);
-		in_aut2 = is_in_lang(aut2, payload);
+		match_latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::high_resolution_clock::now() - match_start).count());
 	}
 
-	if (in_aut1) { ++accepted_aut1; }
-	if (in_aut2) { ++accepted_aut2; }
+	if (in_aut1) { accepted_aut1.inc(); }
+	if (in_aut2) { accepted_aut2.inc(); }
 
 	if (in_aut1 != in_aut2)
 	{
-		++incons_packets;
+		incons_packets.inc();
 
 		if (in_aut1 && !in_aut2)
 		{
-			++accepted_aut1_not_aut2;
+			accepted_aut1_not_aut2.inc();
 		}
 		else if (in_aut2 && !in_aut1)
 		{
-			++accepted_aut2_not_aut1;
+			accepted_aut2_not_aut1.inc();
 		}
 		else
 		{
@@ -394,7 +762,17 @@ void packetHandler(
 		}
 	}
 
-	if (total_packets % 10000 == 0)
+	if (nullptr != dump_descr)
+	{
+		size_t res = (in_aut1? OUTCOME_ONLY_AUT1 : 0) | (in_aut2? OUTCOME_ONLY_AUT2 : 0);
+		if (dumped_cnt[res] < dump_max)
+		{
+			++dumped_cnt[res];
+			pcap_dump(reinterpret_cast<u_char*>(dumpers[res]), pkthdr, packet);
+		}
+	}
+
+	if (total_packets.get() % 10000 == 0)
 	{
 		std::clog << "#";
 		std::clog.flush();
@@ -0,0 +1,269 @@
+// flow-classifier.hh - routing of packets to rules according to their flow
+// attributes (L4 protocol, ports, VLAN)
+//
+// The classifier is configured by a .vtf file with a section of the type
+// @FLOWS, every line of whose body is a rule of the form
+//
+//   <proto> <ports> <vlan> <target>
+//
+// where
+//   <proto>   is one of 'tcp', 'udp', 'other', or 'any',
+//   <ports>   is 'any' or a comma-separated list of ports and port ranges
+//             (e.g. '80,8000-8080'); a packet matches if its source or its
+//             destination port is in the list,
+//   <vlan>    is 'any', 'none' (packets without a VLAN tag), or
+//             a comma-separated list of VLAN IDs and ranges of VLAN IDs,
+//   <target>  is the name of the automaton (typically a .vtf file) the
+//             matching packets are to be checked against.
+//
+// For example:
+//
+//   @FLOWS
+//   # proto  ports         vlan  target
+//   tcp      80,8000-8080  any   http.vtf
+//   udp      53            any   dns.vtf
+//   any      any           12    vlan12.vtf
+//
+// A packet is routed to the targets of *all* rules it matches.  The
+// classification does not go through the rules one by one: for every
+// dimension (protocol, port, VLAN), the set of rules matching a given value is
+// precomputed in a lookup table as a bit vector, so the classification of
+// a packet is just three table lookups and a bitwise conjunction.
+
+#ifndef _VATA2_EXAMPLES_FLOW_CLASSIFIER_HH_
+#define _VATA2_EXAMPLES_FLOW_CLASSIFIER_HH_
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <netinet/in.h>
+
+#include <vata2/parser.hh>
+#include <vata2/util.hh>
+
+/// attributes of a flow a packet belongs to
+struct FlowKey
+{
+	/// L4 protocol (IPPROTO_*)
+	unsigned l4_proto;
+	/// do the ports below have a meaning (i.e., is it a TCP or UDP packet)?
+	bool has_ports;
+	uint16_t src_port;
+	uint16_t dst_port;
+	/// VLAN ID, or FlowKey::NO_VLAN for untagged packets
+	uint16_t vlan;
+
+	static const uint16_t NO_VLAN = 4096;
+
+	FlowKey() : l4_proto(0), has_ports(false), src_port(0), dst_port(0), vlan(NO_VLAN) { }
+};
+
+
+/// Classifies packets into sets of rules according to their flow attributes
+class FlowClassifier
+{
+public:
+
+	/// a set of rules (or targets), as a bit vector
+	using Mask = uint64_t;
+
+	/// maximum number of rules (given by the width of Mask)
+	static const size_t MAX_RULES = 64;
+
+	/// the type of the section in the .vtf file
+	static const char* type_name() { return "FLOWS"; }
+
+private:
+
+	enum ProtoClass { PROTO_TCP = 0, PROTO_UDP = 1, PROTO_OTHER = 2, PROTO_CLASSES = 3 };
+
+	static const size_t NUM_PORTS = 65536;
+	static const size_t NUM_VLANS = FlowKey::NO_VLAN + 1;
+
+	/// lookup tables: rules matching a given value of a dimension
+	Mask proto_table[PROTO_CLASSES] = { 0, 0, 0 };
+	std::vector<Mask> port_table = std::vector<Mask>(NUM_PORTS, 0);
+	std::vector<Mask> vlan_table = std::vector<Mask>(NUM_VLANS, 0);
+	/// rules matching packets without ports (i.e., rules with 'any' ports)
+	Mask portless_rules = 0;
+
+	/// names of targets and the target of every rule
+	std::vector<std::string> targets = { };
+	std::vector<size_t> rule_target = { };
+
+private:
+
+	static size_t parse_number(const std::string& str, size_t max)
+	{ // {{{
+		std::istringstream stream(str);
+		size_t value;
+		if (!(stream >> value) || !stream.eof() || value > max)
+		{
+			throw std::runtime_error("invalid number \"" + str + "\" in a flow rule");
+		}
+
+		return value;
+	} // parse_number }}}
+
+	/// calls @p f on every value in a comma-separated list of values and ranges
+	template <class Func>
+	static void for_each_in_list(const std::string& str, size_t max, Func f)
+	{ // {{{
+		std::istringstream stream(str);
+		std::string item;
+		while (std::getline(stream, item, ','))
+		{
+			size_t dash = item.find('-');
+			size_t low, high;
+			if (std::string::npos == dash)
+			{
+				low = high = parse_number(item, max);
+			}
+			else
+			{
+				low = parse_number(item.substr(0, dash), max);
+				high = parse_number(item.substr(dash + 1), max);
+			}
+
+			if (low > high)
+			{
+				throw std::runtime_error("invalid range \"" + item + "\" in a flow rule");
+			}
+
+			for (size_t val = low; val <= high; ++val) { f(val); }
+		}
+	} // for_each_in_list }}}
+
+	void add_rule(const Vata2::Parser::BodyLine& line)
+	{ // {{{
+		if (line.size() != 4)
+		{
+			throw std::runtime_error("invalid flow rule: " + std::to_string(line) +
+				" (expecting <proto> <ports> <vlan> <target>)");
+		}
+
+		size_t rule = this->rule_target.size();
+		if (rule >= MAX_RULES)
+		{
+			throw std::runtime_error("too many flow rules (the maximum is " +
+				std::to_string(MAX_RULES) + ")");
+		}
+
+		const Mask bit = static_cast<Mask>(1) << rule;
+
+		const std::string& proto = line[0];
+		if ("tcp" == proto) { this->proto_table[PROTO_TCP] |= bit; }
+		else if ("udp" == proto) { this->proto_table[PROTO_UDP] |= bit; }
+		else if ("other" == proto) { this->proto_table[PROTO_OTHER] |= bit; }
+		else if ("any" == proto)
+		{
+			for (Mask& mask : this->proto_table) { mask |= bit; }
+		}
+		else
+		{
+			throw std::runtime_error("invalid protocol \"" + proto + "\" in a flow rule");
+		}
+
+		const std::string& ports = line[1];
+		if ("any" == ports)
+		{
+			for (Mask& mask : this->port_table) { mask |= bit; }
+			this->portless_rules |= bit;
+		}
+		else
+		{
+			for_each_in_list(ports, NUM_PORTS - 1,
+				[this, bit](size_t port) { this->port_table[port] |= bit; });
+		}
+
+		const std::string& vlans = line[2];
+		if ("any" == vlans)
+		{
+			for (Mask& mask : this->vlan_table) { mask |= bit; }
+		}
+		else if ("none" == vlans)
+		{
+			this->vlan_table[FlowKey::NO_VLAN] |= bit;
+		}
+		else
+		{
+			for_each_in_list(vlans, FlowKey::NO_VLAN - 1,
+				[this, bit](size_t vlan) { this->vlan_table[vlan] |= bit; });
+		}
+
+		const std::string& target = line[3];
+		auto it = std::find(this->targets.begin(), this->targets.end(), target);
+		this->rule_target.push_back(it - this->targets.begin());
+		if (this->targets.end() == it) { this->targets.push_back(target); }
+	} // add_rule }}}
+
+public:
+
+	FlowClassifier() { }
+
+	/// constructs the classifier from a parsed @FLOWS section
+	explicit FlowClassifier(const Vata2::Parser::ParsedSection& parsec) : FlowClassifier()
+	{ // {{{
+		if (parsec.type != type_name())
+		{
+			throw std::runtime_error("expecting a section of type @" +
+				std::string(type_name()) + ", got @" + parsec.type);
+		}
+
+		for (const auto& line : parsec.body) { this->add_rule(line); }
+	} // }}}
+
+	/// loads the classifier from a .vtf file
+	static FlowClassifier load(const std::string& file_name)
+	{ // {{{
+		std::ifstream input(file_name);
+		if (!input.is_open())
+		{
+			throw std::runtime_error("Cannot open file " + file_name);
+		}
+
+		return FlowClassifier(Vata2::Parser::parse_vtf_section(input));
+	} // load }}}
+
+	/// the number of rules
+	size_t num_rules() const { return this->rule_target.size(); }
+
+	/// names of targets (indexed by the numbers used in target masks)
+	const std::vector<std::string>& get_targets() const { return this->targets; }
+
+	/// the set of rules matching a flow
+	Mask classify(const FlowKey& key) const
+	{ // {{{
+		Mask proto_mask;
+		if (IPPROTO_TCP == key.l4_proto) { proto_mask = this->proto_table[PROTO_TCP]; }
+		else if (IPPROTO_UDP == key.l4_proto) { proto_mask = this->proto_table[PROTO_UDP]; }
+		else { proto_mask = this->proto_table[PROTO_OTHER]; }
+
+		Mask port_mask = this->portless_rules;
+		if (key.has_ports)
+		{
+			port_mask = this->port_table[key.src_port] | this->port_table[key.dst_port];
+		}
+
+		return proto_mask & port_mask & this->vlan_table[key.vlan];
+	} // classify }}}
+
+	/// translates a set of rules into the set of their targets
+	Mask targets_of(Mask rules) const
+	{ // {{{
+		Mask result = 0;
+		for (size_t rule = 0; 0 != rules; ++rule, rules >>= 1)
+		{
+			if (rules & 1) { result |= static_cast<Mask>(1) << this->rule_target[rule]; }
+		}
+
+		return result;
+	} // targets_of }}}
+}; // FlowClassifier
+
+#endif /* _VATA2_EXAMPLES_FLOW_CLASSIFIER_HH_ */
@@ -0,0 +1,462 @@
+// metrics.hh - in-process metrics of the pcap tools (counters, latency
+// histograms, rates) with periodic snapshots
+//
+// A MetricsRegistry holds named counters and histograms.  Counters are plain
+// integers and histograms use HDR-style log-linear buckets (a fixed array
+// indexed by the position of the most significant bit and the following
+// SUB_BUCKET_BITS bits of the value), so recording a value is a few
+// arithmetic instructions and an increment, with the relative error of
+// reported quantiles below 1/2^SUB_BUCKET_BITS.
+//
+// A MetricsReporter writes snapshots of a registry (including packets/s,
+// bytes/s etc. of every counter, both since the last snapshot and on average)
+// periodically to a file or to a Unix socket, in JSON or in the Prometheus
+// text format.  To keep the cost on the hot path negligible, the clock is
+// consulted only on every CHECK_PERIOD-th call of tick().  Files are written
+// to a temporary file first and then renamed, so readers never see
+// a partially written snapshot; for a Unix socket (given as unix:PATH), the
+// reporter connects to a listening stream socket at PATH, sends the snapshot,
+// and disconnects.
+//
+// The tools take the following options (see extract_metrics_options()):
+//
+//   --metrics DEST              write snapshots to DEST (a file or unix:PATH)
+//   --metrics-format FORMAT     'json' (default) or 'prometheus'
+//   --metrics-interval SECONDS  time between snapshots (default 1)
+
+#ifndef _VATA2_EXAMPLES_METRICS_HH_
+#define _VATA2_EXAMPLES_METRICS_HH_
+
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/// a monotonically increasing counter
+class Counter
+{
+private:
+
+	std::string name;
+	std::string help;
+	uint64_t value = 0;
+
+public:
+
+	Counter(const std::string& name, const std::string& help) :
+		name(name), help(help)
+	{ }
+
+	void inc() { ++this->value; }
+	void add(uint64_t n) { this->value += n; }
+	uint64_t get() const { return this->value; }
+
+	const std::string& get_name() const { return this->name; }
+	const std::string& get_help() const { return this->help; }
+}; // Counter
+
+
+/// a histogram of (non-negative integer) values with HDR-style buckets
+class Histogram
+{
+public:
+
+	/// number of bits of a value kept below its most significant bit
+	static const unsigned SUB_BUCKET_BITS = 6;
+
+private:
+
+	static const uint64_t SUB_BUCKET_HALF = static_cast<uint64_t>(1) << SUB_BUCKET_BITS;
+	static const uint64_t SUB_BUCKET_COUNT = 2 * SUB_BUCKET_HALF;
+	static const size_t NUM_BUCKETS =
+		SUB_BUCKET_COUNT + (64 - SUB_BUCKET_BITS - 1) * SUB_BUCKET_HALF;
+
+	std::string name;
+	std::string help;
+	std::vector<uint64_t> buckets = std::vector<uint64_t>(NUM_BUCKETS, 0);
+	uint64_t count = 0;
+	uint64_t sum = 0;
+	uint64_t min = UINT64_MAX;
+	uint64_t max = 0;
+
+	static size_t bucket_of(uint64_t value)
+	{ // {{{
+		if (value < SUB_BUCKET_COUNT) { return value; }
+
+		unsigned msb = 63 - __builtin_clzll(value);
+		unsigned shift = msb - SUB_BUCKET_BITS;
+		return SUB_BUCKET_COUNT + (shift - 1) * SUB_BUCKET_HALF +
+			((value >> shift) - SUB_BUCKET_HALF);
+	} // bucket_of }}}
+
+	/// the highest value falling into a bucket
+	static uint64_t bucket_high(size_t bucket)
+	{ // {{{
+		if (bucket < SUB_BUCKET_COUNT) { return bucket; }
+
+		unsigned shift = (bucket - SUB_BUCKET_COUNT) / SUB_BUCKET_HALF + 1;
+		uint64_t sub = (bucket - SUB_BUCKET_COUNT) % SUB_BUCKET_HALF + SUB_BUCKET_HALF;
+		return ((sub + 1) << shift) - 1;
+	} // bucket_high }}}
+
+public:
+
+	Histogram(const std::string& name, const std::string& help) :
+		name(name), help(help)
+	{ }
+
+	void record(uint64_t value)
+	{ // {{{
+		++this->buckets[bucket_of(value)];
+		++this->count;
+		this->sum += value;
+		if (value < this->min) { this->min = value; }
+		if (value > this->max) { this->max = value; }
+	} // record }}}
+
+	/// the value at quantile @p q (from [0,1]), up to the bucket precision
+	uint64_t quantile(double q) const
+	{ // {{{
+		if (0 == this->count) { return 0; }
+
+		uint64_t rank = static_cast<uint64_t>(q * this->count);
+		if (rank >= this->count) { rank = this->count - 1; }
+
+		uint64_t seen = 0;
+		for (size_t i = 0; i < NUM_BUCKETS; ++i)
+		{
+			seen += this->buckets[i];
+			if (seen > rank) { return std::min(bucket_high(i), this->max); }
+		}
+
+		return this->max;
+	} // quantile }}}
+
+	uint64_t get_count() const { return this->count; }
+	uint64_t get_sum() const { return this->sum; }
+	uint64_t get_min() const { return (0 == this->count)? 0 : this->min; }
+	uint64_t get_max() const { return this->max; }
+
+	const std::string& get_name() const { return this->name; }
+	const std::string& get_help() const { return this->help; }
+}; // Histogram
+
+
+/// a registry of metrics of a tool
+class MetricsRegistry
+{
+private:
+
+	// deques keep references to their elements valid
+	std::deque<Counter> counters = { };
+	std::deque<Histogram> histograms = { };
+
+public:
+
+	Counter& counter(const std::string& name, const std::string& help)
+	{ // {{{
+		this->counters.emplace_back(name, help);
+		return this->counters.back();
+	} // counter }}}
+
+	Histogram& histogram(const std::string& name, const std::string& help)
+	{ // {{{
+		this->histograms.emplace_back(name, help);
+		return this->histograms.back();
+	} // histogram }}}
+
+	const std::deque<Counter>& get_counters() const { return this->counters; }
+	const std::deque<Histogram>& get_histograms() const { return this->histograms; }
+}; // MetricsRegistry
+
+
+/// configuration of a MetricsReporter
+struct MetricsConfig
+{
+	/// destination (a file or unix:PATH); empty means no reporting
+	std::string destination = "";
+	/// 'json' or 'prometheus'
+	std::string format = "json";
+	double interval = 1.0;
+};
+
+
+/**
+ * @brief  Removes the --metrics* options from the command line
+ *
+ * Recognized options are stored into @p config and removed from @p argv, so
+ * that the rest of the command line can be processed as usual.
+ *
+ * @returns  The new number of arguments
+ */
+inline int extract_metrics_options(int argc, char** argv, MetricsConfig* config)
+{ // {{{
+	assert(nullptr != config);
+
+	int out = 1;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string opt = argv[i];
+		if (("--metrics" != opt) && ("--metrics-format" != opt) &&
+			("--metrics-interval" != opt))
+		{
+			argv[out++] = argv[i];
+			continue;
+		}
+
+		if (i + 1 >= argc)
+		{
+			throw std::runtime_error("missing value of " + opt);
+		}
+
+		std::string value = argv[++i];
+		if ("--metrics" == opt) { config->destination = value; }
+		else if ("--metrics-format" == opt)
+		{
+			if (("json" != value) && ("prometheus" != value))
+			{
+				throw std::runtime_error("invalid metrics format \"" + value + "\"");
+			}
+
+			config->format = value;
+		}
+		else
+		{
+			std::istringstream stream(value);
+			if (!(stream >> config->interval) || !stream.eof() || config->interval <= 0)
+			{
+				throw std::runtime_error("invalid metrics interval \"" + value + "\"");
+			}
+		}
+	}
+
+	argv[out] = nullptr;
+	return out;
+} // extract_metrics_options }}}
+
+
+/// periodically writes snapshots of a registry
+class MetricsReporter
+{
+public:
+
+	/// the clock is checked on every CHECK_PERIOD-th tick
+	static const uint64_t CHECK_PERIOD = 1024;
+
+private:
+
+	using Clock = std::chrono::steady_clock;
+
+	const MetricsRegistry& registry;
+	MetricsConfig config;
+
+	Clock::time_point start_time;
+	Clock::time_point last_time;
+	Clock::time_point next_time;
+	uint64_t ticks = 0;
+	size_t snapshots = 0;
+	bool reported_failure = false;
+
+	/// values of counters at the time of the last snapshot
+	std::vector<uint64_t> last_values = { };
+
+	static std::string sanitize(const std::string& name)
+	{ // {{{
+		std::string result = name;
+		for (char& c : result)
+		{
+			if (!isalnum(static_cast<unsigned char>(c))) { c = '_'; }
+		}
+
+		return result;
+	} // sanitize }}}
+
+	void write_json(std::ostream& os, double elapsed, double period) const
+	{ // {{{
+		os << "{\"snapshot\": " << this->snapshots << ", \"elapsed_seconds\": " << elapsed;
+		os << ", \"counters\": {";
+		size_t i = 0;
+		for (const Counter& cnt : this->registry.get_counters())
+		{
+			uint64_t value = cnt.get();
+			uint64_t last = (i < this->last_values.size())? this->last_values[i] : 0;
+			os << ((0 == i)? "" : ", ") << "\"" << cnt.get_name() << "\": {";
+			os << "\"value\": " << value;
+			os << ", \"rate_per_second\": " << ((period > 0)? (value - last) / period : 0.0);
+			os << ", \"avg_rate_per_second\": " << ((elapsed > 0)? value / elapsed : 0.0);
+			os << "}";
+			++i;
+		}
+
+		os << "}, \"histograms\": {";
+		bool first = true;
+		for (const Histogram& hist : this->registry.get_histograms())
+		{
+			os << (first? "" : ", ") << "\"" << hist.get_name() << "\": {";
+			os << "\"count\": " << hist.get_count();
+			os << ", \"sum\": " << hist.get_sum();
+			os << ", \"min\": " << hist.get_min();
+			os << ", \"max\": " << hist.get_max();
+			os << ", \"p50\": " << hist.quantile(0.5);
+			os << ", \"p90\": " << hist.quantile(0.9);
+			os << ", \"p99\": " << hist.quantile(0.99);
+			os << ", \"p999\": " << hist.quantile(0.999);
+			os << "}";
+			first = false;
+		}
+
+		os << "}}\n";
+	} // write_json }}}
+
+	void write_prometheus(std::ostream& os, double elapsed, double period) const
+	{ // {{{
+		os << "# HELP vata_elapsed_seconds Time since the start of processing.\n";
+		os << "# TYPE vata_elapsed_seconds gauge\n";
+		os << "vata_elapsed_seconds " << elapsed << "\n";
+
+		size_t i = 0;
+		for (const Counter& cnt : this->registry.get_counters())
+		{
+			std::string name = "vata_" + sanitize(cnt.get_name());
+			uint64_t value = cnt.get();
+			uint64_t last = (i < this->last_values.size())? this->last_values[i] : 0;
+			os << "# HELP " << name << "_total " << cnt.get_help() << "\n";
+			os << "# TYPE " << name << "_total counter\n";
+			os << name << "_total " << value << "\n";
+			os << "# HELP " << name << "_per_second Rate since the last snapshot.\n";
+			os << "# TYPE " << name << "_per_second gauge\n";
+			os << name << "_per_second " << ((period > 0)? (value - last) / period : 0.0) << "\n";
+			++i;
+		}
+
+		for (const Histogram& hist : this->registry.get_histograms())
+		{
+			std::string name = "vata_" + sanitize(hist.get_name());
+			os << "# HELP " << name << " " << hist.get_help() << "\n";
+			os << "# TYPE " << name << " summary\n";
+			for (double q : {0.5, 0.9, 0.99, 0.999})
+			{
+				os << name << "{quantile=\"" << q << "\"} " << hist.quantile(q) << "\n";
+			}
+
+			os << name << "_sum " << hist.get_sum() << "\n";
+			os << name << "_count " << hist.get_count() << "\n";
+		}
+	} // write_prometheus }}}
+
+	bool send(const std::string& data) const
+	{ // {{{
+		const std::string UNIX_PREFIX = "unix:";
+		const std::string& dest = this->config.destination;
+		if (0 == dest.compare(0, UNIX_PREFIX.size(), UNIX_PREFIX))
+		{
+			std::string path = dest.substr(UNIX_PREFIX.size());
+			sockaddr_un addr;
+			memset(&addr, 0, sizeof(addr));
+			addr.sun_family = AF_UNIX;
+			if (path.size() >= sizeof(addr.sun_path)) { return false; }
+			strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+			int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+			if (fd < 0) { return false; }
+
+			bool ok = (0 == connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)));
+			for (size_t sent = 0; ok && sent < data.size(); )
+			{
+				ssize_t res = write(fd, data.data() + sent, data.size() - sent);
+				ok = (res > 0);
+				if (ok) { sent += res; }
+			}
+
+			close(fd);
+			return ok;
+		}
+
+		std::string tmp = dest + ".tmp";
+		{
+			std::ofstream output(tmp);
+			if (!output.is_open()) { return false; }
+			output << data;
+			if (!output.good()) { return false; }
+		}
+
+		return 0 == std::rename(tmp.c_str(), dest.c_str());
+	} // send }}}
+
+public:
+
+	MetricsReporter(const MetricsRegistry& registry, const MetricsConfig& config) :
+		registry(registry),
+		config(config),
+		start_time(Clock::now()),
+		last_time(start_time),
+		next_time(start_time + this->interval())
+	{ }
+
+	MetricsReporter(const MetricsReporter&) = delete;
+	MetricsReporter& operator=(const MetricsReporter&) = delete;
+
+	Clock::duration interval() const
+	{
+		return std::chrono::duration_cast<Clock::duration>(
+			std::chrono::duration<double>(this->config.interval));
+	}
+
+	/// writes a snapshot if the interval has elapsed; cheap to call often
+	void tick()
+	{ // {{{
+		if (0 != (++this->ticks % CHECK_PERIOD)) { return; }
+
+		if (Clock::now() >= this->next_time) { this->snapshot(); }
+	} // tick }}}
+
+	/// writes a snapshot now
+	void snapshot()
+	{ // {{{
+		Clock::time_point now = Clock::now();
+		double elapsed = std::chrono::duration<double>(now - this->start_time).count();
+		double period = std::chrono::duration<double>(now - this->last_time).count();
+
+		std::ostringstream data;
+		if ("prometheus" == this->config.format)
+		{
+			this->write_prometheus(data, elapsed, period);
+		}
+		else
+		{
+			this->write_json(data, elapsed, period);
+		}
+
+		if (!this->send(data.str()) && !this->reported_failure)
+		{
+			std::cerr << "Warning: cannot write metrics to " << this->config.destination << "\n";
+			this->reported_failure = true;
+		}
+
+		this->last_values.clear();
+		for (const Counter& cnt : this->registry.get_counters())
+		{
+			this->last_values.push_back(cnt.get());
+		}
+
+		++this->snapshots;
+		this->last_time = now;
+		this->next_time = now + this->interval();
+	} // snapshot }}}
+}; // MetricsReporter
+
+#endif /* _VATA2_EXAMPLES_METRICS_HH_ */
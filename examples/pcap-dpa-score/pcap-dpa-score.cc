@@ -0,0 +1,440 @@
+// pcap-dpa-score.cc - scores packets from a PCAP file against a learned
+// probabilistic automaton (e.g. one produced by prob-lo-mizer)
+//
+// The automaton (a @DPA section) is compiled into dense tables of
+// log-probabilities; payloads are collected into batches, and every batch is
+// scored by CompiledDpa::score_batch(), which splits it among the threads of
+// the pool of the library (Vata2::parallel).  Packets can be written into
+// a PCAP file if their log-likelihood is below a threshold (i.e., if they are
+// unlikely according to the model).
+
+#include <vata2/util.hh>
+#include <vata2/dpa.hh>
+#include <vata2/parallel.hh>
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <fstream>
+#include <limits>
+
+// PCAP-related headers
+#include <pcap.h>
+#include <net/ethernet.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <netinet/ip_icmp.h>
+#include <netinet/ip6.h>
+#include <netinet/icmp6.h>
+#include <netinet/tcp.h>
+#include <netinet/udp.h>
+
+// Ethernet 802.1Q header
+// copied from
+// https://stackoverflow.com/questions/13166094/build-vlan-header-in-c
+struct vlan_ethhdr {
+	u_int8_t  ether_dhost[ETH_ALEN];  /* destination eth addr */
+	u_int8_t  ether_shost[ETH_ALEN];  /* source ether addr    */
+	u_int16_t h_vlan_proto;
+	u_int16_t h_vlan_TCI;
+	u_int16_t ether_type;
+} __attribute__ ((__packed__));
+
+using namespace Vata2::Dpa;
+using namespace Vata2::Parser;
+
+using TimePoint = std::chrono::time_point<std::chrono::high_resolution_clock>;
+
+// FUNCTION DECLARATIONS
+void packetHandler(u_char *userData, const pcap_pkthdr* pkthdr, const u_char* packet);
+void process_batch();
+
+/// a packet waiting in a batch
+struct Packet
+{
+	pcap_pkthdr hdr;
+	std::vector<u_char> data;
+	size_t number;
+};
+
+// GLOBAL VARIABLES
+size_t total_packets = 0;
+size_t payloaded_packets = 0;
+size_t impossible_packets = 0;
+size_t below_packets = 0;
+double sum_scores = 0.0;
+LogProb min_score = std::numeric_limits<LogProb>::infinity();
+LogProb max_score = -std::numeric_limits<LogProb>::infinity();
+
+bool prefix_scores = false;
+bool print_scores = false;
+bool use_threshold = false;
+LogProb threshold = 0.0;
+size_t batch_size = 4096;
+
+CompiledDpa model;
+pcap_dumper_t* dumper = nullptr;
+
+std::vector<Packet> batch_packets;
+std::vector<Word> batch_payloads;
+std::vector<LogProb> batch_scores;
+
+
+void print_usage(const char* prog_name)
+{
+	std::cout << "usage: " << prog_name << " [-p] [-s] [-j N] [--batch N] "
+		"[--below T [--dump out.pcap]] <model.vtf> <input.pcap>\n";
+	std::cout << "\n";
+	std::cout << "Computes log-likelihoods of payloads of packets in input.pcap\n";
+	std::cout << "according to the probabilistic automaton in model.vtf\n";
+	std::cout << "\n";
+	std::cout << "Options:\n";
+	std::cout << "  -p              prefix scores (ignore final probabilities)\n";
+	std::cout << "  -s              print the score of every packet with payload\n";
+	std::cout << "  -j N            use N threads (default: VATA_THREADS or the number of CPUs)\n";
+	std::cout << "  --batch N       the number of packets scored together (default: "
+		<< batch_size << ")\n";
+	std::cout << "  --below T       count packets with log-likelihood below T\n";
+	std::cout << "  --dump out.pcap write packets with log-likelihood below T to out.pcap\n";
+}
+
+Dpa load_model(const std::string& file_name)
+{
+	std::ifstream input(file_name);
+	if (input.is_open())
+	{
+		ParsedSection parsec = parse_vtf_section(input);
+		Vata2::Nfa::CharAlphabet alphabet;
+		return Vata2::Dpa::construct(parsec, &alphabet);
+	}
+	else
+	{
+		throw std::runtime_error("Cannot open file " + file_name);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	// PARSING COMMAND LINE ARGUMENTS
+	std::string dump_file;
+	int param_start = 1;
+	try
+	{
+		while (param_start < argc && argv[param_start][0] == '-')
+		{
+			std::string opt = argv[param_start];
+			if ("-p" == opt) { prefix_scores = true; }
+			else if ("-s" == opt) { print_scores = true; }
+			else if ((("-j" == opt) || ("--batch" == opt) || ("--below" == opt) ||
+				("--dump" == opt)) && (param_start + 1 < argc))
+			{
+				std::string value = argv[++param_start];
+				std::istringstream stream(value);
+				bool ok = true;
+				if ("--dump" == opt) { dump_file = value; }
+				else if ("--below" == opt)
+				{
+					ok = static_cast<bool>(stream >> threshold) && stream.eof();
+					use_threshold = true;
+				}
+				else
+				{
+					size_t number;
+					ok = (stream >> number) && stream.eof() && number > 0;
+					if ("-j" == opt) {
+						Vata2::parallel::ThreadPool::get().configure({{"threads", value}});
+					}
+					else { batch_size = number; }
+				}
+
+				if (!ok) { throw std::runtime_error("invalid value of " + opt + ": " + value); }
+			}
+			else
+			{
+				print_usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+
+			++param_start;
+		}
+	}
+	catch (const std::exception& ex)
+	{
+		std::cerr << "Error: " << ex.what() << "\n";
+		return EXIT_FAILURE;
+	}
+
+	if (argc - param_start != 2 || (!dump_file.empty() && !use_threshold))
+	{
+		print_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	// LOADING INPUTS
+	std::string model_file = argv[param_start + 0];
+	std::string packets_file = argv[param_start + 1];
+
+	try
+	{
+		model = CompiledDpa(load_model(model_file));
+	}
+	catch (const std::exception& ex)
+	{
+		std::cerr << "Error loading the model: " << ex.what() << "\n";
+		return EXIT_FAILURE;
+	}
+
+	pcap_t *descr = nullptr;
+	char errbuf[PCAP_ERRBUF_SIZE];
+
+	// open capture file for offline processing
+	descr = pcap_open_offline(packets_file.c_str(), errbuf);
+	if (nullptr == descr)
+	{
+		std::cout << "pcap_open_offline() failed: " << errbuf << "\n";
+		return EXIT_FAILURE;
+	}
+
+	if (!dump_file.empty())
+	{
+		dumper = pcap_dump_open(descr, dump_file.c_str());
+		if (nullptr == dumper)
+		{
+			std::cout << "pcap_dump_open() failed: " << pcap_geterr(descr);
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::cout.precision(std::numeric_limits<double>::max_digits10);
+
+	TimePoint startTime = std::chrono::high_resolution_clock::now();
+
+	// start packet processing loop, just like live capture
+	if (pcap_loop(descr, 0, packetHandler, nullptr) < 0)
+	{
+		std::cout << "pcap_loop() failed: " << pcap_geterr(descr);
+		return EXIT_FAILURE;
+	}
+
+	process_batch();
+
+	if (nullptr != dumper) { pcap_dump_close(dumper); }
+
+	TimePoint finishTime = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> opTime = finishTime - startTime;
+
+	size_t possible_packets = payloaded_packets - impossible_packets;
+
+	std::cout << "\n";
+	std::cout << "Model states: " << model.num_states() << "\n";
+	std::cout << "Threads: " << Vata2::parallel::get_parallelism({}) << "\n";
+	std::cout << "Total packets in " << packets_file << ": " << total_packets << "\n";
+	std::cout << "Packets with payload: " << payloaded_packets << "\n";
+	std::cout << "Packets impossible in the model: " << impossible_packets << "\n";
+	if (0 != possible_packets)
+	{
+		std::cout << "Average log-likelihood: " << sum_scores / possible_packets << "\n";
+		std::cout << "Minimum log-likelihood: " << min_score << "\n";
+		std::cout << "Maximum log-likelihood: " << max_score << "\n";
+	}
+	if (use_threshold)
+	{
+		std::cout << "Packets with log-likelihood below " << threshold << ": " <<
+			below_packets << "\n";
+	}
+	std::cout << "Time: " <<
+		std::chrono::duration_cast<std::chrono::nanoseconds>(opTime).count() * 1e-9
+		<< "\n";
+
+	return EXIT_SUCCESS;
+}
+
+
+/**
+ * @brief  Retrieves payload from a packet
+ */
+Word get_payload(
+	const pcap_pkthdr* pkthdr,
+	const u_char* packet)
+{
+	assert(nullptr != pkthdr);
+	assert(nullptr != packet);
+
+	size_t offset = sizeof(ether_header);
+	const ether_header* eth_hdr = reinterpret_cast<const ether_header*>(packet);
+	uint16_t ether_type = ntohs(eth_hdr->ether_type);
+	if (ETHERTYPE_VLAN == ether_type)
+	{
+		offset = sizeof(vlan_ethhdr);
+		const vlan_ethhdr* vlan_hdr = reinterpret_cast<const vlan_ethhdr*>(packet);
+		ether_type = ntohs(vlan_hdr->ether_type);
+	}
+
+	unsigned l4_proto;
+
+	if (ETHERTYPE_IP == ether_type)
+	{
+		const ip* ip_hdr = reinterpret_cast<const ip*>(packet + offset);
+		offset += sizeof(ip);
+		l4_proto = ip_hdr->ip_p;
+	}
+	else if (ETHERTYPE_IPV6 == ether_type)
+	{
+		const ip6_hdr* ip_hdr = reinterpret_cast<const ip6_hdr*>(packet + offset);
+		offset += sizeof(ip6_hdr);
+		l4_proto = ip_hdr->ip6_nxt;
+	}
+	else
+	{
+		return Word();
+	}
+
+	bool ip_in_ip = false;
+
+	bool processing = true;
+	while (processing)
+	{
+		processing = false;
+		if (IPPROTO_TCP == l4_proto)
+		{
+			const tcphdr* tcp_hdr = reinterpret_cast<const tcphdr*>(packet + offset);
+			size_t tcp_hdr_size = tcp_hdr->th_off * 4;
+			offset += tcp_hdr_size;
+		}
+		else if (IPPROTO_UDP == l4_proto)
+		{
+			offset += sizeof(udphdr);
+		}
+		else if (IPPROTO_IPIP == l4_proto)
+		{
+			if (ip_in_ip) { assert(false); }
+
+			ip_in_ip = true;
+
+			const ip* ip_hdr = reinterpret_cast<const ip*>(packet + offset);
+			offset += sizeof(ip);
+			l4_proto = ip_hdr->ip_p;
+
+			processing = true;
+		}
+		else if (IPPROTO_ESP == l4_proto)
+		{
+			offset += 8;
+		}
+		else if (IPPROTO_ICMP == l4_proto)
+		{
+			offset += sizeof(icmphdr);
+		}
+		else if (IPPROTO_GRE == l4_proto)
+		{
+			return Word();
+		}
+		else if (IPPROTO_ICMPV6 == l4_proto)
+		{
+			offset += sizeof(icmp6_hdr);
+		}
+		else if (IPPROTO_FRAGMENT == l4_proto)
+		{
+			const ip6_frag* ip_hdr = reinterpret_cast<const ip6_frag*>(packet + offset);
+			offset += sizeof(ip6_frag);
+			l4_proto = ip_hdr->ip6f_nxt;
+
+			processing = true;
+		}
+		else if (IPPROTO_IPV6 == l4_proto)
+		{
+			const ip6_hdr* ip_hdr = reinterpret_cast<const ip6_hdr*>(packet + offset);
+			offset += sizeof(ip6_hdr);
+			l4_proto = ip_hdr->ip6_nxt;
+		}
+		else if (IPPROTO_PIM == l4_proto)
+		{
+			return Word();
+		}
+		else
+		{
+			return Word();
+		}
+	}
+
+	return Word(packet + offset, packet + std::max(static_cast<size_t>(pkthdr->len), offset));
+	// return Word(packet + offset, packet + pkthdr->len);
+}
+
+/// scores the current batch in parallel and processes the results
+void process_batch()
+{
+	const size_t size = batch_payloads.size();
+	if (0 == size) { return; }
+
+	// the blocks of the batch are scored by the pool of the library
+	model.score_batch(batch_payloads, &batch_scores, !prefix_scores);
+
+	for (size_t i = 0; i < size; ++i)
+	{
+		LogProb score = batch_scores[i];
+		if (print_scores)
+		{
+			std::cout << batch_packets[i].number << " " << score << "\n";
+		}
+
+		if (std::isinf(score))
+		{
+			++impossible_packets;
+		}
+		else
+		{
+			sum_scores += score;
+			min_score = std::min(min_score, score);
+			max_score = std::max(max_score, score);
+		}
+
+		if (use_threshold && score < threshold)
+		{
+			++below_packets;
+			if (nullptr != dumper)
+			{
+				pcap_dump(reinterpret_cast<u_char*>(dumper), &batch_packets[i].hdr,
+					batch_packets[i].data.data());
+			}
+		}
+	}
+
+	batch_packets.clear();
+	batch_payloads.clear();
+}
+
+void packetHandler(
+	u_char* /* userData */,
+	const pcap_pkthdr* pkthdr,
+	const u_char* packet)
+{
+	assert(nullptr != pkthdr);
+	assert(nullptr != packet);
+
+	++total_packets;
+
+	Word payload = get_payload(pkthdr, packet);
+	if (payload.empty())
+	{
+		return;
+	}
+
+	++payloaded_packets;
+
+	Packet pkt = { *pkthdr, { }, total_packets };
+	if (nullptr != dumper)
+	{
+		pkt.data.assign(packet, packet + pkthdr->caplen);
+	}
+
+	batch_packets.push_back(std::move(pkt));
+	batch_payloads.push_back(std::move(payload));
+	if (batch_payloads.size() >= batch_size) { process_batch(); }
+
+	if (total_packets % 10000 == 0)
+	{
+		std::clog << "#";
+		std::clog.flush();
+	}
+}
@@ -1,5 +1,9 @@
 // pcap-filter.cc - filters packets from a PCAP file that belong (or do not)
 // into the language of a provided NFA
+//
+// Instead of a single NFA, a @FLOWS file (see flow-classifier.hh) can be
+// provided; every packet is then checked only against the NFAs its flow is
+// routed to.
 
 #include <vata2/util.hh>
 #include <vata2/nfa.hh>
@@ -19,6 +23,9 @@
 #include <netinet/tcp.h>
 #include <netinet/udp.h>
 
+#include "flow-classifier.hh"
+#include "metrics.hh"
+
 // Ethernet 802.1Q header
 // copied from
 // https://stackoverflow.com/questions/13166094/build-vlan-header-in-c
@@ -39,23 +46,44 @@ using TimePoint = std::chrono::time_point<std::chrono::high_resolution_clock>;
 void packetHandler(u_char *userData, const pcap_pkthdr* pkthdr, const u_char* packet);
 
 // GLOBAL VARIABLES
-size_t total_packets = 0;
-size_t payloaded_packets = 0;
-size_t filtered_packets = 0;
+MetricsRegistry metrics;
+MetricsReporter* reporter = nullptr;
+Counter& total_packets = metrics.counter("packets", "Packets read.");
+Counter& total_bytes = metrics.counter("bytes", "Bytes of packets read.");
+Counter& payloaded_packets = metrics.counter("payload_packets", "Packets with payload.");
+Counter& payload_bytes = metrics.counter("payload_bytes", "Bytes of payloads.");
+Counter& filtered_packets = metrics.counter("filtered_packets", "Packets written to the output.");
+Histogram& match_latency = metrics.histogram("match_latency_ns",
+	"Time of matching a payload against the automata (in ns).");
 bool prefix_acceptance = false;
 bool keep_in_language = true;
 Nfa aut;
 pcap_dumper_t* dumper = nullptr;
 
+// flow routing (used only if a @FLOWS file is provided)
+FlowClassifier* classifier = nullptr;
+std::vector<Nfa> flow_auts;
+std::vector<size_t> flow_aut_checks;
+std::vector<size_t> flow_aut_accepted;
+Counter& unrouted_packets = metrics.counter("unrouted_packets", "Packets matching no flow rule.");
+
 
 void print_usage(const char* prog_name)
 {
-	std::cout << "usage: " << prog_name << " [-p] <--in|--notin> <aut.vtf> <input.pcap> <output.pcap>\n";
+	std::cout << "usage: " << prog_name << " [-p] <--in|--notin> <aut.vtf|--flows flows.vtf> <input.pcap> <output.pcap>\n";
 	std::cout << "\n";
 	std::cout << "Options:\n";
-	std::cout << "  --in     keep packets IN the language of aut.vtf\n";
-	std::cout << "  --notin  keep packets NOT IN the language of aut.vtf\n";
-	std::cout << "  -p       prefix acceptance\n";
+	std::cout << "  --in               keep packets IN the language of aut.vtf\n";
+	std::cout << "  --notin            keep packets NOT IN the language of aut.vtf\n";
+	std::cout << "  -p                 prefix acceptance\n";
+	std::cout << "  --flows flows.vtf  route packets according to the @FLOWS section in\n";
+	std::cout << "                     flows.vtf and check every packet only against the\n";
+	std::cout << "                     automata it is routed to (a packet is IN if it is\n";
+	std::cout << "                     accepted by one of them; packets matching no rule\n";
+	std::cout << "                     are NOT IN)\n";
+	std::cout << "  --metrics DEST     periodically write metrics to DEST (a file or unix:PATH)\n";
+	std::cout << "  --metrics-format FORMAT     'json' (default) or 'prometheus'\n";
+	std::cout << "  --metrics-interval SECONDS  time between snapshots of metrics (default 1)\n";
 }
 
 Nfa load_aut(const std::string& file_name)
@@ -77,8 +105,19 @@ Nfa load_aut(const std::string& file_name)
 int main(int argc, char** argv)
 {
 	// PARSING COMMAND LINE ARGUMENTS
+	MetricsConfig metrics_config;
+	try
+	{
+		argc = extract_metrics_options(argc, argv, &metrics_config);
+	}
+	catch (const std::exception& ex)
+	{
+		std::cerr << "Error: " << ex.what() << "\n";
+		return EXIT_FAILURE;
+	}
+
 	size_t param_start = 1;
-	if (argc != 5 && argc != 6)
+	if (argc < 5 || argc > 7)
 	{
 		print_usage(argv[0]);
 		return EXIT_FAILURE;
@@ -88,20 +127,13 @@ int main(int argc, char** argv)
 	{
 		prefix_acceptance = true;
 		param_start = 2;
-
-		if (argc != 6)
-		{
-			print_usage(argv[0]);
-			return EXIT_FAILURE;
-		}
 	}
-	else
+
+	bool use_flows = (std::to_string(argv[param_start + 1]) == "--flows");
+	if (static_cast<size_t>(argc) != param_start + (use_flows? 5 : 4))
 	{
-		if (argc != 5)
-		{
-			print_usage(argv[0]);
-			return EXIT_FAILURE;
-		}
+		print_usage(argv[0]);
+		return EXIT_FAILURE;
 	}
 
 	if (std::to_string(argv[param_start + 0]) == "--in")
@@ -120,13 +152,28 @@ int main(int argc, char** argv)
 	}
 
 	// LOADING INPUTS
+	if (use_flows) { ++param_start; }
 	std::string aut_file = argv[param_start + 1];
 	std::string packets_file = argv[param_start + 2];
 	std::string dump_file = argv[param_start + 3];
 
 	try
 	{
-		aut = load_aut(aut_file);
+		if (use_flows)
+		{
+			classifier = new FlowClassifier(FlowClassifier::load(aut_file));
+			for (const std::string& target : classifier->get_targets())
+			{
+				flow_auts.push_back(load_aut(target));
+			}
+
+			flow_aut_checks.resize(flow_auts.size(), 0);
+			flow_aut_accepted.resize(flow_auts.size(), 0);
+		}
+		else
+		{
+			aut = load_aut(aut_file);
+		}
 	}
 	catch (const std::exception& ex)
 	{
@@ -152,6 +199,11 @@ int main(int argc, char** argv)
 		return EXIT_FAILURE;
 	}
 
+	if (!metrics_config.destination.empty())
+	{
+		reporter = new MetricsReporter(metrics, metrics_config);
+	}
+
 	TimePoint startTime = std::chrono::high_resolution_clock::now();
 
 	// start packet processing loop, just like live capture
@@ -167,24 +219,52 @@ int main(int argc, char** argv)
   std::chrono::duration<double> opTime = finishTime - startTime;
 
 	std::cout << "\n";
-	std::cout << "Total packets in " << packets_file << ": " << total_packets << "\n";
-	std::cout << "Packets with payload: " << payloaded_packets << "\n";
-	std::cout << "Filtered packets: " << filtered_packets << "\n";
+	std::cout << "Total packets in " << packets_file << ": " << total_packets.get() << "\n";
+	std::cout << "Packets with payload: " << payloaded_packets.get() << "\n";
+	std::cout << "Filtered packets: " << filtered_packets.get() << "\n";
+	if (nullptr != classifier)
+	{
+		std::cout << "Packets matching no flow rule: " << unrouted_packets.get() << "\n";
+		const std::vector<std::string>& targets = classifier->get_targets();
+		for (size_t i = 0; i < targets.size(); ++i)
+		{
+			std::cout << "Checked against " << targets[i] << ": " << flow_aut_checks[i] <<
+				" (accepted: " << flow_aut_accepted[i] << ")\n";
+		}
+
+		delete classifier;
+	}
 	std::cout << "Time: " <<
 		std::chrono::duration_cast<std::chrono::nanoseconds>(opTime).count() * 1e-9
 		<< "\n";
 
+	if (nullptr != reporter)
+	{
+		reporter->snapshot();
+		delete reporter;
+	}
+
 	return EXIT_SUCCESS;
 }
 
 
+/**
+ * @brief  Retrieves payload from a packet
+ *
+ * @param[out]  flow  If non-null, it is filled with attributes of the flow of
+ *                    the packet
+ */
 Word get_payload(
 	const pcap_pkthdr* pkthdr,
-	const u_char* packet)
+	const u_char* packet,
+	FlowKey* flow)
 {
 	assert(nullptr != pkthdr);
 	assert(nullptr != packet);
 
+	FlowKey dummy_flow;
+	if (nullptr == flow) { flow = &dummy_flow; }
+
 	size_t offset = sizeof(ether_header);
 	const ether_header* eth_hdr = reinterpret_cast<const ether_header*>(packet);
 	uint16_t ether_type = ntohs(eth_hdr->ether_type);
@@ -193,6 +273,7 @@ Word get_payload(
 		offset = sizeof(vlan_ethhdr);
 		const vlan_ethhdr* vlan_hdr = reinterpret_cast<const vlan_ethhdr*>(packet);
 		ether_type = ntohs(vlan_hdr->ether_type);
+		flow->vlan = ntohs(vlan_hdr->h_vlan_TCI) & 0x0fff;
 	}
 
 	unsigned l4_proto;
@@ -220,14 +301,22 @@ Word get_payload(
 	while (processing)
 	{
 		processing = false;
+		flow->l4_proto = l4_proto;
 		if (IPPROTO_TCP == l4_proto)
 		{
 			const tcphdr* tcp_hdr = reinterpret_cast<const tcphdr*>(packet + offset);
+			flow->has_ports = true;
+			flow->src_port = ntohs(tcp_hdr->th_sport);
+			flow->dst_port = ntohs(tcp_hdr->th_dport);
 			size_t tcp_hdr_size = tcp_hdr->th_off * 4;
 			offset += tcp_hdr_size;
 		}
 		else if (IPPROTO_UDP == l4_proto)
 		{
+			const udphdr* udp_hdr = reinterpret_cast<const udphdr*>(packet + offset);
+			flow->has_ports = true;
+			flow->src_port = ntohs(udp_hdr->uh_sport);
+			flow->dst_port = ntohs(udp_hdr->uh_dport);
 			offset += sizeof(udphdr);
 		}
 		else if (IPPROTO_IPIP == l4_proto)
@@ -294,18 +383,47 @@ void packetHandler(
 	assert(nullptr != pkthdr);
 	assert(nullptr != packet);
 
-	++total_packets;
+	total_packets.inc();
+	total_bytes.add(pkthdr->len);
+	if (nullptr != reporter) { reporter->tick(); }
 
-	Word payload = get_payload(pkthdr, packet);
+	FlowKey flow;
+	Word payload = get_payload(pkthdr, packet, &flow);
 	if (payload.empty())
 	{
 		return;
 	}
 
-	++payloaded_packets;
+	payloaded_packets.inc();
+	payload_bytes.add(payload.size());
+
+	TimePoint match_start;
+	if (nullptr != reporter) { match_start = std::chrono::high_resolution_clock::now(); }
 
 	bool in_lang = false;
-	if (prefix_acceptance)
+	if (nullptr != classifier)
+	{
+		FlowClassifier::Mask targets = classifier->targets_of(classifier->classify(flow));
+		if (0 == targets) { unrouted_packets.inc(); }
+
+		for (size_t i = 0; 0 != targets && !in_lang; ++i, targets >>= 1)
+		{
+			if (!(targets & 1)) { continue; }
+
+			++flow_aut_checks[i];
+			if (prefix_acceptance)
+			{
+				in_lang = is_prfx_in_lang(flow_auts[i], payload);
+			}
+			else
+			{
+				in_lang = is_in_lang(flow_auts[i], payload);
+			}
+
+			if (in_lang) { ++flow_aut_accepted[i]; }
+		}
+	}
+	else if (prefix_acceptance)
 	{
 		in_lang = is_prfx_in_lang(aut, payload);
 	}
@@ -314,13 +432,19 @@ void packetHandler(
 		in_lang = is_in_lang(aut, payload);
 	}
 
+	if (nullptr != reporter)
+	{
+		match_latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::high_resolution_clock::now() - match_start).count());
+	}
+
 	if ((in_lang && keep_in_language) || (!in_lang && !keep_in_language))
 	{
-		++filtered_packets;
+		filtered_packets.inc();
 		pcap_dump((u_char*)dumper, pkthdr, packet);
 	}
 
-	if (total_packets % 10000 == 0)
+	if (total_packets.get() % 10000 == 0)
 	{
 		std::clog << "#";
 		std::clog.flush();
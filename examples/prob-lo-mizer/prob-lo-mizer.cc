@@ -20,6 +20,9 @@
 #include <netinet/tcp.h>
 #include <netinet/udp.h>
 
+#include "flow-classifier.hh"
+#include "metrics.hh"
+
 // Ethernet 802.1Q header
 // copied from
 // https://stackoverflow.com/questions/13166094/build-vlan-header-in-c
@@ -40,18 +43,27 @@ using TimePoint = std::chrono::time_point<std::chrono::high_resolution_clock>;
 void packetHandler(u_char *userData, const pcap_pkthdr* pkthdr, const u_char* packet);
 
 // GLOBAL VARIABLES
-size_t total_packets = 0;
-size_t payloaded_packets = 0;
+MetricsRegistry metrics;
+MetricsReporter* reporter = nullptr;
+Counter& total_packets = metrics.counter("packets", "Packets read.");
+Counter& total_bytes = metrics.counter("bytes", "Bytes of packets read.");
+Counter& payloaded_packets = metrics.counter("payload_packets", "Packets with payload.");
+Counter& payload_bytes = metrics.counter("payload_bytes", "Bytes of payloads.");
+Histogram& match_latency = metrics.histogram("match_latency_ns",
+	"Time of running the automaton on a payload and counting (in ns).");
 u_int16_t tcp_port = 0;
 Nfa aut;
 
+// flow filter (used only if a @FLOWS file is provided)
+FlowClassifier* classifier = nullptr;
+
 std::unordered_map<State, size_t> state_occur_cnt;
 std::unordered_map<Trans, size_t> trans_occur_cnt;
 std::unordered_map<State, size_t> state_accept_cnt;
 
 void print_usage(const char* prog_name)
 {
-	std::cout << "usage: " << prog_name << " (--tcp PORT) <aut.vtf> <input.pcap>\n";
+	std::cout << "usage: " << prog_name << " (--tcp PORT | --flows flows.vtf) <aut.vtf> <input.pcap>\n";
 	std::cout << "\n";
 	std::cout << "Accepts a deterministic FA in aut.vtf and a PCAP file in\n";
 	std::cout << "input.pcap and constructs a probabilistic automaton obtained\n";
@@ -59,11 +71,16 @@ void print_usage(const char* prog_name)
 	std::cout << "choices of aut.vtf on the input from the PCAP file\n";
 	std::cout << "\n";
 	std::cout << "Options:\n";
-	std::cout << "  --tcp PORT  Consider *only* TCP packets *only* on PORT (any from src or dst)\n";
+	std::cout << "  --tcp PORT         Consider *only* TCP packets *only* on PORT (any from src or dst)\n";
+	std::cout << "  --flows flows.vtf  Consider *only* packets matching some rule of the @FLOWS\n";
+	std::cout << "                     section in flows.vtf (targets of the rules are ignored)\n";
+	std::cout << "  --metrics DEST     Periodically write metrics to DEST (a file or unix:PATH)\n";
+	std::cout << "  --metrics-format FORMAT     'json' (default) or 'prometheus'\n";
+	std::cout << "  --metrics-interval SECONDS  Time between snapshots of metrics (default 1)\n";
 	std::cout << "\n";
 	std::cout << "Parameters:\n";
-	std::cout << "  aut.vtf     Deterministic FA with the structure to be labelled\n";
-	std::cout << "  input.pcap  Input sample\n";
+	std::cout << "  aut.vtf            Deterministic FA with the structure to be labelled\n";
+	std::cout << "  input.pcap         Input sample\n";
 }
 
 Nfa load_aut(const std::string& file_name)
@@ -85,6 +102,17 @@ Nfa load_aut(const std::string& file_name)
 int main(int argc, char** argv)
 {
 	// PARSING COMMAND LINE ARGUMENTS
+	MetricsConfig metrics_config;
+	try
+	{
+		argc = extract_metrics_options(argc, argv, &metrics_config);
+	}
+	catch (const std::exception& ex)
+	{
+		std::cerr << "Error: " << ex.what() << "\n";
+		return EXIT_FAILURE;
+	}
+
 	size_t param_start = 1;
 	if (argc != 3 && argc != 5)
 	{
@@ -113,6 +141,26 @@ int main(int argc, char** argv)
 			return EXIT_FAILURE;
 		}
 	}
+	else if (std::to_string(argv[1]) == "--flows")
+	{
+		param_start = 3;
+
+		if (argc != 5)
+		{
+			print_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+
+		try
+		{
+			classifier = new FlowClassifier(FlowClassifier::load(argv[2]));
+		}
+		catch (const std::exception& ex)
+		{
+			std::cerr << "Error loading flow rules: " << ex.what() << "\n";
+			return EXIT_FAILURE;
+		}
+	}
 	else
 	{
 		if (argc != 3)
@@ -173,6 +221,11 @@ int main(int argc, char** argv)
 		return EXIT_FAILURE;
 	}
 
+	if (!metrics_config.destination.empty())
+	{
+		reporter = new MetricsReporter(metrics, metrics_config);
+	}
+
 	TimePoint startTime = std::chrono::high_resolution_clock::now();
 
 	// start packet processing loop, just like live capture
@@ -191,9 +244,15 @@ int main(int argc, char** argv)
 	std::cout << "@DPA\n";
 	std::cout << "%Initial " << *aut.initialstates.begin() << ":1.0\n";
 	std::cout << "%Final ";
+	// every visit of a state either continues over a transition or terminates
+	// there, so the probabilities of both are normalized by all visits
+	auto num_visits = [](State st) -> double {
+		return static_cast<double>(state_occur_cnt[st] + state_accept_cnt[st]);
+	};
+
 	for (const auto& st_acc : state_accept_cnt)
 	{
-		double prod = (static_cast<double>(st_acc.second) / state_occur_cnt[st_acc.first]);
+		double prod = (static_cast<double>(st_acc.second) / num_visits(st_acc.first));
 		std::cout << st_acc.first << ":" << prod << " ";
 	}
 	std::cout << "\n";
@@ -201,7 +260,7 @@ int main(int argc, char** argv)
 	for (const auto& trans_acc : trans_occur_cnt)
 	{
 		double prob = (static_cast<double>(trans_acc.second) /
-			state_occur_cnt[trans_acc.first.src]);
+			num_visits(trans_acc.first.src));
 		const Trans& trans = trans_acc.first;
 		std::cout << trans.src << " ";
 		std::cout << trans.symb << ":" << prob << " ";
@@ -209,12 +268,20 @@ int main(int argc, char** argv)
 	}
 
 	std::clog << "\n";
-	std::clog << "Total packets in " << packets_file << ": " << total_packets << "\n";
-	std::clog << "Packets with payload: " << payloaded_packets << "\n";
+	std::clog << "Total packets in " << packets_file << ": " << total_packets.get() << "\n";
+	std::clog << "Packets with payload: " << payloaded_packets.get() << "\n";
 	std::clog << "Time: " <<
 		std::chrono::duration_cast<std::chrono::nanoseconds>(opTime).count() * 1e-9
 		<< "\n";
 
+	delete classifier;
+
+	if (nullptr != reporter)
+	{
+		reporter->snapshot();
+		delete reporter;
+	}
+
 	return EXIT_SUCCESS;
 }
 
@@ -224,15 +291,19 @@ int main(int argc, char** argv)
  *
  * @param[in]  tcp_port  If non-0, specifies a TCP port that will only be
  *                       considered (src or dst)
+ * @param[in]  classifier  If non-null, only packets matching some of its rules
+ *                         are considered
  */
 Word get_payload(
-	const pcap_pkthdr*   pkthdr,
-	const u_char*        packet,
-	u_int16_t            tcp_port)
+	const pcap_pkthdr*     pkthdr,
+	const u_char*          packet,
+	u_int16_t              tcp_port,
+	const FlowClassifier*  classifier)
 {
 	assert(nullptr != pkthdr);
 	assert(nullptr != packet);
 
+	FlowKey flow;
 	size_t offset = sizeof(ether_header);
 	const ether_header* eth_hdr = reinterpret_cast<const ether_header*>(packet);
 	uint16_t ether_type = ntohs(eth_hdr->ether_type);
@@ -241,6 +312,7 @@ Word get_payload(
 		offset = sizeof(vlan_ethhdr);
 		const vlan_ethhdr* vlan_hdr = reinterpret_cast<const vlan_ethhdr*>(packet);
 		ether_type = ntohs(vlan_hdr->ether_type);
+		flow.vlan = ntohs(vlan_hdr->h_vlan_TCI) & 0x0fff;
 	}
 
 	unsigned l4_proto;
@@ -262,6 +334,7 @@ Word get_payload(
 		return Word();
 	}
 
+	flow.l4_proto = l4_proto;
 	if (IPPROTO_TCP == l4_proto)
 	{
 		const tcphdr* tcp_hdr = reinterpret_cast<const tcphdr*>(packet + offset);
@@ -272,14 +345,36 @@ Word get_payload(
 			return Word();
 		}
 
+		flow.has_ports = true;
+		flow.src_port = ntohs(tcp_hdr->th_sport);
+		flow.dst_port = ntohs(tcp_hdr->th_dport);
 		size_t tcp_hdr_size = tcp_hdr->th_off * 4;
 		offset += tcp_hdr_size;
 	}
+	else if ((nullptr != classifier) && (IPPROTO_UDP == l4_proto))
+	{
+		const udphdr* udp_hdr = reinterpret_cast<const udphdr*>(packet + offset);
+		flow.has_ports = true;
+		flow.src_port = ntohs(udp_hdr->uh_sport);
+		flow.dst_port = ntohs(udp_hdr->uh_dport);
+		offset += sizeof(udphdr);
+	}
+	else if (nullptr != classifier)
+	{
+		// other L4 protocols are matched by rules for 'other' or 'any'; the
+		// payload starts right after the IP header
+		flow.has_ports = false;
+	}
 	else
 	{
 		return Word();
 	}
 
+	if ((nullptr != classifier) && (0 == classifier->classify(flow)))
+	{
+		return Word();
+	}
+
 	return Word(packet + offset, packet + std::max(static_cast<size_t>(pkthdr->len), offset));
 	// return Word(packet + offset, packet + pkthdr->len);
 }
@@ -292,12 +387,18 @@ void packetHandler(
 	assert(nullptr != pkthdr);
 	assert(nullptr != packet);
 
-	++total_packets;
+	total_packets.inc();
+	total_bytes.add(pkthdr->len);
+	if (nullptr != reporter) { reporter->tick(); }
 
-	Word payload = get_payload(pkthdr, packet, tcp_port);
+	Word payload = get_payload(pkthdr, packet, tcp_port, classifier);
 	if (payload.empty()) { return; }
 
-	++payloaded_packets;
+	payloaded_packets.inc();
+	payload_bytes.add(payload.size());
+
+	TimePoint match_start;
+	if (nullptr != reporter) { match_start = std::chrono::high_resolution_clock::now(); }
 
 	// std::clog << std::to_string(payload) << "\n";
 	// for (auto i: payload)
@@ -319,7 +420,7 @@ void packetHandler(
 
 		++state_occur_cnt[src];
 
-		cur = aut.get_post_of_set(cur, sym);
+		cur = aut.post(cur, sym);
 		if (cur.size() != 1) { std::abort(); }
 		State tgt = *cur.begin();
 
@@ -330,7 +431,13 @@ void packetHandler(
 	State st = *cur.begin();
 	++state_accept_cnt[st];
 
-	if (total_packets % 10000 == 0)
+	if (nullptr != reporter)
+	{
+		match_latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::high_resolution_clock::now() - match_start).count());
+	}
+
+	if (total_packets.get() % 10000 == 0)
 	{
 		std::clog << "#";
 		std::clog.flush();
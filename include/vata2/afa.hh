@@ -21,6 +21,7 @@
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <functional>
 #include <set>
 #include <unordered_map>
 #include <unordered_set>
@@ -54,7 +55,7 @@ using StringDict = Vata2::Nfa::StringDict;
 
 using Alphabet = Vata2::Nfa::Alphabet;
 
-/// A transition
+/// A transition (in the textual form)
 struct Trans
 {
 	State src;
@@ -71,6 +72,319 @@ struct Trans
 };
 
 
+/// identifier of a formula in a FormulaStore
+using FormulaId = uint32_t;
+
+
+/**
+ * @brief  A set of states represented as a bit vector
+ *
+ * State @p s is represented by the bit @p s, so states are expected to be
+ * numbered densely from 0 (as done by construct()).  The bit vector grows as
+ * needed; bits beyond its size are considered to be 0.
+ */
+class StateBitset
+{ // {{{
+public:
+
+	using Block = uint64_t;
+	static const size_t BLOCK_BITS = 64;
+
+private:
+
+	std::vector<Block> blocks = { };
+
+public:
+
+	StateBitset() { }
+	explicit StateBitset(size_t num_states) :
+		blocks((num_states + BLOCK_BITS - 1) / BLOCK_BITS, 0)
+	{ }
+	/// a set given by a range of blocks
+	template <class InputIt>
+	StateBitset(InputIt first, InputIt last) : blocks(first, last) { }
+
+	/// the number of bits that are currently allocated
+	size_t capacity() const { return this->blocks.size() * BLOCK_BITS; }
+
+	bool test(State state) const
+	{ // {{{
+		size_t idx = state / BLOCK_BITS;
+		return idx < this->blocks.size() &&
+			(this->blocks[idx] >> (state % BLOCK_BITS)) & 1;
+	} // test }}}
+
+	void set(State state)
+	{ // {{{
+		size_t idx = state / BLOCK_BITS;
+		if (idx >= this->blocks.size()) { this->blocks.resize(idx + 1, 0); }
+		this->blocks[idx] |= static_cast<Block>(1) << (state % BLOCK_BITS);
+	} // set }}}
+
+	void reset(State state)
+	{ // {{{
+		size_t idx = state / BLOCK_BITS;
+		if (idx < this->blocks.size())
+		{
+			this->blocks[idx] &= ~(static_cast<Block>(1) << (state % BLOCK_BITS));
+		}
+	} // reset }}}
+
+	void clear() { std::fill(this->blocks.begin(), this->blocks.end(), 0); }
+
+	bool none() const
+	{ // {{{
+		for (Block block : this->blocks) { if (0 != block) { return false; } }
+		return true;
+	} // none }}}
+
+	size_t count() const
+	{ // {{{
+		size_t cnt = 0;
+		for (Block block : this->blocks) { cnt += __builtin_popcountll(block); }
+		return cnt;
+	} // count }}}
+
+	/// is every state of @p this also in @p rhs?
+	bool is_subset_of(const StateBitset& rhs) const
+	{ // {{{
+		for (size_t i = 0; i < this->blocks.size(); ++i)
+		{
+			Block rhs_block = (i < rhs.blocks.size())? rhs.blocks[i] : 0;
+			if (0 != (this->blocks[i] & ~rhs_block)) { return false; }
+		}
+
+		return true;
+	} // is_subset_of }}}
+
+	StateBitset& operator|=(const StateBitset& rhs)
+	{ // {{{
+		if (rhs.blocks.size() > this->blocks.size()) { this->blocks.resize(rhs.blocks.size(), 0); }
+		for (size_t i = 0; i < rhs.blocks.size(); ++i) { this->blocks[i] |= rhs.blocks[i]; }
+		return *this;
+	} // operator|= }}}
+
+	StateBitset& operator&=(const StateBitset& rhs)
+	{ // {{{
+		for (size_t i = 0; i < this->blocks.size(); ++i)
+		{
+			this->blocks[i] &= (i < rhs.blocks.size())? rhs.blocks[i] : 0;
+		}
+
+		return *this;
+	} // operator&= }}}
+
+	bool operator==(const StateBitset& rhs) const
+	{ // {{{
+		return this->is_subset_of(rhs) && rhs.is_subset_of(*this);
+	} // operator== }}}
+	bool operator!=(const StateBitset& rhs) const { return !(*this == rhs); }
+
+	/// calls @p func on every state in the set (in the increasing order)
+	template <class Func>
+	void for_each(Func func) const
+	{ // {{{
+		for (size_t i = 0; i < this->blocks.size(); ++i)
+		{
+			for (Block block = this->blocks[i]; 0 != block; block &= block - 1)
+			{
+				func(static_cast<State>(i * BLOCK_BITS + __builtin_ctzll(block)));
+			}
+		}
+	} // for_each }}}
+
+	std::set<State> to_set() const
+	{ // {{{
+		std::set<State> result;
+		this->for_each([&result](State st) { result.insert(st); });
+		return result;
+	} // to_set }}}
+
+	const std::vector<Block>& get_blocks() const { return this->blocks; }
+
+	size_t hash() const
+	{ // {{{
+		// trailing zero blocks are ignored so that equal sets have equal hashes
+		size_t len = this->blocks.size();
+		while (len > 0 && 0 == this->blocks[len - 1]) { --len; }
+		return Vata2::util::hash_range(this->blocks.begin(), this->blocks.begin() + len);
+	} // hash }}}
+
+	/// a hasher for unordered containers
+	struct Hash
+	{
+		size_t operator()(const StateBitset& states) const { return states.hash(); }
+	};
+}; // StateBitset }}}
+
+
+/**
+ * @brief  A hash-consed store of positive Boolean formulae
+ *
+ * Atoms of the formulae are states and symbols.  Every formula is stored
+ * exactly once (formulae equal up to associativity, commutativity, and
+ * idempotence of conjunction and disjunction get the same FormulaId), so
+ * formulae can be compared by their identifiers.  Conjunctions and
+ * disjunctions are flattened, their operands are sorted by their identifiers,
+ * and constants are propagated when they are created.
+ */
+class FormulaStore
+{ // {{{
+public:
+
+	enum class Kind : uint8_t { FALSE, TRUE, STATE, SYMBOL, AND, OR };
+
+	struct Node
+	{
+		Kind kind;
+		/// the state or symbol for atoms
+		uintptr_t atom;
+		/// operands of conjunctions and disjunctions
+		std::vector<FormulaId> children;
+
+		bool operator==(const Node& rhs) const
+		{ // {{{
+			return this->kind == rhs.kind && this->atom == rhs.atom &&
+				this->children == rhs.children;
+		} // operator== }}}
+	};
+
+	static const FormulaId FALSE_ID = 0;
+	static const FormulaId TRUE_ID = 1;
+
+private:
+
+	struct NodeHash
+	{
+		size_t operator()(const Node& node) const
+		{ // {{{
+			size_t accum = std::hash<uint8_t>{}(static_cast<uint8_t>(node.kind));
+			accum = Vata2::util::hash_combine(accum, node.atom);
+			accum = Vata2::util::hash_combine(accum, node.children);
+			return accum;
+		} // operator() }}}
+	};
+
+	std::vector<Node> nodes = { };
+	std::unordered_map<Node, FormulaId, NodeHash> unique = { };
+
+	FormulaId insert(const Node& node);
+
+	/// normalizes operands of a conjunction or disjunction: either stores the
+	/// resulting formula to @p result and returns true (if it is a constant
+	/// or has a single operand), or flattens and sorts @p children and
+	/// returns false
+	bool normalize(Kind kind, std::vector<FormulaId>* children, FormulaId* result) const;
+
+public:
+
+	FormulaStore();
+
+	FormulaId mk_false() const { return FALSE_ID; }
+	FormulaId mk_true() const { return TRUE_ID; }
+	FormulaId mk_state(State state) { return this->insert({Kind::STATE, state, {}}); }
+	FormulaId mk_symbol(Symbol symb) { return this->insert({Kind::SYMBOL, symb, {}}); }
+	FormulaId mk_and(FormulaId lhs, FormulaId rhs) { return this->mk_nary(Kind::AND, {lhs, rhs}); }
+	FormulaId mk_or(FormulaId lhs, FormulaId rhs) { return this->mk_nary(Kind::OR, {lhs, rhs}); }
+	/// creates a conjunction or disjunction (of @p kind) of @p children
+	FormulaId mk_nary(Kind kind, std::vector<FormulaId> children);
+
+	const Node& operator[](FormulaId id) const
+	{ // {{{
+		assert(id < this->nodes.size());
+		return this->nodes[id];
+	} // operator[] }}}
+
+	/// the number of stored formulae (including subformulae)
+	size_t size() const { return this->nodes.size(); }
+
+	/**
+	 * @brief  Substitutes symbol atoms by constants
+	 *
+	 * Symbols are mutually exclusive (exactly one symbol is read at a time),
+	 * so @p symb is substituted by true and all other symbols by false.  If
+	 * @p symb is nullptr, all symbols are substituted by false.
+	 */
+	FormulaId restrict_symbol(FormulaId formula, const Symbol* symb);
+
+	/**
+	 * @brief  The dual of a formula
+	 *
+	 * Conjunctions and disjunctions, and true and false are swapped; atoms are
+	 * kept.  For a formula over states, the dual formula is satisfied by a set
+	 * of states iff the original one is not satisfied by its complement.
+	 */
+	FormulaId dualize(FormulaId formula);
+
+	/// copies @p formula from @p other into this store; states are renamed by
+	/// adding @p state_offset
+	FormulaId import(const FormulaStore& other, FormulaId formula, State state_offset = 0);
+
+	/// finds the formula @p formula of @p other in this store (without
+	/// inserting it); returns false if it is not present
+	bool lookup(const FormulaStore& other, FormulaId formula, FormulaId* result) const;
+
+	/// the set of symbols occurring in @p formula
+	std::set<Symbol> get_symbols(FormulaId formula) const;
+	/// the set of states occurring in @p formula
+	std::set<State> get_states(FormulaId formula) const;
+
+	/// evaluates a formula without symbols against a set of states
+	bool eval(FormulaId formula, const StateBitset& states) const
+	{ // {{{
+		const Node& node = (*this)[formula];
+		switch (node.kind)
+		{
+			case Kind::FALSE:  return false;
+			case Kind::TRUE:   return true;
+			case Kind::STATE:  return states.test(node.atom);
+			case Kind::SYMBOL: return false;
+			case Kind::AND:
+				for (FormulaId child : node.children) {
+					if (!this->eval(child, states)) { return false; }
+				}
+				return true;
+			case Kind::OR:
+				for (FormulaId child : node.children) {
+					if (this->eval(child, states)) { return true; }
+				}
+				return false;
+		}
+
+		assert(false);
+		return false;
+	} // eval }}}
+
+	/**
+	 * @brief  The disjunctive normal form of a formula
+	 *
+	 * The formula is satisfied by a set of states iff the set contains one of
+	 * the returned cubes (sets of states).  The cubes are minimal wrt
+	 * inclusion; symbols are treated as false.  If @p dual is set, the normal
+	 * form of the dual formula (with conjunctions and disjunctions, and true
+	 * and false swapped) is returned.
+	 */
+	std::vector<StateBitset> get_dnf(FormulaId formula, bool dual = false) const;
+
+	/// converts a formula into a string
+	std::string to_string(
+		FormulaId                               formula,
+		const std::function<std::string(Symbol)>&  symbol_namer,
+		const std::function<std::string(State)>&   state_namer) const;
+}; // FormulaStore }}}
+
+
+/// inserts @p cube into an antichain of cubes (sets of states) that are
+/// minimal wrt inclusion (supersets of @p cube are removed)
+void insert_minimal(std::vector<StateBitset>* antichain, const StateBitset& cube);
+
+/// minimal unions of a cube of @p lhs and a cube of @p rhs (i.e., the normal
+/// form of the conjunction of two formulae in the normal form)
+std::vector<StateBitset> join_cubes(
+	const std::vector<StateBitset>&  lhs,
+	const std::vector<StateBitset>&  rhs);
+
+
 struct Afa;
 
 /// serializes Afa into a ParsedSection
@@ -80,21 +394,54 @@ Vata2::Parser::ParsedSection serialize(
 	const StateToStringMap*   state_map = nullptr);
 
 
-///  An AFA
+/**
+ * @brief  An AFA
+ *
+ * Transitions are positive Boolean formulae over states and symbols; the
+ * transition function of a state @p q is the disjunction of the formulae of
+ * all transitions from @p q, and its successors over a symbol @p a are
+ * obtained by substituting true for @p a and false for other symbols.  A set
+ * of states is accepting if all its states are final, and the automaton
+ * accepts a word if some of its initial states does.
+ *
+ * Formulae are parsed only once, when they are added, and kept in
+ * a hash-consed store; the transition function is indexed by the source
+ * state and the symbol.
+ */
 struct Afa
 { // {{{
 private:
 
-public: // TODO: make private
-  // TODO: transition relation
-  std::vector<Trans> transitions;
+	/// the transition function of a state
+	struct StatePost
+	{
+		/// the disjunction of all transitions from the state
+		FormulaId formula;
+		/// the successors over symbols (only for those occurring in formula)
+		std::unordered_map<Symbol, FormulaId> symbol_post;
+		/// the successors over symbols not in symbol_post
+		FormulaId other_post;
+	};
+
+	FormulaStore formulas = { };
+	/// transitions in the order in which they were added
+	std::vector<std::pair<State, FormulaId>> trans_list = { };
+	std::unordered_set<std::pair<State, FormulaId>> trans_set = { };
+	std::unordered_map<State, StatePost> posts = { };
+	/// the number of states, i.e., the highest state + 1
+	size_t num_states_ = 0;
+
+	void note_state(State state)
+	{ // {{{
+		this->num_states_ = std::max(this->num_states_, static_cast<size_t>(state) + 1);
+	} // note_state }}}
 
 public:
 
 	std::set<State> initialstates = {};
 	std::set<State> finalstates = {};
 
-	void add_initial(State state) { this->initialstates.insert(state); }
+	void add_initial(State state) { this->initialstates.insert(state); this->note_state(state); }
 	void add_initial(const std::vector<State> vec)
 	{ // {{{
 		for (const State& st : vec) { this->add_initial(st); }
@@ -103,7 +450,7 @@ public:
 	{ // {{{
 		return Vata2::util::haskey(this->initialstates, state);
 	} // }}}
-	void add_final(State state) { this->finalstates.insert(state); }
+	void add_final(State state) { this->finalstates.insert(state); this->note_state(state); }
 	void add_final(const std::vector<State> vec)
 	{ // {{{
 		for (const State& st : vec) { this->add_final(st); }
@@ -113,49 +460,287 @@ public:
 		return Vata2::util::haskey(this->finalstates, state);
 	} // }}}
 
+	/// the store of formulae of the automaton (used to build new formulae)
+	FormulaStore& get_formulas() { return this->formulas; }
+	const FormulaStore& get_formulas() const { return this->formulas; }
+
+	/// adds a transition with a formula from the store of the automaton
+	void add_trans(State src, FormulaId formula);
+
+	/**
+	 * @brief  Adds a transition given by a formula in the textual form
+	 *
+	 * The formula uses the naming convention of serialize() without maps:
+	 * 'qN' and plain numbers denote states and 'aN' or quoted characters
+	 * denote symbols.
+	 */
 	void add_trans(const Trans& trans);
 	void add_trans(State src, const std::string& formula)
 	{ // {{{
 		this->add_trans({src, formula});
 	} // }}}
 
+	bool has_trans(State src, FormulaId formula) const
+	{ // {{{
+		return Vata2::util::haskey(this->trans_set, std::make_pair(src, formula));
+	} // }}}
 	bool has_trans(const Trans& trans) const;
 	bool has_trans(State src, const std::string& formula) const
 	{ // {{{
 		return this->has_trans({src, formula});
 	} // }}}
 
-	bool trans_empty() const { /* TODO */ assert(false);};// no transitions
-	size_t trans_size() const;/// number of transitions; has linear time complexity
+	bool trans_empty() const { return this->trans_list.empty(); }
+	size_t trans_size() const;/// number of transitions
+
+	/// transitions (source state, formula) in the order in which they were added
+	const std::vector<std::pair<State, FormulaId>>& get_trans_list() const
+	{ // {{{
+		return this->trans_list;
+	} // }}}
 
+	/// the number of states, i.e., the highest state used + 1
+	size_t num_states() const { return this->num_states_; }
 
+	/// the disjunction of all transitions from @p state
+	FormulaId get_formula(State state) const
+	{ // {{{
+		auto it = this->posts.find(state);
+		return (this->posts.end() == it)? FormulaStore::FALSE_ID : it->second.formula;
+	} // get_formula }}}
+
+	/// the successors of @p state over @p symb (a formula over states)
+	FormulaId get_post(State state, Symbol symb) const
+	{ // {{{
+		auto it = this->posts.find(state);
+		if (this->posts.end() == it) { return FormulaStore::FALSE_ID; }
+
+		auto jt = it->second.symbol_post.find(symb);
+		return (it->second.symbol_post.end() == jt)? it->second.other_post : jt->second;
+	} // get_post }}}
+
+	/// the successors of @p state over symbols not occurring in its transitions
+	FormulaId get_other_post(State state) const
+	{ // {{{
+		auto it = this->posts.find(state);
+		return (this->posts.end() == it)? FormulaStore::FALSE_ID : it->second.other_post;
+	} // get_other_post }}}
+
+	/// symbols occurring in transitions from @p state
+	std::set<Symbol> get_symbols(State state) const;
+
+	/// symbols occurring in all transitions
+	std::set<Symbol> get_symbols() const;
+
+	/// can the set of states @p states be reached from @p state over @p symb?
+	bool eval_post(State state, Symbol symb, const StateBitset& states) const
+	{ // {{{
+		return this->formulas.eval(this->get_post(state, symb), states);
+	} // eval_post }}}
+
+	/// final states as a bitset
+	StateBitset get_final_bitset() const;
 }; // Afa }}}
 
 
+/**
+ * @brief  An AFA compiled for fast membership testing
+ *
+ * The successors of every state over every symbol are compiled into a flat
+ * list of AND/OR gates (in the topological order, with shared subformulae
+ * compiled once), stored in a table indexed by (symbol, state).  Membership
+ * of a word is then decided by a backward pass over the word that maintains
+ * the set of states accepting the remaining suffix as a bit vector; a state
+ * is added to the set if its gates evaluate to true against the set, in
+ * time linear in the size of the formula.  Symbols not occurring in the
+ * automaton share a single column.
+ *
+ * If the "dnf" key of the parameters is set to n, formulae whose
+ * disjunctive normal form has at most n cubes are converted into it
+ * instead, with cubes stored as bit vectors; a state is then added if one
+ * of its cubes is a subset of the set, which is tested a machine word at a
+ * time.  The normal form may be exponential in the size of the formula
+ * (e.g., for formulae in the conjunctive normal form), so it is not used by
+ * default.
+ */
+class CompiledAfa
+{ // {{{
+public:
+
+	using Block = StateBitset::Block;
+
+private:
+
+	/// a gate; operands of AND and OR gates are operands[op_begin .. op_end]
+	/// (offsets of gates from the first gate of the formula)
+	struct Gate
+	{
+		FormulaStore::Kind kind;
+		State state;
+		size_t op_begin;
+		size_t op_end;
+	};
+
+	/// the compiled successors of (column, state): either cubes[begin .. end]
+	/// (in blocks) or gates[begin .. end] (the last gate is the root)
+	struct Entry
+	{
+		bool dnf;
+		size_t begin;
+		size_t end;
+	};
+
+	size_t num_states_ = 0;
+	/// the number of blocks of a set of states
+	size_t num_blocks = 0;
+	/// columns of the table; symbols that are not here use column 0
+	std::unordered_map<Symbol, size_t> symbol_column = { };
+	/// the successors of (column, state) are in entries[column * num_states + state]
+	std::vector<Entry> entries = { };
+	std::vector<Block> cubes = { };
+	std::vector<Gate> gates = { };
+	std::vector<size_t> operands = { };
+	/// the maximal number of gates of a formula
+	size_t max_gates = 0;
+	std::vector<Block> initial = { };
+	std::vector<Block> final = { };
+	/// does some state accept a symbol unconditionally (from any set)?
+	bool has_empty_cube = false;
+
+	/// compiles @p formula of @p store into gates
+	void compile_gates(const FormulaStore& store, FormulaId formula, Entry* entry);
+
+	/// evaluates the gates of @p entry against @p next (using the working
+	/// memory @p values of max_gates elements)
+	bool eval_gates(const Entry& entry, const Block* next, char* values) const;
+
+	/// the cubes of @p entry (converted from the gates if needed)
+	std::vector<StateBitset> get_cubes(const Entry& entry) const;
+
+	size_t get_column(Symbol symb) const
+	{ // {{{
+		auto it = this->symbol_column.find(symb);
+		return (this->symbol_column.end() == it)? 0 : it->second;
+	} // get_column }}}
+
+	/// computes the set @p result of states accepting @p column followed by a
+	/// word accepted from all states of some subset of @p next (using the
+	/// working memory @p values for gates)
+	void step_back(size_t column, const Block* next, Block* result, char* values) const;
+
+	bool is_empty(const std::vector<Block>& states) const
+	{ // {{{
+		for (Block block : states) { if (0 != block) { return false; } }
+		return true;
+	} // is_empty }}}
+
+	template <class BidirIt>
+	bool run_back(
+		BidirIt              first,
+		BidirIt              last,
+		std::vector<Block>*  cur,
+		std::vector<Block>*  next,
+		std::vector<char>*   values) const
+	{ // {{{
+		cur->assign(this->final.begin(), this->final.end());
+		next->resize(this->num_blocks);
+		values->resize(this->max_gates);
+		while (first != last)
+		{
+			if (!this->has_empty_cube && this->is_empty(*cur)) { return false; }
+
+			--last;
+			this->step_back(this->get_column(static_cast<Symbol>(*last)),
+				cur->data(), next->data(), values->data());
+			std::swap(*cur, *next);
+		}
+
+		for (size_t i = 0; i < this->num_blocks; ++i)
+		{
+			if (0 != ((*cur)[i] & this->initial[i])) { return true; }
+		}
+
+		return false;
+	} // run_back }}}
+
+public:
+
+	CompiledAfa() { }
+	explicit CompiledAfa(const Afa& aut, const StringDict& params = {});
+
+	size_t num_states() const { return this->num_states_; }
+
+	/// Checks whether a word (a range of symbols) is in the language
+	template <class BidirIt>
+	bool is_in_lang(BidirIt first, BidirIt last) const
+	{ // {{{
+		std::vector<Block> cur;
+		std::vector<Block> next;
+		std::vector<char> values;
+		return this->run_back(first, last, &cur, &next, &values);
+	} // is_in_lang }}}
+
+	bool is_in_lang(const Word& word) const
+	{ // {{{
+		return this->is_in_lang(word.begin(), word.end());
+	} // }}}
+
+	/// Checks whether a prefix of a word is in the language
+	bool is_prfx_in_lang(const Word& word) const;
+
+	/// the number of words of a batch checked by one task of
+	/// is_in_lang_batch()
+	static const size_t BATCH_BLOCK = 64;
+
+	/// Checks membership of a batch of words; the batch is split into blocks
+	/// of BATCH_BLOCK words, which are checked in parallel by parallel_for()
+	/// (@p params are passed to it), each reusing its working memory
+	void is_in_lang_batch(
+		const Word*        words,
+		size_t             num_words,
+		bool*              result,
+		const StringDict&  params = {}) const;
+
+	void is_in_lang_batch(
+		const std::vector<Word>&  words,
+		std::vector<bool>*        result,
+		const StringDict&         params = {}) const;
+}; // CompiledAfa }}}
+
+
 /// a wrapper encapsulating @p Afa for higher-level use
 struct AfaWrapper
 { // {{{
 	/// the AFA
-	Afa afa;
+	Afa afa = {};
 
 	/// the alphabet
-	Alphabet* alphabet;
+	Alphabet* alphabet = nullptr;
 
 	/// mapping of state names (as strings) to their numerical values
-	StringToStateMap state_dict;
+	StringToStateMap state_dict = {};
 }; // AfaWrapper }}}
 
 
 /// Do the automata have disjoint sets of states?
 bool are_state_disjoint(const Afa& lhs, const Afa& rhs);
-/// Is the language of the automaton empty?
+/**
+ * @brief  Is the language of the automaton empty?
+ *
+ * Explores the subset construction on the fly, keeping only the minimal sets
+ * of states (antichains).  If the language is not empty, @p cex is set to
+ * the states on a branch of an accepting run.
+ */
 bool is_lang_empty(const Afa& aut, Path* cex = nullptr);
+/// Is the language of the automaton empty?  Sets @p cex to an accepted word
+/// otherwise.
 bool is_lang_empty_cex(const Afa& aut, Word* cex);
 
 /// Retrieves the states reachable from initial states
 std::unordered_set<State> get_fwd_reach_states(const Afa& aut);
 
-/// Is the language of the automaton universal?
+/// Is the language of the automaton universal?  Checks emptiness of the dual
+/// automaton with antichains; @p cex is set to a rejected word.
 bool is_universal(
 	const Afa&         aut,
 	const Alphabet&    alphabet,
@@ -173,7 +758,9 @@ inline bool is_universal(
 /// Does the language of the automaton contain epsilon?
 bool accepts_epsilon(const Afa& aut);
 
-/// Checks inclusion of languages of two automata (smaller <= bigger)?
+/// Checks inclusion of languages of two automata (smaller <= bigger)?  Checks
+/// emptiness of the conjunction of @p smaller and the dual of @p bigger with
+/// antichains; @p cex is set to a word accepted only by @p smaller.
 bool is_incl(
 	const Afa&         smaller,
 	const Afa&         bigger,
@@ -213,6 +800,61 @@ Afa union_rename(
 	const Afa&  lhs,
 	const Afa&  rhs);
 
+/**
+ * @brief  Compute intersection of a pair of automata
+ *
+ * The states of @p rhs are renamed by adding lhs.num_states() and a new
+ * initial state that conjoins the transitions of the initial states of both
+ * automata is added, so the size of the result is linear.
+ */
+void intersection(
+	Afa*        result,
+	const Afa&  lhs,
+	const Afa&  rhs);
+
+inline Afa intersection(
+	const Afa&  lhs,
+	const Afa&  rhs)
+{ // {{{
+	Afa result;
+	intersection(&result, lhs, rhs);
+	return result;
+} // intersection }}}
+
+/**
+ * @brief  Complement of an automaton wrt an alphabet
+ *
+ * The complement is obtained by dualization of transitions (over each symbol
+ * of @p alphabet) and complementing the set of final states; a new initial
+ * state conjoins the dualized transitions of the initial states.  The states
+ * of @p aut are kept and the size of the result is linear in the size of @p
+ * aut times the size of @p alphabet.
+ */
+void complement(
+	Afa*             result,
+	const Afa&       aut,
+	const Alphabet&  alphabet);
+
+inline Afa complement(
+	const Afa&       aut,
+	const Alphabet&  alphabet)
+{ // {{{
+	Afa result;
+	complement(&result, aut, alphabet);
+	return result;
+} // complement }}}
+
+/// Embeds an NFA into an AFA (with the same states); a transition (p, a, q)
+/// becomes the formula a & q from p
+void nfa_to_afa(Afa* result, const Vata2::Nfa::Nfa& aut);
+
+inline Afa nfa_to_afa(const Vata2::Nfa::Nfa& aut)
+{ // {{{
+	Afa result;
+	nfa_to_afa(&result, aut);
+	return result;
+} // nfa_to_afa }}}
+
 
 /// makes the transition relation complete
 void make_complete(
@@ -268,6 +910,96 @@ bool is_deterministic(const Afa& aut);
 /// symbol.
 bool is_complete(const Afa& aut, const Alphabet& alphabet);
 
+/**
+ * @brief  An AFA viewed as an NFA, constructed lazily
+ *
+ * States of the NFA (macrostates) are sets of states of the AFA that all need
+ * to accept the rest of the word.  Macrostates are hash-consed and numbered
+ * densely; successors are computed on demand (only the ones minimal wrt
+ * inclusion) and cached.  The view is a node of the lazy NFA expressions
+ * (see lazy(NfaView&)), so the terminal operations on lazy NFAs
+ * (membership, emptiness, and inclusion through intersection() and
+ * complement()) run on it.
+ *
+ * The number of macrostates is bounded by a budget: creating a macrostate
+ * over the budget throws std::runtime_error.  Between operations, flush()
+ * drops all cached macrostates except the given ones (which are
+ * renumbered); it invalidates the states of expressions built over the view,
+ * so streaming users flush only the view they traverse themselves.
+ */
+class NfaView : public Vata2::Nfa::LazyNode
+{ // {{{
+public:
+
+	using StateSet = Vata2::Nfa::StateSet;
+	using PostSymb = Vata2::Nfa::PostSymb;
+
+	static const size_t DEFAULT_MAX_MACROSTATES = 100000;
+
+private:
+
+	const Afa& aut;
+	size_t max_macrostates;
+	StateBitset final_states = { };
+	/// the symbols of the AFA (for successors over all symbols)
+	std::vector<Symbol> symbols = { };
+
+	std::vector<StateBitset> macrostates = { };
+	std::unordered_map<StateBitset, State, StateBitset::Hash> macro_map = { };
+	std::vector<bool> macro_final = { };
+
+	std::unordered_map<std::pair<State, Symbol>, StateSet> post_cache = { };
+	std::unordered_map<State, PostSymb> post_symb_cache = { };
+	std::unordered_map<std::pair<State, Symbol>, std::vector<StateBitset>> cube_cache = { };
+
+	size_t flushes = 0;
+
+	NfaView(const NfaView&);
+	NfaView& operator=(const NfaView&);
+
+	State get_macrostate_id(const StateBitset& macro);
+	void reset();
+
+public:
+
+	StateSet initialstates = { };
+
+	explicit NfaView(const Afa& aut, size_t max_macrostates = DEFAULT_MAX_MACROSTATES);
+
+	const Afa& get_aut() const { return this->aut; }
+	size_t num_macrostates() const { return this->macrostates.size(); }
+	size_t num_flushes() const { return this->flushes; }
+
+	/// the set of states of the AFA corresponding to a macrostate
+	const StateBitset& get_macrostate(State macro) const
+	{ // {{{
+		assert(macro < this->macrostates.size());
+		return this->macrostates[macro];
+	} // get_macrostate }}}
+
+	virtual const StateSet& get_initial() override { return this->initialstates; }
+
+	virtual bool has_final(State macro) override
+	{ // {{{
+		assert(macro < this->macro_final.size());
+		return this->macro_final[macro];
+	} // has_final }}}
+
+	/// successors of a macrostate over all symbols of the AFA
+	virtual const PostSymb& post(State macro) override;
+
+	/// successors of a macrostate
+	virtual const StateSet& post(State macro, Symbol symb) override;
+
+	/// drops all macrostates except initial ones and @p keep (which is
+	/// renumbered)
+	void flush(StateSet* keep);
+}; // NfaView }}}
+
+/// a lazy NFA of @p view (for the terminal operations on lazy NFAs), which
+/// needs to outlive the result
+Vata2::Nfa::LazyNfa lazy(NfaView& view);
+
 /** Loads an automaton from Parsed object */
 void construct(
 	Afa*                                 aut,
@@ -322,12 +1054,20 @@ inline Afa construct(
 std::pair<Word, bool> get_word_for_path(const Afa& aut, const Path& path);
 
 
-/// Checks whether a string is in the language of an automaton
+/// Checks whether a string is in the language of an automaton (compiles the
+/// automaton; use CompiledAfa for testing more words)
 bool is_in_lang(const Afa& aut, const Word& word);
 
 /// Checks whether the prefix of a string is in the language of an automaton
 bool is_prfx_in_lang(const Afa& aut, const Word& word);
 
+/// Checks whether strings are in the language of an automaton (in parallel,
+/// see CompiledAfa::is_in_lang_batch())
+std::vector<bool> is_in_lang_batch(
+	const Afa&                aut,
+	const std::vector<Word>&  words,
+	const StringDict&         params = {});
+
 /** Encodes a vector of strings (each corresponding to one symbol) into a
  *  @c Word instance
  */
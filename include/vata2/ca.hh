@@ -0,0 +1,404 @@
+/* ca.hh -- nondeterministic finite automaton with bounded counters
+ *
+ * Copyright (c) 2018 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _VATA2_CA_HH_
+#define _VATA2_CA_HH_
+
+#include <cassert>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+// VATA2 headers
+#include <vata2/nfa.hh>
+#include <vata2/parser.hh>
+#include <vata2/util.hh>
+
+namespace Vata2
+{
+namespace Ca
+{
+/// the name of the type (a constant, as it is used by dispatchers registered
+/// during static initialization)
+constexpr const char TYPE_CA[] = "CA";
+
+// START OF THE DECLARATIONS
+
+using State = Vata2::Nfa::State;
+using Symbol = Vata2::Nfa::Symbol;
+using StateSet = Vata2::Nfa::StateSet;
+using Word = Vata2::Nfa::Word;
+
+using StringToStateMap = Vata2::Nfa::StringToStateMap;
+using StringToSymbolMap = Vata2::Nfa::StringToSymbolMap;
+using StateToStringMap = Vata2::Nfa::StateToStringMap;
+using SymbolToStringMap = Vata2::Nfa::SymbolToStringMap;
+using StringDict = Vata2::Nfa::StringDict;
+
+using Alphabet = Vata2::Nfa::Alphabet;
+
+/// identifier of a counter
+using CounterId = size_t;
+
+/// the counter of states without a counter
+const CounterId NO_COUNTER = std::numeric_limits<CounterId>::max();
+
+/// the maximum bound of repetition e{m,n} in regular expressions compiled
+/// into counting automata (counters are not unrolled, so it is larger than
+/// Vata2::Nfa::REGEX_REPEAT_MAX)
+const size_t REGEX_COUNTER_MAX = 1 << 16;
+
+/// a counter with values in [1, max] that allows leaving its scope with
+/// values in [min, max]
+struct Counter
+{ // {{{
+	size_t min;
+	size_t max;
+}; // Counter }}}
+
+/// a condition on the counter of the source state of a transition
+enum class Guard
+{
+	NONE,       ///< always true
+	CAN_INCR,   ///< the value is smaller than the maximum
+	CAN_EXIT    ///< the value is at least the minimum
+};
+
+/// an update of the counter of the target state of a transition
+enum class Action
+{
+	NONE,       ///< the target has no counter
+	KEEP,       ///< the value of the (same) counter of the source is kept
+	INCR,       ///< the value of the (same) counter of the source is incremented
+	            ///< (disabled if the value is the maximum)
+	RESET       ///< the counter is set to 1 (the first iteration has started)
+};
+
+/// A transition
+struct Trans
+{ // {{{
+	State src;
+	Symbol symb;
+	State tgt;
+	Guard guard;
+	Action action;
+
+	Trans() : src(), symb(), tgt(), guard(Guard::NONE), action(Action::NONE) { }
+	Trans(State src, Symbol symb, State tgt, Guard guard = Guard::NONE,
+		Action action = Action::NONE) :
+		src(src), symb(symb), tgt(tgt), guard(guard), action(action)
+	{ }
+
+	bool operator==(const Trans& rhs) const
+	{ // {{{
+		return src == rhs.src && symb == rhs.symb && tgt == rhs.tgt &&
+			guard == rhs.guard && action == rhs.action;
+	} // operator== }}}
+	bool operator!=(const Trans& rhs) const { return !this->operator==(rhs); }
+}; // Trans }}}
+
+
+/**
+ * @brief  A set of counter values supporting incrementing all values at once
+ *
+ * Values are stored relative to an offset in a deque ordered from the
+ * largest (the oldest) to the smallest (the newest) one, so that
+ * incrementing all values is O(1) and inserting 1 or removing values that
+ * exceeded a bound only touches the ends of the deque.
+ */
+class CountingSet
+{ // {{{
+private:
+
+	std::deque<int64_t> elems = { };
+	int64_t offset = 0;
+
+public:
+
+	bool empty() const { return this->elems.empty(); }
+	size_t size() const { return this->elems.size(); }
+
+	size_t max() const
+	{ // {{{
+		assert(!this->empty());
+		return this->elems.front() + this->offset;
+	} // max }}}
+	size_t min() const
+	{ // {{{
+		assert(!this->empty());
+		return this->elems.back() + this->offset;
+	} // min }}}
+
+	/// increments all values
+	void incr() { ++this->offset; }
+
+	/// removes values that are at least @p bound
+	void remove_from(size_t bound)
+	{ // {{{
+		while (!this->empty() && this->max() >= bound) { this->elems.pop_front(); }
+	} // remove_from }}}
+
+	/// removes values that are smaller than @p bound
+	void remove_below(size_t bound)
+	{ // {{{
+		while (!this->empty() && this->min() < bound) { this->elems.pop_back(); }
+	} // remove_below }}}
+
+	void insert(size_t value);
+	bool contains(size_t value) const;
+
+	/// adds all values of @p rhs (which is left in an unspecified state)
+	void merge(CountingSet&& rhs);
+
+	/// the values in the decreasing order
+	std::vector<size_t> get_values() const;
+}; // CountingSet }}}
+
+
+struct Ca;
+
+/// serializes Ca into a ParsedSection
+Vata2::Parser::ParsedSection serialize(
+	const Ca&                 aut,
+	const SymbolToStringMap*  symbol_map = nullptr,
+	const StateToStringMap*   state_map = nullptr);
+
+
+/**
+ * @brief  A nondeterministic finite automaton with bounded counters
+ *
+ * Every state has at most one counter.  A configuration of the automaton
+ * is a state with a value of its counter; a transition may require a
+ * condition on the counter of its source (Guard) and determines the value
+ * of the counter of its target (Action).  A final state with a counter
+ * accepts if the value is at least the minimum of the counter.  Initial
+ * states do not have counters.
+ *
+ * This makes it possible to represent e{m,n} with a single copy of e
+ * instead of n copies.
+ */
+struct Ca
+{ // {{{
+public:
+
+	/// a transition from a known source over a known symbol
+	struct Move
+	{ // {{{
+		State tgt;
+		Guard guard;
+		Action action;
+	}; // Move }}}
+
+	using MoveList = std::vector<Move>;
+	using PostSymb = std::unordered_map<Symbol, MoveList>;
+
+private:
+
+	std::vector<Counter> counters = { };
+	std::unordered_map<State, CounterId> state_counter = { };
+	std::unordered_map<State, PostSymb> transitions = { };
+	size_t num_trans = 0;
+
+public:
+
+	StateSet initialstates = { };
+	StateSet finalstates = { };
+
+	void add_initial(State state) { this->initialstates.insert(state); }
+	void add_final(State state) { this->finalstates.insert(state); }
+	bool has_initial(State state) const
+	{ // {{{
+		return Vata2::util::haskey(this->initialstates, state);
+	} // }}}
+	bool has_final(State state) const
+	{ // {{{
+		return Vata2::util::haskey(this->finalstates, state);
+	} // }}}
+
+	/// adds a counter with the bounds [@p min, @p max]
+	CounterId add_counter(size_t min, size_t max);
+	const std::vector<Counter>& get_counters() const { return this->counters; }
+	const Counter& get_counter(CounterId id) const
+	{ // {{{
+		assert(id < this->counters.size());
+		return this->counters[id];
+	} // get_counter }}}
+
+	/// assigns the counter @p id to @p state
+	void set_counter(State state, CounterId id);
+	/// the counter of @p state (or NO_COUNTER)
+	CounterId get_state_counter(State state) const
+	{ // {{{
+		auto it = this->state_counter.find(state);
+		return (this->state_counter.end() == it)? NO_COUNTER : it->second;
+	} // get_state_counter }}}
+
+	/// adds a transition; throws if the guard and the action do not agree
+	/// with the counters of the source and the target
+	void add_trans(const Trans& trans);
+	void add_trans(State src, Symbol symb, State tgt, Guard guard = Guard::NONE,
+		Action action = Action::NONE)
+	{ // {{{
+		this->add_trans({src, symb, tgt, guard, action});
+	} // }}}
+
+	bool has_trans(const Trans& trans) const;
+
+	bool trans_empty() const { return 0 == this->num_trans; }
+	size_t trans_size() const { return this->num_trans; } /// number of transitions
+
+	/// the transitions from @p src
+	const PostSymb& get_post(State src) const;
+	/// the transitions from @p src over @p symb
+	const MoveList& get_moves(State src, Symbol symb) const;
+
+	/// all transitions
+	std::vector<Trans> get_transitions() const;
+}; // Ca }}}
+
+
+/// a configuration: the active states with the sets of values of their
+/// counters (states without a counter have the value 0)
+using Config = std::unordered_map<State, CountingSet>;
+
+/// the initial configuration of @p aut
+Config get_initial_config(const Ca& aut);
+
+/// the successor configuration of @p config over @p symb (@p config is used
+/// up)
+Config post(const Ca& aut, Config&& config, Symbol symb);
+
+/// checks whether @p config contains an accepting configuration
+bool is_accepting(const Ca& aut, const Config& config);
+
+/// Checks whether a string is in the language of an automaton (using
+/// counting sets, i.e., without unrolling the counters)
+bool is_in_lang(const Ca& aut, const Word& word);
+
+/**
+ * @brief  Expands the counters of an automaton into states of an NFA
+ *
+ * Every reachable pair (state, value of the counter) becomes a state of
+ * the result.  The size of the result is proportional to the bounds of
+ * the counters, so this is meant for algorithms that need a plain NFA.
+ */
+void expand(Vata2::Nfa::Nfa* result, const Ca& aut);
+
+inline Vata2::Nfa::Nfa expand(const Ca& aut)
+{ // {{{
+	Vata2::Nfa::Nfa result;
+	expand(&result, aut);
+	return result;
+} // expand }}}
+
+/**
+ * @brief  Compiles a regular expression into a counting automaton
+ *
+ * The syntax and the parameters are the same as for
+ * Vata2::Nfa::compile_regex(), but e{m,n} with n > 1 gets a counter rather
+ * than n copies of e (unless e itself contains counted repetition).  The
+bounds may be up to REGEX_COUNTER_MAX.
+ */
+void compile_regex(
+	Ca*                 result,
+	const std::string&  pattern,
+	const StringDict&   params = {});
+
+inline Ca compile_regex(
+	const std::string&  pattern,
+	const StringDict&   params = {})
+{ // {{{
+	Ca result;
+	compile_regex(&result, pattern, params);
+	return result;
+} // compile_regex }}}
+
+/** Loads an automaton from Parsed object
+ *
+ * Counters are given by the "Counters" key as triples "name min max", the
+ * states of counters by the "Scopes" key as pairs "state counter".  A
+ * transition is given by the line "src symb tgt [guard] [action]", where
+ * guard is one of "lt" (CAN_INCR) and "ge" (CAN_EXIT) and action is one of
+ * "keep", "incr", and "reset".
+ */
+void construct(
+	Ca*                                  aut,
+	const Vata2::Parser::ParsedSection&  parsec,
+	Alphabet*                            alphabet,
+	StringToStateMap*                    state_map = nullptr);
+
+/** Loads an automaton from Parsed object */
+inline Ca construct(
+	const Vata2::Parser::ParsedSection&  parsec,
+	Alphabet*                            alphabet,
+	StringToStateMap*                    state_map = nullptr)
+{ // {{{
+	Ca result;
+	construct(&result, parsec, alphabet, state_map);
+	return result;
+} // construct(Alphabet) }}}
+
+/** Loads an automaton from Parsed object */
+void construct(
+	Ca*                                  aut,
+	const Vata2::Parser::ParsedSection&  parsec,
+	StringToSymbolMap*                   symbol_map = nullptr,
+	StringToStateMap*                    state_map = nullptr);
+
+/** Loads an automaton from Parsed object */
+inline Ca construct(
+	const Vata2::Parser::ParsedSection&  parsec,
+	StringToSymbolMap*                   symbol_map = nullptr,
+	StringToStateMap*                    state_map = nullptr)
+{ // {{{
+	Ca result;
+	construct(&result, parsec, symbol_map, state_map);
+	return result;
+} // construct }}}
+
+/// operator<<
+std::ostream& operator<<(std::ostream& strm, const Ca& ca);
+
+/// a wrapper encapsulating @p Ca for higher-level use
+struct CaWrapper
+{ // {{{
+	/// the CA
+	Ca ca = {};
+
+	/// the alphabet
+	Alphabet* alphabet = nullptr;
+
+	/// mapping of state names (as strings) to their numerical values
+	StringToStateMap state_dict = {};
+}; // CaWrapper }}}
+
+/// global constructor to be called at program startup (from vm-dispatch)
+void init();
+
+// CLOSING NAMESPACES AND GUARDS
+} /* Ca */
+} /* Vata2 */
+
+namespace std
+{ // {{{
+std::ostream& operator<<(std::ostream& os, const Vata2::Ca::Trans& trans);
+std::ostream& operator<<(std::ostream& os, const Vata2::Ca::CaWrapper& ca_wrap);
+} // std }}}
+
+#endif /* _VATA2_CA_HH_ */
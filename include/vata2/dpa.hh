@@ -0,0 +1,350 @@
+/* dpa.hh -- deterministic probabilistic automaton (over finite words)
+ *
+ * Copyright (c) 2018 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _VATA2_DPA_HH_
+#define _VATA2_DPA_HH_
+
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+// VATA2 headers
+#include <vata2/nfa.hh>
+#include <vata2/parser.hh>
+#include <vata2/util.hh>
+
+namespace Vata2
+{
+namespace Dpa
+{
+/// the name of the type (a constant, as it is used by dispatchers registered
+/// during static initialization)
+constexpr const char TYPE_DPA[] = "DPA";
+
+// START OF THE DECLARATIONS
+
+using State = Vata2::Nfa::State;
+using Symbol = Vata2::Nfa::Symbol;
+using Word = Vata2::Nfa::Word;
+
+using StringToStateMap = Vata2::Nfa::StringToStateMap;
+using StringToSymbolMap = Vata2::Nfa::StringToSymbolMap;
+using StateToStringMap = Vata2::Nfa::StateToStringMap;
+using SymbolToStringMap = Vata2::Nfa::SymbolToStringMap;
+
+using Alphabet = Vata2::Nfa::Alphabet;
+using StringDict = Vata2::Nfa::StringDict;
+
+/// probability of a transition or of termination in a state
+using Prob = double;
+/// natural logarithm of a probability
+using LogProb = double;
+
+/// log-probability of impossible events
+const LogProb LOG_ZERO = -std::numeric_limits<LogProb>::infinity();
+
+/// A transition
+struct Trans
+{
+	State src;
+	Symbol symb;
+	Prob prob;
+	State tgt;
+
+	Trans() : src(), symb(), prob(), tgt() { }
+	Trans(State src, Symbol symb, Prob prob, State tgt) :
+		src(src), symb(symb), prob(prob), tgt(tgt)
+	{ }
+
+	bool operator==(const Trans& rhs) const
+	{ // {{{
+		return src == rhs.src && symb == rhs.symb && tgt == rhs.tgt &&
+			!(prob < rhs.prob) && !(rhs.prob < prob);
+	} // operator== }}}
+	bool operator!=(const Trans& rhs) const { return !this->operator==(rhs); }
+};
+
+/// the probability and the target of a transition from a state over a symbol
+using ProbTgt = std::pair<Prob, State>;
+using PostSymb = std::unordered_map<Symbol, ProbTgt>;
+using StateToPostMap = std::unordered_map<State, PostSymb>;
+
+
+struct Dpa;
+
+/// serializes Dpa into a ParsedSection
+Vata2::Parser::ParsedSection serialize(
+	const Dpa&                aut,
+	const SymbolToStringMap*  symbol_map = nullptr,
+	const StateToStringMap*   state_map = nullptr);
+
+
+/**
+ * @brief  A deterministic probabilistic automaton
+ *
+ * The automaton has a single initial state (entered with the probability
+ * @p initprob), every state has at most one transition over every symbol, and
+ * every transition is labelled with its probability.  Moreover, every state
+ * has a probability of terminating in it (the final probability, which is 0
+ * for states not in @p finalprobs).  The probability of a word is the product
+ * of the probabilities of the transitions on its run and the final
+ * probability of the state the run ends in.
+ */
+struct Dpa
+{ // {{{
+private:
+
+	StateToPostMap transitions = {};
+
+public:
+
+	State initialstate = 0;
+	Prob initprob = 1.0;
+	std::unordered_map<State, Prob> finalprobs = {};
+
+	void set_initial(State state, Prob prob = 1.0)
+	{ // {{{
+		this->initialstate = state;
+		this->initprob = prob;
+	} // }}}
+
+	void set_final(State state, Prob prob) { this->finalprobs[state] = prob; }
+	Prob get_final(State state) const
+	{ // {{{
+		auto it = this->finalprobs.find(state);
+		return (this->finalprobs.end() == it)? 0.0 : it->second;
+	} // }}}
+
+	/// adds a transition; throws if it breaks determinism
+	void add_trans(const Trans& trans);
+	void add_trans(State src, Symbol symb, Prob prob, State tgt)
+	{ // {{{
+		this->add_trans({src, symb, prob, tgt});
+	} // }}}
+
+	/// the transition from @p src over @p symb or nullptr if there is none
+	const ProbTgt* get_trans(State src, Symbol symb) const
+	{ // {{{
+		auto it = this->transitions.find(src);
+		if (this->transitions.end() == it) { return nullptr; }
+		auto jt = it->second.find(symb);
+		return (it->second.end() == jt)? nullptr : &jt->second;
+	} // get_trans }}}
+
+	bool has_trans(State src, Symbol symb) const
+	{ // {{{
+		return nullptr != this->get_trans(src, symb);
+	} // }}}
+
+	bool trans_empty() const { return this->transitions.empty(); }
+	size_t trans_size() const;/// number of transitions; has linear time complexity
+
+	/// all transitions (in an unspecified order)
+	std::vector<Trans> get_transitions() const;
+
+	const StateToPostMap& get_post_map() const { return this->transitions; }
+}; // Dpa }}}
+
+
+/**
+ * @brief  A DPA compiled for fast scoring
+ *
+ * States are renumbered densely and the transition function is stored in
+ * dense tables indexed by (state, symbol) holding the target state and the
+ * natural logarithm of the probability of the transition.  Missing
+ * transitions lead to a dead state with log-probability LOG_ZERO, so
+ * scoring a word is a tight loop of table lookups and additions.  The symbols
+ * need to be small (e.g. bytes), since the tables have (max symbol + 1)
+ * columns.
+ */
+class CompiledDpa
+{ // {{{
+public:
+
+	using DenseState = uint32_t;
+
+	/// the maximum supported number of columns of the tables
+	static const size_t MAX_ALPHABET_SIZE = 1 << 16;
+
+	/// the number of words scored in an interleaved manner by score_batch()
+	static const size_t BATCH_LANES = 8;
+	/// the number of words of a batch scored by one task of score_batch()
+	static const size_t BATCH_BLOCK = 32 * BATCH_LANES;
+
+private:
+
+	size_t alph_size = 0;
+	DenseState init = 0;
+	DenseState dead = 0;
+	LogProb init_logprob = LOG_ZERO;
+
+	/// target states, indexed by state * alph_size + symbol
+	std::vector<DenseState> next = { };
+	/// log-probabilities of transitions, indexed the same way as next
+	std::vector<LogProb> logprob = { };
+	/// log-probabilities of terminating in a state
+	std::vector<LogProb> final_logprob = { };
+
+	/// scores words in lockstep in the calling thread
+	void score_lanes(
+		const Word*  words,
+		size_t       num_words,
+		LogProb*     result,
+		bool         with_final) const;
+
+public:
+
+	CompiledDpa() { }
+	explicit CompiledDpa(const Dpa& aut);
+
+	size_t num_states() const { return this->final_logprob.size(); }
+	size_t alphabet_size() const { return this->alph_size; }
+
+	/**
+	 * @brief  Log-likelihood of a word
+	 *
+	 * @param[in]  first, last  The word (a range of symbols)
+	 * @param[in]  with_final   Whether the final probability of the reached
+	 *                          state is included (if not, the result is the
+	 *                          log-likelihood of the word being a prefix)
+	 */
+	template <class InputIt>
+	LogProb score(InputIt first, InputIt last, bool with_final = true) const
+	{ // {{{
+		DenseState st = this->init;
+		LogProb result = this->init_logprob;
+		for (; first != last; ++first)
+		{
+			Symbol symb = static_cast<Symbol>(*first);
+			if (symb >= this->alph_size) { return LOG_ZERO; }
+			size_t idx = st * this->alph_size + symb;
+			result += this->logprob[idx];
+			st = this->next[idx];
+			if (st == this->dead) { return LOG_ZERO; }
+		}
+
+		return with_final? result + this->final_logprob[st] : result;
+	} // score }}}
+
+	LogProb score(const Word& word, bool with_final = true) const
+	{ // {{{
+		return this->score(word.begin(), word.end(), with_final);
+	} // }}}
+
+	/**
+	 * @brief  Log-likelihoods of a batch of words
+	 *
+	 * The batch is split into blocks of BATCH_BLOCK words, which are scored
+	 * in parallel by parallel_for() (@p params are passed to it).  In a
+	 * block, words are processed BATCH_LANES at a time in lockstep, so that
+	 * the independent table lookups of different words overlap.
+	 */
+	void score_batch(
+		const Word*        words,
+		size_t             num_words,
+		LogProb*           result,
+		bool               with_final = true,
+		const StringDict&  params = {}) const;
+
+	void score_batch(
+		const std::vector<Word>&  words,
+		std::vector<LogProb>*     result,
+		bool                      with_final = true,
+		const StringDict&         params = {}) const
+	{ // {{{
+		assert(nullptr != result);
+		result->resize(words.size());
+		this->score_batch(words.data(), words.size(), result->data(), with_final, params);
+	} // }}}
+}; // CompiledDpa }}}
+
+
+/** Loads an automaton from Parsed object */
+void construct(
+	Dpa*                                 aut,
+	const Vata2::Parser::ParsedSection&  parsec,
+	Alphabet*                            alphabet,
+	StringToStateMap*                    state_map = nullptr);
+
+/** Loads an automaton from Parsed object */
+inline Dpa construct(
+	const Vata2::Parser::ParsedSection&  parsec,
+	Alphabet*                            alphabet,
+	StringToStateMap*                    state_map = nullptr)
+{ // {{{
+	Dpa result;
+	construct(&result, parsec, alphabet, state_map);
+	return result;
+} // construct(Alphabet) }}}
+
+/** Loads an automaton from Parsed object */
+void construct(
+	Dpa*                                 aut,
+	const Vata2::Parser::ParsedSection&  parsec,
+	StringToSymbolMap*                   symbol_map = nullptr,
+	StringToStateMap*                    state_map = nullptr);
+
+/** Loads an automaton from Parsed object */
+inline Dpa construct(
+	const Vata2::Parser::ParsedSection&  parsec,
+	StringToSymbolMap*                   symbol_map = nullptr,
+	StringToStateMap*                    state_map = nullptr)
+{ // {{{
+	Dpa result;
+	construct(&result, parsec, symbol_map, state_map);
+	return result;
+} // construct }}}
+
+/// Log-likelihood of a word in an automaton (uses no compiled tables)
+LogProb score(const Dpa& aut, const Word& word);
+
+/// the underlying NFA (transitions with non-zero probability; states with
+/// non-zero final probability are final)
+Vata2::Nfa::Nfa get_support(const Dpa& aut);
+
+/// operator<<
+std::ostream& operator<<(std::ostream& strm, const Dpa& dpa);
+
+/// a wrapper encapsulating @p Dpa for higher-level use
+struct DpaWrapper
+{ // {{{
+	/// the DPA
+	Dpa dpa = {};
+
+	/// the alphabet
+	Alphabet* alphabet = nullptr;
+
+	/// mapping of state names (as strings) to their numerical values
+	StringToStateMap state_dict = {};
+}; // DpaWrapper }}}
+
+/// global constructor to be called at program startup (from vm-dispatch)
+void init();
+
+// CLOSING NAMESPACES AND GUARDS
+} /* Dpa */
+} /* Vata2 */
+
+namespace std
+{ // {{{
+std::ostream& operator<<(std::ostream& os, const Vata2::Dpa::Trans& trans);
+std::ostream& operator<<(std::ostream& os, const Vata2::Dpa::DpaWrapper& dpa_wrap);
+} // std }}}
+
+#endif /* _VATA2_DPA_HH_ */
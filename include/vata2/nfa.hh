@@ -21,12 +21,14 @@
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <memory>
 #include <set>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 // VATA2 headers
+#include <vata2/parallel.hh>
 #include <vata2/parser.hh>
 #include <vata2/util.hh>
 
@@ -34,7 +36,9 @@ namespace Vata2
 {
 namespace Nfa
 {
-extern const std::string TYPE_NFA;
+/// the name of the type (a constant, as it is used by dispatchers registered
+/// during static initialization)
+constexpr const char TYPE_NFA[] = "NFA";
 
 // START OF THE DECLARATIONS
 
@@ -56,6 +60,10 @@ using SymbolToStringMap = std::unordered_map<Symbol, std::string>;
 
 using StringDict = std::unordered_map<std::string, std::string>;
 
+template <class T>
+using AsyncHandle = Vata2::parallel::AsyncHandle<T>;
+using ProgressCallback = Vata2::parallel::ProgressCallback;
+
 const PostSymb EMPTY_POST{};
 
 /// A transition
@@ -210,6 +218,79 @@ public:
 // }}}
 
 
+/// the maximum number of states that a Workspace marks in dense arrays
+/// (larger states are marked in a hash table)
+const size_t WORKSPACE_DENSE_MAX = 1 << 22;
+
+/**
+ * @brief  Reusable memory for traversals of automata
+ *
+ * Operations that accept a Workspace keep their worklists, marks of visited
+ * states, and macrostates in it instead of allocating them on every call.
+ * Once its buffers have grown to the size of the automata, repeated calls
+ * with the same workspace do not allocate.  Visited states are stamped with
+ * the number of the current traversal (the epoch), so starting a new
+ * traversal does not need to clear the marks.  A workspace may be used by
+ * one call at a time only; the contents of the buffers after a call are
+ * unspecified unless the operation says otherwise.
+ */
+struct Workspace
+{ // {{{
+private:
+
+	uint32_t epoch = 1;
+	/// the epoch in which a state was visited, and its parent
+	std::vector<uint32_t> stamps = { };
+	std::vector<State> parents = { };
+	/// the visited states (and their parents) not covered by the arrays
+	std::unordered_map<State, State> sparse = { };
+
+	bool grow(State state);
+
+public:
+
+	/// a FIFO worklist: a traversal pushes every state at most once and
+	/// reads it by an index, so the buffer does not need to wrap around
+	std::vector<State> worklist = { };
+	/// macrostates as unsorted vectors without duplicates
+	std::vector<State> macrostate = { };
+	std::vector<State> next_macrostate = { };
+	/// a sorted buffer of symbols
+	std::vector<Symbol> symbols = { };
+
+	/// starts a new traversal, in which no state is visited
+	void new_epoch();
+
+	/// marks @p state as visited from @p parent; returns false if it has
+	/// already been visited in the current epoch
+	bool visit(State state, State parent = 0)
+	{ // {{{
+		if (state >= this->stamps.size() && !this->grow(state)) {
+			return this->sparse.insert({state, parent}).second;
+		}
+
+		if (this->epoch == this->stamps[state]) { return false; }
+		this->stamps[state] = this->epoch;
+		this->parents[state] = parent;
+		return true;
+	} // visit }}}
+
+	bool is_visited(State state) const
+	{ // {{{
+		if (state < this->stamps.size()) { return this->epoch == this->stamps[state]; }
+		return Vata2::util::haskey(this->sparse, state);
+	} // is_visited }}}
+
+	/// the parent of a visited @p state
+	State get_parent(State state) const
+	{ // {{{
+		assert(this->is_visited(state));
+		if (state < this->stamps.size()) { return this->parents[state]; }
+		return this->sparse.at(state);
+	} // get_parent }}}
+}; // Workspace }}}
+
+
 struct Nfa;
 
 /// serializes Nfa into a ParsedSection
@@ -268,6 +349,23 @@ public:
 	bool trans_empty() const { return this->transitions.empty();};// no transitions
 	size_t trans_size() const;/// number of transitions; has linear time complexity
 
+	/// 1 + the largest state occurring in the automaton, i.e., the number of
+	/// states if they are numbered densely from 0; has linear time complexity
+	size_t num_states() const;
+
+	/// adds the transitions of @p aut with all states increased by @p offset
+	/// (the initial and final states of @p aut are not added)
+	void add_trans_shifted(const Nfa& aut, State offset);
+
+	/// moves the transitions out of the automaton (which is left without
+	/// transitions), so that they can be consumed while it is rebuilt
+	StateToPostMap release_transitions()
+	{ // {{{
+		StateToPostMap result = std::move(this->transitions);
+		this->transitions.clear();
+		return result;
+	} // release_transitions }}}
+
 	struct const_iterator
 	{ // {{{
 		const Nfa* nfa;
@@ -321,6 +419,15 @@ public:
 	/// gets a post of a set of states over a symbol
 	StateSet post(const StateSet& macrostate, Symbol sym) const;
 
+	/// gets a post of a macrostate (a vector without duplicates) over a
+	/// symbol into @p result (in no particular order); @p result must not be
+	/// @p macrostate
+	void post(
+		std::vector<State>*        result,
+		const std::vector<State>&  macrostate,
+		Symbol                     sym,
+		Workspace*                 ws) const;
+
 	// /// ostream& << operator
 	// friend std::ostream& operator<<(std::ostream& os, const Nfa& nfa)
 	// {
@@ -356,13 +463,21 @@ struct NfaWrapper
 
 /// Do the automata have disjoint sets of states?
 bool are_state_disjoint(const Nfa& lhs, const Nfa& rhs);
-/// Is the language of the automaton empty?
-bool is_lang_empty(const Nfa& aut, Path* cex = nullptr);
-bool is_lang_empty_cex(const Nfa& aut, Word* cex);
+/// Is the language of the automaton empty?  The buffers of @p ws are used
+/// if it is given
+bool is_lang_empty(const Nfa& aut, Path* cex = nullptr, Workspace* ws = nullptr);
+bool is_lang_empty_cex(const Nfa& aut, Word* cex, Workspace* ws = nullptr);
 
 /// Retrieves the states reachable from initial states
 std::unordered_set<State> get_fwd_reach_states(const Nfa& aut);
 
+/// Retrieves the states reachable from initial states (in the BFS order)
+/// into @p result, using the buffers of @p ws if it is given
+void get_fwd_reach_states(
+	std::vector<State>*  result,
+	const Nfa&           aut,
+	Workspace*           ws = nullptr);
+
 /// Is the language of the automaton universal?
 bool is_universal(
 	const Nfa&         aut,
@@ -415,12 +530,129 @@ inline Nfa union_norename(
 	return result;
 } // union_norename }}}
 
+/// Compute union of a pair of automata, reusing the storage of @p lhs
+/// Assumes that sets of states of lhs and rhs are disjoint
+Nfa union_norename(
+	Nfa&&       lhs,
+	const Nfa&  rhs);
+
 /// Compute union of a pair of automata
 /// The states of the automata do not need to be disjoint; renaming will be done
 Nfa union_rename(
 	const Nfa&  lhs,
 	const Nfa&  rhs);
 
+/**
+ * @brief  Compute union of a list of automata
+ *
+ * The states of auts[i] are increased by the sum of num_states() of the
+ * previous automata, so no renaming map is needed and the time is linear in
+ * the total size of the automata.
+ */
+void union_offset(
+	Nfa*                             result,
+	const std::vector<const Nfa*>&  auts);
+
+inline Nfa union_offset(const std::vector<const Nfa*>& auts)
+{ // {{{
+	Nfa result;
+	union_offset(&result, auts);
+	return result;
+} // union_offset }}}
+
+/// Compute union of a list of automata, reusing the storage of auts[0]
+Nfa union_offset(std::vector<Nfa>&& auts);
+
+/**
+ * @brief  Compute concatenation of a pair of automata
+ *
+ * The states of @p rhs are increased by lhs.num_states().  Final states of
+ * @p lhs get copies of the transitions leaving initial states of @p rhs, so
+ * no epsilon transitions are needed.
+ */
+void concatenate(
+	Nfa*        result,
+	const Nfa&  lhs,
+	const Nfa&  rhs);
+
+inline Nfa concatenate(
+	const Nfa&  lhs,
+	const Nfa&  rhs)
+{ // {{{
+	Nfa result;
+	concatenate(&result, lhs, rhs);
+	return result;
+} // concatenate }}}
+
+/// Compute concatenation of a pair of automata, reusing the storage of @p lhs
+Nfa concatenate(
+	Nfa&&       lhs,
+	const Nfa&  rhs);
+
+/**
+ * @brief  Compute concatenation of a list of automata
+ *
+ * Unlike repeated binary concatenation, the offsets of the states are
+ * accumulated, so the time is linear in the total size of the automata
+ * (plus the transitions added between final and initial states).  State 0 is
+ * the initial state accepting the empty word (the result for an empty list).
+ */
+void concatenate(
+	Nfa*                             result,
+	const std::vector<const Nfa*>&  auts);
+
+inline Nfa concatenate(const std::vector<const Nfa*>& auts)
+{ // {{{
+	Nfa result;
+	concatenate(&result, auts);
+	return result;
+} // concatenate(vector) }}}
+
+/**
+ * @brief  Iteration (Kleene star) of an automaton
+ *
+ * Final states get copies of the transitions leaving initial states and a
+ * new state (aut.num_states()) accepting the empty word is added (unless
+ * the empty word is already accepted).
+ */
+void star(Nfa* result, const Nfa& aut);
+
+inline Nfa star(const Nfa& aut)
+{ // {{{
+	Nfa result;
+	star(&result, aut);
+	return result;
+} // star }}}
+
+/// Iteration of an automaton, reusing the storage of @p aut
+Nfa star(Nfa&& aut);
+
+/// Iteration of an automaton without the empty word (e+ = ee*)
+void plus(Nfa* result, const Nfa& aut);
+
+inline Nfa plus(const Nfa& aut)
+{ // {{{
+	Nfa result;
+	plus(&result, aut);
+	return result;
+} // plus }}}
+
+/// Iteration without the empty word, reusing the storage of @p aut
+Nfa plus(Nfa&& aut);
+
+/// The language of an automaton extended with the empty word (e? = e|())
+void optional(Nfa* result, const Nfa& aut);
+
+inline Nfa optional(const Nfa& aut)
+{ // {{{
+	Nfa result;
+	optional(&result, aut);
+	return result;
+} // optional }}}
+
+/// The language extended with the empty word, reusing the storage of @p aut
+Nfa optional(Nfa&& aut);
+
 /// Compute intersection of a pair of automata
 void intersection(
 	Nfa*         result,
@@ -455,11 +687,64 @@ inline Nfa determinize(
 	return result;
 } // determinize }}}
 
-/// makes the transition relation complete
+/// Determinize an automaton that is consumed; its storage is released as
+/// soon as the result is built (the posts of its states may be needed by any
+/// macrostate until then)
+Nfa determinize(
+	Nfa&&       aut,
+	SubsetMap*  subset_map = nullptr,
+	State*      last_state_num = nullptr);
+
+/**
+ * @brief  Determinize an automaton using a method set by @p params
+ *
+ * The "algo" key is one of
+ *   - "classical": the subset construction as above
+ *   - "simulation": the maximal forward simulation on @p aut is computed
+ *     first and every macrostate is pruned to its simulation-maximal states
+ *     before it is looked up in @p subset_map.  Pruning keeps the language of
+ *     a macrostate, so the result is language-equivalent, but macrostates
+ *     that differ only by simulated states are merged.  The simulation takes
+ *     O(n^2) memory for n states.
+ */
+void determinize(
+	Nfa*               result,
+	const Nfa&         aut,
+	const StringDict&  params,
+	SubsetMap*         subset_map = nullptr,
+	State*             last_state_num = nullptr);
+
+inline Nfa determinize(
+	const Nfa&         aut,
+	const StringDict&  params,
+	SubsetMap*         subset_map = nullptr,
+	State*             last_state_num = nullptr)
+{ // {{{
+	Nfa result;
+	determinize(&result, aut, params, subset_map, last_state_num);
+	return result;
+} // determinize(params) }}}
+
+/// the symbols of @p alphabet, sorted and without duplicates (e.g. for
+/// repeated calls of make_complete() or is_complete())
+void get_sorted_symbols(std::vector<Symbol>* result, const Alphabet& alphabet);
+
+/// makes the transition relation complete (the symbols are obtained by
+/// Alphabet::get_symbols())
 void make_complete(
 	Nfa*             aut,
 	const Alphabet&  alphabet,
-	State            sink_state);
+	State            sink_state,
+	Workspace*       ws = nullptr);
+
+/// makes the transition relation complete over @p symbols, which are sorted
+/// and without duplicates; with a reused @p ws, only added transitions
+/// allocate
+void make_complete(
+	Nfa*                        aut,
+	const std::vector<Symbol>&  symbols,
+	State                       sink_state,
+	Workspace*                  ws = nullptr);
 
 /// Complement
 void complement(
@@ -490,6 +775,11 @@ inline Nfa revert(const Nfa& aut)
 	return result;
 } // revert }}}
 
+/// Reverting the automaton in place: the transitions of every state are
+/// released as soon as they are reverted, so the input and the result are
+/// never held in full at the same time
+Nfa revert(Nfa&& aut);
+
 /// Removing epsilon transitions
 void remove_epsilon(Nfa* result, const Nfa& aut, Symbol epsilon);
 
@@ -517,6 +807,115 @@ inline Nfa minimize(
 	return result;
 } // minimize }}}
 
+/// Minimizes an NFA that is consumed (every step of the construction
+/// consumes the automaton built by the previous one)
+Nfa minimize(
+	Nfa&&              aut,
+	const StringDict&  params = {});
+
+
+/// Removes states that are not reachable from initial states or that cannot
+/// reach a final state
+void trim(Nfa* result, const Nfa& aut);
+
+inline Nfa trim(const Nfa& aut)
+{ // {{{
+	Nfa result;
+	trim(&result, aut);
+	return result;
+} // trim }}}
+
+
+/**
+ * @brief  Reduces the size of an NFA without determinizing it
+ *
+ * Removes useless states and merges forward-bisimilar states; the states of
+ * the result are numbered from 0.  The method is set by the "algo" key of @p
+ * params (only "bisim" is supported so far).  If the "depth" key is set to k,
+ * states are merged if they are bisimilar up to depth k, which is coarser
+ * than bisimilarity and over-approximates the language (useful for widening).
+ */
+void reduce(
+	Nfa*               result,
+	const Nfa&         aut,
+	const StringDict&  params = {{"algo", "bisim"}});
+
+inline Nfa reduce(
+	const Nfa&         aut,
+	const StringDict&  params = {{"algo", "bisim"}})
+{ // {{{
+	Nfa result;
+	reduce(&result, aut, params);
+	return result;
+} // reduce }}}
+
+
+/**
+ * @brief  Constructs the canonical residual finite-state automaton (RFSA)
+ *
+ * The states are the prime residuals of the language (those that are not
+ * unions of other residuals), a transition p -a-> q is present iff q is a
+ * subset of the a-residual of p, and initial states are the prime residuals
+ * contained in the language.  The result is often much smaller than the
+ * minimal DFA and, since the states are numbered in the shortlex order of
+ * the least words leading to them, it is a canonical form of the language:
+ * equivalent automata give identical results.  The method is set by the
+ * "algo" key of @p params:
+ *   - "dfa": from the minimal DFA and inclusion of its residuals
+ *   - "double-reversal": by the subset construction on the co-deterministic
+ *     automaton obtained by reverting a determinized reverse of @p aut
+ */
+void canonical_rfsa(
+	Nfa*               result,
+	const Nfa&         aut,
+	const StringDict&  params = {{"algo", "double-reversal"}});
+
+inline Nfa canonical_rfsa(
+	const Nfa&         aut,
+	const StringDict&  params = {{"algo", "double-reversal"}})
+{ // {{{
+	Nfa result;
+	canonical_rfsa(&result, aut, params);
+	return result;
+} // canonical_rfsa }}}
+
+
+/// the maximum bound of repetition e{m,n} in regular expressions
+const size_t REGEX_REPEAT_MAX = 1000;
+
+/**
+ * @brief  Compiles a regular expression into an NFA over bytes
+ *
+ * Supports the common subset of POSIX ERE and PCRE syntax: alternation,
+ * grouping (also "(?:...)"), *, +, ?, bounded repetition {m}, {m,}, {m,n}
+ * (lazy variants are accepted), ".", bracket expressions with ranges,
+ * negation and [:name:] classes, and the escapes \d, \w, \s (and their
+ * negations), \n, \r, \t, \f, \v, \a, \e, \0 and \xHH.  "^" and "$" are
+ * allowed only at the ends of the expression.
+ *
+ * The result is the (epsilon-free) Glushkov automaton over symbols 0-255
+ * (i.e., @c CharAlphabet) with the initial state 0 and a state for every
+ * occurrence of a byte class in the expression.  The syntax tree is
+ * processed in a single bottom-up pass; bounded repetition is expanded.
+ * If the "match" key of @p params is "search", the automaton accepts
+ * words with a factor matching the expression (the default is "full"); "^"
+ * ("$") restricts the factor to a prefix (suffix), which is not supported
+ * for expressions that are alternatives outside of parentheses.
+ */
+void compile_regex(
+	Nfa*                result,
+	const std::string&  pattern,
+	const StringDict&   params = {});
+
+inline Nfa compile_regex(
+	const std::string&  pattern,
+	const StringDict&   params = {})
+{ // {{{
+	Nfa result;
+	compile_regex(&result, pattern, params);
+	return result;
+} // compile_regex }}}
+
 
 /// Test whether an automaton is deterministic, i.e., whether it has exactly
 /// one initial state and every state has at most one outgoing transition over
@@ -526,7 +925,17 @@ bool is_deterministic(const Nfa& aut);
 /// Test for automaton completeness wrt an alphabet.  An automaton is complete
 /// if every reachable state has at least one outgoing transition over every
 /// symbol.
-bool is_complete(const Nfa& aut, const Alphabet& alphabet);
+bool is_complete(
+	const Nfa&       aut,
+	const Alphabet&  alphabet,
+	Workspace*       ws = nullptr);
+
+/// Test for completeness wrt @p symbols (sorted and without duplicates);
+/// with a reused @p ws, the test does not allocate
+bool is_complete(
+	const Nfa&                  aut,
+	const std::vector<Symbol>&  symbols,
+	Workspace*                  ws = nullptr);
 
 /** Loads an automaton from Parsed object */
 void construct(
@@ -583,10 +992,281 @@ std::pair<Word, bool> get_word_for_path(const Nfa& aut, const Path& path);
 
 
 /// Checks whether a string is in the language of an automaton
-bool is_in_lang(const Nfa& aut, const Word& word);
+bool is_in_lang(const Nfa& aut, const Word& word, Workspace* ws = nullptr);
 
 /// Checks whether the prefix of a string is in the language of an automaton
-bool is_prfx_in_lang(const Nfa& aut, const Word& word);
+bool is_prfx_in_lang(const Nfa& aut, const Word& word, Workspace* ws = nullptr);
+
+/// the maximum number of states for the "bitparallel" algorithm of
+/// edit_distance()
+const size_t APPROX_BITPARALLEL_MAX = 64;
+
+/**
+ * @brief  Edit distance of a string to the language of an automaton
+ *
+ * Returns the least number of insertions, deletions and substitutions of
+ * symbols that turn @p word into a word of the language of @p aut, or @p
+ * max_dist + 1 if the distance is larger than @p max_dist.  The error
+ * automaton is never built; the method can be set using @p params:
+ *   - "match": "full" (default) or "search" (the distance of the closest
+ *     factor of @p word, i.e., the best match anywhere in @p word)
+ *   - "algo": "bitparallel" (a bit vector of states for every number of
+ *     errors, for at most APPROX_BITPARALLEL_MAX states), "product" (lazy
+ *     0-1 BFS over pairs (state, position in @p word)), or "auto" (the
+ *     default; "bitparallel" for small automata, otherwise "product")
+ */
+size_t edit_distance(
+	const Nfa&         aut,
+	const Word&        word,
+	size_t             max_dist,
+	const StringDict&  params = {});
+
+/// Checks whether a string is at most @p max_dist edits from the language of
+/// an automaton (see edit_distance())
+inline bool is_in_lang_approx(
+	const Nfa&         aut,
+	const Word&        word,
+	size_t             max_dist,
+	const StringDict&  params = {})
+{ // {{{
+	return edit_distance(aut, word, max_dist, params) <= max_dist;
+} // is_in_lang_approx }}}
+
+/**
+ * @brief  A node of a lazily evaluated expression over automata
+ *
+ * A node is an automaton given by its initial states, finality, and
+ * successor function, whose states are explored only when asked for.  The
+ * states of nodes built by the operations below are hash-consed tuples (or
+ * sets) of states of the operands, numbered densely, and their successors
+ * are cached, so every part of an expression is computed at most once.
+ * Users may derive their own nodes (e.g. for automata that are too large to
+ * build); nodes are not thread-safe.
+ */
+class LazyNode
+{ // {{{
+public:
+
+	/// the initial states
+	virtual const StateSet& get_initial() = 0;
+
+	virtual bool has_final(State state) = 0;
+
+	/// the successors of @p state over all symbols; the result is valid as
+	/// long as the node
+	virtual const PostSymb& post(State state) = 0;
+
+	/// the successors of @p state over @p symb (by default, taken from
+	/// post(State))
+	virtual const StateSet& post(State state, Symbol symb);
+
+	virtual ~LazyNode() { }
+}; // LazyNode }}}
+
+/// a lazily evaluated automaton (the root node of an expression)
+using LazyNfa = std::shared_ptr<LazyNode>;
+
+/// a lazy view of @p aut, which needs to outlive the view
+LazyNfa lazy(const Nfa& aut);
+/// a lazy view of @p aut, which is moved into the view
+LazyNfa lazy(Nfa&& aut);
+
+/**
+ * @brief  Lazy operations
+ *
+ * The operations build a graph of nodes and do not explore anything; states
+ * are explored by the terminal operations below (is_lang_empty(),
+ * is_in_lang(), and materialize()), only as far as they need.  The
+ * exception is revert(), which needs all predecessors of a state: it
+ * materializes its operand the first time it is explored.
+ *
+ * Adjacent operations are fused when the expression is built:
+ * revert(revert(x)) is x, determinize() of a deterministic node (a
+ * determinized or complemented one) is the node itself, complement() of
+ * determinize(x) is complement(x), and complement(complement(x)) over the
+ * same alphabet is determinize(x).  Hence, the results of terminal operations are determined
+ * by the languages of the operands, but materialize() need not return the
+ * same automaton as the eager operations.
+ */
+LazyNfa intersection(const LazyNfa& lhs, const LazyNfa& rhs);
+LazyNfa union_rename(const LazyNfa& lhs, const LazyNfa& rhs);
+LazyNfa complement(const LazyNfa& aut, const Alphabet& alphabet);
+LazyNfa revert(const LazyNfa& aut);
+LazyNfa determinize(const LazyNfa& aut);
+
+/// Is the language of a lazy automaton empty?  Sets @p cex to a word of the
+/// language if not
+bool is_lang_empty(const LazyNfa& aut, Word* cex = nullptr);
+
+/// Checks whether a string is in the language of a lazy automaton
+bool is_in_lang(const LazyNfa& aut, const Word& word);
+
+/// Builds the part of a lazy automaton reachable from its initial states
+void materialize(Nfa* result, const LazyNfa& aut);
+
+inline Nfa materialize(const LazyNfa& aut)
+{ // {{{
+	Nfa result;
+	materialize(&result, aut);
+	return result;
+} // materialize }}}
+
+/// a state stored in a SharedStore or a SharedNfa: its finality and its
+/// transitions sorted by (symbol, target), with targets numbered as states
+/// of a SharedNfa
+struct SharedNode
+{ // {{{
+	bool final = false;
+	std::vector<std::pair<Symbol, State>> succ = { };
+
+	bool operator==(const SharedNode& rhs) const
+	{ // {{{
+		return this->final == rhs.final && this->succ == rhs.succ;
+	} // operator== }}}
+}; // SharedNode }}}
+
+class SharedStore;
+
+/**
+ * @brief  An automaton whose acyclic tails are kept in a SharedStore
+ *
+ * Only the states that can reach a cycle are stored in the view (in a
+ * compact form); the others are nodes of the store.  States of the view are
+ * numbered so that even states are the nodes of the store and odd states
+ * are the states of the view.  The store needs to outlive the view.
+ */
+class SharedNfa
+{ // {{{
+private:
+
+	const SharedStore* store;
+	std::vector<SharedNode> nodes = { };
+	StateSet initialstates = { };
+
+	friend class SharedStore;
+
+	explicit SharedNfa(const SharedStore* store) : store(store) { }
+
+public:
+
+	SharedNfa(const SharedNfa&) = default;
+	SharedNfa(SharedNfa&&) = default;
+	SharedNfa& operator=(const SharedNfa&) = default;
+	SharedNfa& operator=(SharedNfa&&) = default;
+
+	const StateSet& get_initial() const { return this->initialstates; }
+
+	inline const SharedNode& get_node(State state) const;
+
+	/// the number of states (and transitions) that are not shared
+	size_t num_private_states() const { return this->nodes.size(); }
+	size_t num_private_trans() const;
+}; // SharedNfa }}}
+
+/**
+ * @brief  A store of the acyclic tails of many automata
+ *
+ * Rule libraries often consist of many automata that share long identical
+ * suffixes.  When an automaton is added, every reachable state from which no
+ * cycle is reachable is hash-consed over its finality and its sorted
+ * transitions (to hash-consed states), bottom-up, so isomorphic acyclic
+ * sub-automata of all added automata are stored once.  The rest of the
+ * automaton is kept in the returned view.  Nodes are never removed from the
+ * store, and the store is not thread-safe.
+ */
+class SharedStore
+{ // {{{
+private:
+
+	struct NodeHash
+	{ // {{{
+		size_t operator()(const SharedNode& node) const
+		{ // {{{
+			size_t accum = std::hash<bool>{}(node.final);
+			for (const auto& symb_tgt : node.succ)
+			{
+				accum = Vata2::util::hash_combine(accum, symb_tgt.first);
+				accum = Vata2::util::hash_combine(accum, symb_tgt.second);
+			}
+
+			return accum;
+		} // operator() }}}
+	}; // NodeHash }}}
+
+	std::vector<const SharedNode*> nodes = { };
+	std::unordered_map<SharedNode, State, NodeHash> index = { };
+	size_t num_trans = 0;
+
+	SharedStore(const SharedStore&);
+	SharedStore& operator=(const SharedStore&);
+
+	State add_node(SharedNode&& node);
+
+public:
+
+	SharedStore() { }
+
+	/// adds the part of @p aut reachable from its initial states
+	SharedNfa add(const Nfa& aut);
+
+	const SharedNode& get_node(State id) const
+	{ // {{{
+		assert(id < this->nodes.size());
+		return *this->nodes[id];
+	} // get_node }}}
+
+	size_t num_nodes() const { return this->nodes.size(); }
+	size_t num_node_trans() const { return this->num_trans; }
+}; // SharedStore }}}
+
+inline const SharedNode& SharedNfa::get_node(State state) const
+{ // {{{
+	if (0 == state % 2) { return this->store->get_node(state / 2); }
+
+	assert(state / 2 < this->nodes.size());
+	return this->nodes[state / 2];
+} // SharedNfa::get_node }}}
+
+/// Checks whether a string is in the language of a shared automaton
+bool is_in_lang(const SharedNfa& aut, const Word& word);
+
+/// a lazy view of @p aut (e.g. for is_lang_empty() or materialize()), which
+/// needs to outlive the view
+LazyNfa lazy(const SharedNfa& aut);
+
+/**
+ * @brief  Asynchronous operations
+ *
+ * The operations run in the pool of Vata2::parallel (see run_async()) and
+ * take the automata by value, so they can be moved in.  @p callback
+ * receives the numbers of explored (macro)states and of states in the
+ * worklist of the current phase (e.g. of each determinization in
+ * minimize()).  After cancel() is called on the handle, the operation stops
+ * at its next report and get() throws Vata2::parallel::Cancelled.
+ */
+AsyncHandle<Nfa> determinize_async(
+	Nfa               aut,
+	ProgressCallback  callback = nullptr);
+
+AsyncHandle<Nfa> minimize_async(
+	Nfa               aut,
+	ProgressCallback  callback = nullptr,
+	const StringDict& params = {});
+
+/// @p alphabet needs to outlive the operation
+AsyncHandle<bool> is_incl_async(
+	Nfa               smaller,
+	Nfa               bigger,
+	const Alphabet&   alphabet,
+	ProgressCallback  callback = nullptr,
+	const StringDict& params = {});
+
+/// loads the first section of the VTF file @p filename; @p alphabet needs to
+/// outlive the operation and must not be used by others in the meantime
+AsyncHandle<Nfa> load_async(
+	const std::string&  filename,
+	Alphabet*           alphabet,
+	ProgressCallback    callback = nullptr);
 
 /** Encodes a vector of strings (each corresponding to one symbol) into a
  *  @c Word instance
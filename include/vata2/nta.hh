@@ -0,0 +1,381 @@
+/* nta.hh -- nondeterministic (bottom-up) tree automaton
+ *
+ * Copyright (c) 2018 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _VATA2_NTA_HH_
+#define _VATA2_NTA_HH_
+
+#include <cassert>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// VATA2 headers
+#include <vata2/nfa.hh>
+#include <vata2/parser.hh>
+#include <vata2/util.hh>
+
+namespace Vata2
+{
+namespace Nta
+{
+/// the name of the type (a constant, as it is used by dispatchers registered
+/// during static initialization)
+constexpr const char TYPE_NTA[] = "NTA";
+
+// START OF THE DECLARATIONS
+
+using State = Vata2::Nfa::State;
+using Symbol = Vata2::Nfa::Symbol;
+using StateSet = Vata2::Nfa::StateSet;
+
+using StringToStateMap = Vata2::Nfa::StringToStateMap;
+using StringToSymbolMap = Vata2::Nfa::StringToSymbolMap;
+using StateToStringMap = Vata2::Nfa::StateToStringMap;
+using SymbolToStringMap = Vata2::Nfa::SymbolToStringMap;
+using StringDict = Vata2::Nfa::StringDict;
+
+using Alphabet = Vata2::Nfa::Alphabet;
+
+/// a tuple of (children) states
+using StateTuple = std::vector<State>;
+
+/// A transition (q1, ..., qn) -a-> q
+struct Trans
+{ // {{{
+	StateTuple children;
+	Symbol symb;
+	State tgt;
+
+	Trans() : children(), symb(), tgt() { }
+	Trans(const StateTuple& children, Symbol symb, State tgt) :
+		children(children), symb(symb), tgt(tgt)
+	{ }
+
+	bool operator==(const Trans& rhs) const
+	{ // {{{
+		return children == rhs.children && symb == rhs.symb && tgt == rhs.tgt;
+	} // operator== }}}
+	bool operator!=(const Trans& rhs) const { return !this->operator==(rhs); }
+}; // Trans }}}
+
+/// A (finite ordered ranked) tree
+struct Tree
+{ // {{{
+	Symbol symb;
+	std::vector<Tree> children;
+
+	Tree() : symb(), children() { }
+	Tree(Symbol symb, const std::vector<Tree>& children = { }) :
+		symb(symb), children(children)
+	{ }
+
+	bool operator==(const Tree& rhs) const
+	{ // {{{
+		return symb == rhs.symb && children == rhs.children;
+	} // operator== }}}
+	bool operator!=(const Tree& rhs) const { return !this->operator==(rhs); }
+}; // Tree }}}
+
+/// identifier of a tuple in a TupleTable
+using TupleId = uint32_t;
+
+/// identifier of a transition of an Nta
+using TransId = uint32_t;
+
+/**
+ * @brief  A table of hash-consed tuples of states
+ *
+ * Every tuple is stored once and gets a stable identifier, so transitions
+ * with the same children share them.
+ */
+class TupleTable
+{ // {{{
+private:
+
+	std::vector<StateTuple> tuples = { };
+	std::unordered_map<StateTuple, TupleId> ids = { };
+
+public:
+
+	/// returns the identifier of @p tuple (inserting it if needed)
+	TupleId intern(const StateTuple& tuple)
+	{ // {{{
+		auto it_ins = this->ids.insert({tuple, static_cast<TupleId>(this->tuples.size())});
+		if (it_ins.second) { this->tuples.push_back(tuple); }
+		return it_ins.first->second;
+	} // intern }}}
+
+	/// finds the identifier of @p tuple; returns false if it is not in the table
+	bool find(const StateTuple& tuple, TupleId* id) const
+	{ // {{{
+		assert(nullptr != id);
+		auto it = this->ids.find(tuple);
+		if (this->ids.end() == it) { return false; }
+		*id = it->second;
+		return true;
+	} // find }}}
+
+	const StateTuple& operator[](TupleId id) const
+	{ // {{{
+		assert(id < this->tuples.size());
+		return this->tuples[id];
+	} // operator[] }}}
+
+	size_t size() const { return this->tuples.size(); }
+}; // TupleTable }}}
+
+
+struct Nta;
+
+/// serializes Nta into a ParsedSection
+Vata2::Parser::ParsedSection serialize(
+	const Nta&                aut,
+	const SymbolToStringMap*  symbol_map = nullptr,
+	const StateToStringMap*   state_map = nullptr);
+
+
+/**
+ * @brief  A nondeterministic bottom-up tree automaton
+ *
+ * Transitions (q1, ..., qn) -a-> q are stored as (tuple, symbol, target)
+ * triples with tuples hash-consed in a TupleTable.  Transitions are indexed
+ * by their symbol, by their target, and by the states of their children
+ * (both with and without the position), so that bottom-up and top-down
+ * successors do not need to scan all transitions.  Transitions of arity 0
+ * (leaves) are listed separately.
+ */
+struct Nta
+{ // {{{
+public:
+
+	/// a transition with an interned tuple of children
+	struct TransRec
+	{ // {{{
+		TupleId tuple;
+		Symbol symb;
+		State tgt;
+	}; // TransRec }}}
+
+	using TransList = std::vector<TransId>;
+
+private:
+
+	TupleTable tuples = { };
+	std::vector<TransRec> trans = { };
+	std::unordered_set<std::pair<std::pair<TupleId, Symbol>, State>> trans_set = { };
+
+	std::unordered_map<Symbol, TransList> by_symbol = { };
+	std::unordered_map<State, TransList> by_tgt = { };
+	/// one entry for every occurrence of a state among children
+	std::unordered_map<State, TransList> by_child = { };
+	std::unordered_map<std::pair<State, size_t>, TransList> by_child_pos = { };
+	TransList leaves = { };
+
+	/// returns the list for @p key in @p index (or an empty list)
+	template <class Index, class Key>
+	static const TransList& get_list(const Index& index, const Key& key)
+	{ // {{{
+		static const TransList EMPTY;
+		auto it = index.find(key);
+		return (index.end() == it)? EMPTY : it->second;
+	} // get_list }}}
+
+public:
+
+	StateSet finalstates = { };
+
+	void add_final(State state) { this->finalstates.insert(state); }
+	void add_final(const std::vector<State> vec)
+	{ // {{{
+		for (const State& st : vec) { this->add_final(st); }
+	} // }}}
+	bool has_final(State state) const
+	{ // {{{
+		return Vata2::util::haskey(this->finalstates, state);
+	} // }}}
+
+	void add_trans(const StateTuple& children, Symbol symb, State tgt);
+	void add_trans(const Trans& trans) { this->add_trans(trans.children, trans.symb, trans.tgt); }
+
+	bool has_trans(const StateTuple& children, Symbol symb, State tgt) const;
+	bool has_trans(const Trans& trans) const
+	{ // {{{
+		return this->has_trans(trans.children, trans.symb, trans.tgt);
+	} // }}}
+
+	bool trans_empty() const { return this->trans.empty(); }
+	size_t trans_size() const { return this->trans.size(); } /// number of transitions
+
+	const TupleTable& get_tuples() const { return this->tuples; }
+
+	const TransRec& get_trans_rec(TransId id) const
+	{ // {{{
+		assert(id < this->trans.size());
+		return this->trans[id];
+	} // get_trans_rec }}}
+
+	const StateTuple& get_children(TransId id) const
+	{ // {{{
+		return this->tuples[this->get_trans_rec(id).tuple];
+	} // get_children }}}
+
+	Trans get_trans(TransId id) const
+	{ // {{{
+		const TransRec& rec = this->get_trans_rec(id);
+		return {this->tuples[rec.tuple], rec.symb, rec.tgt};
+	} // get_trans }}}
+
+	/// all transitions (in the order of their insertion)
+	std::vector<Trans> get_transitions() const;
+
+	const TransList& get_trans_by_symbol(Symbol symb) const
+	{ // {{{
+		return get_list(this->by_symbol, symb);
+	} // }}}
+	const TransList& get_trans_to(State tgt) const
+	{ // {{{
+		return get_list(this->by_tgt, tgt);
+	} // }}}
+	/// transitions with @p child among children (once for every occurrence)
+	const TransList& get_trans_by_child(State child) const
+	{ // {{{
+		return get_list(this->by_child, child);
+	} // }}}
+	/// transitions with @p child at position @p pos of children
+	const TransList& get_trans_by_child(State child, size_t pos) const
+	{ // {{{
+		return get_list(this->by_child_pos, std::make_pair(child, pos));
+	} // }}}
+	const TransList& get_leaf_trans() const { return this->leaves; }
+
+	/// bottom-up post: targets of transitions over @p symb whose children
+	/// are all in @p states
+	StateSet post(const StateSet& states, Symbol symb) const;
+
+	/// top-down pre: tuples of children of transitions over @p symb to @p tgt
+	std::vector<TupleId> pre(State tgt, Symbol symb) const;
+}; // Nta }}}
+
+
+/// Computes the set of states reachable by the automaton on @p tree
+StateSet get_reach_states(const Nta& aut, const Tree& tree);
+
+/// Checks whether a tree is in the language of an automaton
+bool is_in_lang(const Nta& aut, const Tree& tree);
+
+/// Computes the set of states that accept some tree
+std::unordered_set<State> get_useful_states(const Nta& aut);
+
+/// Is the language of the automaton empty?  Sets @p cex to an accepted tree
+/// if not
+bool is_lang_empty(const Nta& aut, Tree* cex = nullptr);
+
+/**
+ * @brief  Checks inclusion of languages of two automata
+ *
+ * The algorithm is set by the "algo" key of @p params:
+ *
+ *  - "upward_antichains" (or "antichains") explores pairs (q, S) of a state
+ *    of @p smaller and the set of states of @p bigger reachable on the same
+ *    tree bottom-up, keeping only pairs with ⊆-minimal sets,
+ *  - "downward_antichains" checks top-down that the language of every final
+ *    state of @p smaller is included in the union of languages of final
+ *    states of @p bigger, caching pairs (q, S) known not to be included
+ *    (with ⊆-maximal sets) and known to be included (with ⊆-minimal sets).
+ *    It does not need to compute the sets of states of @p bigger reachable
+ *    bottom-up, which may be large for automata with many leaves.
+ *
+ * @param[out]  cex  A tree in the language of @p smaller but not of @p bigger
+ *                   (if not nullptr and the inclusion does not hold)
+ */
+bool is_incl(
+	const Nta&         smaller,
+	const Nta&         bigger,
+	Tree*              cex = nullptr,
+	const StringDict&  params = {{"algo", "antichains"}});
+
+/** Loads an automaton from Parsed object
+ *
+ * A transition (q1, ..., qn) -a-> q is given by the line "q1 ... qn a q".
+ */
+void construct(
+	Nta*                                 aut,
+	const Vata2::Parser::ParsedSection&  parsec,
+	Alphabet*                            alphabet,
+	StringToStateMap*                    state_map = nullptr);
+
+/** Loads an automaton from Parsed object */
+inline Nta construct(
+	const Vata2::Parser::ParsedSection&  parsec,
+	Alphabet*                            alphabet,
+	StringToStateMap*                    state_map = nullptr)
+{ // {{{
+	Nta result;
+	construct(&result, parsec, alphabet, state_map);
+	return result;
+} // construct(Alphabet) }}}
+
+/** Loads an automaton from Parsed object */
+void construct(
+	Nta*                                 aut,
+	const Vata2::Parser::ParsedSection&  parsec,
+	StringToSymbolMap*                   symbol_map = nullptr,
+	StringToStateMap*                    state_map = nullptr);
+
+/** Loads an automaton from Parsed object */
+inline Nta construct(
+	const Vata2::Parser::ParsedSection&  parsec,
+	StringToSymbolMap*                   symbol_map = nullptr,
+	StringToStateMap*                    state_map = nullptr)
+{ // {{{
+	Nta result;
+	construct(&result, parsec, symbol_map, state_map);
+	return result;
+} // construct }}}
+
+/// operator<<
+std::ostream& operator<<(std::ostream& strm, const Nta& nta);
+
+/// a wrapper encapsulating @p Nta for higher-level use
+struct NtaWrapper
+{ // {{{
+	/// the NTA
+	Nta nta = {};
+
+	/// the alphabet
+	Alphabet* alphabet = nullptr;
+
+	/// mapping of state names (as strings) to their numerical values
+	StringToStateMap state_dict = {};
+}; // NtaWrapper }}}
+
+/// global constructor to be called at program startup (from vm-dispatch)
+void init();
+
+// CLOSING NAMESPACES AND GUARDS
+} /* Nta */
+} /* Vata2 */
+
+namespace std
+{ // {{{
+std::ostream& operator<<(std::ostream& os, const Vata2::Nta::Trans& trans);
+std::ostream& operator<<(std::ostream& os, const Vata2::Nta::Tree& tree);
+std::ostream& operator<<(std::ostream& os, const Vata2::Nta::NtaWrapper& nta_wrap);
+} // std }}}
+
+#endif /* _VATA2_NTA_HH_ */
@@ -0,0 +1,377 @@
+/* parallel.hh -- the process-wide work-stealing thread pool
+ *
+ * Copyright (c) 2018 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _VATA2_PARALLEL_HH_
+#define _VATA2_PARALLEL_HH_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Vata2
+{
+namespace parallel
+{
+
+using StringDict = std::unordered_map<std::string, std::string>;
+
+/// a unit of work
+using Task = std::function<void()>;
+
+/// placement of worker threads on CPUs (the pool is NUMA-agnostic; the
+/// operating system decides where memory lives)
+enum class Affinity
+{
+	NONE,      ///< threads are not pinned
+	COMPACT,   ///< worker i is pinned to the i-th allowed CPU
+	SCATTER    ///< workers are pinned to CPUs spread evenly over the allowed ones
+};
+
+
+/**
+ * @brief  The process-wide work-stealing thread pool
+ *
+ * Every worker has its own deque of tasks: it pushes and pops tasks at the
+ * back and other workers steal from the front.  Tasks submitted from
+ * outside of the pool go to a shared queue.  All parallel operations of the
+ * library run on the single instance returned by get(), so they never
+ * create their own threads; a thread waiting for a TaskGroup executes
+ * pending tasks in the meantime, so nested parallelism does not block
+ * workers (and with 0 workers, tasks run in the waiting thread).
+ *
+ * The number of threads (the workers and the thread that waits for them)
+ * is taken from the VATA_THREADS environment variable when the pool is
+ * first used; by default, it is the number of hardware threads.
+ */
+class ThreadPool
+{ // {{{
+private:
+
+	/// a queue of tasks with its own lock
+	struct Queue
+	{ // {{{
+		std::mutex mtx = { };
+		std::deque<Task> tasks = { };
+	}; // Queue }}}
+
+	/// the queue of every worker; shared_queue is for external submissions
+	std::vector<std::unique_ptr<Queue>> queues = { };
+	/// guards the vector of queues (not the queues themselves): shared by
+	/// submit() and pop(), exclusive when configure() rebuilds it
+	std::shared_timed_mutex queues_mtx = { };
+	Queue shared_queue = { };
+	std::vector<std::thread> workers = { };
+	/// the size of workers (read without config_mtx)
+	std::atomic<size_t> num_workers_ = { 0 };
+	Affinity affinity = Affinity::NONE;
+
+	/// the number of queued tasks
+	std::atomic<size_t> pending = { 0 };
+	std::atomic<bool> stop = { false };
+	std::mutex sleep_mtx = { };
+	std::condition_variable sleep_cv = { };
+
+	/// serializes configure() calls
+	std::mutex config_mtx = { };
+
+	ThreadPool(const ThreadPool&);
+	ThreadPool& operator=(const ThreadPool&);
+
+	explicit ThreadPool(size_t num_workers);
+
+	void start(size_t num_workers);
+	void shutdown();
+	void work(size_t index);
+	bool pop(Task* task, size_t index);
+
+public:
+
+	/// the process-wide pool
+	static ThreadPool& get();
+
+	~ThreadPool();
+
+	/// the number of worker threads
+	size_t num_workers() const { return this->num_workers_; }
+
+	/**
+	 * @brief  Reconfigures the pool
+	 *
+	 * The keys of @p params are "threads" (the number of workers plus one for
+	 * the waiting thread, as for VATA_THREADS) and "affinity" ("none",
+	 * "compact", or "scatter").  Workers are restarted;
+	 * queued tasks are kept.  It may be called while other threads use the
+	 * pool (their tasks then wait for the new workers or run in the waiting
+	 * threads), but not from a task.
+	 */
+	void configure(const StringDict& params);
+
+	/// queues @p task (at the back of the deque of the calling worker)
+	void submit(Task task);
+
+	/// executes one queued task in the calling thread; returns false if
+	/// there was none
+	bool run_one();
+}; // ThreadPool }}}
+
+
+/**
+ * @brief  A group of tasks that can be waited for and cancelled together
+ *
+ * The first exception thrown by a task cancels the group and is rethrown
+ * by wait().  Tasks of a cancelled group that have not started yet are
+ * skipped; running tasks may poll is_cancelled().  The destructor waits for
+ * the tasks (but does not rethrow).
+ */
+class TaskGroup
+{ // {{{
+private:
+
+	ThreadPool& pool;
+	std::atomic<size_t> unfinished = { 0 };
+	std::atomic<bool> cancelled = { false };
+
+	std::mutex mtx = { };
+	std::condition_variable done_cv = { };
+	std::exception_ptr exception = nullptr;
+
+	TaskGroup(const TaskGroup&);
+	TaskGroup& operator=(const TaskGroup&);
+
+	void finish_one();
+	void wait_nothrow();
+
+public:
+
+	explicit TaskGroup(ThreadPool& pool = ThreadPool::get()) : pool(pool) { }
+	~TaskGroup() { this->wait_nothrow(); }
+
+	/// runs @p task in the pool
+	void run(Task task);
+
+	/// waits for all tasks of the group (executing queued tasks meanwhile)
+	/// and rethrows the first exception of a task
+	void wait();
+
+	void cancel() { this->cancelled = true; }
+	bool is_cancelled() const { return this->cancelled; }
+}; // TaskGroup }}}
+
+
+/**
+ * @brief  Runs @p body for every index in [@p begin, @p end) in the pool
+ *
+ * The range is split into chunks.  The "threads" key of @p params bounds
+ * the number of chunks running at the same time (the default is the number
+ * of workers plus the calling thread); "1" runs the loop sequentially in
+ * the calling thread.  If @p body throws, the remaining chunks are skipped
+ * and the first exception is rethrown.
+ */
+void parallel_for(
+	size_t                              begin,
+	size_t                              end,
+	const std::function<void(size_t)>&  body,
+	const StringDict&                   params = {});
+
+/// the parallelism requested by the "threads" key of @p params (or the
+/// number of workers plus the calling thread)
+size_t get_parallelism(const StringDict& params);
+
+
+/// the progress of an asynchronous operation (of its current phase)
+struct Progress
+{ // {{{
+	size_t explored = 0;   ///< explored states (macrostates, lines, ...)
+	size_t worklist = 0;   ///< states waiting to be explored
+}; // Progress }}}
+
+/// a callback receiving the progress of an asynchronous operation; it is
+/// called in the thread running the operation
+using ProgressCallback = std::function<void(const Progress&)>;
+
+/// thrown in a cancelled asynchronous operation (and by its handle)
+class Cancelled : public std::runtime_error
+{ // {{{
+public:
+
+	Cancelled() : std::runtime_error("the operation was cancelled") { }
+}; // Cancelled }}}
+
+
+/**
+ * @brief  The state shared by an asynchronous operation and its handle
+ *
+ * Operations of the library report their progress by calling
+ * report_progress(), which passes it to the job of the operation running in
+ * the calling thread (if any): the callback is called at most once per
+ * interval, and a cancelled job throws Cancelled.
+ */
+class Job
+{ // {{{
+private:
+
+	std::atomic<bool> cancelled = { false };
+	ProgressCallback callback;
+	std::chrono::steady_clock::duration interval;
+	std::chrono::steady_clock::time_point last_report = { };
+
+	mutable std::mutex mtx = { };
+	Progress progress = { };
+
+	Job(const Job&);
+	Job& operator=(const Job&);
+
+public:
+
+	Job(ProgressCallback callback, std::chrono::steady_clock::duration interval) :
+		callback(std::move(callback)), interval(interval)
+	{ }
+
+	void cancel() { this->cancelled = true; }
+	bool is_cancelled() const { return this->cancelled; }
+
+	/// the last reported progress
+	Progress get_progress() const;
+
+	/// records @p progress (and calls the callback if the interval passed)
+	void report(const Progress& progress);
+}; // Job }}}
+
+
+/// reports the progress of the asynchronous operation running in the
+/// calling thread; does nothing outside of asynchronous operations
+void report_progress(size_t explored, size_t worklist);
+
+/// submits @p task, which runs with @p job set as the job of its thread
+void submit_job(const std::shared_ptr<Job>& job, Task task);
+
+
+/**
+ * @brief  A handle of an asynchronous operation started by run_async()
+ *
+ * The handle is movable but not copyable.  Waiting for the operation in a
+ * thread executes queued tasks of the pool in the meantime (as in
+ * TaskGroup::wait()), so with no workers, the operation runs when it is
+ * waited for.
+ */
+template <class T>
+class AsyncHandle
+{ // {{{
+private:
+
+	std::future<T> future;
+	std::shared_ptr<Job> job;
+
+public:
+
+	AsyncHandle(std::future<T>&& future, std::shared_ptr<Job> job) :
+		future(std::move(future)), job(std::move(job))
+	{ }
+
+	AsyncHandle(AsyncHandle&&) = default;
+	AsyncHandle& operator=(AsyncHandle&&) = default;
+
+	bool is_ready() const
+	{ // {{{
+		return std::future_status::ready ==
+			this->future.wait_for(std::chrono::seconds(0));
+	} // is_ready }}}
+
+	void wait() const
+	{ // {{{
+		while (!this->is_ready())
+		{
+			if (ThreadPool::get().run_one()) { continue; }
+			this->future.wait_for(std::chrono::milliseconds(1));
+		}
+	} // wait }}}
+
+	/// waits for the result; rethrows the exception of the operation (or
+	/// Cancelled); can be called once
+	T get()
+	{ // {{{
+		this->wait();
+		return this->future.get();
+	} // get }}}
+
+	/// asks the operation to stop at its next report of progress
+	void cancel() { this->job->cancel(); }
+
+	Progress get_progress() const { return this->job->get_progress(); }
+}; // AsyncHandle }}}
+
+
+/// sets the value of @p promise to the result of @p op
+template <class T, class Operation>
+void fulfil(std::promise<T>* promise, Operation& op) { promise->set_value(op()); }
+
+template <class Operation>
+void fulfil(std::promise<void>* promise, Operation& op)
+{ // {{{
+	op();
+	promise->set_value();
+} // fulfil }}}
+
+
+/**
+ * @brief  Runs @p op asynchronously in the pool
+ *
+ * The operation is moved into the task; everything it refers to needs to
+ * outlive it.  @p callback receives the progress reported by the operation
+ * at most once per @p interval.
+ */
+template <class Operation>
+AsyncHandle<decltype(std::declval<Operation&>()())> run_async(
+	Operation                  op,
+	ProgressCallback           callback = nullptr,
+	std::chrono::milliseconds  interval = std::chrono::milliseconds(100))
+{ // {{{
+	using T = decltype(std::declval<Operation&>()());
+
+	auto job = std::make_shared<Job>(std::move(callback), interval);
+	auto promise = std::make_shared<std::promise<T>>();
+	auto shared_op = std::make_shared<Operation>(std::move(op));
+	AsyncHandle<T> handle(promise->get_future(), job);
+
+	submit_job(job, [job, promise, shared_op]() {
+		try
+		{
+			if (job->is_cancelled()) { throw Cancelled(); }
+			fulfil(promise.get(), *shared_op);
+		}
+		catch (...) { promise->set_exception(std::current_exception()); }
+	});
+
+	return handle;
+} // run_async }}}
+
+// CLOSING NAMESPACES AND GUARDS
+} /* parallel */
+} /* Vata2 */
+
+#endif /* _VATA2_PARALLEL_HH_ */
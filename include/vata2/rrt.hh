@@ -21,6 +21,12 @@
 #ifndef _VATA2_RRT_HH_
 #define _VATA2_RRT_HH_
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <unordered_set>
+#include <vector>
+
 #include <vata2/nfa.hh>
 
 namespace Vata2
@@ -55,8 +61,13 @@ struct Trans
 		GuardType type;
 		Symbol val;     // although of type Symbol, it can also store register name
 
+    /// the guard with the value cleared if it is not used by the type
+    Guard normalized() const;
+
     bool operator==(const Guard& rhs) const;
     bool operator!=(const Guard& rhs) const { return !this->operator==(rhs); }
+    /// a total order on normalized guards
+    bool operator<(const Guard& rhs) const;
 	}; // Guard }}}
 
 	struct Update
@@ -76,6 +87,7 @@ struct Trans
 
     bool operator==(const Update& rhs) const;
     bool operator!=(const Update& rhs) const { return !this->operator==(rhs); }
+    bool operator<(const Update& rhs) const;
 	}; // Update }}}
 
 	struct Output
@@ -91,12 +103,15 @@ struct Trans
 		OutputType type;
 		Symbol val;        // register or auxiliary memory name (FIXME: smaller data type)
 
+    /// the output with the value cleared if it is not used by the type
+    Output normalized() const;
+
     bool operator==(const Output& rhs) const;
     bool operator!=(const Output& rhs) const { return !this->operator==(rhs); }
 	}; // Output }}}
 
-	using GuardList = std::list<Guard>;
-	using UpdateList = std::list<Update>;
+	using GuardList = std::vector<Guard>;
+	using UpdateList = std::vector<Update>;
 
   struct Label
   {	// {{{
@@ -114,6 +129,18 @@ struct Trans
     : guards(guards), updates(updates), out1(out1), out2(out2)
     { }
 
+    /**
+     * @brief  The canonical form of the label
+     *
+     * Guards and updates are sorted and deduplicated, and values that are not
+     * used by the type of a guard or an output are cleared, so that equal
+     * labels have identical canonical forms.
+     */
+    Label canonical() const;
+
+    /// the symbol on input tape 1 required by an IN1_IS guard (if any)
+    bool get_in1_symbol(Symbol* symb) const;
+
     bool operator==(const Label& rhs) const;
     bool operator!=(const Label& rhs) const { return !this->operator==(rhs); }
   }; // Label }}}
@@ -148,11 +175,59 @@ struct Trans
 	bool operator!=(const Trans& rhs) const { return !this->operator==(rhs); }
 }; // Trans }}}
 
-// the post here is more complex than, e.g., for NFAs due to the complicated
-// structure of Label, for which it is not easy to make a hash table; so far,
-// we use a list
-using PostSymb = std::list<std::pair<Trans::Label, State>>; /// post over a symbol
-using StateToPostMap = std::unordered_map<State, PostSymb>; /// transitions
+/// a hasher of labels in the canonical form
+struct LabelHash
+{ // {{{
+	size_t operator()(const Trans::Label& lbl) const;
+}; // LabelHash }}}
+
+/// identifier of an interned label
+using LabelId = uint32_t;
+
+/**
+ * @brief  A table of interned labels
+ *
+ * Every label is stored once in its canonical form and gets a stable
+ * identifier, so that labels can be compared by their identifiers.
+ */
+class LabelTable
+{ // {{{
+private:
+
+	std::vector<Trans::Label> labels = { };
+	std::unordered_map<Trans::Label, LabelId, LabelHash> ids = { };
+
+public:
+
+	/// returns the identifier of @p lbl (inserting it if needed)
+	LabelId intern(const Trans::Label& lbl);
+
+	/// finds the identifier of @p lbl; returns false if it is not in the table
+	bool find(const Trans::Label& lbl, LabelId* id) const;
+
+	const Trans::Label& operator[](LabelId id) const
+	{ // {{{
+		assert(id < this->labels.size());
+		return this->labels[id];
+	} // operator[] }}}
+
+	size_t size() const { return this->labels.size(); }
+}; // LabelTable }}}
+
+/// a label (interned) and a target state of a transition
+using LabelTgt = std::pair<LabelId, State>;
+using PostSymb = std::vector<LabelTgt>; /// post over a symbol
+
+/// transitions from a state indexed by the symbol on input tape 1
+struct StatePost
+{ // {{{
+	/// transitions whose labels require a given symbol on input tape 1
+	std::unordered_map<Symbol, PostSymb> in1_symbol = {};
+	/// transitions whose labels allow more symbols on input tape 1
+	PostSymb other = {};
+}; // StatePost }}}
+
+using StateToPostMap = std::unordered_map<State, StatePost>; /// transitions
 
 ///  A 2-tape RRT
 struct Rrt
@@ -163,6 +238,9 @@ private:
 	// returns something else than expected (basically returns the number of
 	// states with outgoing edges in the RRT)
 	StateToPostMap transitions = {};
+	LabelTable labels = {};
+	/// all transitions (source, (label, target)) for fast membership tests
+	std::unordered_set<std::pair<State, LabelTgt>> trans_set = {};
 
 public:
 
@@ -207,27 +285,239 @@ public:
 	bool has_trans(
 		State                 src,
 		const Trans::Label&   lbl,
-		State                 tgt);
-	bool has_trans(const Trans& trans) { return this->has_trans(trans.src, trans.lbl, trans.tgt); }
+		State                 tgt) const;
+	bool has_trans(const Trans& trans) const { return this->has_trans(trans.src, trans.lbl, trans.tgt); }
 	bool has_trans(
 		State                     src,
 		const Trans::GuardList&   guards,
 		const Trans::UpdateList&  updates,
 		const Trans::Output&      out1,
 		const Trans::Output&      out2,
-		State                     tgt)
+		State                     tgt) const
 	{ // {{{
 		return this->has_trans(src, Trans::Label(guards, updates, out1, out2), tgt);
 	} // }}}
 
+	bool trans_empty() const { return this->trans_set.empty(); }
+	size_t trans_size() const { return this->trans_set.size(); } /// number of transitions
+
+	/// the table of labels of the transducer
+	const LabelTable& get_labels() const { return this->labels; }
+	const Trans::Label& get_label(LabelId id) const { return this->labels[id]; }
+
+	/// transitions from @p src (or nullptr if there are none)
+	const StatePost* get_post(State src) const
+	{ // {{{
+		auto it = this->transitions.find(src);
+		return (this->transitions.end() == it)? nullptr : &it->second;
+	} // get_post }}}
+
+	/// calls @p func(label id, target) on transitions from @p src that may be
+	/// enabled if input tape 1 contains @p in1
+	template <class Func>
+	void for_each_trans(State src, Symbol in1, Func func) const
+	{ // {{{
+		const StatePost* post = this->get_post(src);
+		if (nullptr == post) { return; }
+
+		auto it = post->in1_symbol.find(in1);
+		if (post->in1_symbol.end() != it) {
+			for (const LabelTgt& lbl_tgt : it->second) { func(lbl_tgt.first, lbl_tgt.second); }
+		}
+
+		for (const LabelTgt& lbl_tgt : post->other) { func(lbl_tgt.first, lbl_tgt.second); }
+	} // for_each_trans }}}
+
+	/// all transitions (in an unspecified order)
+	std::vector<Trans> get_transitions() const;
+
 }; // Rrt }}}
 
+/// the number of bits of an encoded pair of symbols used for the second symbol
+const unsigned SYMBOL_PAIR_SHIFT = 32;
+
+/// encodes a pair of symbols (on tapes 1 and 2) into a single symbol
+inline Symbol encode_symbol_pair(Symbol first, Symbol second)
+{ // {{{
+	if ((first >> SYMBOL_PAIR_SHIFT) != 0 || (second >> SYMBOL_PAIR_SHIFT) != 0) {
+		throw std::runtime_error("symbol too large to be encoded in a pair: " +
+			std::to_string(std::max(first, second)));
+	}
+
+	return (first << SYMBOL_PAIR_SHIFT) | second;
+} // encode_symbol_pair }}}
+
+/// decodes a pair of symbols encoded by encode_symbol_pair()
+inline std::pair<Symbol, Symbol> decode_symbol_pair(Symbol symb)
+{ // {{{
+	return {symb >> SYMBOL_PAIR_SHIFT, symb & ((static_cast<Symbol>(1) << SYMBOL_PAIR_SHIFT) - 1)};
+} // decode_symbol_pair }}}
+
+/// values of registers followed by values of auxiliary memories
+using RegValuation = std::vector<Symbol>;
+
+/// the value of a register or an auxiliary memory that was not assigned
+const Symbol NO_VALUE = std::numeric_limits<Symbol>::max();
+
+/**
+ * @brief  The image of an NFA under an RRT constructed on the fly
+ *
+ * States of the image are reachable configurations (RRT state, NFA state,
+ * register valuation) numbered densely in the order of their discovery;
+ * register valuations are hash-consed and referred to by their identifiers.
+ * Symbols of both the NFA and the image are pairs of symbols (one for every
+ * tape) encoded by encode_symbol_pair().
+ *
+ * A transition of the RRT is enabled on a pair (in1, in2) if all its guards
+ * hold; guards and outputs are evaluated with the valuation before the
+ * updates of the transition.  IN1_VAR and IN2_VAR hold for every symbol,
+ * guards comparing a symbol with an unassigned register are true for
+ * inequality and false for equality, and outputting an unassigned register or
+ * auxiliary memory disables the transition.  Updates are applied in the
+ * canonical order of the label (stores before clears).
+ */
+class NfaImage
+{ // {{{
+public:
+
+	using ValuationId = uint32_t;
+	using SymbTgt = std::pair<Symbol, State>;
+
+	/// a state of the image
+	struct Config
+	{ // {{{
+		State rrt_state;
+		State nfa_state;
+		ValuationId val;
+
+		bool operator==(const Config& rhs) const
+		{ // {{{
+			return this->rrt_state == rhs.rrt_state && this->nfa_state == rhs.nfa_state &&
+				this->val == rhs.val;
+		} // operator== }}}
+
+		struct Hash
+		{ // {{{
+			size_t operator()(const Config& conf) const
+			{ // {{{
+				size_t accum = std::hash<State>{}(conf.rrt_state);
+				accum = Vata2::util::hash_combine(accum, conf.nfa_state);
+				return Vata2::util::hash_combine(accum, conf.val);
+			} // operator() }}}
+		}; // Hash }}}
+	}; // Config }}}
+
+private:
+
+	const Rrt& rrt;
+	const Nfa::Nfa& nfa;
+
+	size_t num_regs = 0;
+	size_t num_aux = 0;
+
+	std::vector<RegValuation> valuations = { };
+	std::unordered_map<RegValuation, ValuationId> valuation_ids = { };
+
+	std::vector<Config> configs = { };
+	std::unordered_map<Config, State, Config::Hash> config_ids = { };
+	std::vector<std::vector<SymbTgt>> posts = { };
+	std::vector<bool> expanded = { };
+
+	NfaImage(const NfaImage&);
+	NfaImage& operator=(const NfaImage&);
+
+	ValuationId get_valuation_id(const RegValuation& val);
+	State get_state(const Config& conf);
+
+	/// fires a transition with label @p lbl on (@p in1, @p in2) from @p val;
+	/// returns false if it is not enabled
+	bool fire(
+		const Trans::Label&  lbl,
+		Symbol               in1,
+		Symbol               in2,
+		const RegValuation&  val,
+		Symbol*              out,
+		RegValuation*        new_val) const;
+
+public:
+
+	Nfa::StateSet initialstates = { };
+
+	NfaImage(const Rrt& rrt, const Nfa::Nfa& nfa);
+
+	/// the number of states discovered so far
+	size_t num_states() const { return this->configs.size(); }
+	/// the number of distinct register valuations discovered so far
+	size_t num_valuations() const { return this->valuations.size(); }
+
+	const Config& get_config(State st) const
+	{ // {{{
+		assert(st < this->configs.size());
+		return this->configs[st];
+	} // get_config }}}
+
+	const RegValuation& get_valuation(ValuationId id) const
+	{ // {{{
+		assert(id < this->valuations.size());
+		return this->valuations[id];
+	} // get_valuation }}}
+
+	bool has_final(State st) const
+	{ // {{{
+		const Config& conf = this->get_config(st);
+		return this->rrt.has_final(conf.rrt_state) && this->nfa.has_final(conf.nfa_state);
+	} // has_final }}}
+
+	/// outgoing transitions of @p st (computed on the first call), sorted
+	const std::vector<SymbTgt>& post(State st);
+
+	/// explores the rest of the image and stores it into @p result (states of
+	/// the image are states of @p result)
+	void explore(Nfa::Nfa* result);
+}; // NfaImage }}}
+
+/// Is the language of the image empty?  Sets @p cex to a path to a final state
+/// if not.  Only the part of the image needed to find it is constructed.
+bool is_lang_empty(NfaImage& image, Nfa::Path* cex = nullptr);
+
+/// Is the language of the image included in the language of @p bigger?  Sets
+/// @p cex to a word of the image not accepted by @p bigger if not.  The image
+/// and the subset construction of @p bigger are explored on the fly; pairs
+/// whose subset of @p bigger includes one seen with the same state of the
+/// image are pruned (antichains).
+bool is_incl(NfaImage& image, const Nfa::Nfa& bigger, Nfa::Word* cex = nullptr);
+
 /** Computes the post of an NFA wrt an RRT
  *
- * Note that the symbols in the NFA are addresses of pairs of symbols (to match the RRT)
+ * Note that the symbols in the NFA are pairs of symbols (to match the RRT)
+ * encoded by encode_symbol_pair(); so are the symbols in the result.  Only
+ * configurations reachable from the initial ones are constructed.
  * */
 Nfa::Nfa post_of_nfa(const Rrt& rrt, const Nfa::Nfa& nfa);
 
+/**
+ * @brief  Computes the configurations reachable by repeated application of an RRT
+ *
+ * Starting from X_0 = @p init, iterates X_{i+1} = X_i ∪ post(X_i) until
+ * post(X_i) ⊆ X_i, which is checked on the image constructed on the fly.
+ * Every iterate is reduced by Nfa::reduce() unless the "reduce" key of @p
+ * params is "none".  If the "widen" key is set to k, states of every iterate
+ * that are bisimilar up to depth k are merged, so the result may be an
+ * over-approximation (but it is always closed under post).  The "max_iter"
+ * key limits the number of iterations.
+ *
+ * @param[out]  result    The last iterate
+ * @param[out]  num_iter  The number of iterations performed (if not nullptr)
+ *
+ * @returns  true if a fixpoint was reached
+ */
+bool reach_fixpoint(
+	Nfa::Nfa*                result,
+	const Rrt&               rrt,
+	const Nfa::Nfa&          init,
+	const Nfa::StringDict&   params = {},
+	size_t*                  num_iter = nullptr);
+
 // CLOSING NAMESPACES AND GUARDS
 } /* Rrt */
 } /* Vata2 */
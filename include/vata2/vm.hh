@@ -26,18 +26,21 @@
 namespace Vata2
 {
 
+// type names are constants (not std::string globals) since dispatchers are
+// registered during static initialization
+
 /// the type of tokens
-extern const std::string TYPE_TOKEN;
+constexpr const char TYPE_TOKEN[] = "token";
 /// the type name of the boolean data type
-extern const std::string TYPE_BOOL;
+constexpr const char TYPE_BOOL[] = "bool";
 /// the type name of the string data type
-extern const std::string TYPE_STR;
+constexpr const char TYPE_STR[] = "str";
 /// the type name of the void data type
-extern const std::string TYPE_VOID;
+constexpr const char TYPE_VOID[] = "void";
 /// the type name of Not a Value
-extern const std::string TYPE_NOT_A_VALUE;
+constexpr const char TYPE_NOT_A_VALUE[] = "nav";
 /// the type name of parsed section
-extern const std::string TYPE_PARSEC;
+constexpr const char TYPE_PARSEC[] = "parsec";
 
 namespace VM
 {
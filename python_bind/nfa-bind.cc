@@ -50,6 +50,8 @@ extern "C" void nfa_print(NfaId id_nfa);
 extern "C" void nfa_union(NfaId id_dst, NfaId id_lhs, NfaId id_rhs);
 extern "C" void nfa_minimize(NfaId id_dst, NfaId id_nfa);
 extern "C" void nfa_remove_epsilon(NfaId id_dst, NfaId id_nfa, Symbol epsilon);
+extern "C" int  nfa_from_regex(NfaId id_dst, const char* pattern, const Symbol* symbols,
+	int search);
 
 // language tests
 extern "C" int  nfa_is_incl(NfaId id_lhs, NfaId id_rhs);
@@ -301,3 +303,29 @@ void nfa_remove_epsilon(NfaId id_dst, NfaId id_nfa, Symbol epsilon)
 	Nfa* dst = mem[id_dst];
 	remove_epsilon(dst, *aut, epsilon);
 }
+
+int nfa_from_regex(NfaId id_dst, const char* pattern, const Symbol* symbols, int search)
+{
+	DEBUG_PRINT("Some bound checking here...");
+	Nfa* dst = mem[id_dst];
+
+	Nfa aut;
+	try {
+		StringDict params{{"match", search? "search" : "full"}};
+		compile_regex(&aut, pattern, params);
+	}
+	catch (const std::exception& ex) {
+		DEBUG_PRINT(ex.what());
+		return -1;
+	}
+
+	// bytes are translated to the symbols used by the caller
+	*dst = Nfa();
+	dst->initialstates = aut.initialstates;
+	dst->finalstates = aut.finalstates;
+	for (auto tr : aut) {
+		dst->add_trans(tr.src, symbols[tr.symb], tr.tgt);
+	}
+
+	return 0;
+}
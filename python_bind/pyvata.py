@@ -228,6 +228,21 @@ class NFA:
         g_vatalib.nfa_union(tmp.aut, lhs.aut, rhs.aut)
         return tmp
 
+    @classmethod
+    def fromRegex(cls, pattern, search=False):
+        """Compiles a regular expression into an NFA over one-character symbols
+        (bytes are translated to characters using latin-1)."""
+        assert type(pattern) in (str, bytes)
+        if type(pattern) == str:
+            pattern = pattern.encode('latin-1')
+        symbols = (ctypes.c_size_t * 256)(*[NFA.symbToNum(chr(i)) for i in range(256)])
+        tmp = NFA()
+        rv = g_vatalib.nfa_from_regex(tmp.aut, ctypes.c_char_p(pattern), symbols,
+            1 if search else 0)
+        if rv != 0:
+            raise Exception("invalid regular expression: {}".format(pattern))
+        return tmp
+
     @classmethod
     def isIncl(cls, lhs, rhs):
         """Tests inclusion of languages of two NFAs."""
@@ -389,6 +404,17 @@ class NFATest(unittest.TestCase):
         self.assertFalse(aut2.isInitial(3))
         self.assertFalse(aut2.isInitial(4))
 
+    def test_fromRegex(self):
+        """Testing compilation of regular expressions"""
+        aut = NFA.fromRegex("a[bc]*")
+        self.assertTrue(aut.isInitial(0))
+        self.assertEqual(len(aut.getFwdReachStates()), 3)
+        self.assertTrue(aut.hasTransition(0, "a", 1))
+        self.assertTrue(aut.hasTransition(1, "c", 3))
+        self.assertFalse(aut.hasTransition(0, "b", 2))
+        with self.assertRaises(Exception):
+            NFA.fromRegex("a(")
+
     def test_isIncl(self):
         """Testing language inclusion."""
         # TODO: write some tests
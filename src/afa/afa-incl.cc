@@ -0,0 +1,334 @@
+/* afa-incl.cc -- AFA language emptiness, universality, and inclusion
+ *
+ * Copyright (c) 2018 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <deque>
+#include <limits>
+
+// VATA headers
+#include <vata2/afa.hh>
+
+using namespace Vata2::Afa;
+using namespace Vata2::util;
+
+namespace {
+
+/// an automaton taking part in a search; its states are shifted by @p offset
+/// and if @p dual is set, the automaton is dualized (i.e., complemented)
+struct Component
+{
+	const Afa* aut;
+	bool dual;
+	State offset;
+};
+
+
+/**
+ * @brief  A search for a word accepted by a conjunction of (dualized) AFAs
+ *
+ * The search explores the implicit subset construction: its states are
+ * configurations, i.e., sets of states that all need to accept the rest of
+ * the word.  A configuration is accepting if all its states are accepting
+ * (final states of normal components and non-final states of dualized
+ * components).  Since a superset of a configuration accepts less words, only
+ * configurations that are minimal wrt inclusion are explored (antichains).
+ * Dualization swaps conjunctions with disjunctions (and true with false) in
+ * successor formulae, so complements are never constructed explicitly.
+ */
+class ConfigSearch
+{ // {{{
+private:
+
+	/// a node of the search
+	struct Node
+	{
+		StateBitset config;
+		size_t parent;
+		Symbol symb;
+	};
+
+	static const size_t NO_PARENT = std::numeric_limits<size_t>::max();
+
+	std::vector<Component> components;
+	std::vector<Symbol> symbols;
+	StateBitset accepting = { };
+	std::unordered_map<std::pair<State, Symbol>, std::vector<StateBitset>> post_cache = { };
+	std::vector<Node> nodes = { };
+
+	const Component& get_component(State state) const
+	{ // {{{
+		for (auto it = this->components.rbegin(); it != this->components.rend(); ++it) {
+			if (it->offset <= state) { return *it; }
+		}
+
+		assert(false);
+		return this->components.front();
+	} // get_component }}}
+
+	/// cubes of the successors of @p state over @p symb
+	const std::vector<StateBitset>& get_post(State state, Symbol symb)
+	{ // {{{
+		auto it_ins = this->post_cache.insert({{state, symb}, {}});
+		if (it_ins.second) {
+			const Component& comp = this->get_component(state);
+			FormulaId post = comp.aut->get_post(state - comp.offset, symb);
+			for (const StateBitset& cube : comp.aut->get_formulas().get_dnf(post, comp.dual)) {
+				StateBitset shifted;
+				cube.for_each([&](State st) { shifted.set(st + comp.offset); });
+				it_ins.first->second.push_back(shifted);
+			}
+		}
+
+		return it_ins.first->second;
+	} // get_post }}}
+
+	/// minimal successors of a configuration over a symbol
+	std::vector<StateBitset> get_succ(const StateBitset& config, Symbol symb)
+	{ // {{{
+		std::vector<StateBitset> result = { StateBitset() };
+		config.for_each([&](State st) {
+			result = join_cubes(result, this->get_post(st, symb));
+		});
+
+		return result;
+	} // get_succ }}}
+
+	/// follows one branch of the run leading to node @p idx
+	Path get_branch(size_t idx)
+	{ // {{{
+		std::vector<size_t> trace;
+		for (; NO_PARENT != idx; idx = this->nodes[idx].parent) { trace.push_back(idx); }
+		std::reverse(trace.begin(), trace.end());
+
+		Path result;
+		const StateBitset& first = this->nodes[trace.front()].config;
+		if (first.none()) { return result; }
+
+		State state = *first.to_set().begin();
+		result.push_back(state);
+		for (size_t i = 1; i < trace.size(); ++i) {
+			const Node& node = this->nodes[trace[i]];
+			bool found = false;
+			for (const StateBitset& cube : this->get_post(state, node.symb)) {
+				// the successor configuration contains a cube of every state
+				if (!cube.is_subset_of(node.config)) { continue; }
+
+				found = true;
+				if (cube.none()) { return result; }   // the branch ends here
+				state = *cube.to_set().begin();
+				break;
+			}
+
+			assert(found);
+			(void)found;
+			result.push_back(state);
+		}
+
+		return result;
+	} // get_branch }}}
+
+public:
+
+	ConfigSearch(
+		const std::vector<Component>&  components,
+		const std::vector<Symbol>&     symbols) :
+		components(components), symbols(symbols)
+	{ // {{{
+		for (const Component& comp : this->components) {
+			for (State st = 0; st < comp.aut->num_states(); ++st) {
+				if (comp.dual != comp.aut->has_final(st)) { this->accepting.set(st + comp.offset); }
+			}
+		}
+	} // ConfigSearch }}}
+
+	/**
+	 * @brief  Searches for an accepted word
+	 *
+	 * @param[in]   start  The initial configurations
+	 * @param[out]  word   An accepted word (if not nullptr)
+	 * @param[out]  path   A branch of a run over the word (if not nullptr)
+	 *
+	 * @returns  true iff some word is accepted
+	 */
+	bool search(const std::vector<StateBitset>& start, Word* word, Path* path)
+	{ // {{{
+		// the antichain of minimal configurations seen so far
+		std::vector<size_t> antichain;
+		std::deque<size_t> worklist;
+
+		auto add_node = [&](const StateBitset& config, size_t parent, Symbol symb) {
+			for (size_t idx : antichain) {
+				if (this->nodes[idx].config.is_subset_of(config)) { return; }
+			}
+
+			antichain.erase(std::remove_if(antichain.begin(), antichain.end(),
+				[&](size_t idx) { return config.is_subset_of(this->nodes[idx].config); }),
+				antichain.end());
+
+			antichain.push_back(this->nodes.size());
+			worklist.push_back(this->nodes.size());
+			this->nodes.push_back({config, parent, symb});
+		};
+
+		for (const StateBitset& config : start) { add_node(config, NO_PARENT, 0); }
+
+		while (!worklist.empty()) {
+			size_t idx = worklist.front();
+			worklist.pop_front();
+
+			if (this->nodes[idx].config.is_subset_of(this->accepting)) {
+				if (nullptr != word) {
+					word->clear();
+					for (size_t i = idx; NO_PARENT != this->nodes[i].parent; i = this->nodes[i].parent) {
+						word->push_back(this->nodes[i].symb);
+					}
+
+					std::reverse(word->begin(), word->end());
+				}
+
+				if (nullptr != path) { *path = this->get_branch(idx); }
+
+				return true;
+			}
+
+			for (Symbol symb : this->symbols) {
+				// nodes may be reallocated by add_node()
+				const StateBitset config = this->nodes[idx].config;
+				for (const StateBitset& succ : this->get_succ(config, symb)) {
+					add_node(succ, idx, symb);
+				}
+			}
+		}
+
+		return false;
+	} // search }}}
+}; // ConfigSearch }}}
+
+const size_t ConfigSearch::NO_PARENT;
+
+
+/// symbols that need to be explored for emptiness of an automaton
+std::vector<Symbol> get_search_symbols(const Afa& aut)
+{ // {{{
+	std::set<Symbol> symbols = aut.get_symbols();
+
+	// by monotonicity, symbols not occurring in the automaton allow less than
+	// the ones that do occur; if there are none, any symbol will do
+	if (symbols.empty()) { return { 0 }; }
+
+	return std::vector<Symbol>(symbols.begin(), symbols.end());
+} // get_search_symbols }}}
+
+
+/// symbols of an alphabet
+std::vector<Symbol> get_alphabet_symbols(const Alphabet& alphabet)
+{ // {{{
+	std::list<Symbol> symbols = alphabet.get_symbols();
+	return std::vector<Symbol>(symbols.begin(), symbols.end());
+} // get_alphabet_symbols }}}
+
+
+/// checks that the antichains algorithm is selected
+void check_algo(const std::string& func, const StringDict& params)
+{ // {{{
+	if (!haskey(params, "algo")) {
+		throw std::runtime_error(func +
+			" requires setting the \"algo\" key in the \"params\" argument; "
+			"received: " + std::to_string(params));
+	}
+
+	const std::string& str_algo = params.at("algo");
+	if ("antichains" != str_algo) {
+		throw std::runtime_error(func +
+			" received an unknown value of the \"algo\" key: " + str_algo);
+	}
+} // check_algo }}}
+
+} // anonymous namespace
+
+
+bool Vata2::Afa::is_lang_empty(const Afa& aut, Path* cex)
+{ // {{{
+	std::vector<StateBitset> start;
+	for (State st : aut.initialstates) {
+		StateBitset config;
+		config.set(st);
+		start.push_back(config);
+	}
+
+	ConfigSearch search({{&aut, false, 0}}, get_search_symbols(aut));
+	return !search.search(start, nullptr, cex);
+} // is_lang_empty }}}
+
+
+bool Vata2::Afa::is_lang_empty_cex(const Afa& aut, Word* cex)
+{ // {{{
+	assert(nullptr != cex);
+
+	std::vector<StateBitset> start;
+	for (State st : aut.initialstates) {
+		StateBitset config;
+		config.set(st);
+		start.push_back(config);
+	}
+
+	ConfigSearch search({{&aut, false, 0}}, get_search_symbols(aut));
+	return !search.search(start, cex, nullptr);
+} // is_lang_empty_cex }}}
+
+
+bool Vata2::Afa::is_universal(
+	const Afa&         aut,
+	const Alphabet&    alphabet,
+	Word*              cex,
+	const StringDict&  params)
+{ // {{{
+	check_algo(std::to_string(__func__), params);
+
+	// the dual automaton needs all initial states to accept
+	StateBitset start;
+	for (State st : aut.initialstates) { start.set(st); }
+
+	ConfigSearch search({{&aut, true, 0}}, get_alphabet_symbols(alphabet));
+	return !search.search({start}, cex, nullptr);
+} // is_universal }}}
+
+
+bool Vata2::Afa::is_incl(
+	const Afa&         smaller,
+	const Afa&         bigger,
+	const Alphabet&    alphabet,
+	Word*              cex,
+	const StringDict&  params)
+{ // {{{
+	check_algo(std::to_string(__func__), params);
+
+	// searching for a word accepted by smaller and rejected by bigger
+	const State offset = smaller.num_states();
+	StateBitset bigger_init;
+	for (State st : bigger.initialstates) { bigger_init.set(st + offset); }
+
+	std::vector<StateBitset> start;
+	for (State st : smaller.initialstates) {
+		StateBitset config = bigger_init;
+		config.set(st);
+		start.push_back(config);
+	}
+
+	ConfigSearch search({{&smaller, false, 0}, {&bigger, true, offset}},
+		get_alphabet_symbols(alphabet));
+	return !search.search(start, cex, nullptr);
+} // is_incl }}}
@@ -0,0 +1,137 @@
+/* afa-nfa-view.cc -- lazily constructed NFA view of an AFA
+ *
+ * Copyright (c) 2018 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <stdexcept>
+
+// VATA headers
+#include <vata2/afa.hh>
+
+using namespace Vata2::Afa;
+using namespace Vata2::util;
+
+const size_t NfaView::DEFAULT_MAX_MACROSTATES;
+
+
+NfaView::NfaView(const Afa& aut, size_t max_macrostates) :
+	aut(aut),
+	max_macrostates(std::max(max_macrostates, static_cast<size_t>(1)))
+{ // {{{
+	this->final_states = aut.get_final_bitset();
+	const std::set<Symbol> symbs = aut.get_symbols();
+	this->symbols.assign(symbs.begin(), symbs.end());
+	this->reset();
+} // NfaView::NfaView }}}
+
+
+void NfaView::reset()
+{ // {{{
+	this->macrostates.clear();
+	this->macro_map.clear();
+	this->macro_final.clear();
+	this->post_cache.clear();
+	this->post_symb_cache.clear();
+	this->cube_cache.clear();
+
+	this->initialstates.clear();
+	for (State st : this->aut.initialstates) {
+		StateBitset macro;
+		macro.set(st);
+		this->initialstates.insert(this->get_macrostate_id(macro));
+	}
+} // reset }}}
+
+
+State NfaView::get_macrostate_id(const StateBitset& macro)
+{ // {{{
+	auto it_ins = this->macro_map.insert({macro, this->macrostates.size()});
+	if (it_ins.second) {
+		this->macrostates.push_back(macro);
+		this->macro_final.push_back(macro.is_subset_of(this->final_states));
+	}
+
+	return it_ins.first->second;
+} // get_macrostate_id }}}
+
+
+const NfaView::StateSet& NfaView::post(State macro, Symbol symb)
+{ // {{{
+	auto it = this->post_cache.find({macro, symb});
+	if (this->post_cache.end() != it) { return it->second; }
+
+	std::vector<StateBitset> succ = { StateBitset() };
+	const StateBitset config = this->get_macrostate(macro);
+	config.for_each([&](State st) {
+		auto it_ins = this->cube_cache.insert({{st, symb}, {}});
+		if (it_ins.second) {
+			it_ins.first->second = this->aut.get_formulas().get_dnf(
+				this->aut.get_post(st, symb));
+		}
+
+		succ = join_cubes(succ, it_ins.first->second);
+	});
+
+	StateSet result;
+	for (const StateBitset& cube : succ) { result.insert(this->get_macrostate_id(cube)); }
+
+	if (this->macrostates.size() > this->max_macrostates) {
+		throw std::runtime_error(std::string(__func__) +
+			": the budget of macrostates was exceeded");
+	}
+
+	return this->post_cache[{macro, symb}] = std::move(result);
+} // post }}}
+
+
+const NfaView::PostSymb& NfaView::post(State macro)
+{ // {{{
+	auto it_ins = this->post_symb_cache.insert({macro, { }});
+	if (it_ins.second) {
+		PostSymb result;
+		for (Symbol symb : this->symbols) {
+			const StateSet& succ = this->post(macro, symb);
+			if (!succ.empty()) { result[symb] = succ; }
+		}
+
+		// post(State, Symbol) may rehash the cache
+		return this->post_symb_cache[macro] = std::move(result);
+	}
+
+	return it_ins.first->second;
+} // post(State) }}}
+
+
+void NfaView::flush(StateSet* keep)
+{ // {{{
+	assert(nullptr != keep);
+
+	++this->flushes;
+
+	std::vector<StateBitset> kept;
+	for (State macro : *keep) { kept.push_back(this->get_macrostate(macro)); }
+
+	this->reset();
+
+	keep->clear();
+	for (const StateBitset& macro : kept) { keep->insert(this->get_macrostate_id(macro)); }
+} // flush }}}
+
+
+Vata2::Nfa::LazyNfa Vata2::Afa::lazy(NfaView& view)
+{ // {{{
+	// the view is owned by the caller
+	return Vata2::Nfa::LazyNfa(&view, [](NfaView*) { });
+} // lazy(NfaView) }}}
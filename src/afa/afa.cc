@@ -16,11 +16,13 @@
  */
 
 #include <algorithm>
+#include <cctype>
 #include <list>
 #include <unordered_set>
 
 // VATA headers
 #include <vata2/afa.hh>
+#include <vata2/parallel.hh>
 #include <vata2/util.hh>
 #include <vata2/vm-dispatch.hh>
 
@@ -32,6 +34,11 @@ using Vata2::Afa::Symbol;
 
 const std::string Vata2::Afa::TYPE_AFA = "AFA";
 
+const size_t StateBitset::BLOCK_BITS;
+const FormulaId FormulaStore::FALSE_ID;
+const FormulaId FormulaStore::TRUE_ID;
+const size_t CompiledAfa::BATCH_BLOCK;
+
 std::ostream& std::operator<<(std::ostream& os, const Vata2::Afa::Trans& trans)
 { // {{{
 	std::string result = "(" + std::to_string(trans.src) + ", " + trans.formula + ")";
@@ -39,25 +46,726 @@ std::ostream& std::operator<<(std::ostream& os, const Vata2::Afa::Trans& trans)
 } // operator<<(ostream, Trans) }}}
 
 
-void Afa::add_trans(const Trans& trans)
+namespace
+{ // {{{
+
+/// a formula parsed from its textual form (atoms are still strings)
+struct ParsedFormula
+{ // {{{
+	enum class Kind { FALSE, TRUE, ATOM, AND, OR };
+
+	Kind kind;
+	std::string atom;
+	std::vector<ParsedFormula> children;
+}; // ParsedFormula }}}
+
+
+/// splits the textual form of a formula into tokens
+std::vector<std::string> tokenize_formula(const std::string& str)
+{ // {{{
+	std::vector<std::string> result;
+	size_t i = 0;
+	while (i < str.length()) {
+		char ch = str[i];
+		if (std::isspace(static_cast<unsigned char>(ch))) { ++i; }
+		else if ('(' == ch || ')' == ch) {
+			result.push_back(std::string(1, ch));
+			++i;
+		} else if ('&' == ch || '|' == ch) {
+			size_t len = (i + 1 < str.length() && str[i + 1] == ch)? 2 : 1;
+			result.push_back(str.substr(i, len));
+			i += len;
+		} else if ('\'' == ch || '"' == ch) { // a quoted character or string
+			size_t close = str.find(ch, i + 1);
+			if (std::string::npos == close) {
+				throw std::runtime_error("unterminated quote in formula \"" + str + "\"");
+			}
+
+			result.push_back(str.substr(i, close - i + 1));
+			i = close + 1;
+		} else {
+			size_t j = i;
+			while (j < str.length() &&
+				!std::isspace(static_cast<unsigned char>(str[j])) &&
+				!haskey(std::set<char>{'(', ')', '&', '|'}, str[j]))
+			{
+				++j;
+			}
+
+			result.push_back(str.substr(i, j - i));
+			i = j;
+		}
+	}
+
+	return result;
+} // tokenize_formula }}}
+
+
+/// a recursive-descent parser of formulae; conjunction binds tighter than
+/// disjunction
+class FormulaParser
+{ // {{{
+private:
+
+	const std::string& str;
+	std::vector<std::string> tokens;
+	size_t pos = 0;
+
+	bool is_and(const std::string& tok) const
+	{
+		return "&" == tok || "&&" == tok || "and" == tok || "AND" == tok;
+	}
+
+	bool is_or(const std::string& tok) const
+	{
+		return "|" == tok || "||" == tok || "or" == tok || "OR" == tok;
+	}
+
+	[[noreturn]] void error(const std::string& msg) const
+	{
+		throw std::runtime_error("invalid formula \"" + this->str + "\": " + msg);
+	}
+
+	ParsedFormula parse_atom()
+	{ // {{{
+		if (this->pos >= this->tokens.size()) { this->error("unexpected end"); }
+
+		const std::string& tok = this->tokens[this->pos++];
+		if ("(" == tok) {
+			ParsedFormula result = this->parse_or();
+			if (this->pos >= this->tokens.size() || ")" != this->tokens[this->pos]) {
+				this->error("missing ')'");
+			}
+
+			++this->pos;
+			return result;
+		}
+
+		if (")" == tok || this->is_and(tok) || this->is_or(tok)) {
+			this->error("unexpected \"" + tok + "\"");
+		}
+
+		if ("true" == tok || "TRUE" == tok) { return {ParsedFormula::Kind::TRUE, "", {}}; }
+		if ("false" == tok || "FALSE" == tok) { return {ParsedFormula::Kind::FALSE, "", {}}; }
+
+		return {ParsedFormula::Kind::ATOM, tok, {}};
+	} // parse_atom }}}
+
+	ParsedFormula parse_and()
+	{ // {{{
+		ParsedFormula result = {ParsedFormula::Kind::AND, "", {this->parse_atom()}};
+		while (this->pos < this->tokens.size() && this->is_and(this->tokens[this->pos])) {
+			++this->pos;
+			result.children.push_back(this->parse_atom());
+		}
+
+		return (1 == result.children.size())? result.children.front() : result;
+	} // parse_and }}}
+
+	ParsedFormula parse_or()
+	{ // {{{
+		ParsedFormula result = {ParsedFormula::Kind::OR, "", {this->parse_and()}};
+		while (this->pos < this->tokens.size() && this->is_or(this->tokens[this->pos])) {
+			++this->pos;
+			result.children.push_back(this->parse_and());
+		}
+
+		return (1 == result.children.size())? result.children.front() : result;
+	} // parse_or }}}
+
+public:
+
+	explicit FormulaParser(const std::string& str) :
+		str(str), tokens(tokenize_formula(str))
+	{ }
+
+	ParsedFormula parse()
+	{ // {{{
+		ParsedFormula result = this->parse_or();
+		if (this->pos != this->tokens.size()) {
+			this->error("unexpected \"" + this->tokens[this->pos] + "\"");
+		}
+
+		return result;
+	} // parse }}}
+}; // FormulaParser }}}
+
+
+/// collects names of atoms in a parsed formula
+void collect_atoms(const ParsedFormula& formula, std::vector<std::string>* atoms)
+{ // {{{
+	if (ParsedFormula::Kind::ATOM == formula.kind) { atoms->push_back(formula.atom); }
+	for (const ParsedFormula& child : formula.children) { collect_atoms(child, atoms); }
+} // collect_atoms }}}
+
+
+/// builds a parsed formula in a store; @p get_atom translates atoms
+FormulaId build_formula(
+	FormulaStore*                                        store,
+	const ParsedFormula&                                 formula,
+	const std::function<FormulaId(const std::string&)>&  get_atom)
+{ // {{{
+	switch (formula.kind) {
+		case ParsedFormula::Kind::FALSE: return FormulaStore::FALSE_ID;
+		case ParsedFormula::Kind::TRUE: return FormulaStore::TRUE_ID;
+		case ParsedFormula::Kind::ATOM: return get_atom(formula.atom);
+		case ParsedFormula::Kind::AND:
+		case ParsedFormula::Kind::OR: {
+			std::vector<FormulaId> children;
+			for (const ParsedFormula& child : formula.children) {
+				children.push_back(build_formula(store, child, get_atom));
+			}
+
+			return store->mk_nary((ParsedFormula::Kind::AND == formula.kind)?
+				FormulaStore::Kind::AND : FormulaStore::Kind::OR, std::move(children));
+		}
+	}
+
+	assert(false);
+	return FormulaStore::FALSE_ID;
+} // build_formula }}}
+
+
+/// parses a number (throws if @p str is not a number)
+uintptr_t parse_number(const std::string& str, const std::string& formula)
+{ // {{{
+	if (str.empty() || !std::all_of(str.begin(), str.end(),
+		[](char ch) { return std::isdigit(static_cast<unsigned char>(ch)); }))
+	{
+		throw std::runtime_error("invalid atom \"" + str + "\" in formula \"" +
+			formula + "\"");
+	}
+
+	return std::stoull(str);
+} // parse_number }}}
+
+
+/// parses a formula using the default naming of states and symbols (the one
+/// used by serialize() without maps)
+FormulaId parse_default_formula(FormulaStore* store, const std::string& str)
+{ // {{{
+	ParsedFormula parsed = FormulaParser(str).parse();
+	return build_formula(store, parsed, [store, &str](const std::string& atom) {
+		if (3 == atom.length() && ('\'' == atom[0] || '"' == atom[0]) && atom[0] == atom[2]) {
+			return store->mk_symbol(atom[1]);
+		} else if (!atom.empty() && 'q' == atom[0]) {
+			return store->mk_state(parse_number(atom.substr(1), str));
+		} else if (!atom.empty() && 'a' == atom[0]) {
+			return store->mk_symbol(parse_number(atom.substr(1), str));
+		} else {
+			return store->mk_state(parse_number(atom, str));
+		}
+	});
+} // parse_default_formula }}}
+
+
+
+/// all states of an automaton
+std::set<State> get_states(const Afa& aut)
+{ // {{{
+	std::set<State> result(aut.initialstates.begin(), aut.initialstates.end());
+	result.insert(aut.finalstates.begin(), aut.finalstates.end());
+	for (const auto& trans : aut.get_trans_list()) {
+		result.insert(trans.first);
+		std::set<State> states = aut.get_formulas().get_states(trans.second);
+		result.insert(states.begin(), states.end());
+	}
+
+	return result;
+} // get_states }}}
+
+
+/// copies transitions of @p aut into @p result, renaming states by adding
+/// @p offset
+void import_trans(Afa* result, const Afa& aut, State offset)
+{ // {{{
+	for (const auto& trans : aut.get_trans_list()) {
+		result->add_trans(trans.first + offset,
+			result->get_formulas().import(aut.get_formulas(), trans.second, offset));
+	}
+} // import_trans }}}
+
+
+/// an upper bound on the number of cubes of the disjunctive normal form of
+/// @p formula, saturated at @p bound + 1
+size_t count_cubes(
+	const FormulaStore&                     store,
+	FormulaId                               formula,
+	size_t                                  bound,
+	std::unordered_map<FormulaId, size_t>*  cache)
+{ // {{{
+	auto it = cache->find(formula);
+	if (cache->end() != it) { return it->second; }
+
+	const FormulaStore::Node& node = store[formula];
+	size_t result = 0;
+	switch (node.kind) {
+		case FormulaStore::Kind::FALSE:
+		case FormulaStore::Kind::SYMBOL: break;
+		case FormulaStore::Kind::TRUE:
+		case FormulaStore::Kind::STATE: result = 1; break;
+		case FormulaStore::Kind::OR: {
+			for (FormulaId child : node.children) {
+				result = std::min(bound + 1, result + count_cubes(store, child, bound, cache));
+			}
+			break;
+		}
+		case FormulaStore::Kind::AND: {
+			result = 1;
+			for (FormulaId child : node.children) {
+				const size_t child_cubes = count_cubes(store, child, bound, cache);
+				result = (0 == child_cubes || result <= (bound + 1) / child_cubes)?
+					result * child_cubes : bound + 1;
+			}
+			break;
+		}
+	}
+
+	return (*cache)[formula] = result;
+} // count_cubes }}}
+
+} // anonymous namespace }}}
+
+
+FormulaStore::FormulaStore()
+{ // {{{
+	FormulaId false_id = this->insert({Kind::FALSE, 0, {}});
+	FormulaId true_id = this->insert({Kind::TRUE, 0, {}});
+	assert(FALSE_ID == false_id);
+	assert(TRUE_ID == true_id);
+	(void)false_id;
+	(void)true_id;
+} // FormulaStore() }}}
+
+
+FormulaId FormulaStore::insert(const Node& node)
+{ // {{{
+	auto it_ins = this->unique.insert({node, static_cast<FormulaId>(this->nodes.size())});
+	if (it_ins.second) { this->nodes.push_back(node); }
+	return it_ins.first->second;
+} // insert }}}
+
+
+bool FormulaStore::normalize(
+	Kind                     kind,
+	std::vector<FormulaId>*  children,
+	FormulaId*               result) const
+{ // {{{
+	assert(Kind::AND == kind || Kind::OR == kind);
+	assert(nullptr != children && nullptr != result);
+
+	// the absorbing and the neutral element
+	FormulaId absorbing = (Kind::AND == kind)? FALSE_ID : TRUE_ID;
+	FormulaId neutral = (Kind::AND == kind)? TRUE_ID : FALSE_ID;
+
+	std::vector<FormulaId> flat;
+	for (FormulaId child : *children) {
+		if (absorbing == child) { *result = absorbing; return true; }
+		else if (neutral == child) { continue; }
+
+		const Node& node = (*this)[child];
+		if (kind == node.kind) {
+			flat.insert(flat.end(), node.children.begin(), node.children.end());
+		} else {
+			flat.push_back(child);
+		}
+	}
+
+	std::sort(flat.begin(), flat.end());
+	flat.erase(std::unique(flat.begin(), flat.end()), flat.end());
+
+	if (flat.empty()) { *result = neutral; return true; }
+	if (1 == flat.size()) { *result = flat.front(); return true; }
+
+	*children = std::move(flat);
+	return false;
+} // normalize }}}
+
+
+FormulaId FormulaStore::mk_nary(Kind kind, std::vector<FormulaId> children)
+{ // {{{
+	FormulaId result;
+	if (this->normalize(kind, &children, &result)) { return result; }
+
+	return this->insert({kind, 0, std::move(children)});
+} // mk_nary }}}
+
+
+FormulaId FormulaStore::restrict_symbol(FormulaId formula, const Symbol* symb)
+{ // {{{
+	std::unordered_map<FormulaId, FormulaId> cache;
+	std::function<FormulaId(FormulaId)> restrict_rec = [&](FormulaId id) {
+		auto it = cache.find(id);
+		if (cache.end() != it) { return it->second; }
+
+		Node node = (*this)[id];
+		FormulaId result = id;
+		if (Kind::SYMBOL == node.kind) {
+			result = (nullptr != symb && *symb == node.atom)? TRUE_ID : FALSE_ID;
+		} else if (Kind::AND == node.kind || Kind::OR == node.kind) {
+			std::vector<FormulaId> children;
+			for (FormulaId child : node.children) { children.push_back(restrict_rec(child)); }
+			result = this->mk_nary(node.kind, std::move(children));
+		}
+
+		cache[id] = result;
+		return result;
+	};
+
+	return restrict_rec(formula);
+} // restrict_symbol }}}
+
+
+FormulaId FormulaStore::dualize(FormulaId formula)
+{ // {{{
+	std::unordered_map<FormulaId, FormulaId> cache;
+	std::function<FormulaId(FormulaId)> dualize_rec = [&](FormulaId id) {
+		auto it = cache.find(id);
+		if (cache.end() != it) { return it->second; }
+
+		Node node = (*this)[id];
+		FormulaId result = id;
+		switch (node.kind) {
+			case Kind::FALSE: result = TRUE_ID; break;
+			case Kind::TRUE: result = FALSE_ID; break;
+			case Kind::STATE:
+			case Kind::SYMBOL: break;
+			case Kind::AND:
+			case Kind::OR: {
+				std::vector<FormulaId> children;
+				for (FormulaId child : node.children) { children.push_back(dualize_rec(child)); }
+				result = this->mk_nary((Kind::AND == node.kind)? Kind::OR : Kind::AND,
+					std::move(children));
+				break;
+			}
+		}
+
+		cache[id] = result;
+		return result;
+	};
+
+	return dualize_rec(formula);
+} // dualize }}}
+
+
+FormulaId FormulaStore::import(
+	const FormulaStore&  other,
+	FormulaId            formula,
+	State                state_offset)
+{ // {{{
+	std::unordered_map<FormulaId, FormulaId> cache;
+	std::function<FormulaId(FormulaId)> import_rec = [&](FormulaId id) {
+		auto it = cache.find(id);
+		if (cache.end() != it) { return it->second; }
+
+		const Node& node = other[id];
+		FormulaId result = FALSE_ID;
+		switch (node.kind) {
+			case Kind::FALSE: result = FALSE_ID; break;
+			case Kind::TRUE: result = TRUE_ID; break;
+			case Kind::STATE: result = this->mk_state(node.atom + state_offset); break;
+			case Kind::SYMBOL: result = this->mk_symbol(node.atom); break;
+			case Kind::AND:
+			case Kind::OR: {
+				std::vector<FormulaId> children;
+				for (FormulaId child : node.children) { children.push_back(import_rec(child)); }
+				result = this->mk_nary(node.kind, std::move(children));
+				break;
+			}
+		}
+
+		cache[id] = result;
+		return result;
+	};
+
+	return import_rec(formula);
+} // import }}}
+
+
+bool FormulaStore::lookup(
+	const FormulaStore&  other,
+	FormulaId            formula,
+	FormulaId*           result) const
+{ // {{{
+	assert(nullptr != result);
+
+	const Node& node = other[formula];
+	Node found = {node.kind, node.atom, {}};
+	if (Kind::AND == node.kind || Kind::OR == node.kind) {
+		for (FormulaId child : node.children) {
+			FormulaId found_child;
+			if (!this->lookup(other, child, &found_child)) { return false; }
+			found.children.push_back(found_child);
+		}
+
+		if (this->normalize(node.kind, &found.children, result)) { return true; }
+	}
+
+	auto it = this->unique.find(found);
+	if (this->unique.end() == it) { return false; }
+
+	*result = it->second;
+	return true;
+} // lookup }}}
+
+
+std::set<Symbol> FormulaStore::get_symbols(FormulaId formula) const
+{ // {{{
+	std::set<Symbol> result;
+	std::unordered_set<FormulaId> visited;
+	std::vector<FormulaId> worklist = { formula };
+	while (!worklist.empty()) {
+		FormulaId id = worklist.back();
+		worklist.pop_back();
+		if (!visited.insert(id).second) { continue; }
+
+		const Node& node = (*this)[id];
+		if (Kind::SYMBOL == node.kind) { result.insert(node.atom); }
+		else {
+			worklist.insert(worklist.end(), node.children.begin(), node.children.end());
+		}
+	}
+
+	return result;
+} // get_symbols }}}
+
+
+std::set<State> FormulaStore::get_states(FormulaId formula) const
+{ // {{{
+	std::set<State> result;
+	std::unordered_set<FormulaId> visited;
+	std::vector<FormulaId> worklist = { formula };
+	while (!worklist.empty()) {
+		FormulaId id = worklist.back();
+		worklist.pop_back();
+		if (!visited.insert(id).second) { continue; }
+
+		const Node& node = (*this)[id];
+		if (Kind::STATE == node.kind) { result.insert(node.atom); }
+		else {
+			worklist.insert(worklist.end(), node.children.begin(), node.children.end());
+		}
+	}
+
+	return result;
+} // get_states }}}
+
+
+void Vata2::Afa::insert_minimal(
+	std::vector<StateBitset>*  antichain,
+	const StateBitset&         cube)
+{ // {{{
+	assert(nullptr != antichain);
+
+	for (const StateBitset& other : *antichain) {
+		if (other.is_subset_of(cube)) { return; }
+	}
+
+	antichain->erase(std::remove_if(antichain->begin(), antichain->end(),
+		[&cube](const StateBitset& other) { return cube.is_subset_of(other); }),
+		antichain->end());
+	antichain->push_back(cube);
+} // insert_minimal }}}
+
+
+std::vector<StateBitset> Vata2::Afa::join_cubes(
+	const std::vector<StateBitset>&  lhs,
+	const std::vector<StateBitset>&  rhs)
+{ // {{{
+	std::vector<StateBitset> result;
+	for (const StateBitset& lhs_cube : lhs) {
+		for (const StateBitset& rhs_cube : rhs) {
+			StateBitset cube = lhs_cube;
+			cube |= rhs_cube;
+			insert_minimal(&result, cube);
+		}
+	}
+
+	return result;
+} // join_cubes }}}
+
+
+std::vector<StateBitset> FormulaStore::get_dnf(FormulaId formula, bool dual) const
+{ // {{{
+	// references to elements of the cache stay valid when it grows
+	std::unordered_map<FormulaId, std::vector<StateBitset>> cache;
+	std::function<const std::vector<StateBitset>&(FormulaId)> dnf_rec =
+		[&](FormulaId id) -> const std::vector<StateBitset>& {
+		auto it = cache.find(id);
+		if (cache.end() != it) { return it->second; }
+
+		const Node& node = (*this)[id];
+		Kind kind = node.kind;
+		if (dual) {
+			switch (kind) {
+				case Kind::FALSE: kind = Kind::TRUE; break;
+				case Kind::TRUE: kind = Kind::FALSE; break;
+				case Kind::AND: kind = Kind::OR; break;
+				case Kind::OR: kind = Kind::AND; break;
+				default: break;
+			}
+		}
+
+		std::vector<StateBitset> result;
+		switch (kind) {
+			case Kind::FALSE:
+			case Kind::SYMBOL: break;
+			case Kind::TRUE: result.push_back(StateBitset()); break;
+			case Kind::STATE: {
+				StateBitset cube;
+				cube.set(node.atom);
+				result.push_back(cube);
+				break;
+			}
+			case Kind::OR: {
+				for (FormulaId child : node.children) {
+					for (const StateBitset& cube : dnf_rec(child)) {
+						insert_minimal(&result, cube);
+					}
+				}
+				break;
+			}
+			case Kind::AND: {
+				result.push_back(StateBitset());
+				for (FormulaId child : node.children) {
+					result = join_cubes(result, dnf_rec(child));
+				}
+				break;
+			}
+		}
+
+		return cache[id] = std::move(result);
+	};
+
+	return dnf_rec(formula);
+} // get_dnf }}}
+
+
+std::string FormulaStore::to_string(
+	FormulaId                                  formula,
+	const std::function<std::string(Symbol)>&  symbol_namer,
+	const std::function<std::string(State)>&   state_namer) const
+{ // {{{
+	const Node& node = (*this)[formula];
+	switch (node.kind) {
+		case Kind::FALSE: return "false";
+		case Kind::TRUE: return "true";
+		case Kind::STATE: return state_namer(node.atom);
+		case Kind::SYMBOL: return symbol_namer(node.atom);
+		case Kind::AND:
+		case Kind::OR: {
+			// disjunctions inside conjunctions need parentheses
+			auto print_child = [&](FormulaId child) {
+				std::string str = this->to_string(child, symbol_namer, state_namer);
+				return (Kind::AND == node.kind && Kind::OR == (*this)[child].kind)?
+					"(" + str + ")" : str;
+			};
+
+			std::string result;
+			for (FormulaId child : node.children) {
+				if (!result.empty()) { result += (Kind::AND == node.kind)? " & " : " | "; }
+				result += print_child(child);
+			}
+
+			return result;
+		}
+	}
+
+	assert(false);
+	return "";
+} // to_string }}}
+
+
+void Afa::add_trans(State src, FormulaId formula)
 { // {{{
-	this->transitions.push_back(trans);
+	if (!this->trans_set.insert({src, formula}).second) { return; }
+	this->trans_list.push_back({src, formula});
+
+	this->note_state(src);
+	for (State st : this->formulas.get_states(formula)) { this->note_state(st); }
+
+	auto it_ins = this->posts.insert({src, StatePost{
+		FormulaStore::FALSE_ID, {}, FormulaStore::FALSE_ID}});
+	StatePost& post = it_ins.first->second;
+
+	// substituting symbols distributes over disjunction, so the index can be
+	// updated incrementally
+	std::set<Symbol> symbols = this->formulas.get_symbols(formula);
+	FormulaId formula_other = this->formulas.restrict_symbol(formula, nullptr);
+	for (Symbol symb : symbols) {
+		post.symbol_post.insert({symb, post.other_post});
+	}
+
+	for (auto& symb_post : post.symbol_post) {
+		FormulaId formula_symb = haskey(symbols, symb_post.first)?
+			this->formulas.restrict_symbol(formula, &symb_post.first) : formula_other;
+		symb_post.second = this->formulas.mk_or(symb_post.second, formula_symb);
+	}
+
+	post.other_post = this->formulas.mk_or(post.other_post, formula_other);
+	post.formula = this->formulas.mk_or(post.formula, formula);
 } // add_trans }}}
 
+
+void Afa::add_trans(const Trans& trans)
+{ // {{{
+	FormulaId formula = parse_default_formula(&this->formulas, trans.formula);
+	this->add_trans(trans.src, formula);
+} // add_trans(Trans) }}}
+
+
 bool Afa::has_trans(const Trans& trans) const
 { // {{{
-  return std::find(this->transitions.begin(),
-                   this->transitions.end(),
-                   trans) != this->transitions.end();
+	FormulaStore tmp;
+	FormulaId tmp_formula = parse_default_formula(&tmp, trans.formula);
+
+	FormulaId formula;
+	return this->formulas.lookup(tmp, tmp_formula, &formula) &&
+		this->has_trans(trans.src, formula);
 } // has_trans }}}
 
 
 size_t Afa::trans_size() const
 { // {{{
-	return this->transitions.size();
+	return this->trans_list.size();
 } // trans_size() }}}
 
 
+std::set<Symbol> Afa::get_symbols(State state) const
+{ // {{{
+	std::set<Symbol> result;
+	auto it = this->posts.find(state);
+	if (this->posts.end() != it) {
+		for (const auto& symb_post : it->second.symbol_post) {
+			result.insert(symb_post.first);
+		}
+	}
+
+	return result;
+} // get_symbols(State) }}}
+
+
+std::set<Symbol> Afa::get_symbols() const
+{ // {{{
+	std::set<Symbol> result;
+	for (const auto& state_post : this->posts) {
+		for (const auto& symb_post : state_post.second.symbol_post) {
+			result.insert(symb_post.first);
+		}
+	}
+
+	return result;
+} // get_symbols }}}
+
+
+StateBitset Afa::get_final_bitset() const
+{ // {{{
+	StateBitset result(this->num_states());
+	for (State st : this->finalstates) { result.set(st); }
+	return result;
+} // get_final_bitset }}}
+
+
 std::ostream& Vata2::Afa::operator<<(std::ostream& os, const Afa& afa)
 { // {{{
 	return os << std::to_string(serialize(afa));
@@ -66,11 +774,12 @@ std::ostream& Vata2::Afa::operator<<(std::ostream& os, const Afa& afa)
 
 bool Vata2::Afa::are_state_disjoint(const Afa& lhs, const Afa& rhs)
 { // {{{
-  assert(&lhs);
-  assert(&rhs);
+	std::set<State> lhs_states = get_states(lhs);
+	for (State st : get_states(rhs)) {
+		if (haskey(lhs_states, st)) { return false; }
+	}
 
-  // TODO
-  assert(false);
+	return true;
 } // are_disjoint }}}
 
 
@@ -81,11 +790,11 @@ void Vata2::Afa::union_norename(
 { // {{{
 	assert(nullptr != result);
 
-  assert(&lhs);
-  assert(&rhs);
-
-  // TODO
-  assert(false);
+	for (const Afa* aut : {&lhs, &rhs}) {
+		for (State st : aut->initialstates) { result->add_initial(st); }
+		for (State st : aut->finalstates) { result->add_final(st); }
+		import_trans(result, *aut, 0);
+	}
 } // union_norename }}}
 
 
@@ -93,34 +802,109 @@ Afa Vata2::Afa::union_rename(
 	const Afa&  lhs,
 	const Afa&  rhs)
 { // {{{
-  assert(&lhs);
-  assert(&rhs);
+	Afa result;
+	const State offset = lhs.num_states();
+	for (const Afa* aut : {&lhs, &rhs}) {
+		State aut_offset = (aut == &lhs)? 0 : offset;
+		for (State st : aut->initialstates) { result.add_initial(st + aut_offset); }
+		for (State st : aut->finalstates) { result.add_final(st + aut_offset); }
+		import_trans(&result, *aut, aut_offset);
+	}
 
-  // TODO
-  assert(false);
+	return result;
 } // union_rename }}}
 
 
-bool Vata2::Afa::is_lang_empty(const Afa& aut, Path* cex)
+void Vata2::Afa::intersection(
+	Afa*        result,
+	const Afa&  lhs,
+	const Afa&  rhs)
 { // {{{
-  assert(&aut);
-  assert(&cex);
+	assert(nullptr != result);
 
-  // TODO
-  assert(false);
-} // is_lang_empty }}}
+	const State offset = lhs.num_states();
+	const State init = offset + rhs.num_states();
+	FormulaStore& store = result->get_formulas();
+
+	FormulaId conj = FormulaStore::TRUE_ID;
+	bool accepts_eps = true;
+	for (const Afa* aut : {&lhs, &rhs}) {
+		State aut_offset = (aut == &lhs)? 0 : offset;
+		for (State st : aut->finalstates) { result->add_final(st + aut_offset); }
+		import_trans(result, *aut, aut_offset);
+
+		// the new initial state behaves as some initial state of each automaton
+		FormulaId disj = FormulaStore::FALSE_ID;
+		for (State st : aut->initialstates) {
+			disj = store.mk_or(disj,
+				store.import(aut->get_formulas(), aut->get_formula(st), aut_offset));
+		}
+
+		conj = store.mk_and(conj, disj);
+		accepts_eps = accepts_eps && accepts_epsilon(*aut);
+	}
+
+	result->add_initial(init);
+	if (accepts_eps) { result->add_final(init); }
+	if (FormulaStore::FALSE_ID != conj) { result->add_trans(init, conj); }
+} // intersection }}}
 
 
-bool Vata2::Afa::is_lang_empty_cex(const Afa& aut, Word* cex)
+void Vata2::Afa::complement(
+	Afa*             result,
+	const Afa&       aut,
+	const Alphabet&  alphabet)
 { // {{{
-	assert(nullptr != cex);
+	assert(nullptr != result);
 
-  assert(&aut);
-  assert(&cex);
+	const State init = aut.num_states();
+	FormulaStore& store = result->get_formulas();
+	std::list<Symbol> symbols = alphabet.get_symbols();
 
-  // TODO
-  assert(false);
-} // is_lang_empty_cex }}}
+	// the dual of the successors of a state over a symbol
+	auto get_dual_post = [&](State st, Symbol symb) {
+		return store.dualize(store.import(aut.get_formulas(), aut.get_post(st, symb)));
+	};
+
+	for (State st = 0; st < aut.num_states(); ++st) {
+		if (!aut.has_final(st)) { result->add_final(st); }
+
+		FormulaId formula = FormulaStore::FALSE_ID;
+		for (Symbol symb : symbols) {
+			formula = store.mk_or(formula,
+				store.mk_and(store.mk_symbol(symb), get_dual_post(st, symb)));
+		}
+
+		if (FormulaStore::FALSE_ID != formula) { result->add_trans(st, formula); }
+	}
+
+	// the new initial state rejects if some initial state accepts
+	FormulaId formula = FormulaStore::FALSE_ID;
+	for (Symbol symb : symbols) {
+		FormulaId conj = FormulaStore::TRUE_ID;
+		for (State st : aut.initialstates) { conj = store.mk_and(conj, get_dual_post(st, symb)); }
+		formula = store.mk_or(formula, store.mk_and(store.mk_symbol(symb), conj));
+	}
+
+	result->add_initial(init);
+	if (!accepts_epsilon(aut)) { result->add_final(init); }
+	if (FormulaStore::FALSE_ID != formula) { result->add_trans(init, formula); }
+} // complement }}}
+
+
+void Vata2::Afa::nfa_to_afa(Afa* result, const Vata2::Nfa::Nfa& aut)
+{ // {{{
+	assert(nullptr != result);
+
+	for (State st : aut.initialstates) { result->add_initial(st); }
+	for (State st : aut.finalstates) { result->add_final(st); }
+
+	FormulaStore& store = result->get_formulas();
+	for (const auto& trans : aut) {
+		result->add_trans(trans.src,
+			store.mk_and(store.mk_symbol(trans.symb), store.mk_state(trans.tgt)));
+	}
+} // nfa_to_afa }}}
 
 
 void Vata2::Afa::make_complete(
@@ -195,11 +979,42 @@ Vata2::Parser::ParsedSection Vata2::Afa::serialize(
 	}
 	parsec.dict["Final"] = fin_states;
 
-	for (const auto& trans : aut.transitions) {
-		bool_str_pair src_bsp = state_namer(trans.src);
-		if (!src_bsp.first) { throw std::runtime_error("cannot translate state " + std::to_string(trans.src)); }
+	// states occurring only in formulae need to be declared
+	std::set<State> declared(aut.initialstates.begin(), aut.initialstates.end());
+	declared.insert(aut.finalstates.begin(), aut.finalstates.end());
+	std::set<State> undeclared;
+	for (const auto& trans : aut.get_trans_list()) { declared.insert(trans.first); }
+	for (const auto& trans : aut.get_trans_list()) {
+		for (State st : aut.get_formulas().get_states(trans.second)) {
+			if (!haskey(declared, st)) { undeclared.insert(st); }
+		}
+	}
 
-		parsec.body.push_back({ src_bsp.second, trans.formula });
+	if (!undeclared.empty()) {
+		std::vector<std::string> states;
+		for (State s : undeclared) {
+			bool_str_pair bsp = state_namer(s);
+			if (!bsp.first) { throw std::runtime_error("cannot translate state " + std::to_string(s)); }
+			states.push_back(bsp.second);
+		}
+		parsec.dict["States"] = states;
+	}
+
+	auto state_str = [&state_namer](State st) {
+		bool_str_pair bsp = state_namer(st);
+		if (!bsp.first) { throw std::runtime_error("cannot translate state " + std::to_string(st)); }
+		return bsp.second;
+	};
+
+	auto symbol_str = [&symbol_namer](Symbol sym) {
+		bool_str_pair bsp = symbol_namer(sym);
+		if (!bsp.first) { throw std::runtime_error("cannot translate symbol " + std::to_string(sym)); }
+		return bsp.second;
+	};
+
+	for (const auto& trans : aut.get_trans_list()) {
+		parsec.body.push_back({ state_str(trans.first),
+			aut.get_formulas().to_string(trans.second, symbol_str, state_str) });
 	}
 
 	return parsec;
@@ -279,11 +1094,46 @@ void Vata2::Afa::construct(
 	};
 
 
+	// parse formulae first; atoms that are names of states (declared in
+	// Initial, Final, or States, or being a source of a transition) are
+	// states, the other ones are symbols
+	std::unordered_set<std::string> state_names;
+	for (const char* key : {"Initial", "Final", "States"}) {
+		auto it = parsec.dict.find(key);
+		if (parsec.dict.end() != it) {
+			state_names.insert(it->second.begin(), it->second.end());
+		}
+	}
+
+	std::vector<ParsedFormula> formulae;
+	for (const auto& body_line : parsec.body) {
+		if (body_line.size() < 2) {
+			// clean up
+			clean_up();
+
+			throw std::runtime_error("Invalid transition: " +
+				std::to_string(body_line));
+		}
+
+		state_names.insert(body_line[0]);
+		std::string formula;
+		for (size_t i = 1; i < body_line.size(); ++i) {
+			formula += ((1 == i)? "" : " ") + body_line[i];
+		}
+
+		try {
+			formulae.push_back(FormulaParser(formula).parse());
+		} catch (std::exception&) {
+			clean_up();
+			throw;
+		}
+	}
+
 	auto it = parsec.dict.find("Initial");
 	if (parsec.dict.end() != it) {
 		for (const auto& str : it->second) {
 			State state = get_state_name(str);
-			aut->initialstates.insert(state);
+			aut->add_initial(state);
 		}
 	}
 
@@ -292,26 +1142,25 @@ void Vata2::Afa::construct(
 	if (parsec.dict.end() != it) {
 		for (const auto& str : it->second) {
 			State state = get_state_name(str);
-			aut->finalstates.insert(state);
+			aut->add_final(state);
 		}
 	}
 
-	for (const auto& body_line : parsec.body) {
-		if (body_line.size() < 2) {
-			// clean up
-      clean_up();
+	FormulaStore& store = aut->get_formulas();
+	auto get_atom = [&](const std::string& str) {
+		if (haskey(state_names, str)) { return store.mk_state(get_state_name(str)); }
+		else { return store.mk_symbol(alphabet->translate_symb(str)); }
+	};
 
-      throw std::runtime_error("Invalid transition: " +
-        std::to_string(body_line));
+	try {
+		auto formula_it = formulae.begin();
+		for (const auto& body_line : parsec.body) {
+			State src_state = get_state_name(body_line[0]);
+			aut->add_trans(src_state, build_formula(&store, *formula_it++, get_atom));
 		}
-
-		State src_state = get_state_name(body_line[0]);
-    std::string formula;
-    for (size_t i = 1; i < body_line.size(); ++i) {
-      formula += body_line[i] + " ";
-    }
-
-    aut->add_trans(src_state, formula);
+	} catch (std::exception&) {
+		clean_up();
+		throw;
 	}
 
 	// do the dishes and take out garbage
@@ -352,26 +1201,355 @@ void Vata2::Afa::construct(
 } // construct(StringToSymbolMap) }}}
 
 
+CompiledAfa::CompiledAfa(const Afa& aut, const StringDict& params) : CompiledAfa()
+{ // {{{
+	size_t max_cubes = 0;
+	if (haskey(params, "dnf")) { max_cubes = std::stoul(params.at("dnf")); }
+
+	this->num_states_ = aut.num_states();
+	this->num_blocks = (this->num_states_ + StateBitset::BLOCK_BITS - 1) /
+		StateBitset::BLOCK_BITS;
+
+	// column 0 is for symbols not occurring in the automaton
+	std::vector<Symbol> column_symbol = { 0 };
+	for (Symbol symb : aut.get_symbols()) {
+		this->symbol_column.insert({symb, column_symbol.size()});
+		column_symbol.push_back(symb);
+	}
+
+	auto append_bitset = [this](std::vector<Block>* vec, const StateBitset& states) {
+		const std::vector<Block>& blocks = states.get_blocks();
+		for (size_t i = 0; i < this->num_blocks; ++i) {
+			vec->push_back((i < blocks.size())? blocks[i] : 0);
+		}
+	};
+
+	const FormulaStore& store = aut.get_formulas();
+	const std::vector<Block> empty_set(this->num_blocks, 0);
+	std::unordered_map<FormulaId, Entry> entry_cache;
+	std::unordered_map<FormulaId, size_t> cube_counts;
+	this->entries.reserve(column_symbol.size() * this->num_states_);
+	for (size_t col = 0; col < column_symbol.size(); ++col) {
+		for (State st = 0; st < this->num_states_; ++st) {
+			FormulaId post = (0 == col)? aut.get_other_post(st) :
+				aut.get_post(st, column_symbol[col]);
+
+			auto it_ins = entry_cache.insert({post, {false, 0, 0}});
+			Entry& entry = it_ins.first->second;
+			if (it_ins.second) {
+				if (0 != max_cubes && count_cubes(store, post, max_cubes, &cube_counts) <= max_cubes) {
+					entry = {true, this->cubes.size(), 0};
+					for (const StateBitset& cube : store.get_dnf(post)) {
+						if (cube.none()) { this->has_empty_cube = true; }
+						append_bitset(&this->cubes, cube);
+					}
+
+					entry.end = this->cubes.size();
+				} else {
+					this->compile_gates(store, post, &entry);
+					std::vector<char> values(entry.end - entry.begin);
+					if (this->eval_gates(entry, empty_set.data(), values.data())) {
+						this->has_empty_cube = true;
+					}
+				}
+			}
+
+			this->entries.push_back(entry);
+		}
+	}
+
+	StateBitset initial_set;
+	for (State st : aut.initialstates) { initial_set.set(st); }
+	append_bitset(&this->initial, initial_set);
+	append_bitset(&this->final, aut.get_final_bitset());
+} // CompiledAfa::CompiledAfa }}}
+
+
+void CompiledAfa::compile_gates(const FormulaStore& store, FormulaId formula, Entry* entry)
+{ // {{{
+	assert(nullptr != entry);
+
+	entry->dnf = false;
+	entry->begin = this->gates.size();
+
+	// shared subformulae are compiled once; operands precede their gates
+	std::unordered_map<FormulaId, size_t> offsets;
+	std::function<size_t(FormulaId)> compile_rec = [&](FormulaId id) -> size_t {
+		auto it = offsets.find(id);
+		if (offsets.end() != it) { return it->second; }
+
+		const FormulaStore::Node& node = store[id];
+		Gate gate = {node.kind, 0, 0, 0};
+		switch (node.kind) {
+			case FormulaStore::Kind::STATE: gate.state = node.atom; break;
+			// symbols are treated as false
+			case FormulaStore::Kind::SYMBOL: gate.kind = FormulaStore::Kind::FALSE; break;
+			case FormulaStore::Kind::AND:
+			case FormulaStore::Kind::OR: {
+				std::vector<size_t> ops;
+				for (FormulaId child : node.children) { ops.push_back(compile_rec(child)); }
+				gate.op_begin = this->operands.size();
+				this->operands.insert(this->operands.end(), ops.begin(), ops.end());
+				gate.op_end = this->operands.size();
+				break;
+			}
+			default: break;
+		}
+
+		this->gates.push_back(gate);
+		return offsets[id] = this->gates.size() - 1 - entry->begin;
+	};
+
+	compile_rec(formula);
+	entry->end = this->gates.size();
+	this->max_gates = std::max(this->max_gates, entry->end - entry->begin);
+} // compile_gates }}}
+
+
+bool CompiledAfa::eval_gates(const Entry& entry, const Block* next, char* values) const
+{ // {{{
+	assert(!entry.dnf && entry.begin < entry.end);
+
+	for (size_t i = entry.begin; i < entry.end; ++i) {
+		const Gate& gate = this->gates[i];
+		char& value = values[i - entry.begin];
+		switch (gate.kind) {
+			case FormulaStore::Kind::TRUE: value = 1; break;
+			case FormulaStore::Kind::STATE: {
+				value = (next[gate.state / StateBitset::BLOCK_BITS] >>
+					(gate.state % StateBitset::BLOCK_BITS)) & 1;
+				break;
+			}
+			case FormulaStore::Kind::AND: {
+				value = 1;
+				for (size_t op = gate.op_begin; op < gate.op_end && value; ++op) {
+					value = values[this->operands[op]];
+				}
+				break;
+			}
+			case FormulaStore::Kind::OR: {
+				value = 0;
+				for (size_t op = gate.op_begin; op < gate.op_end && !value; ++op) {
+					value = values[this->operands[op]];
+				}
+				break;
+			}
+			default: value = 0; break;
+		}
+	}
+
+	return 0 != values[entry.end - entry.begin - 1];
+} // eval_gates }}}
+
+
+std::vector<StateBitset> CompiledAfa::get_cubes(const Entry& entry) const
+{ // {{{
+	if (entry.dnf) {
+		std::vector<StateBitset> result;
+		for (size_t pos = entry.begin; pos < entry.end; pos += this->num_blocks) {
+			result.emplace_back(this->cubes.begin() + pos,
+				this->cubes.begin() + pos + this->num_blocks);
+		}
+
+		return result;
+	}
+
+	std::vector<std::vector<StateBitset>> gate_cubes(entry.end - entry.begin);
+	for (size_t i = entry.begin; i < entry.end; ++i) {
+		const Gate& gate = this->gates[i];
+		std::vector<StateBitset>& result = gate_cubes[i - entry.begin];
+		switch (gate.kind) {
+			case FormulaStore::Kind::TRUE: result.push_back(StateBitset()); break;
+			case FormulaStore::Kind::STATE: {
+				StateBitset cube;
+				cube.set(gate.state);
+				result.push_back(cube);
+				break;
+			}
+			case FormulaStore::Kind::AND: {
+				result.push_back(StateBitset());
+				for (size_t op = gate.op_begin; op < gate.op_end; ++op) {
+					result = join_cubes(result, gate_cubes[this->operands[op]]);
+				}
+				break;
+			}
+			case FormulaStore::Kind::OR: {
+				for (size_t op = gate.op_begin; op < gate.op_end; ++op) {
+					for (const StateBitset& cube : gate_cubes[this->operands[op]]) {
+						insert_minimal(&result, cube);
+					}
+				}
+				break;
+			}
+			default: break;
+		}
+	}
+
+	return gate_cubes.back();
+} // get_cubes }}}
+
+
+void CompiledAfa::step_back(
+	size_t        column,
+	const Block*  next,
+	Block*        result,
+	char*         values) const
+{ // {{{
+	std::fill(result, result + this->num_blocks, 0);
+
+	const size_t row = column * this->num_states_;
+	for (size_t st = 0; st < this->num_states_; ++st) {
+		const Entry& entry = this->entries[row + st];
+		bool accepts = false;
+		if (entry.dnf) {
+			for (size_t pos = entry.begin; pos < entry.end; pos += this->num_blocks) {
+				const Block* cube = &this->cubes[pos];
+				Block missing = 0;
+				for (size_t i = 0; i < this->num_blocks; ++i) { missing |= cube[i] & ~next[i]; }
+
+				if (0 == missing) {
+					accepts = true;
+					break;
+				}
+			}
+		} else {
+			accepts = this->eval_gates(entry, next, values);
+		}
+
+		if (accepts) {
+			result[st / StateBitset::BLOCK_BITS] |=
+				static_cast<Block>(1) << (st % StateBitset::BLOCK_BITS);
+		}
+	}
+} // step_back }}}
+
+
+bool CompiledAfa::is_prfx_in_lang(const Word& word) const
+{ // {{{
+	// a forward pass over configurations, i.e., sets of states that all need
+	// to accept the rest of the word; only the minimal ones are kept
+	std::vector<StateBitset> configs;
+	for (size_t i = 0; i < this->num_blocks; ++i) {
+		for (Block block = this->initial[i]; 0 != block; block &= block - 1) {
+			StateBitset config;
+			config.set(i * StateBitset::BLOCK_BITS + __builtin_ctzll(block));
+			configs.push_back(config);
+		}
+	}
+
+	const StateBitset final_set(this->final.begin(), this->final.end());
+	auto some_accepting = [&configs, &final_set]() {
+		for (const StateBitset& config : configs) {
+			if (config.is_subset_of(final_set)) { return true; }
+		}
+
+		return false;
+	};
+
+	// cubes of the entries used so far (converted from gates only if needed)
+	std::unordered_map<size_t, std::vector<StateBitset>> cube_cache;
+	for (Symbol symb : word) {
+		if (some_accepting()) { return true; }
+
+		const size_t row = this->get_column(symb) * this->num_states_;
+		std::vector<StateBitset> succ;
+		for (const StateBitset& config : configs) {
+			std::vector<StateBitset> product = { StateBitset() };
+			config.for_each([&](State st) {
+				auto it_ins = cube_cache.insert({row + st, { }});
+				if (it_ins.second) {
+					it_ins.first->second = this->get_cubes(this->entries[row + st]);
+				}
+
+				product = join_cubes(product, it_ins.first->second);
+			});
+
+			for (const StateBitset& cube : product) { insert_minimal(&succ, cube); }
+		}
+
+		configs = std::move(succ);
+		if (configs.empty()) { return false; }
+	}
+
+	return some_accepting();
+} // is_prfx_in_lang }}}
+
+
+void CompiledAfa::is_in_lang_batch(
+	const Word*        words,
+	size_t             num_words,
+	bool*              result,
+	const StringDict&  params) const
+{ // {{{
+	assert(nullptr != words || 0 == num_words);
+	assert(nullptr != result || 0 == num_words);
+
+	const size_t num_blocks = (num_words + BATCH_BLOCK - 1) / BATCH_BLOCK;
+	Vata2::parallel::parallel_for(0, num_blocks, [=](size_t block) {
+		std::vector<Block> cur;
+		std::vector<Block> next;
+		std::vector<char> values;
+		const size_t end = std::min(num_words, (block + 1) * BATCH_BLOCK);
+		for (size_t i = block * BATCH_BLOCK; i < end; ++i) {
+			result[i] = this->run_back(words[i].begin(), words[i].end(), &cur, &next, &values);
+		}
+	}, params);
+} // is_in_lang_batch }}}
+
+
+void CompiledAfa::is_in_lang_batch(
+	const std::vector<Word>&  words,
+	std::vector<bool>*        result,
+	const StringDict&         params) const
+{ // {{{
+	assert(nullptr != result);
+
+	// std::vector<bool> cannot be written by several threads
+	std::unique_ptr<bool[]> flags(new bool[words.size()]);
+	this->is_in_lang_batch(words.data(), words.size(), flags.get(), params);
+	result->assign(flags.get(), flags.get() + words.size());
+} // is_in_lang_batch(vector) }}}
+
+
 bool Vata2::Afa::is_in_lang(const Afa& aut, const Word& word)
 { // {{{
-  assert(&aut);
-  assert(&word);
+	// a backward pass evaluating only the formulae of the symbols of the
+	// word (compiling all of them does not pay off for a single word)
+	StateBitset cur = aut.get_final_bitset();
+	for (auto it = word.rbegin(); it != word.rend(); ++it) {
+		StateBitset next;
+		for (State st = 0; st < aut.num_states(); ++st) {
+			if (aut.eval_post(st, *it, cur)) { next.set(st); }
+		}
 
-  // TODO
-  assert(false);
+		cur = std::move(next);
+	}
+
+	for (State st : aut.initialstates) {
+		if (cur.test(st)) { return true; }
+	}
+
+	return false;
 } // is_in_lang }}}
 
 
 bool Vata2::Afa::is_prfx_in_lang(const Afa& aut, const Word& word)
 { // {{{
-  assert(&aut);
-  assert(&word);
-
-  // TODO
-  assert(false);
+	return CompiledAfa(aut).is_prfx_in_lang(word);
 } // is_prfx_in_lang }}}
 
 
+std::vector<bool> Vata2::Afa::is_in_lang_batch(
+	const Afa&                aut,
+	const std::vector<Word>&  words,
+	const StringDict&         params)
+{ // {{{
+	std::vector<bool> result;
+	CompiledAfa(aut).is_in_lang_batch(words, &result, params);
+	return result;
+} // is_in_lang_batch }}}
+
+
 bool Vata2::Afa::is_deterministic(const Afa& aut)
 { // {{{
   assert(&aut);
@@ -390,6 +1568,56 @@ bool Vata2::Afa::is_complete(const Afa& aut, const Alphabet& alphabet)
   assert(false);
 } // is_complete }}}
 
+std::unordered_set<State> Vata2::Afa::get_fwd_reach_states(const Afa& aut)
+{ // {{{
+	std::vector<State> worklist(aut.initialstates.begin(), aut.initialstates.end());
+	std::unordered_set<State> processed(aut.initialstates.begin(), aut.initialstates.end());
+
+	while (!worklist.empty()) {
+		State state = worklist.back();
+		worklist.pop_back();
+
+		for (State tgt : aut.get_formulas().get_states(aut.get_formula(state))) {
+			if (processed.insert(tgt).second) { worklist.push_back(tgt); }
+		}
+	}
+
+	return processed;
+} // get_fwd_reach_states }}}
+
+
+std::pair<Word, bool> Vata2::Afa::get_word_for_path(const Afa& aut, const Path& path)
+{ // {{{
+	Word word;
+	for (size_t i = 1; i < path.size(); ++i) {
+		State src = path[i - 1];
+		State tgt = path[i];
+
+		bool found = false;
+		for (Symbol symb : aut.get_symbols(src)) {
+			if (haskey(aut.get_formulas().get_states(aut.get_post(src, symb)), tgt)) {
+				word.push_back(symb);
+				found = true;
+				break;
+			}
+		}
+
+		if (!found && haskey(aut.get_formulas().get_states(aut.get_other_post(src)), tgt)) {
+			// any symbol not occurring in transitions from src
+			std::set<Symbol> used = aut.get_symbols(src);
+			Symbol symb = 0;
+			while (haskey(used, symb)) { ++symb; }
+			word.push_back(symb);
+			found = true;
+		}
+
+		if (!found) { return {{}, false}; }
+	}
+
+	return {word, true};
+} // get_word_for_path }}}
+
+
 bool Vata2::Afa::accepts_epsilon(const Afa& aut)
 { // {{{
 	for (State st : aut.initialstates) {
@@ -27,7 +27,7 @@ TEST_CASE("Vata2::Afa::construct() correct calls")
 
 		construct(&aut, parsec);
 
-		// REQUIRE(is_lang_empty(aut));
+		REQUIRE(is_lang_empty(aut));
 	}
 
 	SECTION("construct a simple non-empty automaton accepting the empty word")
@@ -38,7 +38,7 @@ TEST_CASE("Vata2::Afa::construct() correct calls")
 
 		construct(&aut, parsec);
 
-		// REQUIRE(!is_lang_empty(aut));
+		REQUIRE(!is_lang_empty(aut));
 	}
 
 	SECTION("construct an automaton with more than one initial/final states")
@@ -49,8 +49,8 @@ TEST_CASE("Vata2::Afa::construct() correct calls")
 
 		construct(&aut, parsec);
 
-		// REQUIRE(aut.initialstates.size() == 2);
-		// REQUIRE(aut.finalstates.size() == 3);
+		REQUIRE(aut.initialstates.size() == 2);
+		REQUIRE(aut.finalstates.size() == 3);
 	}
 
 	SECTION("construct a simple non-empty automaton accepting only the word 'a'")
@@ -63,3 +63,653 @@ TEST_CASE("Vata2::Afa::construct() correct calls")
 		construct(&aut, parsec);
 	}
 } // }}}
+
+
+TEST_CASE("Vata2::Afa::FormulaStore")
+{ // {{{
+	FormulaStore store;
+
+	SECTION("formulae are hash-consed")
+	{
+		FormulaId lhs = store.mk_and(store.mk_symbol('a'), store.mk_state(2));
+		FormulaId rhs = store.mk_and(store.mk_state(2), store.mk_symbol('a'));
+		REQUIRE(lhs == rhs);
+		REQUIRE(store.mk_or(lhs, lhs) == lhs);
+		REQUIRE(store.mk_and(lhs, store.mk_true()) == lhs);
+		REQUIRE(store.mk_or(lhs, store.mk_true()) == FormulaStore::TRUE_ID);
+		REQUIRE(store.mk_and(lhs, store.mk_false()) == FormulaStore::FALSE_ID);
+	}
+
+	SECTION("substitution of symbols")
+	{
+		Symbol a = 'a';
+		Symbol b = 'b';
+		FormulaId q1 = store.mk_state(1);
+		FormulaId q2 = store.mk_state(2);
+		FormulaId formula = store.mk_or(
+			store.mk_and(store.mk_symbol(a), q1),
+			store.mk_and(store.mk_symbol(b), q2));
+
+		REQUIRE(store.restrict_symbol(formula, &a) == q1);
+		REQUIRE(store.restrict_symbol(formula, &b) == q2);
+		REQUIRE(store.restrict_symbol(formula, nullptr) == FormulaStore::FALSE_ID);
+		REQUIRE(store.get_symbols(formula) == std::set<Symbol>({a, b}));
+		REQUIRE(store.get_states(formula) == std::set<State>({1, 2}));
+	}
+
+	SECTION("evaluation against a set of states")
+	{
+		FormulaId formula = store.mk_or(
+			store.mk_and(store.mk_state(1), store.mk_state(70)),
+			store.mk_state(3));
+
+		StateBitset states;
+		REQUIRE(!store.eval(formula, states));
+		states.set(1);
+		REQUIRE(!store.eval(formula, states));
+		states.set(70);
+		REQUIRE(store.eval(formula, states));
+		states.reset(70);
+		states.set(3);
+		REQUIRE(store.eval(formula, states));
+		REQUIRE(states.to_set() == std::set<State>({1, 3}));
+	}
+} // }}}
+
+
+TEST_CASE("Vata2::Afa::Afa::add_trans()/get_post()")
+{ // {{{
+	Afa aut;
+
+	SECTION("Empty automata have no transitions")
+	{
+		REQUIRE(aut.trans_empty());
+		REQUIRE(aut.trans_size() == 0);
+		REQUIRE(aut.get_post(1, 'a') == FormulaStore::FALSE_ID);
+	}
+
+	SECTION("Transitions are indexed by the source state and the symbol")
+	{
+		aut.add_trans(1, "('a' & q2 & q3) | ('b' & q1)");
+		aut.add_trans(1, "q4 && a99");
+
+		REQUIRE(aut.trans_size() == 2);
+		REQUIRE(aut.num_states() == 5);
+		REQUIRE(aut.has_trans(1, "'b' & q1 | q3 & q2 & 'a'"));
+		REQUIRE(aut.has_trans(1, "a99 AND 4"));
+		REQUIRE(!aut.has_trans(2, "q4 && a99"));
+		REQUIRE(!aut.has_trans(1, "q4"));
+		REQUIRE(aut.get_symbols(1) == std::set<Symbol>({'a', 'b', 99}));
+
+		FormulaStore& store = aut.get_formulas();
+		REQUIRE(aut.get_post(1, 'a') ==
+			store.mk_and(store.mk_state(2), store.mk_state(3)));
+		REQUIRE(aut.get_post(1, 'b') == store.mk_state(1));
+		REQUIRE(aut.get_post(1, 99) == store.mk_state(4));
+		REQUIRE(aut.get_post(1, 'd') == FormulaStore::FALSE_ID);
+
+		StateBitset states;
+		states.set(2);
+		REQUIRE(!aut.eval_post(1, 'a', states));
+		states.set(3);
+		REQUIRE(aut.eval_post(1, 'a', states));
+	}
+
+	SECTION("Transitions with symbol-free formulae are taken over any symbol")
+	{
+		aut.add_trans(1, "true");
+		aut.add_trans(2, "q1 | 'a' & q2");
+
+		REQUIRE(aut.get_post(1, 'z') == FormulaStore::TRUE_ID);
+		REQUIRE(aut.get_post(2, 'z') == aut.get_formulas().mk_state(1));
+		REQUIRE(aut.get_post(2, 'a') == aut.get_formulas().mk_or(
+			aut.get_formulas().mk_state(1), aut.get_formulas().mk_state(2)));
+	}
+
+	SECTION("Invalid formulae throw")
+	{
+		CHECK_THROWS_WITH(aut.add_trans(1, "(q1 & 'a'"), Catch::Contains("missing ')'"));
+		CHECK_THROWS_WITH(aut.add_trans(1, "q1 & | q2"), Catch::Contains("unexpected"));
+		CHECK_THROWS_WITH(aut.add_trans(1, "foo"), Catch::Contains("invalid atom"));
+	}
+} // }}}
+
+
+TEST_CASE("Vata2::Afa::construct() formulae")
+{ // {{{
+	Afa aut;
+	ParsedSection parsec;
+	parsec.type = Vata2::Afa::TYPE_AFA;
+	StringToSymbolMap symbol_map;
+	StringToStateMap state_map;
+
+	SECTION("names of states are distinguished from symbols")
+	{
+		parsec.dict.insert({"Initial", {"q1"}});
+		parsec.dict.insert({"Final", {"q2"}});
+		parsec.dict.insert({"States", {"r"}});
+		parsec.body = { {"q1", "a AND q2 AND r"}, {"q2", "(", "b", "or", "q1", ")"} };
+
+		construct(&aut, parsec, &symbol_map, &state_map);
+
+		REQUIRE(aut.trans_size() == 2);
+		REQUIRE(symbol_map.size() == 2);
+		REQUIRE(state_map.size() == 3);
+
+		const FormulaStore& store = aut.get_formulas();
+		StateBitset states;
+		states.set(state_map["q2"]);
+		REQUIRE(!store.eval(aut.get_post(state_map["q1"], symbol_map["a"]), states));
+		states.set(state_map["r"]);
+		REQUIRE(store.eval(aut.get_post(state_map["q1"], symbol_map["a"]), states));
+		REQUIRE(aut.get_post(state_map["q2"], symbol_map["b"]) == FormulaStore::TRUE_ID);
+	}
+
+	SECTION("invalid formula")
+	{
+		parsec.body = { {"q1", "a", "AND"} };
+
+		CHECK_THROWS_WITH(construct(&aut, parsec), Catch::Contains("unexpected end"));
+	}
+} // }}}
+
+
+TEST_CASE("Vata2::Afa::serialize()")
+{ // {{{
+	Afa aut;
+
+	SECTION("serialization and construction give the same automaton")
+	{
+		aut.add_initial(0);
+		aut.add_final(2);
+		aut.add_trans(0, "(a1 | a2) & q1 & q2 | a3 & q0");
+		aut.add_trans(1, "true");
+
+		ParsedSection parsec = serialize(aut);
+		REQUIRE(parsec.type == Vata2::Afa::TYPE_AFA);
+		REQUIRE(parsec.body.size() == 2);
+
+		StringToSymbolMap symbol_map;
+		StringToStateMap state_map;
+		Afa loaded = construct(parsec, &symbol_map, &state_map);
+
+		REQUIRE(loaded.trans_size() == aut.trans_size());
+		REQUIRE(loaded.initialstates == std::set<State>({state_map["q0"]}));
+		REQUIRE(loaded.finalstates == std::set<State>({state_map["q2"]}));
+
+		const FormulaStore& store = loaded.get_formulas();
+		StateBitset states;
+		states.set(state_map["q1"]);
+		REQUIRE(!store.eval(loaded.get_post(state_map["q0"], symbol_map["a1"]), states));
+		states.set(state_map["q2"]);
+		REQUIRE(store.eval(loaded.get_post(state_map["q0"], symbol_map["a1"]), states));
+		REQUIRE(store.eval(loaded.get_post(state_map["q0"], symbol_map["a2"]), states));
+		REQUIRE(!store.eval(loaded.get_post(state_map["q0"], symbol_map["a3"]), states));
+		REQUIRE(loaded.get_post(state_map["q1"], symbol_map["a3"]) == FormulaStore::TRUE_ID);
+	}
+
+	SECTION("states occurring only in formulae are declared")
+	{
+		aut.add_initial(0);
+		aut.add_trans(0, "a1 & q5");
+
+		ParsedSection parsec = serialize(aut);
+		REQUIRE(parsec["States"] == std::vector<std::string>({"q5"}));
+		REQUIRE(parsec.body.front() == BodyLine({"q0", "a1 & q5"}));
+	}
+} // }}}
+
+
+TEST_CASE("Vata2::Afa::is_in_lang()")
+{ // {{{
+	Afa aut;
+
+	// words x.w where w contains both 'a' and 'b' (q1 needs an 'a', q2 needs a 'b')
+	aut.add_initial(0);
+	aut.add_final(3);
+	aut.add_trans(0, "('a' | 'b') & q1 & q2");
+	aut.add_trans(1, "'a' & q3 | ('a' | 'b') & q1");
+	aut.add_trans(2, "'b' & q3 | ('a' | 'b') & q2");
+	aut.add_trans(3, "('a' | 'b') & q3");
+
+	SECTION("membership of words")
+	{
+		REQUIRE(!is_in_lang(aut, {}));
+		REQUIRE(!is_in_lang(aut, {'a', 'b'}));
+		REQUIRE(is_in_lang(aut, {'a', 'a', 'b'}));
+		REQUIRE(is_in_lang(aut, {'b', 'b', 'a'}));
+		REQUIRE(is_in_lang(aut, {'a', 'b', 'b', 'b', 'a', 'a'}));
+		REQUIRE(!is_in_lang(aut, {'a', 'a', 'a', 'a'}));
+		REQUIRE(!is_in_lang(aut, {'c', 'a', 'b'}));
+		REQUIRE(!is_in_lang(aut, {'a', 'a', 'b', 'c'}));
+	}
+
+	SECTION("membership of prefixes")
+	{
+		REQUIRE(!is_prfx_in_lang(aut, {}));
+		REQUIRE(is_prfx_in_lang(aut, {'a', 'a', 'b', 'c', 'c'}));
+		REQUIRE(!is_prfx_in_lang(aut, {'a', 'b', 'c', 'a'}));
+		REQUIRE(is_prfx_in_lang(aut, {'a', 'b', 'a', 'b'}));
+	}
+
+	SECTION("batch membership gives the same results")
+	{
+		std::vector<Word> words;
+		for (size_t i = 0; i < 3 * CompiledAfa::BATCH_BLOCK + 5; ++i) {
+			Word word;
+			for (size_t j = 0; j < i % 6; ++j) { word.push_back(((i >> j) & 1)? 'a' : 'b'); }
+			words.push_back(word);
+		}
+
+		for (const std::string threads : {"1", "4"})
+		{
+			std::vector<bool> results = is_in_lang_batch(aut, words, {{"threads", threads}});
+			REQUIRE(results.size() == words.size());
+			for (size_t i = 0; i < words.size(); ++i) {
+				REQUIRE(results[i] == is_in_lang(aut, words[i]));
+			}
+		}
+	}
+
+	SECTION("states spanning more blocks")
+	{
+		Afa big;
+		big.add_initial(0);
+		big.add_final(99);
+		big.add_trans(0, "'a' & q70 & q1");
+		big.add_trans(1, "'a' & q99");
+		big.add_trans(70, "'a' & q99 | 'b' & q1");
+
+		CompiledAfa compiled(big);
+		REQUIRE(compiled.num_states() == 100);
+		REQUIRE(!compiled.is_in_lang(Word{'a'}));
+		REQUIRE(compiled.is_in_lang(Word{'a', 'a'}));
+		REQUIRE(!compiled.is_in_lang(Word{'a', 'b'}));
+		REQUIRE(!compiled.is_in_lang(Word{'a', 'a', 'a'}));
+		REQUIRE(compiled.is_prfx_in_lang(Word{'a', 'a', 'a'}));
+
+		const unsigned char payload[] = { 'a', 'a' };
+		REQUIRE(compiled.is_in_lang(payload, payload + 2));
+	}
+
+	SECTION("the normal form as an opt-in")
+	{
+		CompiledAfa gates(aut);
+		CompiledAfa dnf(aut, {{"dnf", "16"}});
+		std::vector<Word> words = { { } };
+		for (size_t i = 0; i < words.size(); ++i) {
+			if (words[i].size() < 5) {
+				for (Symbol symb : {'a', 'b', 'c'}) {
+					Word word = words[i];
+					word.push_back(symb);
+					words.push_back(word);
+				}
+			}
+		}
+
+		for (const Word& word : words) {
+			REQUIRE(gates.is_in_lang(word) == is_in_lang(aut, word));
+			REQUIRE(dnf.is_in_lang(word) == is_in_lang(aut, word));
+			REQUIRE(gates.is_prfx_in_lang(word) == dnf.is_prfx_in_lang(word));
+		}
+	}
+
+	SECTION("formulae in the conjunctive normal form")
+	{
+		// (q1 | q2) & (q3 | q4) & ... has 2^20 cubes in the normal form
+		Afa cnf;
+		cnf.add_initial(0);
+		cnf.add_final(41);
+		std::string formula = "'a'";
+		for (State st = 1; st < 41; st += 2) {
+			formula += " & (q" + std::to_string(st) + " | q" + std::to_string(st + 1) + ")";
+			cnf.add_trans(st, "'a' & q41");
+		}
+
+		cnf.add_trans(0, formula);
+
+		for (const StringDict& params : std::vector<StringDict>{{}, {{"dnf", "1000"}}}) {
+			CompiledAfa compiled(cnf, params);
+			REQUIRE(!compiled.is_in_lang(Word{'a'}));
+			REQUIRE(compiled.is_in_lang(Word{'a', 'a'}));
+			REQUIRE(!compiled.is_in_lang(Word{'a', 'b'}));
+		}
+
+		REQUIRE(is_in_lang(cnf, {'a', 'a'}));
+		REQUIRE(!is_in_lang(cnf, {'a', 'a', 'a'}));
+	}
+} // }}}
+
+
+// Some common automata {{{
+
+// Automaton A (over {a0, a1}): words x.w where w contains both a0 and a1
+#define FILL_WITH_AUT_A(x) \
+	x.add_initial(0); \
+	x.add_final(3); \
+	x.add_trans(0, "(a0 | a1) & q1 & q2"); \
+	x.add_trans(1, "a0 & q3 | (a0 | a1) & q1"); \
+	x.add_trans(2, "a1 & q3 | (a0 | a1) & q2"); \
+	x.add_trans(3, "(a0 | a1) & q3"); \
+
+// Automaton B (over {a0, a1}): words of length at least 3
+#define FILL_WITH_AUT_B(x) \
+	x.add_initial(0); \
+	x.add_final(3); \
+	x.add_trans(0, "(a0 | a1) & q1"); \
+	x.add_trans(1, "(a0 | a1) & q2"); \
+	x.add_trans(2, "(a0 | a1) & q3"); \
+	x.add_trans(3, "(a0 | a1) & q3"); \
+
+// }}}
+
+
+TEST_CASE("Vata2::Afa::is_lang_empty()")
+{ // {{{
+	Afa aut;
+
+	SECTION("a non-empty automaton")
+	{
+		FILL_WITH_AUT_A(aut);
+
+		Path path;
+		REQUIRE(!is_lang_empty(aut, &path));
+		REQUIRE(path.size() == 4);
+		REQUIRE(path.front() == 0);
+		REQUIRE(path.back() == 3);
+		REQUIRE(get_word_for_path(aut, path).second);
+
+		Word cex;
+		REQUIRE(!is_lang_empty_cex(aut, &cex));
+		REQUIRE(cex.size() == 3);
+		REQUIRE(is_in_lang(aut, cex));
+	}
+
+	SECTION("conjunctions that cannot be satisfied")
+	{
+		aut.add_initial(0);
+		aut.add_final(3);
+		aut.add_trans(0, "a0 & q1 & q2 | a1 & q0 & q1");
+		aut.add_trans(1, "a0 & q3 | a1 & q1");
+		aut.add_trans(2, "a1 & q2");
+		aut.add_trans(3, "a0 & q3");
+
+		REQUIRE(is_lang_empty(aut));
+
+		Word cex;
+		REQUIRE(is_lang_empty_cex(aut, &cex));
+	}
+
+	SECTION("transitions over any symbol")
+	{
+		aut.add_initial(0);
+		aut.add_final(1);
+		aut.add_trans(0, "q1 & q1");
+
+		Word cex;
+		REQUIRE(!is_lang_empty_cex(aut, &cex));
+		REQUIRE(cex.size() == 1);
+		REQUIRE(get_fwd_reach_states(aut) == std::unordered_set<State>({0, 1}));
+	}
+} // }}}
+
+
+TEST_CASE("Vata2::Afa::is_universal()")
+{ // {{{
+	Afa aut;
+	Vata2::Nfa::EnumAlphabet alph = {"a", "b"};
+	Word cex;
+
+	SECTION("universal automata")
+	{
+		aut.add_initial(0);
+		aut.add_final(0);
+		aut.add_final(1);
+		aut.add_trans(0, "(a0 | a1) & q0 & q1");
+		aut.add_trans(1, "true");
+
+		REQUIRE(is_universal(aut, alph, &cex));
+	}
+
+	SECTION("non-universal automata")
+	{
+		// every a1 is immediately followed by a0
+		aut.add_initial(0);
+		aut.add_final(0);
+		aut.add_trans(0, "a0 & q0 | a1 & q1");
+		aut.add_trans(1, "a0 & q0");
+
+		REQUIRE(!is_universal(aut, alph, &cex));
+		REQUIRE(cex == Word({1}));
+
+		FILL_WITH_AUT_A(aut);
+		REQUIRE(!is_universal(aut, alph, &cex));
+		REQUIRE(!is_in_lang(aut, cex));
+	}
+
+	SECTION("no initial states")
+	{
+		REQUIRE(!is_universal(aut, alph, &cex));
+		REQUIRE(cex.empty());
+	}
+
+	SECTION("unknown algorithms")
+	{
+		CHECK_THROWS_WITH(is_universal(aut, alph, {{"algo", "foo"}}),
+			Catch::Contains("unknown value"));
+	}
+} // }}}
+
+
+TEST_CASE("Vata2::Afa::is_incl()")
+{ // {{{
+	Afa smaller;
+	Afa bigger;
+	Vata2::Nfa::EnumAlphabet alph = {"a", "b"};
+	Word cex;
+
+	FILL_WITH_AUT_A(smaller);
+	FILL_WITH_AUT_B(bigger);
+
+	SECTION("included languages")
+	{
+		REQUIRE(is_incl(smaller, bigger, alph, &cex));
+		REQUIRE(is_incl(smaller, smaller, alph));
+	}
+
+	SECTION("non-included languages")
+	{
+		REQUIRE(!is_incl(bigger, smaller, alph, &cex));
+		REQUIRE(cex.size() == 3);
+		REQUIRE(is_in_lang(bigger, cex));
+		REQUIRE(!is_in_lang(smaller, cex));
+	}
+} // }}}
+
+
+TEST_CASE("Vata2::Afa::union_rename()/intersection()/complement()")
+{ // {{{
+	Afa lhs;
+	Afa rhs;
+	Vata2::Nfa::EnumAlphabet alph = {"a", "b"};
+
+	FILL_WITH_AUT_A(lhs);
+
+	// words ending with a1
+	rhs.add_initial(0);
+	rhs.add_final(1);
+	rhs.add_trans(0, "(a0 | a1) & q0 | a1 & q1");
+
+	// all words over {a0, a1} up to length 5
+	std::vector<Word> words = { { } };
+	for (size_t i = 0; i < words.size(); ++i) {
+		if (words[i].size() < 5) {
+			for (Symbol symb : {0, 1}) {
+				Word word = words[i];
+				word.push_back(symb);
+				words.push_back(word);
+			}
+		}
+	}
+
+	SECTION("union")
+	{
+		REQUIRE(!are_state_disjoint(lhs, rhs));
+
+		Afa result = union_rename(lhs, rhs);
+		REQUIRE(result.trans_size() == lhs.trans_size() + rhs.trans_size());
+		for (const Word& word : words) {
+			REQUIRE(is_in_lang(result, word) ==
+				(is_in_lang(lhs, word) || is_in_lang(rhs, word)));
+		}
+	}
+
+	SECTION("intersection")
+	{
+		Afa result = intersection(lhs, rhs);
+		REQUIRE(result.num_states() == lhs.num_states() + rhs.num_states() + 1);
+		for (const Word& word : words) {
+			REQUIRE(is_in_lang(result, word) ==
+				(is_in_lang(lhs, word) && is_in_lang(rhs, word)));
+		}
+
+		REQUIRE(is_lang_empty(intersection(lhs, Afa())));
+	}
+
+	SECTION("complement")
+	{
+		Afa result = complement(lhs, alph);
+		for (const Word& word : words) {
+			REQUIRE(is_in_lang(result, word) == !is_in_lang(lhs, word));
+		}
+
+		REQUIRE(is_lang_empty(intersection(lhs, result)));
+		REQUIRE(is_universal(union_rename(lhs, result), alph));
+		REQUIRE(is_incl(lhs, complement(result, alph), alph));
+		REQUIRE(is_incl(complement(result, alph), lhs, alph));
+	}
+
+	SECTION("rule A and not rule B")
+	{
+		// words that contain a0 and a1 (after the first symbol) and do not end
+		// with a1
+		Afa result = intersection(lhs, complement(rhs, alph));
+		Word cex;
+		REQUIRE(!is_lang_empty_cex(result, &cex));
+		REQUIRE(is_in_lang(lhs, cex));
+		REQUIRE(!is_in_lang(rhs, cex));
+		REQUIRE(cex.back() == 0);
+	}
+} // }}}
+
+
+TEST_CASE("Vata2::Afa::nfa_to_afa()")
+{ // {{{
+	Vata2::Nfa::Nfa nfa;
+	nfa.initialstates = {1};
+	nfa.finalstates = {3};
+	nfa.add_trans(1, 'a', 2);
+	nfa.add_trans(1, 'a', 1);
+	nfa.add_trans(1, 'b', 1);
+	nfa.add_trans(2, 'b', 3);
+
+	Afa aut = nfa_to_afa(nfa);
+	REQUIRE(aut.trans_size() == 4);
+	for (const Word& word : std::vector<Word>{
+		{}, {'a', 'b'}, {'b', 'a', 'b'}, {'a', 'b', 'a'}, {'b'}})
+	{
+		REQUIRE(is_in_lang(aut, word) == Vata2::Nfa::is_in_lang(nfa, word));
+	}
+} // }}}
+
+
+TEST_CASE("Vata2::Afa::NfaView")
+{ // {{{
+	Afa aut;
+	FILL_WITH_AUT_A(aut);
+
+	std::vector<Word> words = { { } };
+	for (size_t i = 0; i < words.size(); ++i) {
+		if (words[i].size() < 6) {
+			for (Symbol symb : {0, 1}) {
+				Word word = words[i];
+				word.push_back(symb);
+				words.push_back(word);
+			}
+		}
+	}
+
+	SECTION("macrostates are hash-consed")
+	{
+		NfaView view(aut);
+		REQUIRE(view.initialstates.size() == 1);
+
+		State init = *view.initialstates.begin();
+		REQUIRE(view.get_macrostate(init).to_set() == std::set<State>({0}));
+		REQUIRE(!view.has_final(init));
+
+		const NfaView::StateSet& post = view.post(init, 0);
+		REQUIRE(post.size() == 1);
+		REQUIRE(view.get_macrostate(*post.begin()).to_set() == std::set<State>({1, 2}));
+		REQUIRE(view.post(init, 1) == post);
+		REQUIRE(view.num_macrostates() == 2);
+	}
+
+	SECTION("terminal operations on lazy NFAs")
+	{
+		NfaView view(aut);
+		for (const Word& word : words) {
+			REQUIRE(Vata2::Nfa::is_in_lang(lazy(view), word) == is_in_lang(aut, word));
+		}
+
+		Word cex;
+		REQUIRE(!Vata2::Nfa::is_lang_empty(lazy(view), &cex));
+		REQUIRE(cex.size() == 3);
+		REQUIRE(is_in_lang(aut, cex));
+	}
+
+	SECTION("inclusion")
+	{
+		Afa aut_b;
+		FILL_WITH_AUT_B(aut_b);
+		Vata2::Nfa::EnumAlphabet alph = {"a0", "a1"};
+
+		NfaView view(aut);
+		NfaView view_b(aut_b);
+
+		Word cex;
+		REQUIRE(Vata2::Nfa::is_lang_empty(Vata2::Nfa::intersection(
+			lazy(view), Vata2::Nfa::complement(lazy(view_b), alph)), &cex));
+		REQUIRE(!Vata2::Nfa::is_lang_empty(Vata2::Nfa::intersection(
+			lazy(view_b), Vata2::Nfa::complement(lazy(view), alph)), &cex));
+		REQUIRE(is_in_lang(aut_b, cex));
+		REQUIRE(!is_in_lang(aut, cex));
+	}
+
+	SECTION("the budget of macrostates")
+	{
+		NfaView view(aut, 8);
+		for (const Word& word : words) {
+			NfaView::StateSet cur = view.initialstates;
+			for (Symbol symb : word) {
+				NfaView::StateSet next;
+				for (State macro : cur) {
+					const NfaView::StateSet& macro_post = view.post(macro, symb);
+					next.insert(macro_post.begin(), macro_post.end());
+				}
+
+				cur = std::move(next);
+				if (view.num_macrostates() > 4) { view.flush(&cur); }
+			}
+
+			bool fin = false;
+			for (State macro : cur) { fin = fin || view.has_final(macro); }
+			REQUIRE(fin == is_in_lang(aut, word));
+		}
+
+		REQUIRE(view.num_flushes() > 0);
+
+		NfaView small(aut, 1);
+		CHECK_THROWS_WITH(Vata2::Nfa::is_lang_empty(lazy(small)), Catch::Contains("budget"));
+	}
+} // }}}
@@ -0,0 +1,189 @@
+/* ca-regex.cc -- compilation of regular expressions into counting automata
+ *
+ * Copyright (c) 2018 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+// VATA headers
+#include <vata2/ca.hh>
+
+// local headers
+#include "../regex-aux.hh"
+
+using namespace Vata2::Ca;
+using namespace Vata2::regex;
+using namespace Vata2::util;
+
+
+void Vata2::Ca::compile_regex(
+	Ca*                 result,
+	const std::string&  pattern,
+	const StringDict&   params)
+{ // {{{
+	assert(nullptr != result);
+
+	bool search = false;
+	if (haskey(params, "match")) {
+		const std::string& str_match = params.at("match");
+		if ("search" == str_match) { search = true; }
+		else if ("full" != str_match) {
+			throw std::runtime_error(std::to_string(__func__) +
+				" received an unknown value of the \"match\" key: " + str_match);
+		}
+	}
+
+	RegexParser parser(pattern, true, REGEX_COUNTER_MAX);
+	const size_t root = parser.parse();
+	if (search) { parser.check_anchors(); }
+
+	// ^ removes the loop in the initial state, $ removes the sink
+	const bool loop_initial = search && !parser.anchored_begin;
+	const bool use_sink = search && !parser.anchored_end;
+	const std::vector<Node>& nodes = parser.nodes;
+	const Glushkov sets = compute_glushkov(nodes, root);
+
+	*result = Ca();
+
+	std::vector<bool> nullable(nodes.size());
+	for (size_t i = 0; i <= root; ++i)
+	{
+		const Node& node = nodes[i];
+		switch (node.kind)
+		{
+			case Node::EPSILON: nullable[i] = true; break;
+			case Node::BYTES: nullable[i] = false; break;
+			case Node::CAT: nullable[i] = nullable[node.left] && nullable[node.right]; break;
+			case Node::ALT: nullable[i] = nullable[node.left] || nullable[node.right]; break;
+			case Node::PLUS: nullable[i] = nullable[node.left]; break;
+			case Node::REPEAT: nullable[i] = nullable[node.left] || 0 == node.min; break;
+			default: nullable[i] = true;
+		}
+	}
+
+	// the counter of the REPEAT node above every node (parents follow their
+	// children, so the tree is traversed top-down backwards; nodes that are
+	// not in the tree come from e{0} and are skipped)
+	std::vector<CounterId> scope(nodes.size(), NO_COUNTER);
+	std::vector<bool> in_tree(nodes.size());
+	in_tree[root] = true;
+	for (size_t i = root + 1; i > 0; --i)
+	{
+		const Node& node = nodes[i - 1];
+		if (!in_tree[i - 1]) { continue; }
+
+		switch (node.kind)
+		{
+			case Node::EPSILON: break;
+			case Node::BYTES: break;
+			case Node::CAT: // fallthrough
+			case Node::ALT:
+				scope[node.left] = scope[node.right] = scope[i - 1];
+				in_tree[node.left] = in_tree[node.right] = true;
+				break;
+			case Node::REPEAT:
+				assert(NO_COUNTER == scope[i - 1]);
+				// if e is nullable, then e{m,n} = e{0,n}
+				scope[node.left] = result->add_counter(
+					nullable[node.left]? 0 : node.min, node.max);
+				in_tree[node.left] = true;
+				break;
+			default:
+				scope[node.left] = scope[i - 1];
+				in_tree[node.left] = true;
+		}
+	}
+
+	// in the search mode, every transition to a final state without a
+	// counter also leads to an accepting sink (so that final states do not
+	// need loops); final states with a counter move to the sink if they can
+	// leave the counter
+	std::vector<bool> is_final(nodes.size());
+	for (size_t pos : sets.last) { is_final[pos] = true; }
+	const State sink = nodes.size() + 1;
+
+	// only positions reachable from the initial state get a state
+	PositionSymbols symbols(nodes);
+	std::vector<bool> visited(nodes.size());
+	std::vector<size_t> worklist;
+	auto add_edge = [&](State src, size_t tgt, Guard guard, Action action) {
+		if (!visited[tgt])
+		{
+			visited[tgt] = true;
+			worklist.push_back(tgt);
+			if (NO_COUNTER != scope[tgt]) { result->set_counter(tgt + 1, scope[tgt]); }
+		}
+
+		for (Symbol symb : symbols[tgt])
+		{
+			result->add_trans(src, symb, tgt + 1, guard, action);
+			if (use_sink && is_final[tgt] && NO_COUNTER == scope[tgt]) {
+				result->add_trans(src, symb, sink, guard);
+			}
+		}
+	};
+
+	result->initialstates = {0};
+	for (size_t pos : sets.first)
+	{
+		add_edge(0, pos, Guard::NONE, (NO_COUNTER == scope[pos])? Action::NONE : Action::RESET);
+	}
+
+	while (!worklist.empty())
+	{
+		const size_t pos = worklist.back();
+		worklist.pop_back();
+		for (const Glushkov::Edge& edge : sets.follow[pos])
+		{
+			const Node& creator = nodes[edge.creator];
+			if (Node::REPEAT == creator.kind)
+			{ // the next iteration
+				add_edge(pos + 1, edge.tgt, Guard::CAN_INCR, Action::INCR);
+			}
+			else if (NO_COUNTER != scope[edge.creator])
+			{ // within an iteration
+				add_edge(pos + 1, edge.tgt, Guard::NONE, Action::KEEP);
+			}
+			else
+			{ // possibly leaving a counter and entering another one
+				add_edge(pos + 1, edge.tgt,
+					(NO_COUNTER == scope[pos])? Guard::NONE : Guard::CAN_EXIT,
+					(NO_COUNTER == scope[edge.tgt])? Action::NONE : Action::RESET);
+			}
+		}
+	}
+
+	if (sets.nullable) { result->finalstates.insert(0); }
+	for (size_t pos : sets.last) { result->finalstates.insert(pos + 1); }
+
+	if (loop_initial)
+	{ // every word with a factor (suffix if anchored at the end) in the language
+		for (size_t byte = 0; byte < 256; ++byte) { result->add_trans(0, byte, 0); }
+	}
+
+	if (use_sink)
+	{ // every word with a factor (prefix if anchored at the beginning) in the language
+		result->finalstates.insert(sink);
+		for (size_t byte = 0; byte < 256; ++byte)
+		{
+			result->add_trans(sink, byte, sink);
+			if (sets.nullable) { result->add_trans(0, byte, sink); }
+			for (size_t pos : sets.last)
+			{
+				if (visited[pos] && NO_COUNTER != scope[pos]) {
+					result->add_trans(pos + 1, byte, sink, Guard::CAN_EXIT);
+				}
+			}
+		}
+	}
+} // compile_regex }}}
@@ -0,0 +1,663 @@
+/* ca.cc -- operations for counting automata
+ *
+ * Copyright (c) 2018 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <algorithm>
+#include <functional>
+#include <set>
+#include <tuple>
+
+// VATA headers
+#include <vata2/ca.hh>
+#include <vata2/util.hh>
+
+using namespace Vata2::util;
+using namespace Vata2::Ca;
+
+
+namespace
+{
+	const char* guard_to_str(Guard guard)
+	{ // {{{
+		switch (guard)
+		{
+			case Guard::CAN_INCR: return "lt";
+			case Guard::CAN_EXIT: return "ge";
+			default: return "";
+		}
+	} // guard_to_str }}}
+
+	const char* action_to_str(Action action)
+	{ // {{{
+		switch (action)
+		{
+			case Action::KEEP: return "keep";
+			case Action::INCR: return "incr";
+			case Action::RESET: return "reset";
+			default: return "";
+		}
+	} // action_to_str }}}
+
+	/// checks whether the guard of a transition is satisfied by @p value of
+	/// the counter @p counter of the source
+	bool check_guard(Guard guard, const Counter* counter, size_t value)
+	{ // {{{
+		switch (guard)
+		{
+			case Guard::CAN_INCR: return value < counter->max;
+			case Guard::CAN_EXIT: return value >= counter->min;
+			default: return true;
+		}
+	} // check_guard }}}
+} // anonymous namespace
+
+
+std::ostream& std::operator<<(std::ostream& os, const Vata2::Ca::Trans& trans)
+{ // {{{
+	std::string result = "(" + std::to_string(trans.src) + ", " +
+		std::to_string(trans.symb) + ", " + std::to_string(trans.tgt);
+	if (Guard::NONE != trans.guard) { result += std::string(", ") + guard_to_str(trans.guard); }
+	if (Action::NONE != trans.action) {
+		result += std::string(", ") + action_to_str(trans.action);
+	}
+	return os << result + ")";
+} // operator<<(ostream, Trans) }}}
+
+
+void CountingSet::insert(size_t value)
+{ // {{{
+	const int64_t stored = static_cast<int64_t>(value) - this->offset;
+	if (this->empty() || stored < this->elems.back()) {
+		this->elems.push_back(stored);
+		return;
+	}
+	if (stored > this->elems.front()) {
+		this->elems.push_front(stored);
+		return;
+	}
+
+	auto it = std::lower_bound(this->elems.begin(), this->elems.end(), stored,
+		std::greater<int64_t>());
+	if (*it != stored) { this->elems.insert(it, stored); }
+} // insert }}}
+
+
+bool CountingSet::contains(size_t value) const
+{ // {{{
+	const int64_t stored = static_cast<int64_t>(value) - this->offset;
+	return std::binary_search(this->elems.begin(), this->elems.end(), stored,
+		std::greater<int64_t>());
+} // contains }}}
+
+
+void CountingSet::merge(CountingSet&& rhs)
+{ // {{{
+	if (this->size() < rhs.size()) {
+		std::swap(this->elems, rhs.elems);
+		std::swap(this->offset, rhs.offset);
+	}
+	if (rhs.empty()) { return; }
+
+	// the common cases: all new values are at one end
+	if (this->empty() || rhs.max() < this->min()) {
+		for (int64_t elem : rhs.elems) { this->elems.push_back(elem + rhs.offset - this->offset); }
+		return;
+	}
+	if (rhs.min() > this->max()) {
+		for (auto it = rhs.elems.rbegin(); it != rhs.elems.rend(); ++it) {
+			this->elems.push_front(*it + rhs.offset - this->offset);
+		}
+		return;
+	}
+
+	std::deque<int64_t> merged;
+	auto lhs_it = this->elems.begin();
+	auto rhs_it = rhs.elems.begin();
+	while (this->elems.end() != lhs_it || rhs.elems.end() != rhs_it)
+	{
+		int64_t elem;
+		if (rhs.elems.end() == rhs_it ||
+			(this->elems.end() != lhs_it && *lhs_it >= *rhs_it + rhs.offset - this->offset))
+		{
+			elem = *lhs_it++;
+		}
+		else
+		{
+			elem = *rhs_it++ + rhs.offset - this->offset;
+		}
+
+		if (merged.empty() || merged.back() != elem) { merged.push_back(elem); }
+	}
+
+	this->elems = std::move(merged);
+} // merge }}}
+
+
+std::vector<size_t> CountingSet::get_values() const
+{ // {{{
+	std::vector<size_t> result;
+	for (int64_t elem : this->elems) { result.push_back(elem + this->offset); }
+	return result;
+} // get_values }}}
+
+
+CounterId Ca::add_counter(size_t min, size_t max)
+{ // {{{
+	if (0 == max || max < min) {
+		throw std::runtime_error("invalid bounds of a counter: [" + std::to_string(min) +
+			", " + std::to_string(max) + "]");
+	}
+
+	this->counters.push_back({min, max});
+	return this->counters.size() - 1;
+} // add_counter }}}
+
+
+void Ca::set_counter(State state, CounterId id)
+{ // {{{
+	if (id >= this->counters.size()) {
+		throw std::runtime_error("unknown counter " + std::to_string(id));
+	}
+
+	this->state_counter[state] = id;
+} // set_counter }}}
+
+
+void Ca::add_trans(const Trans& trans)
+{ // {{{
+	const CounterId src_cnt = this->get_state_counter(trans.src);
+	const CounterId tgt_cnt = this->get_state_counter(trans.tgt);
+
+	bool consistent = (Guard::NONE == trans.guard || NO_COUNTER != src_cnt);
+	switch (trans.action)
+	{
+		case Action::NONE: consistent &= (NO_COUNTER == tgt_cnt); break;
+		case Action::KEEP: // fallthrough
+		case Action::INCR: consistent &= (NO_COUNTER != tgt_cnt && src_cnt == tgt_cnt); break;
+		case Action::RESET: consistent &= (NO_COUNTER != tgt_cnt); break;
+	}
+
+	if (!consistent) {
+		throw std::runtime_error("inconsistent counters in the transition " +
+			std::to_string(trans));
+	}
+
+	MoveList& moves = this->transitions[trans.src][trans.symb];
+	for (const Move& move : moves)
+	{
+		if (move.tgt == trans.tgt && move.guard == trans.guard && move.action == trans.action) {
+			return;
+		}
+	}
+
+	moves.push_back({trans.tgt, trans.guard, trans.action});
+	++this->num_trans;
+} // add_trans }}}
+
+
+bool Ca::has_trans(const Trans& trans) const
+{ // {{{
+	for (const Move& move : this->get_moves(trans.src, trans.symb))
+	{
+		if (move.tgt == trans.tgt && move.guard == trans.guard && move.action == trans.action) {
+			return true;
+		}
+	}
+
+	return false;
+} // has_trans }}}
+
+
+const Ca::PostSymb& Ca::get_post(State src) const
+{ // {{{
+	static const PostSymb EMPTY;
+	auto it = this->transitions.find(src);
+	return (this->transitions.end() == it)? EMPTY : it->second;
+} // get_post }}}
+
+
+const Ca::MoveList& Ca::get_moves(State src, Symbol symb) const
+{ // {{{
+	static const MoveList EMPTY;
+	const PostSymb& post = this->get_post(src);
+	auto it = post.find(symb);
+	return (post.end() == it)? EMPTY : it->second;
+} // get_moves }}}
+
+
+std::vector<Trans> Ca::get_transitions() const
+{ // {{{
+	std::vector<Trans> result;
+	for (const auto& src_post : this->transitions)
+	{
+		for (const auto& symb_moves : src_post.second)
+		{
+			for (const Move& move : symb_moves.second)
+			{
+				result.push_back({src_post.first, symb_moves.first, move.tgt, move.guard,
+					move.action});
+			}
+		}
+	}
+
+	std::sort(result.begin(), result.end(), [](const Trans& lhs, const Trans& rhs) {
+		return std::tie(lhs.src, lhs.symb, lhs.tgt, lhs.guard, lhs.action) <
+			std::tie(rhs.src, rhs.symb, rhs.tgt, rhs.guard, rhs.action);
+	});
+	return result;
+} // get_transitions }}}
+
+
+Config Vata2::Ca::get_initial_config(const Ca& aut)
+{ // {{{
+	Config result;
+	for (State st : aut.initialstates)
+	{
+		if (NO_COUNTER != aut.get_state_counter(st)) {
+			throw std::runtime_error("the initial state " + std::to_string(st) +
+				" has a counter");
+		}
+
+		result[st].insert(0);
+	}
+
+	return result;
+} // get_initial_config }}}
+
+
+Config Vata2::Ca::post(const Ca& aut, Config&& config, Symbol symb)
+{ // {{{
+	Config result;
+	for (auto& st_values : config)
+	{
+		CountingSet& values = st_values.second;
+		if (values.empty()) { continue; }
+
+		const CounterId cnt = aut.get_state_counter(st_values.first);
+		const Counter* counter = (NO_COUNTER == cnt)? nullptr : &aut.get_counter(cnt);
+		const Ca::MoveList& moves = aut.get_moves(st_values.first, symb);
+
+		// moves that only check whether the guard is satisfied by some value
+		for (const Ca::Move& move : moves)
+		{
+			if (Action::KEEP == move.action || Action::INCR == move.action) { continue; }
+
+			bool enabled = true;
+			if (Guard::CAN_INCR == move.guard) { enabled = values.min() < counter->max; }
+			else if (Guard::CAN_EXIT == move.guard) { enabled = values.max() >= counter->min; }
+
+			if (enabled) { result[move.tgt].insert((Action::RESET == move.action)? 1 : 0); }
+		}
+
+		// moves that take over the values (the last of them uses the original)
+		size_t last_use = moves.size();
+		for (size_t i = 0; i < moves.size(); ++i)
+		{
+			if (Action::KEEP == moves[i].action || Action::INCR == moves[i].action) { last_use = i; }
+		}
+
+		for (size_t i = 0; i < moves.size(); ++i)
+		{
+			const Ca::Move& move = moves[i];
+			if (Action::KEEP != move.action && Action::INCR != move.action) { continue; }
+
+			CountingSet moved = (i == last_use)? std::move(values) : values;
+			if (Guard::CAN_INCR == move.guard || Action::INCR == move.action) {
+				moved.remove_from(counter->max);
+			}
+			if (Guard::CAN_EXIT == move.guard) { moved.remove_below(counter->min); }
+			if (moved.empty()) { continue; }
+
+			if (Action::INCR == move.action) { moved.incr(); }
+			result[move.tgt].merge(std::move(moved));
+		}
+	}
+
+	return result;
+} // post }}}
+
+
+bool Vata2::Ca::is_accepting(const Ca& aut, const Config& config)
+{ // {{{
+	for (const auto& st_values : config)
+	{
+		if (!aut.has_final(st_values.first) || st_values.second.empty()) { continue; }
+
+		const CounterId cnt = aut.get_state_counter(st_values.first);
+		if (NO_COUNTER == cnt || st_values.second.max() >= aut.get_counter(cnt).min) {
+			return true;
+		}
+	}
+
+	return false;
+} // is_accepting }}}
+
+
+bool Vata2::Ca::is_in_lang(const Ca& aut, const Word& word)
+{ // {{{
+	Config config = get_initial_config(aut);
+	for (Symbol symb : word)
+	{
+		config = post(aut, std::move(config), symb);
+		if (config.empty()) { return false; }
+	}
+
+	return is_accepting(aut, config);
+} // is_in_lang }}}
+
+
+void Vata2::Ca::expand(Vata2::Nfa::Nfa* result, const Ca& aut)
+{ // {{{
+	assert(nullptr != result);
+
+	using StateValue = std::pair<State, size_t>;
+	std::unordered_map<StateValue, State> ids;
+	std::vector<StateValue> worklist;
+
+	auto get_id = [&ids, &worklist](const StateValue& st_val) {
+		auto it_ins = ids.insert({st_val, ids.size()});
+		if (it_ins.second) { worklist.push_back(st_val); }
+		return it_ins.first->second;
+	};
+
+	*result = Vata2::Nfa::Nfa();
+	for (const auto& st_values : get_initial_config(aut))
+	{
+		result->initialstates.insert(get_id({st_values.first, 0}));
+	}
+
+	while (!worklist.empty())
+	{
+		const StateValue st_val = worklist.back();
+		worklist.pop_back();
+		const State src = ids.at(st_val);
+
+		const CounterId cnt = aut.get_state_counter(st_val.first);
+		const Counter* counter = (NO_COUNTER == cnt)? nullptr : &aut.get_counter(cnt);
+		if (aut.has_final(st_val.first) && (nullptr == counter || st_val.second >= counter->min)) {
+			result->finalstates.insert(src);
+		}
+
+		for (const auto& symb_moves : aut.get_post(st_val.first))
+		{
+			for (const Ca::Move& move : symb_moves.second)
+			{
+				if (!check_guard(move.guard, counter, st_val.second)) { continue; }
+
+				size_t value = 0;
+				switch (move.action)
+				{
+					case Action::NONE: value = 0; break;
+					case Action::KEEP: value = st_val.second; break;
+					case Action::INCR: value = st_val.second + 1; break;
+					case Action::RESET: value = 1; break;
+				}
+				if (Action::INCR == move.action && value > counter->max) { continue; }
+
+				result->add_trans(src, symb_moves.first, get_id({move.tgt, value}));
+			}
+		}
+	}
+} // expand }}}
+
+
+Vata2::Parser::ParsedSection Vata2::Ca::serialize(
+	const Ca&                 aut,
+	const SymbolToStringMap*  symbol_map,
+	const StateToStringMap*   state_map)
+{ // {{{
+	Vata2::Parser::ParsedSection parsec;
+	parsec.type = Vata2::Ca::TYPE_CA;
+
+	auto state_namer = [state_map](State st) -> std::string {
+		if (nullptr == state_map) { return "q" + std::to_string(st); }
+
+		auto it = state_map->find(st);
+		if (state_map->end() == it)
+		{
+			throw std::runtime_error("cannot translate state " + std::to_string(st));
+		}
+
+		return it->second;
+	};
+
+	auto symbol_namer = [symbol_map](Symbol sym) -> std::string {
+		if (nullptr == symbol_map) { return "a" + std::to_string(sym); }
+
+		auto it = symbol_map->find(sym);
+		if (symbol_map->end() == it)
+		{
+			throw std::runtime_error("cannot translate symbol " + std::to_string(sym));
+		}
+
+		return it->second;
+	};
+
+	auto counter_namer = [](CounterId id) { return "c" + std::to_string(id); };
+
+	std::vector<std::string> init_states;
+	for (State st : aut.initialstates) { init_states.push_back(state_namer(st)); }
+	parsec.dict["Initial"] = init_states;
+
+	std::vector<std::string> fin_states;
+	for (State st : aut.finalstates) { fin_states.push_back(state_namer(st)); }
+	parsec.dict["Final"] = fin_states;
+
+	if (!aut.get_counters().empty())
+	{
+		std::vector<std::string> counters;
+		for (CounterId id = 0; id < aut.get_counters().size(); ++id)
+		{
+			counters.push_back(counter_namer(id));
+			counters.push_back(std::to_string(aut.get_counter(id).min));
+			counters.push_back(std::to_string(aut.get_counter(id).max));
+		}
+		parsec.dict["Counters"] = counters;
+	}
+
+	std::vector<std::string> scopes;
+	std::vector<Trans> transs = aut.get_transitions();
+	std::set<State> states(aut.initialstates.begin(), aut.initialstates.end());
+	states.insert(aut.finalstates.begin(), aut.finalstates.end());
+	for (const Trans& trans : transs) { states.insert(trans.src); states.insert(trans.tgt); }
+	for (State st : states)
+	{
+		if (NO_COUNTER != aut.get_state_counter(st))
+		{
+			scopes.push_back(state_namer(st));
+			scopes.push_back(counter_namer(aut.get_state_counter(st)));
+		}
+	}
+	if (!scopes.empty()) { parsec.dict["Scopes"] = scopes; }
+
+	for (const Trans& trans : transs)
+	{
+		std::vector<std::string> line =
+			{state_namer(trans.src), symbol_namer(trans.symb), state_namer(trans.tgt)};
+		if (Guard::NONE != trans.guard) { line.push_back(guard_to_str(trans.guard)); }
+		if (Action::NONE != trans.action) { line.push_back(action_to_str(trans.action)); }
+		parsec.body.push_back(line);
+	}
+
+	return parsec;
+} // serialize }}}
+
+
+void Vata2::Ca::construct(
+	Ca*                                  aut,
+	const Vata2::Parser::ParsedSection&  parsec,
+	Alphabet*                            alphabet,
+	StringToStateMap*                    state_map)
+{ // {{{
+	assert(nullptr != aut);
+	assert(nullptr != alphabet);
+
+	if (parsec.type != Vata2::Ca::TYPE_CA) {
+		throw std::runtime_error(std::string(__FUNCTION__) + ": expecting type \"" +
+			Vata2::Ca::TYPE_CA + "\"");
+	}
+
+	bool remove_state_map = false;
+	if (nullptr == state_map) {
+		state_map = new StringToStateMap();
+		remove_state_map = true;
+	}
+
+	State cnt_state = 0;
+
+	// a lambda for translating state names to identifiers
+	auto get_state_name = [state_map, &cnt_state](const std::string& str) {
+		auto it_insert_pair = state_map->insert({str, cnt_state});
+		if (it_insert_pair.second) { return cnt_state++; }
+		else { return it_insert_pair.first->second; }
+	};
+
+	// a lambda for cleanup
+	auto clean_up = [&]() {
+		if (remove_state_map) { delete state_map; }
+	};
+
+	try
+	{
+		auto it = parsec.dict.find("Initial");
+		if (parsec.dict.end() != it)
+		{
+			for (const auto& str : it->second) { aut->add_initial(get_state_name(str)); }
+		}
+
+		it = parsec.dict.find("Final");
+		if (parsec.dict.end() != it)
+		{
+			for (const auto& str : it->second) { aut->add_final(get_state_name(str)); }
+		}
+
+		std::unordered_map<std::string, CounterId> counter_map;
+		it = parsec.dict.find("Counters");
+		if (parsec.dict.end() != it)
+		{
+			const std::vector<std::string>& list = it->second;
+			if (list.size() % 3 != 0) {
+				throw std::runtime_error("Invalid counters: " + std::to_string(list));
+			}
+
+			for (size_t i = 0; i < list.size(); i += 3)
+			{
+				counter_map[list[i]] = aut->add_counter(std::stoul(list[i + 1]),
+					std::stoul(list[i + 2]));
+			}
+		}
+
+		it = parsec.dict.find("Scopes");
+		if (parsec.dict.end() != it)
+		{
+			const std::vector<std::string>& list = it->second;
+			if (list.size() % 2 != 0) {
+				throw std::runtime_error("Invalid scopes: " + std::to_string(list));
+			}
+
+			for (size_t i = 0; i < list.size(); i += 2)
+			{
+				if (!haskey(counter_map, list[i + 1])) {
+					throw std::runtime_error("Unknown counter: " + list[i + 1]);
+				}
+				aut->set_counter(get_state_name(list[i]), counter_map.at(list[i + 1]));
+			}
+		}
+
+		for (const auto& body_line : parsec.body)
+		{
+			if (body_line.size() < 3 || body_line.size() > 5)
+			{
+				throw std::runtime_error("Invalid transition: " +
+					std::to_string(body_line));
+			}
+
+			std::vector<std::string> line(body_line.begin(), body_line.end());
+			Trans trans(get_state_name(line[0]), alphabet->translate_symb(line[1]),
+				get_state_name(line[2]));
+			for (size_t i = 3; i < line.size(); ++i)
+			{
+				if ("lt" == line[i]) { trans.guard = Guard::CAN_INCR; }
+				else if ("ge" == line[i]) { trans.guard = Guard::CAN_EXIT; }
+				else if ("keep" == line[i]) { trans.action = Action::KEEP; }
+				else if ("incr" == line[i]) { trans.action = Action::INCR; }
+				else if ("reset" == line[i]) { trans.action = Action::RESET; }
+				else
+				{
+					throw std::runtime_error("Invalid transition: " +
+						std::to_string(body_line));
+				}
+			}
+
+			aut->add_trans(trans);
+		}
+	}
+	catch (std::exception&)
+	{
+		clean_up();
+		throw;
+	}
+
+	// do the dishes and take out garbage
+	clean_up();
+} // construct }}}
+
+
+void Vata2::Ca::construct(
+	Ca*                                  aut,
+	const Vata2::Parser::ParsedSection&  parsec,
+	StringToSymbolMap*                   symbol_map,
+	StringToStateMap*                    state_map)
+{ // {{{
+	assert(nullptr != aut);
+
+	bool remove_symbol_map = false;
+	if (nullptr == symbol_map)
+	{
+		symbol_map = new StringToSymbolMap();
+		remove_symbol_map = true;
+	}
+
+	auto release_res = [&](){ if (remove_symbol_map) delete symbol_map; };
+
+	Vata2::Nfa::OnTheFlyAlphabet alphabet(symbol_map);
+
+	try
+	{
+		construct(aut, parsec, &alphabet, state_map);
+	}
+	catch (std::exception&)
+	{
+		release_res();
+		throw;
+	}
+
+	release_res();
+} // construct(StringToSymbolMap) }}}
+
+
+std::ostream& Vata2::Ca::operator<<(std::ostream& os, const Ca& ca)
+{ // {{{
+	return os << std::to_string(serialize(ca));
+} // Ca::operator<<(ostream) }}}
+
+
+std::ostream& std::operator<<(std::ostream& os, const Vata2::Ca::CaWrapper& ca_wrap)
+{ // {{{
+	os << "{CA wrapper|CA: " << ca_wrap.ca << "|alphabet: " << ca_wrap.alphabet <<
+		"|state_dict: " << std::to_string(ca_wrap.state_dict) << "}";
+	return os;
+} // operator<<(CaWrapper) }}}
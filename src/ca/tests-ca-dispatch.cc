@@ -0,0 +1,62 @@
+/* tests-ca-dispatch.cc -- tests of CA dispatch functions
+ *
+ * Copyright (c) 2018 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "../3rdparty/catch.hpp"
+
+#include <vata2/ca.hh>
+#include <vata2/vm-dispatch.hh>
+
+using namespace Vata2::VM;
+using namespace Vata2::Ca;
+
+TEST_CASE("Vata2::VM::find_dispatcher(\"CA\")")
+{
+	SECTION("construct")
+	{
+		Vata2::Parser::ParsedSection parsec;
+		parsec.type = Vata2::Ca::TYPE_CA;
+		parsec.dict.insert({"Initial", {"q0"}});
+		parsec.dict.insert({"Final", {"q1"}});
+		parsec.dict.insert({"Counters", {"c", "2", "3"}});
+		parsec.dict.insert({"Scopes", {"q1", "c"}});
+		parsec.body = { {"q0", "a", "q1", "reset"}, {"q1", "a", "q1", "lt", "incr"} };
+
+		VMValue res = find_dispatcher(Vata2::Ca::TYPE_CA)("construct",
+			{{Vata2::TYPE_PARSEC, &parsec}});
+		REQUIRE(Vata2::Ca::TYPE_CA == res.type);
+		const CaWrapper* wrap = static_cast<const CaWrapper*>(res.get_ptr());
+		REQUIRE(wrap->ca.trans_size() == 2);
+		REQUIRE(wrap->ca.get_state_counter(wrap->state_dict.at("q1")) == 0);
+
+		delete wrap->alphabet;
+		delete wrap;
+	}
+
+	SECTION("no parameters")
+	{
+		CHECK_THROWS_WITH(find_dispatcher(Vata2::Ca::TYPE_CA)("barrel-roll", { }),
+			Catch::Contains("with no arguments"));
+	}
+
+	SECTION("invalid function")
+	{
+		std::string str = "arg1";
+		VMValue res = find_dispatcher(Vata2::Ca::TYPE_CA)("barrel-roll",
+			{{Vata2::TYPE_STR, &str}});
+		REQUIRE(Vata2::TYPE_NOT_A_VALUE == res.type);
+	}
+}
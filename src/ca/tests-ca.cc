@@ -0,0 +1,287 @@
+/* tests-ca.cc -- tests of counting automata
+ *
+ * Copyright (c) 2018 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "../3rdparty/catch.hpp"
+
+#include <vata2/ca.hh>
+
+using namespace Vata2::Ca;
+using namespace Vata2::Parser;
+
+// Some common automata {{{
+
+// Automaton A: a{2,4}b (q1 counts the a's)
+#define FILL_WITH_AUT_A(x) \
+	x.initialstates = {0}; \
+	x.finalstates = {2}; \
+	x.set_counter(1, x.add_counter(2, 4)); \
+	x.add_trans(0, 'a', 1, Guard::NONE, Action::RESET); \
+	x.add_trans(1, 'a', 1, Guard::CAN_INCR, Action::INCR); \
+	x.add_trans(1, 'b', 2, Guard::CAN_EXIT, Action::NONE); \
+
+// }}}
+
+namespace
+{
+	Word to_word(const std::string& str)
+	{ // {{{
+		Word result;
+		for (unsigned char chr : str) { result.push_back(chr); }
+		return result;
+	} // to_word }}}
+
+	/// all words over @p alphabet up to length @p len
+	std::vector<std::string> all_words(const std::string& alphabet, size_t len)
+	{ // {{{
+		std::vector<std::string> result = {""};
+		for (size_t i = 0; i < result.size(); ++i) {
+			if (result[i].size() == len) { continue; }
+			for (char chr : alphabet) { result.push_back(result[i] + chr); }
+		}
+		return result;
+	} // all_words }}}
+} // anonymous namespace
+
+
+TEST_CASE("Vata2::Ca::CountingSet")
+{ // {{{
+	CountingSet set;
+	REQUIRE(set.empty());
+
+	set.insert(1);
+	set.incr();
+	set.insert(1);
+	set.incr();
+	set.insert(1);
+	REQUIRE(set.get_values() == std::vector<size_t>({3, 2, 1}));
+	REQUIRE(set.max() == 3);
+	REQUIRE(set.min() == 1);
+	REQUIRE(set.contains(2));
+	REQUIRE(!set.contains(4));
+
+	set.insert(2);
+	REQUIRE(set.size() == 3);
+
+	SECTION("removing values")
+	{
+		set.remove_from(3);
+		REQUIRE(set.get_values() == std::vector<size_t>({2, 1}));
+		set.remove_below(2);
+		REQUIRE(set.get_values() == std::vector<size_t>({2}));
+		set.remove_below(3);
+		REQUIRE(set.empty());
+	}
+
+	SECTION("merging")
+	{
+		CountingSet other;
+		other.insert(7);
+		other.insert(5);
+		set.merge(std::move(other));
+		REQUIRE(set.get_values() == std::vector<size_t>({7, 5, 3, 2, 1}));
+
+		CountingSet inner;
+		inner.insert(4);
+		inner.insert(2);
+		inner.incr();
+		set.merge(std::move(inner));
+		REQUIRE(set.get_values() == std::vector<size_t>({7, 5, 3, 2, 1}));
+
+		inner = CountingSet();
+		inner.insert(6);
+		inner.insert(4);
+		set.merge(std::move(inner));
+		REQUIRE(set.get_values() == std::vector<size_t>({7, 6, 5, 4, 3, 2, 1}));
+	}
+} // }}}
+
+
+TEST_CASE("Vata2::Ca::Ca::add_trans()/has_trans()")
+{ // {{{
+	Ca aut;
+	FILL_WITH_AUT_A(aut);
+
+	REQUIRE(aut.trans_size() == 3);
+	REQUIRE(aut.has_trans({1, 'a', 1, Guard::CAN_INCR, Action::INCR}));
+	REQUIRE(!aut.has_trans({1, 'a', 1, Guard::NONE, Action::INCR}));
+	REQUIRE(aut.get_moves(1, 'b').size() == 1);
+	REQUIRE(aut.get_moves(2, 'b').empty());
+
+	aut.add_trans(0, 'a', 1, Guard::NONE, Action::RESET);
+	REQUIRE(aut.trans_size() == 3);
+
+	CHECK_THROWS_WITH(aut.add_trans(0, 'a', 1), Catch::Contains("inconsistent"));
+	CHECK_THROWS_WITH(aut.add_trans(0, 'a', 2, Guard::CAN_EXIT),
+		Catch::Contains("inconsistent"));
+	CHECK_THROWS_WITH(aut.add_trans(0, 'a', 1, Guard::NONE, Action::KEEP),
+		Catch::Contains("inconsistent"));
+	CHECK_THROWS_WITH(aut.add_counter(3, 2), Catch::Contains("invalid bounds"));
+} // }}}
+
+
+TEST_CASE("Vata2::Ca::is_in_lang()/expand()")
+{ // {{{
+	Ca aut;
+	FILL_WITH_AUT_A(aut);
+
+	REQUIRE(!is_in_lang(aut, to_word("ab")));
+	REQUIRE(is_in_lang(aut, to_word("aab")));
+	REQUIRE(is_in_lang(aut, to_word("aaaab")));
+	REQUIRE(!is_in_lang(aut, to_word("aaaaab")));
+	REQUIRE(!is_in_lang(aut, to_word("aaa")));
+
+	SECTION("counting sets keep all values of the counter")
+	{
+		// .*a{2,4}b: after reading a^k, the counter has the values 1..min(k, 4)
+		aut.add_trans(0, 'a', 0);
+		aut.add_trans(0, 'b', 0);
+
+		Config config = get_initial_config(aut);
+		for (size_t i = 0; i < 6; ++i) { config = post(aut, std::move(config), 'a'); }
+		REQUIRE(config.at(1).get_values() == std::vector<size_t>({4, 3, 2, 1}));
+		REQUIRE(!is_accepting(aut, config));
+
+		REQUIRE(is_in_lang(aut, to_word("bbaaaaaab")));
+		REQUIRE(!is_in_lang(aut, to_word("bbab")));
+	}
+
+	SECTION("expand()")
+	{
+		Vata2::Nfa::Nfa nfa = expand(aut);
+		REQUIRE(Vata2::Nfa::get_fwd_reach_states(nfa).size() == 6);
+		for (const std::string& word : all_words("ab", 7)) {
+			REQUIRE(Vata2::Nfa::is_in_lang(nfa, to_word(word)) == is_in_lang(aut, to_word(word)));
+		}
+	}
+
+	SECTION("initial states cannot have counters")
+	{
+		aut.initialstates.insert(1);
+		CHECK_THROWS_WITH(is_in_lang(aut, to_word("a")), Catch::Contains("has a counter"));
+	}
+} // }}}
+
+
+TEST_CASE("Vata2::Ca::compile_regex()")
+{ // {{{
+	SECTION("counters instead of unrolling")
+	{
+		Ca aut = compile_regex("[^\\n]{1,1024}");
+		REQUIRE(aut.get_counters().size() == 1);
+		REQUIRE(aut.trans_size() == 2 * 255);
+
+		std::string line(1024, 'x');
+		REQUIRE(is_in_lang(aut, to_word(line)));
+		REQUIRE(!is_in_lang(aut, to_word(line + "x")));
+		REQUIRE(!is_in_lang(aut, to_word("x\nx")));
+		REQUIRE(!is_in_lang(aut, to_word("")));
+
+		CHECK_THROWS_WITH(compile_regex("a{65537}"), Catch::Contains("too large"));
+	}
+
+	SECTION("agrees with the unrolled NFA")
+	{
+		for (const char* pattern : {"(ab|b){2,3}a", "a{2,}b?", "(a{1,2}b){2}", "x(a?b?){2,3}",
+			"(a{2}|b)*", "a{0,2}(ab){1,2}", "(a*b){2,3}", "a{3}"})
+		{
+			Ca aut = compile_regex(pattern);
+			Vata2::Nfa::Nfa nfa = Vata2::Nfa::compile_regex(pattern);
+			Vata2::Nfa::Nfa expanded = expand(aut);
+			for (const std::string& word : all_words("abx", 7)) {
+				const bool expected = Vata2::Nfa::is_in_lang(nfa, to_word(word));
+				INFO(pattern << " " << word);
+				REQUIRE(is_in_lang(aut, to_word(word)) == expected);
+				REQUIRE(Vata2::Nfa::is_in_lang(expanded, to_word(word)) == expected);
+			}
+		}
+	}
+
+	SECTION("search")
+	{
+		for (const char* pattern : {"a{2,3}", "ba{2,3}", "a{2,3}b|b", "^ba{2,3}",
+			"ba{2,3}$", "^a{2,3}b$", "^(a{2,3}b|b)"})
+		{
+			Ca aut = compile_regex(pattern, {{"match", "search"}});
+			Vata2::Nfa::Nfa nfa = Vata2::Nfa::compile_regex(pattern, {{"match", "search"}});
+			for (const std::string& word : all_words("ab", 7)) {
+				INFO(pattern << " " << word);
+				REQUIRE(is_in_lang(aut, to_word(word)) ==
+					Vata2::Nfa::is_in_lang(nfa, to_word(word)));
+			}
+		}
+	}
+} // }}}
+
+
+TEST_CASE("Vata2::Ca::construct()/serialize()")
+{ // {{{
+	Ca aut;
+	ParsedSection parsec;
+	parsec.type = TYPE_CA;
+	StringToSymbolMap symbol_map;
+	StringToStateMap state_map;
+
+	SECTION("construct an automaton")
+	{
+		parsec.dict.insert({"Initial", {"q0"}});
+		parsec.dict.insert({"Final", {"q2"}});
+		parsec.dict.insert({"Counters", {"c", "2", "4"}});
+		parsec.dict.insert({"Scopes", {"q1", "c"}});
+		parsec.body = { {"q0", "a", "q1", "reset"}, {"q1", "a", "q1", "lt", "incr"},
+			{"q1", "b", "q2", "ge"} };
+
+		construct(&aut, parsec, &symbol_map, &state_map);
+
+		REQUIRE(aut.trans_size() == 3);
+		REQUIRE(aut.has_trans({state_map["q1"], symbol_map["a"], state_map["q1"],
+			Guard::CAN_INCR, Action::INCR}));
+		REQUIRE(is_in_lang(aut, {symbol_map["a"], symbol_map["a"], symbol_map["b"]}));
+		REQUIRE(!is_in_lang(aut, {symbol_map["a"], symbol_map["b"]}));
+	}
+
+	SECTION("invalid calls")
+	{
+		parsec.body = { {"q1", "a"} };
+		CHECK_THROWS_WITH(construct(&aut, parsec), Catch::Contains("Invalid transition"));
+
+		parsec.body = { {"q1", "a", "q2", "foo"} };
+		CHECK_THROWS_WITH(construct(&aut, parsec), Catch::Contains("Invalid transition"));
+
+		parsec.body = { };
+		parsec.dict.insert({"Scopes", {"q1", "c"}});
+		CHECK_THROWS_WITH(construct(&aut, parsec), Catch::Contains("Unknown counter"));
+
+		parsec.type = "NFA";
+		CHECK_THROWS_WITH(construct(&aut, parsec), Catch::Contains("expecting type"));
+	}
+
+	SECTION("serialization and construction give the same automaton")
+	{
+		FILL_WITH_AUT_A(aut);
+
+		ParsedSection serialized = serialize(aut);
+		REQUIRE(serialized.type == TYPE_CA);
+		REQUIRE(serialized.body.size() == aut.trans_size());
+		REQUIRE(serialized["Counters"] == std::vector<std::string>({"c0", "2", "4"}));
+		REQUIRE(serialized.body.front() ==
+			std::vector<std::string>({"q0", "a97", "q1", "reset"}));
+
+		Ca loaded = construct(serialized, &symbol_map, &state_map);
+		REQUIRE(loaded.trans_size() == aut.trans_size());
+		REQUIRE(is_in_lang(loaded, {symbol_map["a97"], symbol_map["a97"], symbol_map["a98"]}));
+	}
+} // }}}
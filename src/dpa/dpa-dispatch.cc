@@ -0,0 +1,95 @@
+/* dpa-dispatch.cc -- dispatcher for DPA-related functions
+ *
+ * Copyright (c) 2018 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+// VATA headers
+#include <vata2/dpa.hh>
+#include <vata2/vm-dispatch.hh>
+
+// local headers
+#include "../dispatch-aux.hh"
+
+using namespace Vata2::Dpa;
+using namespace Vata2::VM;
+
+using Vata2::Parser::ParsedSection;
+using Vata2::dispatch::test_and_call;
+
+
+namespace
+{
+	VMValue dpa_dispatch(
+		const VMFuncName&  func_name,
+		const VMFuncArgs&  func_args)
+	{
+		DEBUG_PRINT("calling function \"" + func_name + "\" for " +
+			Vata2::Dpa::TYPE_DPA + " with arguments " + std::to_string(func_args));
+
+		if (func_args.size() == 0) {
+			throw VMException("calling function \"" + func_name + "\" for " +
+				Vata2::Dpa::TYPE_DPA + " with no arguments");
+		}
+
+		// we use throw to return result from test_and_call
+		try {
+
+			test_and_call("construct", func_name, {Vata2::TYPE_PARSEC}, func_args,
+				Vata2::Dpa::TYPE_DPA,
+				*[](const ParsedSection& parsec) -> auto {
+					DpaWrapper* dpa_wrap = new DpaWrapper;
+					DEBUG_PRINT("constructing DPA " + (parsec.haskey("Name")?
+							std::to_string(parsec["Name"]) :
+							"[unnamed]"));
+
+					// choosing the alphabet to use
+					if (parsec.haskey("CharAlphabet")) {
+						DEBUG_PRINT("using CharAlphabet");
+						dpa_wrap->alphabet = new Vata2::Nfa::CharAlphabet();
+					} else if (parsec.haskey("DirectAlphabet")) {
+						DEBUG_PRINT("using DirectAlphabet");
+						dpa_wrap->alphabet = new Vata2::Nfa::DirectAlphabet();
+					} else { // default
+						DEBUG_PRINT("using OnTheFlyAlphabet");
+
+						// TODO: fix resource leak
+						StringToSymbolMap* sym_map = new StringToSymbolMap();
+						dpa_wrap->alphabet = new Vata2::Nfa::OnTheFlyAlphabet(sym_map);
+					}
+
+					construct(&dpa_wrap->dpa, parsec, dpa_wrap->alphabet, &dpa_wrap->state_dict);
+					return static_cast<VMPointer>(dpa_wrap);
+				});
+
+			test_and_call("print", func_name, {TYPE_DPA}, func_args, Vata2::TYPE_VOID,
+				*[](const DpaWrapper& dpa_wrap) -> auto {
+					std::cout << dpa_wrap;
+					return static_cast<VMPointer>(nullptr);
+				});
+		}
+		catch (VMValue res) {
+			return res;
+		}
+
+		return VMValue(Vata2::TYPE_NOT_A_VALUE, nullptr);
+	}
+}
+
+
+void Vata2::Dpa::init()
+{
+	reg_dispatcher(Vata2::Dpa::TYPE_DPA, dpa_dispatch,
+		"deterministic probabilistic finite automaton");
+}
@@ -0,0 +1,488 @@
+/* dpa.cc -- operations for deterministic probabilistic automata
+ *
+ * Copyright (c) 2018 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+// VATA headers
+#include <vata2/dpa.hh>
+#include <vata2/parallel.hh>
+#include <vata2/util.hh>
+
+using namespace Vata2::util;
+using namespace Vata2::Dpa;
+
+const size_t CompiledDpa::MAX_ALPHABET_SIZE;
+const size_t CompiledDpa::BATCH_LANES;
+const size_t CompiledDpa::BATCH_BLOCK;
+
+namespace
+{
+	/// prints a probability so that it can be read back without a loss
+	std::string prob_to_string(Prob prob)
+	{ // {{{
+		std::ostringstream stream;
+		stream.precision(std::numeric_limits<Prob>::max_digits10);
+		stream << prob;
+		return stream.str();
+	} // prob_to_string }}}
+
+	/// splits a token of the form "name:prob" (the probability is optional if
+	/// @p default_prob is non-null)
+	std::pair<std::string, Prob> split_prob(
+		const std::string&  token,
+		const Prob*         default_prob)
+	{ // {{{
+		size_t colon = token.rfind(':');
+		if (std::string::npos == colon)
+		{
+			if (nullptr == default_prob)
+			{
+				throw std::runtime_error("missing probability in \"" + token + "\"");
+			}
+
+			return {token, *default_prob};
+		}
+
+		std::istringstream stream(token.substr(colon + 1));
+		Prob prob;
+		if (0 == colon || !(stream >> prob) || !stream.eof() || prob < 0.0 || prob > 1.0)
+		{
+			throw std::runtime_error("invalid probability in \"" + token + "\"");
+		}
+
+		return {token.substr(0, colon), prob};
+	} // split_prob }}}
+
+	LogProb to_log(Prob prob)
+	{ // {{{
+		return (prob > 0.0)? std::log(prob) : LOG_ZERO;
+	} // to_log }}}
+} // anonymous namespace
+
+
+std::ostream& std::operator<<(std::ostream& os, const Vata2::Dpa::Trans& trans)
+{ // {{{
+	std::string result = "(" + std::to_string(trans.src) + ", " +
+		std::to_string(trans.symb) + ":" + prob_to_string(trans.prob) + ", " +
+		std::to_string(trans.tgt) + ")";
+	return os << result;
+} // operator<<(ostream, Trans) }}}
+
+
+void Dpa::add_trans(const Trans& trans)
+{ // {{{
+	PostSymb& post = this->transitions[trans.src];
+	bool inserted;
+	std::tie(std::ignore, inserted) = post.insert({trans.symb, {trans.prob, trans.tgt}});
+	if (!inserted)
+	{
+		throw std::runtime_error("adding a second transition from state " +
+			std::to_string(trans.src) + " over symbol " + std::to_string(trans.symb) +
+			" to a deterministic automaton");
+	}
+} // add_trans }}}
+
+
+size_t Dpa::trans_size() const
+{ // {{{
+	size_t cnt = 0;
+	for (const auto& state_post_pair : this->transitions)
+	{
+		cnt += state_post_pair.second.size();
+	}
+
+	return cnt;
+} // trans_size }}}
+
+
+std::vector<Trans> Dpa::get_transitions() const
+{ // {{{
+	std::vector<Trans> result;
+	for (const auto& state_post_pair : this->transitions)
+	{
+		for (const auto& symb_prob_tgt : state_post_pair.second)
+		{
+			result.push_back({state_post_pair.first, symb_prob_tgt.first,
+				symb_prob_tgt.second.first, symb_prob_tgt.second.second});
+		}
+	}
+
+	return result;
+} // get_transitions }}}
+
+
+CompiledDpa::CompiledDpa(const Dpa& aut) : CompiledDpa()
+{ // {{{
+	// number states densely
+	std::unordered_map<State, DenseState> state_map;
+	auto get_dense = [&state_map](State st) -> DenseState {
+		auto it_ins = state_map.insert({st, static_cast<DenseState>(state_map.size())});
+		return it_ins.first->second;
+	};
+
+	Symbol max_symb = 0;
+	get_dense(aut.initialstate);
+	for (const auto& state_post_pair : aut.get_post_map())
+	{
+		get_dense(state_post_pair.first);
+		for (const auto& symb_prob_tgt : state_post_pair.second)
+		{
+			get_dense(symb_prob_tgt.second.second);
+			max_symb = std::max(max_symb, symb_prob_tgt.first);
+		}
+	}
+
+	for (const auto& state_prob_pair : aut.finalprobs) { get_dense(state_prob_pair.first); }
+
+	if (max_symb >= MAX_ALPHABET_SIZE)
+	{
+		throw std::runtime_error("symbol " + std::to_string(max_symb) +
+			" is too large for compiling a DPA");
+	}
+
+	this->alph_size = max_symb + 1;
+	this->init = state_map.at(aut.initialstate);
+	this->init_logprob = to_log(aut.initprob);
+	this->dead = static_cast<DenseState>(state_map.size());
+
+	const size_t num_states = state_map.size() + 1;
+	this->next.assign(num_states * this->alph_size, this->dead);
+	this->logprob.assign(num_states * this->alph_size, LOG_ZERO);
+	this->final_logprob.assign(num_states, LOG_ZERO);
+
+	for (const auto& state_post_pair : aut.get_post_map())
+	{
+		const size_t row = state_map.at(state_post_pair.first) * this->alph_size;
+		for (const auto& symb_prob_tgt : state_post_pair.second)
+		{
+			const ProbTgt& prob_tgt = symb_prob_tgt.second;
+			if (!(prob_tgt.first > 0.0)) { continue; }   // leads to the dead state
+
+			this->next[row + symb_prob_tgt.first] = state_map.at(prob_tgt.second);
+			this->logprob[row + symb_prob_tgt.first] = to_log(prob_tgt.first);
+		}
+	}
+
+	for (const auto& state_prob_pair : aut.finalprobs)
+	{
+		this->final_logprob[state_map.at(state_prob_pair.first)] =
+			to_log(state_prob_pair.second);
+	}
+} // CompiledDpa::CompiledDpa }}}
+
+
+void CompiledDpa::score_batch(
+	const Word*        words,
+	size_t             num_words,
+	LogProb*           result,
+	bool               with_final,
+	const StringDict&  params) const
+{ // {{{
+	assert(nullptr != words || 0 == num_words);
+	assert(nullptr != result || 0 == num_words);
+
+	const size_t num_blocks = (num_words + BATCH_BLOCK - 1) / BATCH_BLOCK;
+	Vata2::parallel::parallel_for(0, num_blocks, [=](size_t block) {
+		const size_t begin = block * BATCH_BLOCK;
+		this->score_lanes(words + begin, std::min(BATCH_BLOCK, num_words - begin),
+			result + begin, with_final);
+	}, params);
+} // score_batch }}}
+
+
+void CompiledDpa::score_lanes(
+	const Word*  words,
+	size_t       num_words,
+	LogProb*     result,
+	bool         with_final) const
+{ // {{{
+	DenseState st[BATCH_LANES];
+	LogProb acc[BATCH_LANES];
+	Word::const_iterator pos[BATCH_LANES];
+	Word::const_iterator end[BATCH_LANES];
+
+	for (size_t base = 0; base < num_words; base += BATCH_LANES)
+	{
+		const size_t lanes = std::min(BATCH_LANES, num_words - base);
+		size_t active = 0;
+		for (size_t i = 0; i < lanes; ++i)
+		{
+			st[i] = this->init;
+			acc[i] = this->init_logprob;
+			pos[i] = words[base + i].begin();
+			end[i] = words[base + i].end();
+			if (pos[i] != end[i]) { ++active; }
+		}
+
+		// run all words of the batch in lockstep
+		while (0 != active)
+		{
+			for (size_t i = 0; i < lanes; ++i)
+			{
+				if (pos[i] == end[i]) { continue; }
+
+				Symbol symb = *pos[i]++;
+				if (symb >= this->alph_size)
+				{
+					st[i] = this->dead;
+				}
+				else
+				{
+					size_t idx = st[i] * this->alph_size + symb;
+					acc[i] += this->logprob[idx];
+					st[i] = this->next[idx];
+				}
+
+				if (st[i] == this->dead) { pos[i] = end[i]; }
+				if (pos[i] == end[i]) { --active; }
+			}
+		}
+
+		for (size_t i = 0; i < lanes; ++i)
+		{
+			if (st[i] == this->dead) { result[base + i] = LOG_ZERO; }
+			else if (with_final) { result[base + i] = acc[i] + this->final_logprob[st[i]]; }
+			else { result[base + i] = acc[i]; }
+		}
+	}
+} // score_lanes }}}
+
+
+LogProb Vata2::Dpa::score(const Dpa& aut, const Word& word)
+{ // {{{
+	LogProb result = to_log(aut.initprob);
+	State st = aut.initialstate;
+	for (Symbol symb : word)
+	{
+		const ProbTgt* prob_tgt = aut.get_trans(st, symb);
+		if (nullptr == prob_tgt || !(prob_tgt->first > 0.0)) { return LOG_ZERO; }
+
+		result += std::log(prob_tgt->first);
+		st = prob_tgt->second;
+	}
+
+	return result + to_log(aut.get_final(st));
+} // score }}}
+
+
+Vata2::Nfa::Nfa Vata2::Dpa::get_support(const Dpa& aut)
+{ // {{{
+	Vata2::Nfa::Nfa result;
+	if (aut.initprob > 0.0) { result.initialstates.insert(aut.initialstate); }
+
+	for (const auto& state_prob_pair : aut.finalprobs)
+	{
+		if (state_prob_pair.second > 0.0) { result.finalstates.insert(state_prob_pair.first); }
+	}
+
+	for (const Trans& trans : aut.get_transitions())
+	{
+		if (trans.prob > 0.0) { result.add_trans(trans.src, trans.symb, trans.tgt); }
+	}
+
+	return result;
+} // get_support }}}
+
+
+Vata2::Parser::ParsedSection Vata2::Dpa::serialize(
+	const Dpa&                aut,
+	const SymbolToStringMap*  symbol_map,
+	const StateToStringMap*   state_map)
+{ // {{{
+	Vata2::Parser::ParsedSection parsec;
+	parsec.type = Vata2::Dpa::TYPE_DPA;
+
+	auto state_namer = [state_map](State st) -> std::string {
+		if (nullptr == state_map) { return "q" + std::to_string(st); }
+
+		auto it = state_map->find(st);
+		if (state_map->end() == it)
+		{
+			throw std::runtime_error("cannot translate state " + std::to_string(st));
+		}
+
+		return it->second;
+	};
+
+	auto symbol_namer = [symbol_map](Symbol sym) -> std::string {
+		if (nullptr == symbol_map) { return "a" + std::to_string(sym); }
+
+		auto it = symbol_map->find(sym);
+		if (symbol_map->end() == it)
+		{
+			throw std::runtime_error("cannot translate symbol " + std::to_string(sym));
+		}
+
+		return it->second;
+	};
+
+	parsec.dict["Initial"] = {state_namer(aut.initialstate) + ":" +
+		prob_to_string(aut.initprob)};
+
+	// sort the final states for a deterministic output
+	std::vector<std::pair<State, Prob>> finals(aut.finalprobs.begin(), aut.finalprobs.end());
+	std::sort(finals.begin(), finals.end());
+	std::vector<std::string> fin_states;
+	for (const auto& state_prob_pair : finals)
+	{
+		fin_states.push_back(state_namer(state_prob_pair.first) + ":" +
+			prob_to_string(state_prob_pair.second));
+	}
+	parsec.dict["Final"] = fin_states;
+
+	for (const Trans& trans : aut.get_transitions())
+	{
+		parsec.body.push_back({ state_namer(trans.src),
+			symbol_namer(trans.symb) + ":" + prob_to_string(trans.prob),
+			state_namer(trans.tgt) });
+	}
+
+	return parsec;
+} // serialize }}}
+
+
+void Vata2::Dpa::construct(
+	Dpa*                                 aut,
+	const Vata2::Parser::ParsedSection&  parsec,
+	Alphabet*                            alphabet,
+	StringToStateMap*                    state_map)
+{ // {{{
+	assert(nullptr != aut);
+	assert(nullptr != alphabet);
+
+	if (parsec.type != Vata2::Dpa::TYPE_DPA) {
+		throw std::runtime_error(std::string(__FUNCTION__) + ": expecting type \"" +
+			Vata2::Dpa::TYPE_DPA + "\"");
+	}
+
+	bool remove_state_map = false;
+	if (nullptr == state_map) {
+		state_map = new StringToStateMap();
+		remove_state_map = true;
+	}
+
+	State cnt_state = 0;
+
+	// a lambda for translating state names to identifiers
+	auto get_state_name = [state_map, &cnt_state](const std::string& str) {
+		auto it_insert_pair = state_map->insert({str, cnt_state});
+		if (it_insert_pair.second) { return cnt_state++; }
+		else { return it_insert_pair.first->second; }
+	};
+
+	// a lambda for cleanup
+	auto clean_up = [&]() {
+		if (remove_state_map) { delete state_map; }
+	};
+
+	const Prob ONE = 1.0;
+
+	try
+	{
+		auto it = parsec.dict.find("Initial");
+		if (parsec.dict.end() == it || it->second.size() != 1)
+		{
+			throw std::runtime_error("a DPA needs exactly one initial state");
+		}
+
+		auto state_prob = split_prob(it->second.front(), &ONE);
+		aut->set_initial(get_state_name(state_prob.first), state_prob.second);
+
+		it = parsec.dict.find("Final");
+		if (parsec.dict.end() != it)
+		{
+			for (const auto& str : it->second)
+			{
+				state_prob = split_prob(str, &ONE);
+				aut->set_final(get_state_name(state_prob.first), state_prob.second);
+			}
+		}
+
+		for (const auto& body_line : parsec.body)
+		{
+			if (body_line.size() != 3)
+			{
+				throw std::runtime_error("Invalid transition: " +
+					std::to_string(body_line));
+			}
+
+			State src_state = get_state_name(body_line[0]);
+			auto symb_prob = split_prob(body_line[1], nullptr);
+			Symbol symbol = alphabet->translate_symb(symb_prob.first);
+			State tgt_state = get_state_name(body_line[2]);
+
+			aut->add_trans(src_state, symbol, symb_prob.second, tgt_state);
+		}
+	}
+	catch (std::exception&)
+	{
+		clean_up();
+		throw;
+	}
+
+	// do the dishes and take out garbage
+	clean_up();
+} // construct }}}
+
+
+void Vata2::Dpa::construct(
+	Dpa*                                 aut,
+	const Vata2::Parser::ParsedSection&  parsec,
+	StringToSymbolMap*                   symbol_map,
+	StringToStateMap*                    state_map)
+{ // {{{
+	assert(nullptr != aut);
+
+	bool remove_symbol_map = false;
+	if (nullptr == symbol_map)
+	{
+		symbol_map = new StringToSymbolMap();
+		remove_symbol_map = true;
+	}
+
+	auto release_res = [&](){ if (remove_symbol_map) delete symbol_map; };
+
+	Vata2::Nfa::OnTheFlyAlphabet alphabet(symbol_map);
+
+	try
+	{
+		construct(aut, parsec, &alphabet, state_map);
+	}
+	catch (std::exception&)
+	{
+		release_res();
+		throw;
+	}
+
+	release_res();
+} // construct(StringToSymbolMap) }}}
+
+
+std::ostream& Vata2::Dpa::operator<<(std::ostream& os, const Dpa& dpa)
+{ // {{{
+	return os << std::to_string(serialize(dpa));
+} // Dpa::operator<<(ostream) }}}
+
+
+std::ostream& std::operator<<(std::ostream& os, const Vata2::Dpa::DpaWrapper& dpa_wrap)
+{ // {{{
+	os << "{DPA wrapper|DPA: " << dpa_wrap.dpa << "|alphabet: " << dpa_wrap.alphabet <<
+		"|state_dict: " << std::to_string(dpa_wrap.state_dict) << "}";
+	return os;
+} // operator<<(DpaWrapper) }}}
@@ -0,0 +1,59 @@
+/* tests-dpa-dispatch.cc -- tests of DPA dispatch functions
+ *
+ * Copyright (c) 2018 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "../3rdparty/catch.hpp"
+
+#include <vata2/dpa.hh>
+#include <vata2/vm-dispatch.hh>
+
+using namespace Vata2::VM;
+using namespace Vata2::Dpa;
+
+TEST_CASE("Vata2::VM::find_dispatcher(\"DPA\")")
+{
+	SECTION("construct")
+	{
+		Vata2::Parser::ParsedSection parsec;
+		parsec.type = Vata2::Dpa::TYPE_DPA;
+		parsec.dict.insert({"Initial", {"q1:1.0"}});
+		parsec.dict.insert({"Final", {"q1:0.5"}});
+		parsec.body = { {"q1", "a:0.5", "q1"} };
+
+		VMValue res = find_dispatcher(Vata2::Dpa::TYPE_DPA)("construct",
+			{{Vata2::TYPE_PARSEC, &parsec}});
+		REQUIRE(Vata2::Dpa::TYPE_DPA == res.type);
+		const DpaWrapper* wrap = static_cast<const DpaWrapper*>(res.get_ptr());
+		REQUIRE(wrap->dpa.trans_size() == 1);
+		REQUIRE(wrap->dpa.get_final(wrap->dpa.initialstate) == Approx(0.5));
+		delete wrap->alphabet;
+		delete wrap;
+	}
+
+	SECTION("no parameters")
+	{
+		CHECK_THROWS_WITH(find_dispatcher(Vata2::Dpa::TYPE_DPA)("barrel-roll", { }),
+			Catch::Contains("with no arguments"));
+	}
+
+	SECTION("invalid function")
+	{
+		std::string str = "arg1";
+		VMValue res = find_dispatcher(Vata2::Dpa::TYPE_DPA)("barrel-roll",
+			{{Vata2::TYPE_STR, &str}});
+		REQUIRE(Vata2::TYPE_NOT_A_VALUE == res.type);
+	}
+}
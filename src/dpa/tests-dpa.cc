@@ -0,0 +1,279 @@
+/* tests-dpa.cc -- tests of deterministic probabilistic automata
+ *
+ * Copyright (c) 2018 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "../3rdparty/catch.hpp"
+
+#include <cmath>
+
+#include <vata2/dpa.hh>
+
+using namespace Vata2::Dpa;
+using namespace Vata2::Parser;
+
+// Some common automata {{{
+
+// Automaton A (over {a, b}; p(a^n b) = 0.5^n * 0.5 * 0.8)
+#define FILL_WITH_AUT_A(x) \
+	x.set_initial(1); \
+	x.set_final(2, 0.8); \
+	x.set_final(1, 0.0); \
+	x.add_trans(1, 'a', 0.5, 1); \
+	x.add_trans(1, 'b', 0.5, 2); \
+	x.add_trans(2, 'a', 0.2, 1); \
+
+// }}}
+
+TEST_CASE("Vata2::Dpa::Dpa::add_trans()/get_trans()")
+{ // {{{
+	Dpa aut;
+
+	SECTION("Empty automata have no transitions")
+	{
+		REQUIRE(aut.trans_empty());
+		REQUIRE(!aut.has_trans(1, 'a'));
+	}
+
+	SECTION("If I add a transition, it is in the automaton")
+	{
+		aut.add_trans(1, 'a', 0.25, 2);
+
+		REQUIRE(aut.has_trans(1, 'a'));
+		REQUIRE(!aut.has_trans(1, 'b'));
+		REQUIRE(aut.get_trans(1, 'a')->second == 2);
+		REQUIRE(aut.trans_size() == 1);
+	}
+
+	SECTION("Adding a nondeterministic transition throws")
+	{
+		aut.add_trans(1, 'a', 0.25, 2);
+		CHECK_THROWS_WITH(aut.add_trans(1, 'a', 0.75, 3),
+			Catch::Contains("deterministic"));
+	}
+} // }}}
+
+
+TEST_CASE("Vata2::Dpa::construct() correct calls")
+{ // {{{
+	Dpa aut;
+	ParsedSection parsec;
+	parsec.type = TYPE_DPA;
+	StringToSymbolMap symbol_map;
+
+	SECTION("construct an automaton with probabilities")
+	{
+		parsec.dict.insert({"Initial", {"q1:1.0"}});
+		parsec.dict.insert({"Final", {"q2:0.8"}});
+		parsec.body = { {"q1", "a:0.5", "q1"}, {"q1", "b:0.5", "q2"} };
+
+		construct(&aut, parsec, &symbol_map);
+
+		REQUIRE(aut.trans_size() == 2);
+		REQUIRE(aut.has_trans(aut.initialstate, symbol_map["a"]));
+		const ProbTgt* prob_tgt = aut.get_trans(aut.initialstate, symbol_map["b"]);
+		REQUIRE(nullptr != prob_tgt);
+		REQUIRE(prob_tgt->first == Approx(0.5));
+		REQUIRE(aut.get_final(prob_tgt->second) == Approx(0.8));
+		REQUIRE(aut.get_final(aut.initialstate) == Approx(0.0));
+	}
+
+	SECTION("probabilities of initial and final states default to one")
+	{
+		parsec.dict.insert({"Initial", {"q1"}});
+		parsec.dict.insert({"Final", {"q1"}});
+
+		construct(&aut, parsec, &symbol_map);
+
+		REQUIRE(aut.initprob == Approx(1.0));
+		REQUIRE(aut.get_final(aut.initialstate) == Approx(1.0));
+	}
+
+	SECTION("the output format of prob-lo-mizer")
+	{
+		parsec.dict.insert({"Initial", {"0:1.0"}});
+		parsec.dict.insert({"Final", {"1:0.25", "0:0.5"}});
+		parsec.body = { {"0", "97:0.5", "1"}, {"1", "98:1", "0"} };
+
+		Vata2::Nfa::CharAlphabet alphabet;
+		construct(&aut, parsec, &alphabet);
+
+		REQUIRE(aut.has_trans(aut.initialstate, 'a'));
+		REQUIRE(score(aut, {'a', 'b'}) == Approx(std::log(0.5 * 0.5)));
+	}
+} // }}}
+
+
+TEST_CASE("Vata2::Dpa::construct() invalid calls")
+{ // {{{
+	Dpa aut;
+	ParsedSection parsec;
+	parsec.type = TYPE_DPA;
+	parsec.dict.insert({"Initial", {"q1"}});
+
+	SECTION("construct() call with invalid ParsedSection object")
+	{
+		parsec.type = "FA";
+
+		CHECK_THROWS_WITH(construct(&aut, parsec),
+			Catch::Contains("expecting type"));
+	}
+
+	SECTION("missing probability of a transition")
+	{
+		parsec.body = { {"q1", "a", "q2"} };
+
+		CHECK_THROWS_WITH(construct(&aut, parsec),
+			Catch::Contains("missing probability"));
+	}
+
+	SECTION("invalid probability")
+	{
+		parsec.body = { {"q1", "a:1.5", "q2"} };
+
+		CHECK_THROWS_WITH(construct(&aut, parsec),
+			Catch::Contains("invalid probability"));
+	}
+
+	SECTION("more initial states")
+	{
+		parsec.dict["Initial"] = {"q1", "q2"};
+
+		CHECK_THROWS_WITH(construct(&aut, parsec),
+			Catch::Contains("one initial state"));
+	}
+} // }}}
+
+
+TEST_CASE("Vata2::Dpa::serialize()")
+{ // {{{
+	Dpa aut;
+
+	SECTION("serialization and construction give the same automaton")
+	{
+		FILL_WITH_AUT_A(aut);
+		aut.add_trans(2, 'c', 1.0 / 3, 2);
+
+		ParsedSection parsec = serialize(aut);
+		REQUIRE(parsec.type == TYPE_DPA);
+		REQUIRE(parsec.body.size() == 4);
+
+		StringToSymbolMap symbol_map;
+		StringToStateMap state_map;
+		Dpa loaded = construct(parsec, &symbol_map, &state_map);
+
+		REQUIRE(loaded.trans_size() == aut.trans_size());
+		for (const Word& word : std::vector<Word>{ {}, {'b'}, {'a', 'b', 'c', 'c'} })
+		{
+			Word translated;
+			for (Symbol symb : word)
+			{
+				translated.push_back(symbol_map["a" + std::to_string(symb)]);
+			}
+
+			// probabilities are printed with full precision
+			REQUIRE(score(loaded, translated) == score(aut, word));
+		}
+	}
+} // }}}
+
+
+TEST_CASE("Vata2::Dpa::CompiledDpa::score()")
+{ // {{{
+	Dpa aut;
+	FILL_WITH_AUT_A(aut);
+	CompiledDpa compiled(aut);
+
+	SECTION("scores match the uncompiled automaton")
+	{
+		for (const Word& word : std::vector<Word>{
+			{'b'}, {'a', 'b'}, {'a', 'a', 'a', 'b'}, {'b', 'a', 'b'}})
+		{
+			REQUIRE(compiled.score(word) == Approx(score(aut, word)));
+			REQUIRE(std::isfinite(compiled.score(word)));
+		}
+
+		REQUIRE(compiled.score(Word{'a', 'a', 'b'}) == Approx(std::log(0.125 * 0.8)));
+	}
+
+	SECTION("impossible words have log-probability minus infinity")
+	{
+		REQUIRE(compiled.score(Word{}) == LOG_ZERO);               // final prob. 0
+		REQUIRE(compiled.score(Word{'b', 'b'}) == LOG_ZERO);       // no transition
+		REQUIRE(compiled.score(Word{'z'}) == LOG_ZERO);            // unknown symbol
+		REQUIRE(compiled.score(Word{1000}) == LOG_ZERO);           // out of the table
+		REQUIRE(score(aut, Word{'b', 'b'}) == LOG_ZERO);
+	}
+
+	SECTION("prefix scores do not include final probabilities")
+	{
+		REQUIRE(compiled.score(Word{}, false) == Approx(0.0));
+		REQUIRE(compiled.score(Word{'a', 'b'}, false) == Approx(std::log(0.25)));
+	}
+
+	SECTION("scoring of byte ranges")
+	{
+		const unsigned char payload[] = { 'a', 'b' };
+		REQUIRE(compiled.score(payload, payload + 2) == Approx(std::log(0.25 * 0.8)));
+	}
+
+	SECTION("batch scoring gives the same results")
+	{
+		std::vector<Word> words;
+		for (size_t i = 0; i < 3 * CompiledDpa::BATCH_BLOCK + 1; ++i)
+		{
+			Word word(i % 5, 'a');
+			if (i % 3 != 0) { word.push_back('b'); }
+			if (i % 7 == 0) { word.push_back('b'); }
+			words.push_back(word);
+		}
+
+		std::vector<LogProb> scores;
+		compiled.score_batch(words, &scores);
+		REQUIRE(scores.size() == words.size());
+		for (size_t i = 0; i < words.size(); ++i)
+		{
+			LogProb expected = compiled.score(words[i]);
+			if (std::isinf(expected)) { REQUIRE(std::isinf(scores[i])); }
+			else { REQUIRE(scores[i] == Approx(expected)); }
+		}
+
+		for (const std::string threads : {"1", "4"})
+		{
+			compiled.score_batch(words, &scores, false, {{"threads", threads}});
+			for (size_t i = 0; i < words.size(); ++i)
+			{
+				LogProb expected = compiled.score(words[i], false);
+				if (std::isinf(expected)) { REQUIRE(std::isinf(scores[i])); }
+				else { REQUIRE(scores[i] == Approx(expected)); }
+			}
+		}
+	}
+} // }}}
+
+
+TEST_CASE("Vata2::Dpa::get_support()")
+{ // {{{
+	Dpa aut;
+	FILL_WITH_AUT_A(aut);
+	aut.add_trans(2, 'b', 0.0, 2);
+
+	Vata2::Nfa::Nfa support = get_support(aut);
+	REQUIRE(support.initialstates == Vata2::Nfa::StateSet({1}));
+	REQUIRE(support.finalstates == Vata2::Nfa::StateSet({2}));
+	REQUIRE(support.trans_size() == 3);
+	REQUIRE(!support.has_trans(2, 'b', 2));
+	REQUIRE(is_in_lang(support, {'a', 'b', 'a', 'b'}));
+} // }}}
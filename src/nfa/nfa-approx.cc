@@ -0,0 +1,317 @@
+/* nfa-approx.cc -- approximate (edit-distance) matching of NFAs
+ *
+ * Copyright (c) 2018 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <algorithm>
+#include <deque>
+
+// VATA headers
+#include <vata2/nfa.hh>
+
+using namespace Vata2::Nfa;
+using namespace Vata2::util;
+
+namespace {
+
+/// an NFA with states numbered densely and transitions in sorted lists
+struct DenseNfa
+{ // {{{
+	size_t num_states = 0;
+	std::vector<bool> initial = { };
+	std::vector<bool> final = { };
+	/// (symbol, target) pairs for every state, sorted
+	std::vector<std::vector<std::pair<Symbol, size_t>>> succ = { };
+
+	explicit DenseNfa(const Nfa& aut)
+	{ // {{{
+		std::unordered_map<State, size_t> index;
+		auto get_index = [&](State st) {
+			auto it_ins = index.insert({st, this->num_states});
+			if (it_ins.second) {
+				++this->num_states;
+				this->initial.push_back(aut.has_initial(st));
+				this->final.push_back(aut.has_final(st));
+				this->succ.emplace_back();
+			}
+
+			return it_ins.first->second;
+		};
+
+		for (State st : aut.initialstates) { get_index(st); }
+		for (State st : aut.finalstates) { get_index(st); }
+		for (const Trans& trans : aut) {
+			size_t src = get_index(trans.src);
+			size_t tgt = get_index(trans.tgt);
+			this->succ[src].push_back({trans.symb, tgt});
+		}
+
+		for (auto& succ : this->succ) { std::sort(succ.begin(), succ.end()); }
+	} // DenseNfa() }}}
+}; // DenseNfa }}}
+
+
+/**
+ * @brief  Wu-Manber-style simulation with a bit vector of states per error
+ *
+ * Row j is the set of states reachable with at most j errors.  Successors
+ * of a set are computed by OR-ing precomputed successors of its 4-bit
+ * chunks, so a step costs O(k * n / 4) word operations.
+ */
+class BitParallelMatcher
+{ // {{{
+private:
+
+	using Bits = uint64_t;
+
+	static const size_t CHUNK = 4;
+	static const size_t CHUNK_VALUES = 1 << CHUNK;
+
+	size_t num_chunks;
+	/// chunk tables of the symbols (each has num_chunks * CHUNK_VALUES entries)
+	std::unordered_map<Symbol, std::vector<Bits>> tables = { };
+	/// the chunk table of successors over any symbol
+	std::vector<Bits> any_table = { };
+	Bits initial = 0;
+	Bits final = 0;
+
+	static Bits post(const std::vector<Bits>& table, Bits set)
+	{ // {{{
+		Bits result = 0;
+		for (size_t chunk = 0; 0 != set; ++chunk, set >>= CHUNK) {
+			result |= table[chunk * CHUNK_VALUES + (set & (CHUNK_VALUES - 1))];
+		}
+
+		return result;
+	} // post }}}
+
+	static void fill_table(std::vector<Bits>* table, size_t num_chunks,
+		const std::vector<Bits>& succ)
+	{ // {{{
+		table->assign(num_chunks * CHUNK_VALUES, 0);
+		for (size_t chunk = 0; chunk < num_chunks; ++chunk)
+		{
+			Bits* row = table->data() + chunk * CHUNK_VALUES;
+			for (size_t val = 1; val < CHUNK_VALUES; ++val)
+			{
+				const size_t low = __builtin_ctzl(val);
+				const size_t state = chunk * CHUNK + low;
+				row[val] = row[val & (val - 1)] | ((state < succ.size())? succ[state] : 0);
+			}
+		}
+	} // fill_table }}}
+
+	/// the lowest j such that @p rows[j] contains a final state (or
+	/// rows.size())
+	size_t first_accepting(const std::vector<Bits>& rows, size_t bound) const
+	{ // {{{
+		for (size_t j = 0; j < bound; ++j) {
+			if (0 != (rows[j] & this->final)) { return j; }
+		}
+
+		return rows.size();
+	} // first_accepting }}}
+
+public:
+
+	explicit BitParallelMatcher(const DenseNfa& aut) :
+		num_chunks((aut.num_states + CHUNK - 1) / CHUNK)
+	{ // {{{
+		assert(aut.num_states <= APPROX_BITPARALLEL_MAX);
+
+		std::unordered_map<Symbol, std::vector<Bits>> succ;
+		std::vector<Bits> any_succ(aut.num_states);
+		for (size_t src = 0; src < aut.num_states; ++src)
+		{
+			if (aut.initial[src]) { this->initial |= Bits(1) << src; }
+			if (aut.final[src]) { this->final |= Bits(1) << src; }
+			for (const auto& symb_tgt : aut.succ[src])
+			{
+				std::vector<Bits>& symb_succ = succ[symb_tgt.first];
+				symb_succ.resize(aut.num_states);
+				symb_succ[src] |= Bits(1) << symb_tgt.second;
+				any_succ[src] |= Bits(1) << symb_tgt.second;
+			}
+		}
+
+		for (const auto& symb_succ : succ) {
+			fill_table(&this->tables[symb_succ.first], this->num_chunks, symb_succ.second);
+		}
+		fill_table(&this->any_table, this->num_chunks, any_succ);
+	} // BitParallelMatcher() }}}
+
+	size_t distance(const Word& word, size_t max_dist, bool search) const
+	{ // {{{
+		// rows above the best distance found so far are not needed
+		size_t bound = max_dist + 1;
+		std::vector<Bits> rows(bound), next(bound);
+		rows[0] = this->initial;
+		for (size_t j = 1; j < bound; ++j) {
+			rows[j] = rows[j - 1] | post(this->any_table, rows[j - 1]);
+		}
+
+		size_t best = this->first_accepting(rows, bound);
+		if (search) { bound = std::min(bound, best); }
+
+		for (Symbol symb : word)
+		{
+			if (0 == bound) { break; }
+
+			auto it = this->tables.find(symb);
+			const std::vector<Bits>* table = (this->tables.end() == it)? nullptr : &it->second;
+
+			next[0] = (nullptr == table)? 0 : post(*table, rows[0]);
+			if (search) { next[0] |= this->initial; }
+			for (size_t j = 1; j < bound; ++j)
+			{
+				next[j] = ((nullptr == table)? 0 : post(*table, rows[j])) |
+					rows[j - 1] |                           // insertion
+					post(this->any_table, rows[j - 1]) |    // substitution
+					next[j - 1] |
+					post(this->any_table, next[j - 1]);     // deletion
+			}
+
+			std::swap(rows, next);
+			if (search)
+			{
+				best = std::min(best, this->first_accepting(rows, bound));
+				bound = std::min(bound, best);
+			}
+			else if (0 == rows[bound - 1]) { return max_dist + 1; }
+		}
+
+		if (!search) { best = this->first_accepting(rows, bound); }
+		return std::min(best, max_dist + 1);
+	} // distance }}}
+}; // BitParallelMatcher }}}
+
+
+/**
+ * @brief  Lazy exploration of the product of the automaton with positions of
+ *         the word, where edits are edges of weight 1
+ *
+ * Nodes are explored by 0-1 BFS in the order of their distance, so only
+ * nodes within @p max_dist edits are ever created.
+ */
+size_t product_distance(const DenseNfa& aut, const Word& word, size_t max_dist,
+	bool search)
+{ // {{{
+	// the state before the match (in the search mode)
+	const size_t start = aut.num_states;
+	const size_t width = aut.num_states + 1;
+	auto key = [width](size_t state, size_t pos) { return pos * width + state; };
+
+	std::unordered_map<size_t, size_t> dist;
+	std::deque<std::pair<size_t, size_t>> queue;
+	auto relax = [&](size_t state, size_t pos, size_t cur, size_t cost) {
+		const size_t new_dist = cur + cost;
+		if (new_dist > max_dist) { return; }
+		auto it_ins = dist.insert({key(state, pos), new_dist});
+		if (!it_ins.second)
+		{
+			if (it_ins.first->second <= new_dist) { return; }
+			it_ins.first->second = new_dist;
+		}
+
+		if (0 == cost) { queue.push_front({state, pos}); }
+		else { queue.push_back({state, pos}); }
+	};
+
+	if (search) { relax(start, 0, 0, 0); }
+	else {
+		for (size_t st = 0; st < aut.num_states; ++st) {
+			if (aut.initial[st]) { relax(st, 0, 0, 0); }
+		}
+	}
+
+	while (!queue.empty())
+	{
+		const size_t state = queue.front().first;
+		const size_t pos = queue.front().second;
+		queue.pop_front();
+		const size_t cur = dist.at(key(state, pos));
+
+		if (start == state)
+		{ // skipping a prefix of the word
+			if (pos < word.size()) { relax(start, pos + 1, cur, 0); }
+			for (size_t st = 0; st < aut.num_states; ++st) {
+				if (aut.initial[st]) { relax(st, pos, cur, 0); }
+			}
+			continue;
+		}
+
+		if (aut.final[state] && (search || word.size() == pos)) { return cur; }
+
+		for (const auto& symb_tgt : aut.succ[state])
+		{
+			relax(symb_tgt.second, pos, cur, 1);                           // deletion
+			if (pos < word.size()) {
+				relax(symb_tgt.second, pos + 1, cur,
+					(symb_tgt.first == word[pos])? 0 : 1);                     // (mis)match
+			}
+		}
+
+		if (pos < word.size()) { relax(state, pos + 1, cur, 1); }       // insertion
+	}
+
+	return max_dist + 1;
+} // product_distance }}}
+
+} // anonymous namespace
+
+
+size_t Vata2::Nfa::edit_distance(
+	const Nfa&         aut,
+	const Word&        word,
+	size_t             max_dist,
+	const StringDict&  params)
+{ // {{{
+	bool search = false;
+	if (haskey(params, "match")) {
+		const std::string& str_match = params.at("match");
+		if ("search" == str_match) { search = true; }
+		else if ("full" != str_match) {
+			throw std::runtime_error(std::to_string(__func__) +
+				" received an unknown value of the \"match\" key: " + str_match);
+		}
+	}
+
+	std::string algo = "auto";
+	if (haskey(params, "algo")) {
+		algo = params.at("algo");
+		if ("auto" != algo && "bitparallel" != algo && "product" != algo) {
+			throw std::runtime_error(std::to_string(__func__) +
+				" received an unknown value of the \"algo\" key: " + algo);
+		}
+	}
+
+	const DenseNfa dense(aut);
+	if ("auto" == algo) {
+		algo = (dense.num_states <= APPROX_BITPARALLEL_MAX)? "bitparallel" : "product";
+	}
+
+	if ("bitparallel" == algo)
+	{
+		if (dense.num_states > APPROX_BITPARALLEL_MAX) {
+			throw std::runtime_error(std::to_string(__func__) + ": the automaton has " +
+				std::to_string(dense.num_states) + " states, which is too many for " +
+				"\"bitparallel\"");
+		}
+
+		return BitParallelMatcher(dense).distance(word, max_dist, search);
+	}
+
+	return product_distance(dense, word, max_dist, search);
+} // edit_distance }}}
@@ -0,0 +1,77 @@
+/* nfa-async.cc -- asynchronous operations on NFAs
+ *
+ * Copyright (c) 2018 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <fstream>
+
+// VATA headers
+#include <vata2/nfa.hh>
+#include <vata2/parallel.hh>
+
+using namespace Vata2::Nfa;
+using Vata2::parallel::run_async;
+
+
+AsyncHandle<Nfa> Vata2::Nfa::determinize_async(
+	Nfa               aut,
+	ProgressCallback  callback)
+{ // {{{
+	return run_async([aut = std::move(aut)]() { return determinize(aut); }, std::move(callback));
+} // determinize_async }}}
+
+
+AsyncHandle<Nfa> Vata2::Nfa::minimize_async(
+	Nfa               aut,
+	ProgressCallback  callback,
+	const StringDict& params)
+{ // {{{
+	auto op = [aut = std::move(aut), params]() mutable { return minimize(std::move(aut), params); };
+	return run_async(std::move(op), std::move(callback));
+} // minimize_async }}}
+
+
+AsyncHandle<bool> Vata2::Nfa::is_incl_async(
+	Nfa               smaller,
+	Nfa               bigger,
+	const Alphabet&   alphabet,
+	ProgressCallback  callback,
+	const StringDict& params)
+{ // {{{
+	auto op = [smaller = std::move(smaller), bigger = std::move(bigger),
+		&alphabet, params]() {
+		return is_incl(smaller, bigger, alphabet, params);
+	};
+	return run_async(std::move(op), std::move(callback));
+} // is_incl_async }}}
+
+
+AsyncHandle<Nfa> Vata2::Nfa::load_async(
+	const std::string&  filename,
+	Alphabet*           alphabet,
+	ProgressCallback    callback)
+{ // {{{
+	assert(nullptr != alphabet);
+
+	auto op = [filename, alphabet]() {
+		std::ifstream input(filename);
+		if (!input) {
+			throw std::runtime_error("load_async: cannot open file \"" + filename + "\"");
+		}
+
+		return construct(Vata2::Parser::parse_vtf_section(input), alphabet);
+	};
+	return run_async(std::move(op), std::move(callback));
+} // load_async }}}
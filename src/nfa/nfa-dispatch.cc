@@ -88,6 +88,15 @@ namespace
 					return static_cast<VMPointer>(nfa_wrap);
 				});
 
+			test_and_call("regex", func_name, {Vata2::TYPE_STR}, func_args,
+				Vata2::Nfa::TYPE_NFA,
+				*[](const std::string& pattern) -> auto {
+					NfaWrapper* nfa_wrap = new NfaWrapper;
+					nfa_wrap->alphabet = new CharAlphabet();
+					compile_regex(&nfa_wrap->nfa, pattern);
+					return static_cast<VMPointer>(nfa_wrap);
+				});
+
 			test_and_call("print", func_name, {TYPE_NFA}, func_args, Vata2::TYPE_VOID,
 				*[](const NfaWrapper& nfa_wrap) -> auto {
 					std::cout << nfa_wrap;
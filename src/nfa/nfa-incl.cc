@@ -104,6 +104,8 @@ bool is_incl_antichains(
 	}
 
 	while (!worklist.empty()) {
+		Vata2::parallel::report_progress(processed.size(), worklist.size());
+
 		// get a next product state
 		ProdStateType prod_state;
 		if (is_dfs) {
@@ -0,0 +1,574 @@
+/* nfa-lazy.cc -- lazily evaluated expressions over NFAs
+ *
+ * Copyright (c) 2018 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <algorithm>
+
+// VATA headers
+#include <vata2/nfa.hh>
+
+using namespace Vata2::Nfa;
+using namespace Vata2::util;
+
+namespace {
+
+const StateSet EMPTY_STATE_SET = { };
+
+
+/// numbers values of @p Key densely in the order of their first occurrence
+template <class Key>
+class Interner
+{ // {{{
+private:
+
+	std::unordered_map<Key, State> ids = { };
+	std::vector<const Key*> keys = { };
+
+public:
+
+	/// the number of @p key; @p inserted is set if it is new
+	State get_id(const Key& key, bool* inserted = nullptr)
+	{ // {{{
+		auto it_ins = this->ids.insert({key, this->keys.size()});
+		if (it_ins.second) { this->keys.push_back(&it_ins.first->first); }
+		if (nullptr != inserted) { *inserted = it_ins.second; }
+		return it_ins.first->second;
+	} // get_id }}}
+
+	const Key& get_key(State id) const
+	{ // {{{
+		assert(id < this->keys.size());
+		return *this->keys[id];
+	} // get_key }}}
+}; // Interner }}}
+
+
+/// a node with a concrete automaton
+class NfaNode : public LazyNode
+{ // {{{
+private:
+
+	/// the automaton if it is owned by the node
+	Nfa owned = { };
+	const Nfa* aut;
+
+	NfaNode(const NfaNode&);
+	NfaNode& operator=(const NfaNode&);
+
+public:
+
+	explicit NfaNode(const Nfa& aut) : aut(&aut) { }
+	explicit NfaNode(Nfa&& aut) : owned(std::move(aut)), aut(&this->owned) { }
+
+	virtual const StateSet& get_initial() override { return this->aut->initialstates; }
+	virtual bool has_final(State state) override { return this->aut->has_final(state); }
+	virtual const PostSymb& post(State state) override { return (*this->aut)[state]; }
+
+	virtual const StateSet& post(State state, Symbol symb) override
+	{ // {{{
+		const PostSymb& post_s = (*this->aut)[state];
+		auto it = post_s.find(symb);
+		return (post_s.end() == it)? EMPTY_STATE_SET : it->second;
+	} // post(Symbol) }}}
+}; // NfaNode }}}
+
+
+/**
+ * @brief  A node that caches the successors of its states
+ *
+ * Derived nodes compute the initial states and the successors over all
+ * symbols or over a single one.
+ */
+class CachedNode : public LazyNode
+{ // {{{
+private:
+
+	bool has_initial = false;
+	StateSet initial = { };
+	std::unordered_map<State, PostSymb> post_cache = { };
+	std::unordered_map<std::pair<State, Symbol>, StateSet> symb_cache = { };
+
+protected:
+
+	virtual void compute_initial(StateSet* result) = 0;
+	virtual void compute_post(PostSymb* result, State state) = 0;
+	virtual void compute_post(StateSet* result, State state, Symbol symb) = 0;
+
+public:
+
+	virtual const StateSet& get_initial() override
+	{ // {{{
+		if (!this->has_initial)
+		{
+			this->compute_initial(&this->initial);
+			this->has_initial = true;
+		}
+
+		return this->initial;
+	} // get_initial }}}
+
+	virtual const PostSymb& post(State state) override
+	{ // {{{
+		auto it = this->post_cache.find(state);
+		if (this->post_cache.end() != it) { return it->second; }
+
+		PostSymb result;
+		this->compute_post(&result, state);
+		return this->post_cache[state] = std::move(result);
+	} // post }}}
+
+	virtual const StateSet& post(State state, Symbol symb) override
+	{ // {{{
+		auto it = this->post_cache.find(state);
+		if (this->post_cache.end() != it)
+		{
+			auto jt = it->second.find(symb);
+			return (it->second.end() == jt)? EMPTY_STATE_SET : jt->second;
+		}
+
+		auto it_ins = this->symb_cache.insert({{state, symb}, { }});
+		if (it_ins.second) { this->compute_post(&it_ins.first->second, state, symb); }
+		return it_ins.first->second;
+	} // post(Symbol) }}}
+}; // CachedNode }}}
+
+
+/// the product of two nodes
+class ProductNode : public CachedNode
+{ // {{{
+private:
+
+	LazyNfa lhs;
+	LazyNfa rhs;
+	Interner<std::pair<State, State>> states = { };
+
+protected:
+
+	virtual void compute_initial(StateSet* result) override
+	{ // {{{
+		for (State lhs_st : this->lhs->get_initial()) {
+			for (State rhs_st : this->rhs->get_initial()) {
+				result->insert(this->states.get_id({lhs_st, rhs_st}));
+			}
+		}
+	} // compute_initial }}}
+
+	virtual void compute_post(PostSymb* result, State state) override
+	{ // {{{
+		const std::pair<State, State> pair = this->states.get_key(state);
+		const PostSymb& lhs_post = this->lhs->post(pair.first);
+		const PostSymb& rhs_post = this->rhs->post(pair.second);
+		for (const auto& symb_set : lhs_post)
+		{
+			auto it = rhs_post.find(symb_set.first);
+			if (rhs_post.end() == it) { continue; }
+
+			StateSet& tgts = (*result)[symb_set.first];
+			for (State lhs_tgt : symb_set.second) {
+				for (State rhs_tgt : it->second) {
+					tgts.insert(this->states.get_id({lhs_tgt, rhs_tgt}));
+				}
+			}
+		}
+	} // compute_post }}}
+
+	virtual void compute_post(StateSet* result, State state, Symbol symb) override
+	{ // {{{
+		const std::pair<State, State> pair = this->states.get_key(state);
+		const StateSet& lhs_tgts = this->lhs->post(pair.first, symb);
+		if (lhs_tgts.empty()) { return; }
+
+		for (State lhs_tgt : lhs_tgts) {
+			for (State rhs_tgt : this->rhs->post(pair.second, symb)) {
+				result->insert(this->states.get_id({lhs_tgt, rhs_tgt}));
+			}
+		}
+	} // compute_post(Symbol) }}}
+
+public:
+
+	ProductNode(const LazyNfa& lhs, const LazyNfa& rhs) : lhs(lhs), rhs(rhs) { }
+
+	virtual bool has_final(State state) override
+	{ // {{{
+		const std::pair<State, State> pair = this->states.get_key(state);
+		return this->lhs->has_final(pair.first) && this->rhs->has_final(pair.second);
+	} // has_final }}}
+}; // ProductNode }}}
+
+
+/// the disjoint union of two nodes
+class UnionNode : public CachedNode
+{ // {{{
+private:
+
+	LazyNfa lhs;
+	LazyNfa rhs;
+	/// states are pairs (0 for lhs or 1 for rhs, state of the operand)
+	Interner<std::pair<State, State>> states = { };
+
+	LazyNode& get_operand(State side) { return (0 == side)? *this->lhs : *this->rhs; }
+
+	void add_renamed(StateSet* result, State side, const StateSet& tgts)
+	{ // {{{
+		for (State tgt : tgts) { result->insert(this->states.get_id({side, tgt})); }
+	} // add_renamed }}}
+
+protected:
+
+	virtual void compute_initial(StateSet* result) override
+	{ // {{{
+		this->add_renamed(result, 0, this->lhs->get_initial());
+		this->add_renamed(result, 1, this->rhs->get_initial());
+	} // compute_initial }}}
+
+	virtual void compute_post(PostSymb* result, State state) override
+	{ // {{{
+		const std::pair<State, State> pair = this->states.get_key(state);
+		for (const auto& symb_set : this->get_operand(pair.first).post(pair.second)) {
+			this->add_renamed(&(*result)[symb_set.first], pair.first, symb_set.second);
+		}
+	} // compute_post }}}
+
+	virtual void compute_post(StateSet* result, State state, Symbol symb) override
+	{ // {{{
+		const std::pair<State, State> pair = this->states.get_key(state);
+		this->add_renamed(result, pair.first,
+			this->get_operand(pair.first).post(pair.second, symb));
+	} // compute_post(Symbol) }}}
+
+public:
+
+	UnionNode(const LazyNfa& lhs, const LazyNfa& rhs) : lhs(lhs), rhs(rhs) { }
+
+	virtual bool has_final(State state) override
+	{ // {{{
+		const std::pair<State, State> pair = this->states.get_key(state);
+		return this->get_operand(pair.first).has_final(pair.second);
+	} // has_final }}}
+}; // UnionNode }}}
+
+
+/**
+ * @brief  The subset construction on a node
+ *
+ * If @p complemented is set, the result is completed wrt the given symbols
+ * (by the empty macrostate) and its final states are flipped.
+ */
+class SubsetNode : public CachedNode
+{ // {{{
+private:
+
+	LazyNfa aut;
+	bool complemented;
+	/// the symbols of the alphabet (sorted) for the complement
+	std::vector<Symbol> symbols;
+	Interner<StateSet> macrostates = { };
+	std::vector<bool> final = { };
+
+	State get_id(const StateSet& macrostate)
+	{ // {{{
+		bool inserted;
+		const State id = this->macrostates.get_id(macrostate, &inserted);
+		if (inserted)
+		{
+			bool has_final = false;
+			for (State st : macrostate) {
+				if (this->aut->has_final(st)) { has_final = true; break; }
+			}
+
+			this->final.push_back(has_final != this->complemented);
+		}
+
+		return id;
+	} // get_id }}}
+
+protected:
+
+	virtual void compute_initial(StateSet* result) override
+	{ // {{{
+		result->insert(this->get_id(this->aut->get_initial()));
+	} // compute_initial }}}
+
+	virtual void compute_post(PostSymb* result, State state) override
+	{ // {{{
+		const StateSet& macrostate = this->macrostates.get_key(state);
+		std::unordered_map<Symbol, StateSet> post_symb;
+		if (this->complemented) {
+			for (Symbol symb : this->symbols) { post_symb[symb]; }
+		}
+
+		for (State st : macrostate) {
+			for (const auto& symb_set : this->aut->post(st)) {
+				post_symb[symb_set.first].insert(symb_set.second.begin(), symb_set.second.end());
+			}
+		}
+
+		for (const auto& symb_set : post_symb) {
+			(*result)[symb_set.first] = {this->get_id(symb_set.second)};
+		}
+	} // compute_post }}}
+
+	virtual void compute_post(StateSet* result, State state, Symbol symb) override
+	{ // {{{
+		const StateSet& macrostate = this->macrostates.get_key(state);
+		StateSet tgts;
+		for (State st : macrostate)
+		{
+			const StateSet& st_tgts = this->aut->post(st, symb);
+			tgts.insert(st_tgts.begin(), st_tgts.end());
+		}
+
+		if (!tgts.empty() || (this->complemented &&
+			std::binary_search(this->symbols.begin(), this->symbols.end(), symb)))
+		{
+			result->insert(this->get_id(tgts));
+		}
+	} // compute_post(Symbol) }}}
+
+public:
+
+	SubsetNode(const LazyNfa& aut, bool complemented, std::vector<Symbol> symbols) :
+		aut(aut), complemented(complemented), symbols(std::move(symbols))
+	{ }
+
+	const LazyNfa& get_operand() const { return this->aut; }
+	bool is_complemented() const { return this->complemented; }
+	const std::vector<Symbol>& get_symbols() const { return this->symbols; }
+
+	virtual bool has_final(State state) override
+	{ // {{{
+		assert(state < this->final.size());
+		return this->final[state];
+	} // has_final }}}
+}; // SubsetNode }}}
+
+
+/// the reverse of a node; the node is materialized when first explored
+class RevertNode : public LazyNode
+{ // {{{
+private:
+
+	LazyNfa aut;
+	LazyNfa reverted = nullptr;
+
+	LazyNode& get_reverted()
+	{ // {{{
+		if (nullptr == this->reverted) {
+			this->reverted = lazy(revert(materialize(this->aut)));
+		}
+
+		return *this->reverted;
+	} // get_reverted }}}
+
+public:
+
+	explicit RevertNode(const LazyNfa& aut) : aut(aut) { }
+
+	const LazyNfa& get_operand() const { return this->aut; }
+
+	virtual const StateSet& get_initial() override { return this->get_reverted().get_initial(); }
+	virtual bool has_final(State state) override { return this->get_reverted().has_final(state); }
+	virtual const PostSymb& post(State state) override { return this->get_reverted().post(state); }
+
+	virtual const StateSet& post(State state, Symbol symb) override
+	{ // {{{
+		return this->get_reverted().post(state, symb);
+	} // post(Symbol) }}}
+}; // RevertNode }}}
+
+} // anonymous namespace
+
+
+const StateSet& LazyNode::post(State state, Symbol symb)
+{ // {{{
+	const PostSymb& post_s = this->post(state);
+	auto it = post_s.find(symb);
+	return (post_s.end() == it)? EMPTY_STATE_SET : it->second;
+} // LazyNode::post(Symbol) }}}
+
+
+LazyNfa Vata2::Nfa::lazy(const Nfa& aut)
+{ // {{{
+	return std::make_shared<NfaNode>(aut);
+} // lazy }}}
+
+
+LazyNfa Vata2::Nfa::lazy(Nfa&& aut)
+{ // {{{
+	return std::make_shared<NfaNode>(std::move(aut));
+} // lazy(Nfa&&) }}}
+
+
+LazyNfa Vata2::Nfa::intersection(const LazyNfa& lhs, const LazyNfa& rhs)
+{ // {{{
+	assert(nullptr != lhs && nullptr != rhs);
+	return std::make_shared<ProductNode>(lhs, rhs);
+} // intersection(LazyNfa) }}}
+
+
+LazyNfa Vata2::Nfa::union_rename(const LazyNfa& lhs, const LazyNfa& rhs)
+{ // {{{
+	assert(nullptr != lhs && nullptr != rhs);
+	return std::make_shared<UnionNode>(lhs, rhs);
+} // union_rename(LazyNfa) }}}
+
+
+LazyNfa Vata2::Nfa::complement(const LazyNfa& aut, const Alphabet& alphabet)
+{ // {{{
+	assert(nullptr != aut);
+
+	const std::list<Symbol> symbs_ls = alphabet.get_symbols();
+	std::vector<Symbol> symbols(symbs_ls.begin(), symbs_ls.end());
+	std::sort(symbols.begin(), symbols.end());
+	symbols.erase(std::unique(symbols.begin(), symbols.end()), symbols.end());
+
+	auto subset = std::dynamic_pointer_cast<SubsetNode>(aut);
+	if (nullptr != subset && subset->is_complemented())
+	{ // complementing twice over the same alphabet gives the language of
+		// the operand (over different ones, a complement is complemented)
+		if (subset->get_symbols() == symbols) { return determinize(subset->get_operand()); }
+		return std::make_shared<SubsetNode>(aut, true, std::move(symbols));
+	}
+
+	// the subset construction is done only once
+	const LazyNfa& operand = (nullptr != subset)? subset->get_operand() : aut;
+	return std::make_shared<SubsetNode>(operand, true, std::move(symbols));
+} // complement(LazyNfa) }}}
+
+
+LazyNfa Vata2::Nfa::revert(const LazyNfa& aut)
+{ // {{{
+	assert(nullptr != aut);
+
+	auto reverted = std::dynamic_pointer_cast<RevertNode>(aut);
+	if (nullptr != reverted) { return reverted->get_operand(); }
+
+	return std::make_shared<RevertNode>(aut);
+} // revert(LazyNfa) }}}
+
+
+LazyNfa Vata2::Nfa::determinize(const LazyNfa& aut)
+{ // {{{
+	assert(nullptr != aut);
+
+	// the subset construction gives deterministic nodes
+	if (nullptr != std::dynamic_pointer_cast<SubsetNode>(aut)) { return aut; }
+
+	return std::make_shared<SubsetNode>(aut, false, std::vector<Symbol>());
+} // determinize(LazyNfa) }}}
+
+
+bool Vata2::Nfa::is_lang_empty(const LazyNfa& aut, Word* cex)
+{ // {{{
+	assert(nullptr != aut);
+
+	Workspace ws;
+	ws.new_epoch();
+	std::vector<State>& worklist = ws.worklist;
+	for (State st : aut->get_initial())
+	{
+		ws.visit(st, st);
+		worklist.push_back(st);
+	}
+
+	for (size_t i = 0; i < worklist.size(); ++i)
+	{
+		const State state = worklist[i];
+		if (aut->has_final(state))
+		{
+			if (nullptr != cex)
+			{ // the symbols of the path are found in the (cached) successors
+				cex->clear();
+				for (State st = state; ws.get_parent(st) != st; st = ws.get_parent(st))
+				{
+					for (const auto& symb_set : aut->post(ws.get_parent(st))) {
+						if (haskey(symb_set.second, st)) { cex->push_back(symb_set.first); break; }
+					}
+				}
+
+				std::reverse(cex->begin(), cex->end());
+			}
+
+			return false;
+		}
+
+		for (const auto& symb_set : aut->post(state)) {
+			for (State tgt : symb_set.second) {
+				if (ws.visit(tgt, state)) { worklist.push_back(tgt); }
+			}
+		}
+	}
+
+	return true;
+} // is_lang_empty(LazyNfa) }}}
+
+
+bool Vata2::Nfa::is_in_lang(const LazyNfa& aut, const Word& word)
+{ // {{{
+	assert(nullptr != aut);
+
+	StateSet cur = aut->get_initial();
+	for (Symbol symb : word)
+	{
+		StateSet next;
+		for (State st : cur)
+		{
+			const StateSet& tgts = aut->post(st, symb);
+			next.insert(tgts.begin(), tgts.end());
+		}
+
+		if (next.empty()) { return false; }
+		cur = std::move(next);
+	}
+
+	for (State st : cur) {
+		if (aut->has_final(st)) { return true; }
+	}
+
+	return false;
+} // is_in_lang(LazyNfa) }}}
+
+
+void Vata2::Nfa::materialize(Nfa* result, const LazyNfa& aut)
+{ // {{{
+	assert(nullptr != result);
+	assert(nullptr != aut);
+
+	*result = Nfa();
+	Workspace ws;
+	ws.new_epoch();
+	std::vector<State>& worklist = ws.worklist;
+	for (State st : aut->get_initial())
+	{
+		result->add_initial(st);
+		if (ws.visit(st)) { worklist.push_back(st); }
+	}
+
+	for (size_t i = 0; i < worklist.size(); ++i)
+	{
+		const State state = worklist[i];
+		if (aut->has_final(state)) { result->add_final(state); }
+
+		for (const auto& symb_set : aut->post(state)) {
+			for (State tgt : symb_set.second)
+			{
+				result->add_trans(state, symb_set.first, tgt);
+				if (ws.visit(tgt)) { worklist.push_back(tgt); }
+			}
+		}
+	}
+} // materialize }}}
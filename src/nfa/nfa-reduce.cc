@@ -0,0 +1,172 @@
+/* nfa-reduce.cc -- NFA size reduction
+ *
+ * Copyright (c) 2018 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <algorithm>
+#include <limits>
+
+// VATA headers
+#include <vata2/nfa.hh>
+
+using namespace Vata2::Nfa;
+using namespace Vata2::util;
+
+namespace {
+
+/// an NFA with states numbered densely (and transitions in adjacency lists)
+struct DenseNfa
+{ // {{{
+	std::vector<State> states = { };
+	std::vector<bool> initial = { };
+	std::vector<bool> final = { };
+	/// (symbol, target) pairs for every state, sorted
+	std::vector<std::vector<std::pair<Symbol, size_t>>> succ = { };
+}; // DenseNfa }}}
+
+
+DenseNfa make_dense(const Nfa& aut)
+{ // {{{
+	DenseNfa result;
+	std::unordered_map<State, size_t> index;
+	auto get_index = [&](State st) {
+		auto it_ins = index.insert({st, result.states.size()});
+		if (it_ins.second) {
+			result.states.push_back(st);
+			result.initial.push_back(aut.has_initial(st));
+			result.final.push_back(aut.has_final(st));
+			result.succ.emplace_back();
+		}
+
+		return it_ins.first->second;
+	};
+
+	for (State st : aut.initialstates) { get_index(st); }
+	for (State st : aut.finalstates) { get_index(st); }
+	for (const Trans& trans : aut) {
+		size_t src = get_index(trans.src);
+		size_t tgt = get_index(trans.tgt);
+		result.succ[src].push_back({trans.symb, tgt});
+	}
+
+	for (auto& succ : result.succ) { std::sort(succ.begin(), succ.end()); }
+	return result;
+} // make_dense }}}
+
+
+/**
+ * Computes the coarsest partition of states (into blocks numbered from 0) that
+ * is stable wrt successors after at most @p max_rounds rounds of refinement
+ */
+std::vector<size_t> compute_bisim(const DenseNfa& aut, size_t max_rounds)
+{ // {{{
+	using Signature = std::pair<size_t, std::vector<std::pair<Symbol, size_t>>>;
+
+	const size_t num_states = aut.states.size();
+	// the initial partition separates final and non-final states
+	std::vector<size_t> block(num_states);
+	bool has_final = std::find(aut.final.begin(), aut.final.end(), true) != aut.final.end();
+	bool has_nonfinal = std::find(aut.final.begin(), aut.final.end(), false) != aut.final.end();
+	for (size_t i = 0; i < num_states; ++i) {
+		block[i] = (aut.final[i] && has_nonfinal)? 1 : 0;
+	}
+	size_t num_blocks = (has_final && has_nonfinal)? 2 : 1;
+
+	for (size_t round = 0; round < max_rounds; ++round) {
+		std::unordered_map<Signature, size_t> sig_map;
+		std::vector<size_t> new_block(num_states);
+		for (size_t i = 0; i < num_states; ++i) {
+			Signature sig = {block[i], { }};
+			for (const auto& symb_tgt : aut.succ[i]) {
+				sig.second.push_back({symb_tgt.first, block[symb_tgt.second]});
+			}
+
+			std::sort(sig.second.begin(), sig.second.end());
+			sig.second.erase(std::unique(sig.second.begin(), sig.second.end()),
+				sig.second.end());
+			new_block[i] = sig_map.insert({std::move(sig), sig_map.size()}).first->second;
+		}
+
+		block = std::move(new_block);
+		if (sig_map.size() == num_blocks) { break; }   // stable
+		num_blocks = sig_map.size();
+	}
+
+	return block;
+} // compute_bisim }}}
+
+} // namespace
+
+
+void Vata2::Nfa::trim(Nfa* result, const Nfa& aut)
+{ // {{{
+	assert(nullptr != result);
+
+	std::unordered_set<State> fwd_reach = get_fwd_reach_states(aut);
+	std::unordered_set<State> bwd_reach = get_fwd_reach_states(revert(aut));
+
+	auto is_useful = [&](State st) {
+		return haskey(fwd_reach, st) && haskey(bwd_reach, st);
+	};
+
+	*result = Nfa();
+	for (State st : aut.initialstates) {
+		if (is_useful(st)) { result->add_initial(st); }
+	}
+
+	for (State st : aut.finalstates) {
+		if (is_useful(st)) { result->add_final(st); }
+	}
+
+	for (const Trans& trans : aut) {
+		if (is_useful(trans.src) && is_useful(trans.tgt)) { result->add_trans(trans); }
+	}
+} // trim }}}
+
+
+void Vata2::Nfa::reduce(
+	Nfa*               result,
+	const Nfa&         aut,
+	const StringDict&  params)
+{ // {{{
+	assert(nullptr != result);
+
+	if (!haskey(params, "algo")) {
+		throw std::runtime_error(std::to_string(__func__) +
+			" requires setting the \"algo\" key in the \"params\" argument; "
+			"received: " + std::to_string(params));
+	}
+
+	const std::string& str_algo = params.at("algo");
+	if ("bisim" != str_algo) {
+		throw std::runtime_error(std::to_string(__func__) +
+			" received an unknown value of the \"algo\" key: " + str_algo);
+	}
+
+	size_t max_rounds = std::numeric_limits<size_t>::max();
+	if (haskey(params, "depth")) { max_rounds = std::stoul(params.at("depth")); }
+
+	DenseNfa dense = make_dense(trim(aut));
+	std::vector<size_t> block = compute_bisim(dense, max_rounds);
+
+	*result = Nfa();
+	for (size_t i = 0; i < dense.states.size(); ++i) {
+		if (dense.initial[i]) { result->add_initial(block[i]); }
+		if (dense.final[i]) { result->add_final(block[i]); }
+		for (const auto& symb_tgt : dense.succ[i]) {
+			result->add_trans(block[i], symb_tgt.first, block[symb_tgt.second]);
+		}
+	}
+} // reduce }}}
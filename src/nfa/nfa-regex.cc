@@ -0,0 +1,107 @@
+/* nfa-regex.cc -- compilation of regular expressions into NFAs
+ *
+ * Copyright (c) 2018 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+// VATA headers
+#include <vata2/nfa.hh>
+
+// local headers
+#include "../regex-aux.hh"
+
+using namespace Vata2::Nfa;
+using namespace Vata2::regex;
+using namespace Vata2::util;
+
+
+void Vata2::Nfa::compile_regex(
+	Nfa*                result,
+	const std::string&  pattern,
+	const StringDict&   params)
+{ // {{{
+	assert(nullptr != result);
+
+	bool search = false;
+	if (haskey(params, "match")) {
+		const std::string& str_match = params.at("match");
+		if ("search" == str_match) { search = true; }
+		else if ("full" != str_match) {
+			throw std::runtime_error(std::to_string(__func__) +
+				" received an unknown value of the \"match\" key: " + str_match);
+		}
+	}
+
+	RegexParser parser(pattern);
+	const size_t root = parser.parse();
+	if (search) { parser.check_anchors(); }
+
+	// ^ removes the loop in the initial state, $ removes the sink
+	const bool loop_initial = search && !parser.anchored_begin;
+	const bool use_sink = search && !parser.anchored_end;
+	const std::vector<Node>& nodes = parser.nodes;
+	const Glushkov sets = compute_glushkov(nodes, root);
+
+	// in the search mode (without $), every transition to a final state also
+	// leads to an accepting sink (so that final states do not need loops)
+	std::vector<bool> is_final(nodes.size());
+	for (size_t pos : sets.last) { is_final[pos] = true; }
+	const State sink = nodes.size() + 1;
+
+	// only positions reachable from the initial state get a state
+	PositionSymbols symbols(nodes);
+	std::vector<bool> visited(nodes.size());
+	std::vector<size_t> worklist;
+	auto add_edge = [&](State src, size_t tgt) {
+		if (!visited[tgt])
+		{
+			visited[tgt] = true;
+			worklist.push_back(tgt);
+		}
+
+		for (Symbol symb : symbols[tgt])
+		{
+			result->add_trans(src, symb, tgt + 1);
+			if (use_sink && is_final[tgt]) { result->add_trans(src, symb, sink); }
+		}
+	};
+
+	*result = Nfa();
+	result->initialstates = {0};
+	for (size_t pos : sets.first) { add_edge(0, pos); }
+	while (!worklist.empty())
+	{
+		const size_t pos = worklist.back();
+		worklist.pop_back();
+		for (const Glushkov::Edge& edge : sets.follow[pos]) { add_edge(pos + 1, edge.tgt); }
+	}
+
+	if (sets.nullable) { result->finalstates.insert(0); }
+	for (size_t pos : sets.last) { result->finalstates.insert(pos + 1); }
+
+	if (loop_initial)
+	{ // every word with a factor (suffix if anchored at the end) in the language
+		for (size_t byte = 0; byte < 256; ++byte) { result->add_trans(0, byte, 0); }
+	}
+
+	if (use_sink)
+	{ // every word with a factor (prefix if anchored at the beginning) in the language
+		result->finalstates.insert(sink);
+		for (size_t byte = 0; byte < 256; ++byte)
+		{
+			result->add_trans(sink, byte, sink);
+			if (sets.nullable) { result->add_trans(0, byte, sink); }
+		}
+	}
+} // compile_regex }}}
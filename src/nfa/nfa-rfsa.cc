@@ -0,0 +1,276 @@
+/* nfa-rfsa.cc -- canonical residual finite-state automata
+ *
+ * Copyright (c) 2018 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <algorithm>
+#include <map>
+
+// VATA headers
+#include <vata2/nfa.hh>
+
+using namespace Vata2::Nfa;
+using namespace Vata2::util;
+
+namespace {
+
+/**
+ * @brief  The subset construction with states numbered in the shortlex
+ *         order of their least access words
+ *
+ * When the subsets correspond to the residuals of the language (which is
+ * the case for the inputs below), this numbering of residuals depends only
+ * on the language.
+ */
+struct SubsetDfa
+{ // {{{
+	std::vector<StateSet> subsets = { };
+	std::vector<bool> final = { };
+	/// (symbol, target) pairs for every state, sorted
+	std::vector<std::vector<std::pair<Symbol, size_t>>> succ = { };
+
+	explicit SubsetDfa(const Nfa& aut)
+	{ // {{{
+		if (aut.initialstates.empty()) { return; }
+
+		SubsetMap index;
+		auto get_index = [&](const StateSet& subset) {
+			auto it_ins = index.insert({subset, this->subsets.size()});
+			if (it_ins.second) {
+				this->subsets.push_back(subset);
+				this->final.push_back(!are_disjoint(subset, aut.finalstates));
+				this->succ.emplace_back();
+			}
+
+			return it_ins.first->second;
+		};
+
+		get_index(aut.initialstates);
+		// BFS with symbols in the increasing order visits access words in the
+		// shortlex order
+		for (size_t i = 0; i < this->subsets.size(); ++i)
+		{
+			std::map<Symbol, StateSet> post_symb;
+			for (State st : this->subsets[i]) {
+				for (const auto& symb_set : aut[st]) {
+					post_symb[symb_set.first].insert(symb_set.second.begin(), symb_set.second.end());
+				}
+			}
+
+			for (const auto& symb_set : post_symb)
+			{
+				const size_t tgt = get_index(symb_set.second);
+				this->succ[i].push_back({symb_set.first, tgt});
+			}
+		}
+	} // SubsetDfa() }}}
+
+	size_t size() const { return this->subsets.size(); }
+
+	/// the successor of @p state over @p symb (or size() if there is none)
+	size_t get_succ(size_t state, Symbol symb) const
+	{ // {{{
+		const auto& succ = this->succ[state];
+		auto it = std::lower_bound(succ.begin(), succ.end(),
+			std::make_pair(symb, size_t(0)));
+		return (succ.end() != it && it->first == symb)? it->second : this->size();
+	} // get_succ }}}
+}; // SubsetDfa }}}
+
+
+using Relation = std::vector<std::vector<bool>>;
+
+
+/// inclusion of the languages of states of a minimal DFA (incl[p][q] iff
+/// L(p) is a subset of L(q)), computed as the greatest fixpoint
+Relation compute_dfa_incl(const SubsetDfa& dfa)
+{ // {{{
+	const size_t size = dfa.size();
+	std::vector<std::vector<std::pair<Symbol, size_t>>> pred(size);
+	for (size_t src = 0; src < size; ++src) {
+		for (const auto& symb_tgt : dfa.succ[src]) {
+			pred[symb_tgt.second].push_back({symb_tgt.first, src});
+		}
+	}
+
+	Relation incl(size, std::vector<bool>(size, true));
+	std::vector<std::pair<size_t, size_t>> worklist;
+	auto refute = [&](size_t lhs, size_t rhs) {
+		if (incl[lhs][rhs]) {
+			incl[lhs][rhs] = false;
+			worklist.push_back({lhs, rhs});
+		}
+	};
+
+	// the states are trimmed, so a missing transition means the empty residual
+	for (size_t lhs = 0; lhs < size; ++lhs) {
+		for (size_t rhs = 0; rhs < size; ++rhs)
+		{
+			if (dfa.final[lhs] && !dfa.final[rhs]) { refute(lhs, rhs); continue; }
+			for (const auto& symb_tgt : dfa.succ[lhs]) {
+				if (dfa.get_succ(rhs, symb_tgt.first) == size) { refute(lhs, rhs); break; }
+			}
+		}
+	}
+
+	while (!worklist.empty())
+	{
+		const auto pair = worklist.back();
+		worklist.pop_back();
+		for (const auto& lhs_pred : pred[pair.first]) {
+			for (const auto& rhs_pred : pred[pair.second]) {
+				if (lhs_pred.first == rhs_pred.first) { refute(lhs_pred.second, rhs_pred.second); }
+			}
+		}
+	}
+
+	return incl;
+} // compute_dfa_incl }}}
+
+
+/// checks whether the language of @p state of a minimal DFA is the union of
+/// the languages of the states strictly below it in @p incl
+bool is_dfa_composite(const SubsetDfa& dfa, const Relation& incl, size_t state)
+{ // {{{
+	using Node = std::pair<size_t, std::vector<size_t>>;
+
+	Node init = {state, { }};
+	for (size_t below = 0; below < dfa.size(); ++below) {
+		if (below != state && incl[below][state]) { init.second.push_back(below); }
+	}
+
+	// searching for a word of L(state) that is in none of the languages below
+	std::set<Node> visited = {init};
+	std::vector<Node> worklist = {init};
+	while (!worklist.empty())
+	{
+		const Node node = std::move(worklist.back());
+		worklist.pop_back();
+
+		if (dfa.final[node.first] && std::none_of(node.second.begin(), node.second.end(),
+			[&dfa](size_t st) { return dfa.final[st]; }))
+		{
+			return false;
+		}
+
+		for (const auto& symb_tgt : dfa.succ[node.first])
+		{
+			Node next = {symb_tgt.second, { }};
+			for (size_t st : node.second)
+			{
+				const size_t tgt = dfa.get_succ(st, symb_tgt.first);
+				if (dfa.size() != tgt) { next.second.push_back(tgt); }
+			}
+
+			// the languages of the states are nonempty
+			if (next.second.empty()) { return false; }
+
+			std::sort(next.second.begin(), next.second.end());
+			next.second.erase(std::unique(next.second.begin(), next.second.end()),
+				next.second.end());
+			if (visited.insert(next).second) { worklist.push_back(std::move(next)); }
+		}
+	}
+
+	return true;
+} // is_dfa_composite }}}
+
+
+/// builds the canonical RFSA from the residuals of the language given by
+/// @p dfa (in the shortlex order), their inclusion and primality
+void build_rfsa(Nfa* result, const SubsetDfa& dfa, const Relation& incl,
+	const std::vector<bool>& prime)
+{ // {{{
+	const size_t size = dfa.size();
+	std::vector<State> state(size);
+	std::vector<size_t> primes;
+	for (size_t i = 0; i < size; ++i) {
+		if (prime[i]) { state[i] = primes.size(); primes.push_back(i); }
+	}
+
+	*result = Nfa();
+	for (size_t p : primes)
+	{
+		if (incl[p][0]) { result->add_initial(state[p]); }
+		if (dfa.final[p]) { result->add_final(state[p]); }
+
+		for (const auto& symb_tgt : dfa.succ[p]) {
+			for (size_t q : primes) {
+				if (incl[q][symb_tgt.second]) { result->add_trans(state[p], symb_tgt.first, state[q]); }
+			}
+		}
+	}
+} // build_rfsa }}}
+
+} // anonymous namespace
+
+
+void Vata2::Nfa::canonical_rfsa(
+	Nfa*               result,
+	const Nfa&         aut,
+	const StringDict&  params)
+{ // {{{
+	assert(nullptr != result);
+
+	if (!haskey(params, "algo")) {
+		throw std::runtime_error(std::to_string(__func__) +
+			" requires setting the \"algo\" key in the \"params\" argument; "
+			"received: " + std::to_string(params));
+	}
+
+	const std::string& str_algo = params.at("algo");
+	if ("dfa" == str_algo)
+	{ // residuals are the states of the minimal DFA
+		const SubsetDfa dfa(minimize(aut));
+		const Relation incl = compute_dfa_incl(dfa);
+		std::vector<bool> prime(dfa.size());
+		for (size_t i = 0; i < dfa.size(); ++i) { prime[i] = !is_dfa_composite(dfa, incl, i); }
+
+		build_rfsa(result, dfa, incl, prime);
+	}
+	else if ("double-reversal" == str_algo)
+	{ // the reverse of a DFA is co-deterministic, so the languages of its
+		// states are pairwise disjoint and those of subsets are ordered (and
+		// united) like the subsets
+		const Nfa codet = revert(determinize(revert(aut)));
+		const SubsetDfa dfa(codet);
+
+		Relation incl(dfa.size(), std::vector<bool>(dfa.size()));
+		for (size_t p = 0; p < dfa.size(); ++p) {
+			for (size_t q = 0; q < dfa.size(); ++q) {
+				incl[p][q] = std::includes(dfa.subsets[q].begin(), dfa.subsets[q].end(),
+					dfa.subsets[p].begin(), dfa.subsets[p].end());
+			}
+		}
+
+		std::vector<bool> prime(dfa.size());
+		for (size_t p = 0; p < dfa.size(); ++p)
+		{
+			StateSet below;
+			for (size_t q = 0; q < dfa.size(); ++q) {
+				if (q != p && incl[q][p]) { below.insert(dfa.subsets[q].begin(), dfa.subsets[q].end()); }
+			}
+
+			prime[p] = (below != dfa.subsets[p]);
+		}
+
+		build_rfsa(result, dfa, incl, prime);
+	}
+	else
+	{
+		throw std::runtime_error(std::to_string(__func__) +
+			" received an unknown value of the \"algo\" key: " + str_algo);
+	}
+} // canonical_rfsa }}}
@@ -0,0 +1,251 @@
+/* nfa-shared.cc -- structural sharing of acyclic tails of NFAs
+ *
+ * Copyright (c) 2018 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <algorithm>
+
+// VATA headers
+#include <vata2/nfa.hh>
+
+using namespace Vata2::Nfa;
+using namespace Vata2::util;
+
+namespace {
+
+/// a lazy view of a SharedNfa
+class SharedNfaNode : public LazyNode
+{ // {{{
+private:
+
+	const SharedNfa& aut;
+	std::unordered_map<State, PostSymb> post_cache = { };
+
+public:
+
+	explicit SharedNfaNode(const SharedNfa& aut) : aut(aut) { }
+
+	using LazyNode::post;
+
+	virtual const StateSet& get_initial() override { return this->aut.get_initial(); }
+	virtual bool has_final(State state) override { return this->aut.get_node(state).final; }
+
+	virtual const PostSymb& post(State state) override
+	{ // {{{
+		auto it_ins = this->post_cache.insert({state, { }});
+		if (it_ins.second) {
+			for (const auto& symb_tgt : this->aut.get_node(state).succ) {
+				it_ins.first->second[symb_tgt.first].insert(symb_tgt.second);
+			}
+		}
+
+		return it_ins.first->second;
+	} // post }}}
+}; // SharedNfaNode }}}
+
+} // anonymous namespace
+
+
+size_t SharedNfa::num_private_trans() const
+{ // {{{
+	size_t result = 0;
+	for (const SharedNode& node : this->nodes) { result += node.succ.size(); }
+	return result;
+} // SharedNfa::num_private_trans }}}
+
+
+State SharedStore::add_node(SharedNode&& node)
+{ // {{{
+	auto it_ins = this->index.insert({std::move(node), this->nodes.size()});
+	if (it_ins.second)
+	{
+		this->nodes.push_back(&it_ins.first->first);
+		this->num_trans += it_ins.first->first.succ.size();
+	}
+
+	return it_ins.first->second;
+} // SharedStore::add_node }}}
+
+
+SharedNfa SharedStore::add(const Nfa& aut)
+{ // {{{
+	SharedNfa result(this);
+
+	// Tarjan's algorithm (iterative, as tails may be long); SCCs are
+	// completed in the reverse topological order, so the successors of a
+	// state outside of its SCC are already encoded when the SCC is completed
+	std::unordered_map<State, size_t> num;
+	std::vector<State> states;
+	std::vector<size_t> lowlink;
+	std::vector<bool> on_stack;
+	std::vector<size_t> scc_stack;
+	/// the states of the view (even for nodes of the store) by DFS numbers
+	std::vector<State> encoded;
+
+	struct Frame
+	{ // {{{
+		size_t num;
+		PostSymb::const_iterator symb_it;
+		StateSet::const_iterator tgt_it;
+	}; // Frame }}}
+	std::vector<Frame> frames;
+
+	auto push = [&](State state) {
+		const size_t state_num = states.size();
+		num[state] = state_num;
+		states.push_back(state);
+		lowlink.push_back(state_num);
+		on_stack.push_back(true);
+		scc_stack.push_back(state_num);
+		encoded.push_back(0);
+
+		const PostSymb& post = aut[state];
+		frames.push_back({state_num, post.begin(), StateSet::const_iterator()});
+		if (post.end() != post.begin()) { frames.back().tgt_it = post.begin()->second.begin(); }
+	};
+
+	auto get_succ = [&](size_t state_num, std::vector<std::pair<Symbol, State>>* succ) {
+		for (const auto& symb_set : aut[states[state_num]]) {
+			for (State tgt : symb_set.second) {
+				succ->push_back({symb_set.first, encoded[num.at(tgt)]});
+			}
+		}
+
+		// targets merged into the same node give the same transition
+		std::sort(succ->begin(), succ->end());
+		succ->erase(std::unique(succ->begin(), succ->end()), succ->end());
+	};
+
+	auto complete_scc = [&](size_t root) {
+		std::vector<size_t> scc;
+		size_t member;
+		do {
+			member = scc_stack.back();
+			scc_stack.pop_back();
+			on_stack[member] = false;
+			scc.push_back(member);
+		} while (member != root);
+
+		// a state is a tail if it is not on a cycle and all its successors are
+		bool is_tail = (1 == scc.size());
+		for (const auto& symb_set : aut[states[root]]) {
+			for (State tgt : symb_set.second)
+			{
+				const size_t tgt_num = num.at(tgt);
+				if (tgt_num == root || 1 == encoded[tgt_num] % 2) { is_tail = false; }
+			}
+		}
+
+		if (is_tail)
+		{
+			SharedNode node;
+			node.final = aut.has_final(states[root]);
+			get_succ(root, &node.succ);
+			encoded[root] = 2 * this->add_node(std::move(node));
+			return;
+		}
+
+		for (size_t st_num : scc)
+		{
+			encoded[st_num] = 2 * result.nodes.size() + 1;
+			result.nodes.emplace_back();
+		}
+
+		for (size_t st_num : scc)
+		{
+			SharedNode& node = result.nodes[encoded[st_num] / 2];
+			node.final = aut.has_final(states[st_num]);
+			get_succ(st_num, &node.succ);
+		}
+	};
+
+	for (State init : aut.initialstates)
+	{
+		if (haskey(num, init)) { continue; }
+
+		push(init);
+		while (!frames.empty())
+		{
+			Frame& frame = frames.back();
+			const PostSymb& post = aut[states[frame.num]];
+			if (post.end() != frame.symb_it)
+			{
+				if (frame.symb_it->second.end() == frame.tgt_it)
+				{
+					if (post.end() != ++frame.symb_it) { frame.tgt_it = frame.symb_it->second.begin(); }
+					continue;
+				}
+
+				const State tgt = *frame.tgt_it;
+				++frame.tgt_it;
+				auto it = num.find(tgt);
+				if (num.end() == it) { push(tgt); }
+				else if (on_stack[it->second]) {
+					lowlink[frame.num] = std::min(lowlink[frame.num], it->second);
+				}
+
+				continue;
+			}
+
+			const size_t state_num = frame.num;
+			frames.pop_back();
+			if (!frames.empty()) {
+				lowlink[frames.back().num] = std::min(lowlink[frames.back().num], lowlink[state_num]);
+			}
+
+			if (lowlink[state_num] == state_num) { complete_scc(state_num); }
+		}
+	}
+
+	for (State init : aut.initialstates) {
+		result.initialstates.insert(encoded[num.at(init)]);
+	}
+
+	return result;
+} // SharedStore::add }}}
+
+
+bool Vata2::Nfa::is_in_lang(const SharedNfa& aut, const Word& word)
+{ // {{{
+	std::vector<State> cur(aut.get_initial().begin(), aut.get_initial().end());
+	std::vector<State> next;
+	for (Symbol symb : word)
+	{
+		next.clear();
+		for (State state : cur)
+		{
+			const auto& succ = aut.get_node(state).succ;
+			auto it = std::lower_bound(succ.begin(), succ.end(), std::make_pair(symb, State(0)));
+			for (; succ.end() != it && it->first == symb; ++it) { next.push_back(it->second); }
+		}
+
+		std::sort(next.begin(), next.end());
+		next.erase(std::unique(next.begin(), next.end()), next.end());
+		if (next.empty()) { return false; }
+		std::swap(cur, next);
+	}
+
+	for (State state : cur) {
+		if (aut.get_node(state).final) { return true; }
+	}
+
+	return false;
+} // is_in_lang(SharedNfa) }}}
+
+
+LazyNfa Vata2::Nfa::lazy(const SharedNfa& aut)
+{ // {{{
+	return std::make_shared<SharedNfaNode>(aut);
+} // lazy(SharedNfa) }}}
@@ -0,0 +1,265 @@
+/* nfa-sim.cc -- simulation and determinization up to simulation
+ *
+ * Copyright (c) 2018 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <algorithm>
+#include <list>
+
+// VATA headers
+#include <vata2/nfa.hh>
+
+using namespace Vata2::Nfa;
+using namespace Vata2::util;
+
+namespace {
+
+/**
+ * @brief  The maximal forward simulation on the states of an automaton
+ *
+ * p is simulated by q (L(p) is then a subset of L(q)) if q is final whenever
+ * p is and every transition p -a-> p' is matched by some q -a-> q' such that
+ * p' is simulated by q'.  Computed by the counter-based refinement of
+ * Henzinger, Henzinger and Kopke in O(m * n) time.
+ */
+class Simulation
+{ // {{{
+private:
+
+	std::unordered_map<State, size_t> index = { };
+	size_t num_states = 0;
+	std::vector<bool> rel = { };
+
+	std::vector<bool>::reference at(size_t lhs, size_t rhs)
+	{ // {{{
+		return this->rel[lhs * this->num_states + rhs];
+	} // at }}}
+
+public:
+
+	explicit Simulation(const Nfa& aut)
+	{ // {{{
+		auto get_index = [this](State st) {
+			auto it_ins = this->index.insert({st, this->num_states});
+			if (it_ins.second) { ++this->num_states; }
+			return it_ins.first->second;
+		};
+
+		for (State st : aut.initialstates) { get_index(st); }
+		for (State st : aut.finalstates) { get_index(st); }
+
+		// (state, symbol) pairs with a transition get consecutive numbers
+		std::vector<std::vector<std::pair<Symbol, size_t>>> pred;
+		std::vector<std::vector<std::pair<Symbol, size_t>>> out_pairs;
+		size_t num_pairs = 0;
+		for (const Trans& trans : aut)
+		{
+			const size_t src = get_index(trans.src);
+			const size_t tgt = get_index(trans.tgt);
+			const size_t size = std::max(src, tgt) + 1;
+			if (pred.size() < size) { pred.resize(size); out_pairs.resize(size); }
+
+			pred[tgt].push_back({trans.symb, src});
+			if (out_pairs[src].empty() || out_pairs[src].back().first != trans.symb) {
+				out_pairs[src].push_back({trans.symb, num_pairs++});
+			}
+		}
+		pred.resize(this->num_states);
+		out_pairs.resize(this->num_states);
+		for (auto& pairs : out_pairs) { std::sort(pairs.begin(), pairs.end()); }
+
+		const size_t num = this->num_states;
+		auto pair_id = [&out_pairs](size_t st, Symbol symb) {
+			const auto& pairs = out_pairs[st];
+			auto it = std::lower_bound(pairs.begin(), pairs.end(),
+				std::make_pair(symb, size_t(0)));
+			return (pairs.end() != it && it->first == symb)? it->second : SIZE_MAX;
+		};
+
+		std::vector<bool> final(num);
+		for (State st : aut.finalstates) { final[this->index.at(st)] = true; }
+
+		// the initial over-approximation: finality and enabled symbols
+		this->rel.assign(num * num, false);
+		for (size_t lhs = 0; lhs < num; ++lhs) {
+			for (size_t rhs = 0; rhs < num; ++rhs)
+			{
+				if (final[lhs] && !final[rhs]) { continue; }
+				this->at(lhs, rhs) = std::all_of(out_pairs[lhs].begin(), out_pairs[lhs].end(),
+					[&](const std::pair<Symbol, size_t>& pair) {
+						return SIZE_MAX != pair_id(rhs, pair.first); });
+			}
+		}
+
+		// cnt[pair_id(q, a) * num + p'] = |{q' in post_a(q) | p' <= q'}|
+		std::vector<uint32_t> cnt(num_pairs * num, 0);
+		for (const Trans& trans : aut)
+		{
+			const size_t src = this->index.at(trans.src);
+			const size_t tgt = this->index.at(trans.tgt);
+			const size_t pair = pair_id(src, trans.symb);
+			for (size_t lhs = 0; lhs < num; ++lhs) {
+				if (this->at(lhs, tgt)) { ++cnt[pair * num + lhs]; }
+			}
+		}
+
+		std::vector<std::pair<size_t, size_t>> worklist;
+		auto remove = [&](size_t lhs, size_t rhs) {
+			if (this->at(lhs, rhs)) {
+				this->at(lhs, rhs) = false;
+				worklist.push_back({lhs, rhs});
+			}
+		};
+
+		// q cannot match p -a-> p' if no a-successor of q simulates p'
+		auto refute_preds = [&](size_t rhs, Symbol symb, size_t lhs_tgt) {
+			for (const auto& symb_src : pred[lhs_tgt]) {
+				if (symb_src.first == symb) { remove(symb_src.second, rhs); }
+			}
+		};
+
+		for (size_t rhs = 0; rhs < num; ++rhs) {
+			for (const auto& symb_pair : out_pairs[rhs]) {
+				for (size_t lhs_tgt = 0; lhs_tgt < num; ++lhs_tgt) {
+					if (0 == cnt[symb_pair.second * num + lhs_tgt]) {
+						refute_preds(rhs, symb_pair.first, lhs_tgt);
+					}
+				}
+			}
+		}
+
+		while (!worklist.empty())
+		{
+			const size_t lhs_tgt = worklist.back().first;
+			const size_t rhs_tgt = worklist.back().second;
+			worklist.pop_back();
+
+			for (const auto& symb_src : pred[rhs_tgt])
+			{
+				const size_t pair = pair_id(symb_src.second, symb_src.first);
+				if (0 == --cnt[pair * num + lhs_tgt]) {
+					refute_preds(symb_src.second, symb_src.first, lhs_tgt);
+				}
+			}
+		}
+	} // Simulation() }}}
+
+	/// keeps only the simulation-maximal states of @p macrostate (the least
+	/// one of every class of mutually similar states)
+	StateSet prune(const StateSet& macrostate) const
+	{ // {{{
+		std::vector<std::pair<State, size_t>> states;
+		for (State st : macrostate) { states.push_back({st, this->index.at(st)}); }
+
+		StateSet result;
+		for (const auto& lhs : states)
+		{
+			bool dominated = false;
+			for (const auto& rhs : states)
+			{
+				if (lhs.first == rhs.first) { continue; }
+				const bool le = this->rel[lhs.second * this->num_states + rhs.second];
+				const bool ge = this->rel[rhs.second * this->num_states + lhs.second];
+				if (le && (!ge || rhs.first < lhs.first)) { dominated = true; break; }
+			}
+
+			if (!dominated) { result.insert(result.end(), lhs.first); }
+		}
+
+		return result;
+	} // prune }}}
+}; // Simulation }}}
+
+} // anonymous namespace
+
+
+void Vata2::Nfa::determinize(
+	Nfa*               result,
+	const Nfa&         aut,
+	const StringDict&  params,
+	SubsetMap*         subset_map,
+	State*             last_state_num)
+{ // {{{
+	assert(nullptr != result);
+
+	if (!haskey(params, "algo")) {
+		throw std::runtime_error(std::to_string(__func__) +
+			" requires setting the \"algo\" key in the \"params\" argument; "
+			"received: " + std::to_string(params));
+	}
+
+	const std::string& str_algo = params.at("algo");
+	if ("classical" == str_algo) {
+		determinize(result, aut, subset_map, last_state_num);
+		return;
+	}
+	else if ("simulation" != str_algo) {
+		throw std::runtime_error(std::to_string(__func__) +
+			" received an unknown value of the \"algo\" key: " + str_algo);
+	}
+
+	const Simulation sim(aut);
+
+	SubsetMap local_map;
+	if (nullptr == subset_map) { subset_map = &local_map; }
+
+	// the same as the classical algorithm, but macrostates are pruned before
+	// they are looked up
+	State cnt_state = 0;
+	std::list<std::pair<const StateSet*, State>> worklist;
+
+	*result = Nfa();
+	auto it_bool_pair = subset_map->insert({sim.prune(aut.initialstates), cnt_state});
+	result->initialstates = {cnt_state};
+	worklist.push_back({&it_bool_pair.first->first, cnt_state});
+	++cnt_state;
+
+	while (!worklist.empty())
+	{
+		const StateSet* state_set;
+		State new_state;
+		tie(state_set, new_state) = worklist.front();
+		worklist.pop_front();
+		assert(nullptr != state_set);
+
+		if (!are_disjoint(*state_set, aut.finalstates)) {
+			result->finalstates.insert(new_state);
+		}
+
+		PostSymb post_symb;
+		for (State s : *state_set)
+		{
+			for (const auto& symb_post_pair : aut[s])
+			{
+				const StateSet& post = symb_post_pair.second;
+				post_symb[symb_post_pair.first].insert(post.begin(), post.end());
+			}
+		}
+
+		for (const auto& it : post_symb)
+		{
+			auto it_bool_pair = subset_map->insert({sim.prune(it.second), cnt_state});
+			if (it_bool_pair.second)
+			{ // if not processed yet, add to the queue
+				worklist.push_back({&it_bool_pair.first->first, cnt_state});
+				++cnt_state;
+			}
+
+			result->add_trans(new_state, it.first, it_bool_pair.first->second);
+		}
+	}
+
+	if (nullptr != last_state_num) { *last_state_num = cnt_state - 1; }
+} // determinize(params) }}}
@@ -30,8 +30,6 @@ using namespace Vata2::util;
 using namespace Vata2::Nfa;
 using Vata2::Nfa::Symbol;
 
-const std::string Vata2::Nfa::TYPE_NFA = "NFA";
-
 std::ostream& std::operator<<(std::ostream& os, const Vata2::Nfa::Trans& trans)
 { // {{{
 	std::string result = "(" + std::to_string(trans.src) + ", " +
@@ -198,6 +196,40 @@ size_t Nfa::trans_size() const
 } // trans_size() }}}
 
 
+size_t Nfa::num_states() const
+{ // {{{
+	size_t result = 0;
+	auto upd = [&result](const StateSet& states) {
+		if (!states.empty()) { result = std::max(result, *states.rbegin() + 1); }
+	};
+
+	upd(this->initialstates);
+	upd(this->finalstates);
+	for (const auto& state_post_pair : this->transitions)
+	{
+		result = std::max(result, state_post_pair.first + 1);
+		for (const auto& symb_set_pair : state_post_pair.second) { upd(symb_set_pair.second); }
+	}
+
+	return result;
+} // num_states }}}
+
+
+void Nfa::add_trans_shifted(const Nfa& aut, State offset)
+{ // {{{
+	for (const auto& state_post_pair : aut.transitions)
+	{
+		PostSymb& post = this->transitions[state_post_pair.first + offset];
+		for (const auto& symb_set_pair : state_post_pair.second)
+		{
+			// shifting keeps the order, so hinted insertion is amortized O(1)
+			StateSet& tgts = post[symb_set_pair.first];
+			for (State tgt : symb_set_pair.second) { tgts.insert(tgts.end(), tgt + offset); }
+		}
+	}
+} // add_trans_shifted }}}
+
+
 Nfa::const_iterator Nfa::const_iterator::for_begin(const Nfa* nfa)
 { // {{{
 	assert(nullptr != nfa);
@@ -302,6 +334,70 @@ StateSet Nfa::post(
 } // post }}}
 
 
+void Nfa::post(
+	std::vector<State>*        result,
+	const std::vector<State>&  macrostate,
+	Symbol                     sym,
+	Workspace*                 ws) const
+{ // {{{
+	assert(nullptr != result);
+	assert(nullptr != ws);
+	assert(result != &macrostate);
+
+	result->clear();
+	ws->new_epoch();
+	for (State state : macrostate)
+	{
+		const PostSymb* post_s = this->post(state);
+		if (nullptr == post_s) { continue; }
+
+		auto it = post_s->find(sym);
+		if (post_s->end() == it) { continue; }
+
+		for (State tgt : it->second) {
+			if (ws->visit(tgt)) { result->push_back(tgt); }
+		}
+	}
+} // post(Workspace) }}}
+
+
+void Workspace::new_epoch()
+{ // {{{
+	this->sparse.clear();
+	if (0 == ++this->epoch)
+	{ // the stamps wrapped around
+		std::fill(this->stamps.begin(), this->stamps.end(), 0);
+		this->epoch = 1;
+	}
+} // new_epoch }}}
+
+
+bool Workspace::grow(State state)
+{ // {{{
+	// the arrays grow at most 16 times at once, so that a few large states
+	// do not make them huge
+	const size_t old_size = this->stamps.size();
+	if (state >= WORKSPACE_DENSE_MAX || state >= 16 * (old_size + 1024)) { return false; }
+
+	const size_t size = std::min(std::max<size_t>(state + 1, 2 * old_size),
+		WORKSPACE_DENSE_MAX);
+	this->stamps.resize(size, 0);
+	this->parents.resize(size);
+
+	// states marked in the hash table in this epoch move to the arrays
+	for (auto it = this->sparse.begin(); it != this->sparse.end(); )
+	{
+		if (it->first >= size) { ++it; continue; }
+
+		this->stamps[it->first] = this->epoch;
+		this->parents[it->first] = it->second;
+		it = this->sparse.erase(it);
+	}
+
+	return true;
+} // grow }}}
+
+
 std::ostream& Vata2::Nfa::operator<<(std::ostream& os, const Nfa& nfa)
 { // {{{
 	return os << std::to_string(serialize(nfa));
@@ -367,6 +463,19 @@ void Vata2::Nfa::union_norename(
 } // union_norename }}}
 
 
+Nfa Vata2::Nfa::union_norename(
+	Nfa&&       lhs,
+	const Nfa&  rhs)
+{ // {{{
+	Nfa result = std::move(lhs);
+	result.initialstates.insert(rhs.initialstates.cbegin(), rhs.initialstates.cend());
+	result.finalstates.insert(rhs.finalstates.cbegin(), rhs.finalstates.cend());
+	for (const auto& trans : rhs) { result.add_trans(trans); }
+
+	return result;
+} // union_norename(&&) }}}
+
+
 namespace {
 /// Copies @p src to @p result while peforming a (Haskell-like) map @p f on states
 template <class Func>
@@ -410,17 +519,223 @@ Nfa Vata2::Nfa::union_rename(
 } // union_rename }}}
 
 
+namespace {
+/// adds @p aut with all states increased by @p offset to @p result
+void append_shifted(Nfa* result, const Nfa& aut, State offset)
+{ // {{{
+	assert(nullptr != result);
+
+	for (State st : aut.initialstates) {
+		result->initialstates.insert(result->initialstates.end(), st + offset);
+	}
+	for (State st : aut.finalstates) {
+		result->finalstates.insert(result->finalstates.end(), st + offset);
+	}
+	result->add_trans_shifted(aut, offset);
+} // append_shifted }}}
+
+/// the transitions leaving initial states of @p aut
+std::vector<std::pair<Symbol, State>> get_initial_post(const Nfa& aut)
+{ // {{{
+	std::vector<std::pair<Symbol, State>> result;
+	for (State init : aut.initialstates)
+	{
+		for (const auto& symb_set_pair : aut[init])
+		{
+			for (State tgt : symb_set_pair.second) { result.push_back({symb_set_pair.first, tgt}); }
+		}
+	}
+
+	return result;
+} // get_initial_post }}}
+
+/// concatenates @p rhs with states increased by @p offset to @p lhs in place
+void concatenate_into(Nfa* lhs, const Nfa& rhs, State offset)
+{ // {{{
+	assert(nullptr != lhs);
+
+	lhs->add_trans_shifted(rhs, offset);
+
+	// words of lhs may continue with words of rhs
+	for (const auto& symb_tgt_pair : get_initial_post(rhs))
+	{
+		for (State fin : lhs->finalstates) {
+			lhs->add_trans(fin, symb_tgt_pair.first, symb_tgt_pair.second + offset);
+		}
+	}
+
+	// words of lhs stay accepted only if rhs accepts the empty word
+	if (!accepts_epsilon(rhs)) { lhs->finalstates.clear(); }
+	for (State st : rhs.finalstates) {
+		lhs->finalstates.insert(lhs->finalstates.end(), st + offset);
+	}
+} // concatenate_into }}}
+
+/// makes the language of @p aut L+ in place
+void plus_in_place(Nfa* aut)
+{ // {{{
+	assert(nullptr != aut);
+
+	for (const auto& symb_tgt_pair : get_initial_post(*aut))
+	{
+		for (State fin : aut->finalstates) {
+			aut->add_trans(fin, symb_tgt_pair.first, symb_tgt_pair.second);
+		}
+	}
+} // plus_in_place }}}
+
+/// adds the empty word to the language of @p aut in place
+void optional_in_place(Nfa* aut)
+{ // {{{
+	assert(nullptr != aut);
+
+	if (accepts_epsilon(*aut)) { return; }
+
+	const State eps = aut->num_states();
+	aut->initialstates.insert(eps);
+	aut->finalstates.insert(eps);
+} // optional_in_place }}}
+}
+
+
+void Vata2::Nfa::union_offset(
+	Nfa*                             result,
+	const std::vector<const Nfa*>&  auts)
+{ // {{{
+	assert(nullptr != result);
+
+	Nfa tmp;
+	State offset = 0;
+	for (const Nfa* aut : auts)
+	{
+		assert(nullptr != aut);
+		append_shifted(&tmp, *aut, offset);
+		offset += aut->num_states();
+	}
+
+	*result = std::move(tmp);
+} // union_offset }}}
+
+
+Nfa Vata2::Nfa::union_offset(std::vector<Nfa>&& auts)
+{ // {{{
+	if (auts.empty()) { return Nfa(); }
+
+	Nfa result = std::move(auts.front());
+	State offset = result.num_states();
+	for (auto it = auts.cbegin() + 1; it != auts.cend(); ++it)
+	{
+		append_shifted(&result, *it, offset);
+		offset += it->num_states();
+	}
+
+	auts.clear();
+	return result;
+} // union_offset(&&) }}}
+
+
+void Vata2::Nfa::concatenate(
+	Nfa*        result,
+	const Nfa&  lhs,
+	const Nfa&  rhs)
+{ // {{{
+	assert(nullptr != result);
+
+	Nfa tmp = lhs;
+	concatenate_into(&tmp, rhs, lhs.num_states());
+	*result = std::move(tmp);
+} // concatenate }}}
+
+
+void Vata2::Nfa::concatenate(
+	Nfa*                             result,
+	const std::vector<const Nfa*>&  auts)
+{ // {{{
+	assert(nullptr != result);
+
+	Nfa tmp;
+	tmp.initialstates = {0};
+	tmp.finalstates = {0};
+	State offset = 1;
+	for (const Nfa* aut : auts)
+	{
+		assert(nullptr != aut);
+		concatenate_into(&tmp, *aut, offset);
+		offset += aut->num_states();
+	}
+
+	*result = std::move(tmp);
+} // concatenate(vector) }}}
+
+
+Nfa Vata2::Nfa::concatenate(
+	Nfa&&       lhs,
+	const Nfa&  rhs)
+{ // {{{
+	Nfa result = std::move(lhs);
+	concatenate_into(&result, rhs, result.num_states());
+	return result;
+} // concatenate(&&) }}}
+
+
+void Vata2::Nfa::star(Nfa* result, const Nfa& aut)
+{ // {{{
+	assert(nullptr != result);
+	*result = star(Nfa(aut));
+} // star }}}
+
+
+Nfa Vata2::Nfa::star(Nfa&& aut)
+{ // {{{
+	Nfa result = std::move(aut);
+	plus_in_place(&result);
+	optional_in_place(&result);
+	return result;
+} // star(&&) }}}
+
+
+void Vata2::Nfa::plus(Nfa* result, const Nfa& aut)
+{ // {{{
+	assert(nullptr != result);
+	*result = plus(Nfa(aut));
+} // plus }}}
+
+
+Nfa Vata2::Nfa::plus(Nfa&& aut)
+{ // {{{
+	Nfa result = std::move(aut);
+	plus_in_place(&result);
+	return result;
+} // plus(&&) }}}
+
+
+void Vata2::Nfa::optional(Nfa* result, const Nfa& aut)
+{ // {{{
+	assert(nullptr != result);
+	*result = optional(Nfa(aut));
+} // optional }}}
+
+
+Nfa Vata2::Nfa::optional(Nfa&& aut)
+{ // {{{
+	Nfa result = std::move(aut);
+	optional_in_place(&result);
+	return result;
+} // optional(&&) }}}
+
+
 void Vata2::Nfa::intersection(
 	Nfa*         result,
 	const Nfa&   lhs,
 	const Nfa&   rhs,
 	ProductMap*  prod_map)
 { // {{{
-	bool remove_prod_map = false;
+	// owned here if not given (and released also by Cancelled)
+	std::unique_ptr<ProductMap> own_prod_map = nullptr;
 	if (nullptr == prod_map)
 	{
-		remove_prod_map = true;
-		prod_map = new ProductMap();
+		own_prod_map.reset(new ProductMap());
+		prod_map = own_prod_map.get();
 	}
 
 	// counter for names of new states
@@ -442,6 +757,8 @@ void Vata2::Nfa::intersection(
 
 	while (!worklist.empty())
 	{
+		Vata2::parallel::report_progress(cnt_state - worklist.size(), worklist.size());
+
 		State lhs_st, rhs_st, res_st;
 		tie(lhs_st, rhs_st, res_st) = worklist.front();
 		worklist.pop_front();
@@ -487,44 +804,38 @@ void Vata2::Nfa::intersection(
 			}
 		}
 	}
-
-	if (remove_prod_map)
-	{
-		delete prod_map;
-	}
 } // intersection }}}
 
 
-bool Vata2::Nfa::is_lang_empty(const Nfa& aut, Path* cex)
+bool Vata2::Nfa::is_lang_empty(const Nfa& aut, Path* cex, Workspace* ws)
 { // {{{
-	std::list<State> worklist(
-		aut.initialstates.begin(), aut.initialstates.end());
-	std::unordered_set<State> processed(
-		aut.initialstates.begin(), aut.initialstates.end());
-
-	// 'paths[s] == t' denotes that state 's' was accessed from state 't',
-	// 'paths[s] == s' means that 's' is an initial state
-	std::map<State, State> paths;
-	for (State s : worklist)
-	{	// initialize
-		paths[s] = s;
+	Workspace local_ws;
+	if (nullptr == ws) { ws = &local_ws; }
+
+	// the parent of a state is the state it was accessed from; initial states
+	// are their own parents
+	ws->new_epoch();
+	std::vector<State>& worklist = ws->worklist;
+	worklist.clear();
+	for (State s : aut.initialstates)
+	{
+		ws->visit(s, s);
+		worklist.push_back(s);
 	}
 
-	while (!worklist.empty())
+	for (size_t i = 0; i < worklist.size(); ++i)
 	{
-		State state = worklist.front();
-		worklist.pop_front();
+		State state = worklist[i];
 
 		if (haskey(aut.finalstates, state))
 		{
-			// TODO process the CEX
 			if (nullptr != cex)
 			{
 				cex->clear();
 				cex->push_back(state);
-				while (paths[state] != state)
+				while (ws->get_parent(state) != state)
 				{
-					state = paths[state];
+					state = ws->get_parent(state);
 					cex->push_back(state);
 				}
 
@@ -539,19 +850,7 @@ bool Vata2::Nfa::is_lang_empty(const Nfa& aut, Path* cex)
 			const StateSet& stateset = symb_stateset.second;
 			for (const auto& tgt_state : stateset)
 			{
-				bool inserted;
-				tie(std::ignore, inserted) = processed.insert(tgt_state);
-				if (inserted)
-				{
-					worklist.push_back(tgt_state);
-					// also set that tgt_state was accessed from state
-					paths[tgt_state] = state;
-				}
-				else
-				{
-					// the invariant
-					assert(haskey(paths, tgt_state));
-				}
+				if (ws->visit(tgt_state, state)) { worklist.push_back(tgt_state); }
 			}
 		}
 	}
@@ -560,12 +859,12 @@ bool Vata2::Nfa::is_lang_empty(const Nfa& aut, Path* cex)
 } // is_lang_empty }}}
 
 
-bool Vata2::Nfa::is_lang_empty_cex(const Nfa& aut, Word* cex)
+bool Vata2::Nfa::is_lang_empty_cex(const Nfa& aut, Word* cex, Workspace* ws)
 { // {{{
 	assert(nullptr != cex);
 
 	Path path = { };
-	bool result = is_lang_empty(aut, &path);
+	bool result = is_lang_empty(aut, &path, ws);
 	if (result) { return true; }
 	bool consistent;
 	tie(*cex, consistent) = get_word_for_path(aut, path);
@@ -605,6 +904,33 @@ std::unordered_set<State> Vata2::Nfa::get_fwd_reach_states(const Nfa& aut)
 }
 
 
+void Vata2::Nfa::get_fwd_reach_states(
+	std::vector<State>*  result,
+	const Nfa&           aut,
+	Workspace*           ws)
+{ // {{{
+	assert(nullptr != result);
+
+	Workspace local_ws;
+	if (nullptr == ws) { ws = &local_ws; }
+
+	ws->new_epoch();
+	result->clear();
+	for (State s : aut.initialstates) {
+		if (ws->visit(s)) { result->push_back(s); }
+	}
+
+	for (size_t i = 0; i < result->size(); ++i)
+	{
+		for (const auto& symb_stateset : aut[(*result)[i]]) {
+			for (State tgt_state : symb_stateset.second) {
+				if (ws->visit(tgt_state)) { result->push_back(tgt_state); }
+			}
+		}
+	}
+} // get_fwd_reach_states(Workspace) }}}
+
+
 void Vata2::Nfa::determinize(
 	Nfa*        result,
 	const Nfa&  aut,
@@ -613,11 +939,12 @@ void Vata2::Nfa::determinize(
 { // {{{
 	assert(nullptr != result);
 
-	bool delete_map = false;
+	// owned here if not given (and released also by Cancelled)
+	std::unique_ptr<SubsetMap> own_subset_map = nullptr;
 	if (nullptr == subset_map)
 	{
-		subset_map = new SubsetMap();
-		delete_map = true;
+		own_subset_map.reset(new SubsetMap());
+		subset_map = own_subset_map.get();
 	}
 
 	State cnt_state = 0;
@@ -630,6 +957,8 @@ void Vata2::Nfa::determinize(
 
 	while (!worklist.empty())
 	{
+		Vata2::parallel::report_progress(cnt_state - worklist.size(), worklist.size());
+
 		const StateSet* state_set;
 		State new_state;
 		tie(state_set, new_state) = worklist.front();
@@ -673,11 +1002,6 @@ void Vata2::Nfa::determinize(
 		}
 	}
 
-	if (delete_map)
-	{
-		delete subset_map;
-	}
-
 	if (nullptr != last_state_num)
 	{
 		*last_state_num = cnt_state - 1;
@@ -685,46 +1009,95 @@ void Vata2::Nfa::determinize(
 } // determinize }}}
 
 
+Nfa Vata2::Nfa::determinize(
+	Nfa&&       aut,
+	SubsetMap*  subset_map,
+	State*      last_state_num)
+{ // {{{
+	Nfa result;
+	{ // the input is released before the result is handed over
+		const Nfa input = std::move(aut);
+		determinize(&result, input, subset_map, last_state_num);
+	}
+
+	return result;
+} // determinize(&&) }}}
+
+
+void Vata2::Nfa::get_sorted_symbols(
+	std::vector<Symbol>*  result,
+	const Alphabet&       alphabet)
+{ // {{{
+	assert(nullptr != result);
+
+	const std::list<Symbol> symbs_ls = alphabet.get_symbols();
+	result->assign(symbs_ls.begin(), symbs_ls.end());
+	std::sort(result->begin(), result->end());
+	result->erase(std::unique(result->begin(), result->end()), result->end());
+} // get_sorted_symbols }}}
+
+
 void Vata2::Nfa::make_complete(
 	Nfa*             aut,
 	const Alphabet&  alphabet,
-	State            sink_state)
+	State            sink_state,
+	Workspace*       ws)
+{ // {{{
+	Workspace local_ws;
+	if (nullptr == ws) { ws = &local_ws; }
+
+	get_sorted_symbols(&ws->symbols, alphabet);
+	make_complete(aut, ws->symbols, sink_state, ws);
+} // make_complete }}}
+
+
+void Vata2::Nfa::make_complete(
+	Nfa*                        aut,
+	const std::vector<Symbol>&  symbols,
+	State                       sink_state,
+	Workspace*                  ws)
 { // {{{
 	assert(nullptr != aut);
+	assert(std::is_sorted(symbols.begin(), symbols.end()));
 
-	std::list<State> worklist(aut->initialstates.begin(),
-		aut->initialstates.end());
-	std::unordered_set<State> processed(aut->initialstates.begin(),
-		aut->initialstates.end());
-	worklist.push_back(sink_state);
-	processed.insert(sink_state);
+	Workspace local_ws;
+	if (nullptr == ws) { ws = &local_ws; }
 
-	while (!worklist.empty())
+	ws->new_epoch();
+	std::vector<State>& worklist = ws->worklist;
+	worklist.clear();
+	for (State s : aut->initialstates) {
+		if (ws->visit(s)) { worklist.push_back(s); }
+	}
+	if (ws->visit(sink_state)) { worklist.push_back(sink_state); }
+
+	for (size_t i = 0; i < worklist.size(); ++i)
 	{
-		State state = *worklist.begin();
-		worklist.pop_front();
+		const State state = worklist[i];
 
-		std::set<Symbol> used_symbols;
-		for (const auto& symb_stateset : (*aut)[state])
+		const PostSymb* post_s = aut->post(state);
+		if (nullptr != post_s)
 		{
-			used_symbols.insert(symb_stateset.first);
-
-			const StateSet& stateset = symb_stateset.second;
-			for (const auto& tgt_state : stateset)
+			for (const auto& symb_stateset : *post_s)
 			{
-				bool inserted;
-				tie(std::ignore, inserted) = processed.insert(tgt_state);
-				if (inserted) { worklist.push_back(tgt_state); }
+				const StateSet& stateset = symb_stateset.second;
+				for (const auto& tgt_state : stateset)
+				{
+					if (ws->visit(tgt_state)) { worklist.push_back(tgt_state); }
+				}
 			}
 		}
 
-		auto unused_symbols = alphabet.get_complement(used_symbols);
-		for (Symbol symb : unused_symbols)
+		for (Symbol symb : symbols)
 		{
-			aut->add_trans(state, symb, sink_state);
+			if (nullptr == post_s || !haskey(*post_s, symb))
+			{ // adding a transition may rehash the post, so it is looked up again
+				aut->add_trans(state, symb, sink_state);
+				post_s = aut->post(state);
+			}
 		}
 	}
-} // make_complete }}}
+} // make_complete(symbols) }}}
 
 
 Vata2::Parser::ParsedSection Vata2::Nfa::serialize(
@@ -863,6 +1236,23 @@ void Vata2::Nfa::revert(Nfa* result, const Nfa& aut)
 } // revert }}}
 
 
+Nfa Vata2::Nfa::revert(Nfa&& aut)
+{ // {{{
+	StateToPostMap transitions = aut.release_transitions();
+	Nfa result = std::move(aut);
+	std::swap(result.initialstates, result.finalstates);
+
+	for (auto it = transitions.begin(); transitions.end() != it; it = transitions.erase(it))
+	{
+		for (const auto& symb_set : it->second) {
+			for (State tgt : symb_set.second) { result.add_trans(tgt, symb_set.first, it->first); }
+		}
+	}
+
+	return result;
+} // revert(&&) }}}
+
+
 void Vata2::Nfa::remove_epsilon(Nfa* result, const Nfa& aut, Symbol epsilon)
 { // {{{
 	assert(nullptr != result);
@@ -923,18 +1313,26 @@ void Vata2::Nfa::minimize(
 { // {{{
 	assert(nullptr != result);
 
+	*result = minimize(Nfa(aut), params);
+} // minimize }}}
+
+
+Nfa Vata2::Nfa::minimize(
+	Nfa&&              aut,
+	const StringDict&  params)
+{ // {{{
 	DEBUG_PRINT("ignoring parameters of minimization and using default");
 	assert(&params);
 
 	// TODO: remove useless states before we start doing anything
 
 	// TODO: make controllable using 'params', so far using Brzozowski's
-	// minimization (revert, determinize, revert, determinize)
-	Nfa tmp = revert(aut);
-	tmp = determinize(tmp);
-	tmp = revert(tmp);
-	*result = determinize(tmp);
-} // minimize }}}
+	// minimization (revert, determinize, revert, determinize); every step
+	// consumes the previous automaton
+	Nfa tmp = determinize(revert(std::move(aut)));
+	tmp = revert(std::move(tmp));
+	return determinize(std::move(tmp));
+} // minimize(&&) }}}
 
 
 void Vata2::Nfa::construct(
@@ -1057,32 +1455,57 @@ void Vata2::Nfa::construct(
 } // construct(StringToSymbolMap) }}}
 
 
-bool Vata2::Nfa::is_in_lang(const Nfa& aut, const Word& word)
+namespace {
+/// does @p macrostate contain a final state of @p aut?
+bool has_final(const Nfa& aut, const std::vector<State>& macrostate)
+{ // {{{
+	for (State st : macrostate) {
+		if (aut.has_final(st)) { return true; }
+	}
+
+	return false;
+} // has_final }}}
+}
+
+
+bool Vata2::Nfa::is_in_lang(const Nfa& aut, const Word& word, Workspace* ws)
 { // {{{
-	StateSet cur = aut.initialstates;
+	Workspace local_ws;
+	if (nullptr == ws) { ws = &local_ws; }
+
+	std::vector<State>& cur = ws->macrostate;
+	std::vector<State>& next = ws->next_macrostate;
+	cur.assign(aut.initialstates.begin(), aut.initialstates.end());
 
 	for (Symbol sym : word)
 	{
-		cur = aut.post(cur, sym);
-		if (cur.empty()) { return false; }
+		aut.post(&next, cur, sym, ws);
+		if (next.empty()) { return false; }
+		std::swap(cur, next);
 	}
 
-	return !are_disjoint(cur, aut.finalstates);
+	return has_final(aut, cur);
 } // is_in_lang }}}
 
 
-bool Vata2::Nfa::is_prfx_in_lang(const Nfa& aut, const Word& word)
+bool Vata2::Nfa::is_prfx_in_lang(const Nfa& aut, const Word& word, Workspace* ws)
 { // {{{
-	StateSet cur = aut.initialstates;
+	Workspace local_ws;
+	if (nullptr == ws) { ws = &local_ws; }
+
+	std::vector<State>& cur = ws->macrostate;
+	std::vector<State>& next = ws->next_macrostate;
+	cur.assign(aut.initialstates.begin(), aut.initialstates.end());
 
 	for (Symbol sym : word)
 	{
-	  if (!are_disjoint(cur, aut.finalstates)) { return true; }
-		cur = aut.post(cur, sym);
-		if (cur.empty()) { return false; }
+		if (has_final(aut, cur)) { return true; }
+		aut.post(&next, cur, sym, ws);
+		if (next.empty()) { return false; }
+		std::swap(cur, next);
 	}
 
-	return !are_disjoint(cur, aut.finalstates);
+	return has_final(aut, cur);
 } // is_prfx_in_lang }}}
 
 
@@ -1100,28 +1523,47 @@ bool Vata2::Nfa::is_deterministic(const Nfa& aut)
 } // is_deterministic }}}
 
 
-bool Vata2::Nfa::is_complete(const Nfa& aut, const Alphabet& alphabet)
+bool Vata2::Nfa::is_complete(
+	const Nfa&       aut,
+	const Alphabet&  alphabet,
+	Workspace*       ws)
+{ // {{{
+	Workspace local_ws;
+	if (nullptr == ws) { ws = &local_ws; }
+
+	get_sorted_symbols(&ws->symbols, alphabet);
+	return is_complete(aut, ws->symbols, ws);
+} // is_complete }}}
+
+
+bool Vata2::Nfa::is_complete(
+	const Nfa&                  aut,
+	const std::vector<Symbol>&  symbs,
+	Workspace*                  ws)
 { // {{{
-	std::list<Symbol> symbs_ls = alphabet.get_symbols();
-	std::unordered_set<Symbol> symbs(symbs_ls.cbegin(), symbs_ls.cend());
+	assert(std::is_sorted(symbs.begin(), symbs.end()));
+
+	Workspace local_ws;
+	if (nullptr == ws) { ws = &local_ws; }
 
 	// TODO: make a general function for traversal over reachable states that can
 	// be shared by other functions?
-	std::list<State> worklist(aut.initialstates.begin(),
-		aut.initialstates.end());
-	std::unordered_set<State> processed(aut.initialstates.begin(),
-		aut.initialstates.end());
+	ws->new_epoch();
+	std::vector<State>& worklist = ws->worklist;
+	worklist.clear();
+	for (State s : aut.initialstates) {
+		if (ws->visit(s)) { worklist.push_back(s); }
+	}
 
-	while (!worklist.empty())
+	for (size_t i = 0; i < worklist.size(); ++i)
 	{
-		State state = *worklist.begin();
-		worklist.pop_front();
+		const State state = worklist[i];
 
 		size_t n = 0;      // counter of symbols
 		for (const auto& symb_stateset : aut[state])
 		{
 			++n;
-			if (!haskey(symbs, symb_stateset.first))
+			if (!std::binary_search(symbs.begin(), symbs.end(), symb_stateset.first))
 			{
 				throw std::runtime_error(std::to_string(__func__) +
 					": encountered a symbol that is not in the provided alphabet");
@@ -1130,9 +1572,7 @@ bool Vata2::Nfa::is_complete(const Nfa& aut, const Alphabet& alphabet)
 			const StateSet& stateset = symb_stateset.second;
 			for (const auto& tgt_state : stateset)
 			{
-				bool inserted;
-				tie(std::ignore, inserted) = processed.insert(tgt_state);
-				if (inserted) { worklist.push_back(tgt_state); }
+				if (ws->visit(tgt_state)) { worklist.push_back(tgt_state); }
 			}
 		}
 
@@ -1140,7 +1580,7 @@ bool Vata2::Nfa::is_complete(const Nfa& aut, const Alphabet& alphabet)
 	}
 
 	return true;
-} // is_complete }}}
+} // is_complete(symbols) }}}
 
 bool Vata2::Nfa::accepts_epsilon(const Nfa& aut)
 { // {{{
@@ -60,6 +60,18 @@ TEST_CASE("Vata2::VM::find_dispatcher(\"NFA\")")
 			Catch::Contains("invalid type"));
 	}
 
+	SECTION("regex")
+	{
+		std::string pattern = "ab*";
+		VMValue res = find_dispatcher(Vata2::TYPE_STR)("regex", {{Vata2::TYPE_STR, &pattern}});
+		REQUIRE(Vata2::Nfa::TYPE_NFA == res.type);
+		const NfaWrapper* wrap = static_cast<const NfaWrapper*>(res.get_ptr());
+		REQUIRE(is_in_lang(wrap->nfa, {'a', 'b', 'b'}));
+		REQUIRE(!is_in_lang(wrap->nfa, {'b'}));
+		delete wrap->alphabet;
+		delete wrap;
+	}
+
 	SECTION("aux")
 	{
 		WARN_PRINT("Insufficient testing of Vata2::VM::find_dispatcher(\"NFA\")");
@@ -274,6 +274,106 @@ TEST_CASE("Vata2::Nfa::union_norename()")
 } // }}}
 
 
+TEST_CASE("Vata2::Nfa::union_offset()/concatenate()/star()/plus()/optional()")
+{ // {{{
+	auto word = [](const std::string& str) {
+		Word result;
+		for (unsigned char chr : str) { result.push_back(chr); }
+		return result;
+	};
+
+	// checks that @p aut accepts the same words over {a, b, c} of length at
+	// most 6 as @p pattern
+	auto same_lang = [&word](const Nfa& aut, const std::string& pattern) {
+		Nfa expected = compile_regex(pattern);
+		std::vector<std::string> words = {""};
+		for (size_t i = 0; i < words.size(); ++i)
+		{
+			if (!is_in_lang(aut, word(words[i])) != !is_in_lang(expected, word(words[i]))) {
+				return false;
+			}
+			if (words[i].size() < 6) {
+				for (char chr : {'a', 'b', 'c'}) { words.push_back(words[i] + chr); }
+			}
+		}
+
+		return true;
+	};
+
+	const Nfa a = compile_regex("a"), ab = compile_regex("ab|b*"), c = compile_regex("c+");
+
+	SECTION("num_states()")
+	{
+		Nfa aut;
+		REQUIRE(aut.num_states() == 0);
+		aut.initialstates = {3};
+		REQUIRE(aut.num_states() == 4);
+		aut.add_trans(2, 'a', 7);
+		REQUIRE(aut.num_states() == 8);
+		aut.finalstates = {9};
+		REQUIRE(aut.num_states() == 10);
+	}
+
+	SECTION("union_offset()")
+	{
+		Nfa res = union_offset({&a, &ab, &c});
+		REQUIRE(res.initialstates ==
+			StateSet({0, a.num_states(), a.num_states() + ab.num_states()}));
+		REQUIRE(res.num_states() == a.num_states() + ab.num_states() + c.num_states());
+		REQUIRE(same_lang(res, "a|ab|b*|c+"));
+
+		REQUIRE(same_lang(union_offset(std::vector<Nfa>{a, ab, c}), "a|ab|b*|c+"));
+		REQUIRE(union_offset(std::vector<const Nfa*>{}).trans_empty());
+	}
+
+	SECTION("concatenate()")
+	{
+		REQUIRE(same_lang(concatenate(a, ab), "a(ab|b*)"));
+		REQUIRE(same_lang(concatenate(ab, a), "(ab|b*)a"));
+		REQUIRE(same_lang(concatenate(ab, ab), "(ab|b*)(ab|b*)"));
+		REQUIRE(same_lang(concatenate(concatenate(Nfa(c), a), c), "c+ac+"));
+		REQUIRE(is_lang_empty(concatenate(a, Nfa())));
+
+		Nfa res;
+		concatenate(&res, ab, c);
+		REQUIRE(same_lang(res, "(ab|b*)c+"));
+	}
+
+	SECTION("star()/plus()/optional()")
+	{
+		REQUIRE(same_lang(star(concatenate(a, ab)), "(a(ab|b*))*"));
+		REQUIRE(same_lang(star(ab), "(ab|b*)*"));
+		REQUIRE(same_lang(plus(concatenate(ab, c)), "((ab|b*)c+)+"));
+		REQUIRE(same_lang(optional(concatenate(a, c)), "(ac+)?"));
+		REQUIRE(same_lang(star(Nfa()), ""));
+
+		Nfa res;
+		plus(&res, a);
+		REQUIRE(same_lang(res, "a+"));
+		optional(&res, a);
+		REQUIRE(same_lang(res, "a?"));
+		star(&res, a);
+		REQUIRE(same_lang(res, "a*"));
+		REQUIRE(optional(ab).num_states() == ab.num_states());
+	}
+
+	SECTION("concatenate() of a list")
+	{
+		REQUIRE(same_lang(concatenate({&a, &ab, &c, &ab}), "a(ab|b*)c+(ab|b*)"));
+		REQUIRE(same_lang(concatenate(std::vector<const Nfa*>{}), ""));
+
+		// the offsets are accumulated, so this is linear
+		const Nfa abc = compile_regex("ab|c");
+		std::vector<const Nfa*> auts(10000, &abc);
+		Nfa res = concatenate(auts);
+		std::string long_word;
+		for (size_t i = 0; i < 5000; ++i) { long_word += "abc"; }
+		REQUIRE(is_in_lang(res, word(long_word)));
+		REQUIRE(!is_in_lang(res, word(long_word + "c")));
+	}
+} // }}}
+
+
 TEST_CASE("Vata2::Nfa::intersection()")
 { // {{{
 	Nfa a, b, res;
@@ -618,6 +718,71 @@ TEST_CASE("Vata2::Nfa::determinize()")
 	}
 } // }}}
 
+TEST_CASE("Vata2::Nfa::determinize() up to simulation")
+{ // {{{
+	auto word = [](const std::string& str) {
+		Word result;
+		for (unsigned char chr : str) { result.push_back(chr); }
+		return result;
+	};
+
+	auto same_lang = [&word](const Nfa& lhs, const Nfa& rhs) {
+		std::vector<std::string> words = {""};
+		for (size_t i = 0; i < words.size(); ++i)
+		{
+			if (is_in_lang(lhs, word(words[i])) != is_in_lang(rhs, word(words[i]))) { return false; }
+			if (words[i].size() < 8) {
+				for (char chr : {'a', 'b'}) { words.push_back(words[i] + chr); }
+			}
+		}
+
+		return true;
+	};
+
+	const StringDict sim = {{"algo", "simulation"}};
+
+	SECTION("simulated states are pruned")
+	{
+		// the initial state of the second automaton is simulated by the
+		// initial state of the first one
+		const Nfa first = compile_regex("(a|b)*a(a|b){4}");
+		const Nfa second = compile_regex("a(a|b){4}");
+		const Nfa aut = union_offset(std::vector<const Nfa*>{&first, &second});
+
+		SubsetMap subset_map;
+		const Nfa result = determinize(aut, sim, &subset_map);
+		REQUIRE(is_deterministic(result));
+		REQUIRE(same_lang(result, aut));
+		REQUIRE(result.num_states() == determinize(first).num_states());
+		REQUIRE(result.num_states() < determinize(aut).num_states());
+		REQUIRE(haskey(subset_map, first.initialstates));
+	}
+
+	SECTION("the language is kept")
+	{
+		for (const char* pattern : {"", "a*", "(a|ab)*b", "(a*b|ab*)*a", "a(a|b)*|(a|b)*b",
+			"(aa|ab|b)*(a|b)?"})
+		{
+			const Nfa aut = compile_regex(pattern);
+			const Nfa result = determinize(aut, sim);
+			INFO(pattern);
+			REQUIRE(is_deterministic(result));
+			REQUIRE(same_lang(result, aut));
+			REQUIRE(result.num_states() <= determinize(aut).num_states());
+		}
+
+		REQUIRE(determinize(Nfa(), sim).finalstates.empty());
+	}
+
+	SECTION("invalid parameters")
+	{
+		CHECK_THROWS_WITH(determinize(Nfa(), StringDict()),
+			Catch::Contains("requires setting the \"algo\" key"));
+		CHECK_THROWS_WITH(determinize(Nfa(), {{"algo", "foo"}}), Catch::Contains("unknown value"));
+		REQUIRE(determinize(Nfa(), {{"algo", "classical"}}).initialstates.size() == 1);
+	}
+} // }}}
+
 TEST_CASE("Vata2::Nfa::construct() correct calls")
 { // {{{
 	Nfa aut;
@@ -1493,6 +1658,348 @@ TEST_CASE("Vata2::Nfa::revert()")
 		REQUIRE(result.has_trans(2, 'b', 3));
 		REQUIRE(result.has_trans(8, 'a', 7));
 		REQUIRE(result.initialstates == StateSet({3}));
+
+		SECTION("in place")
+		{
+			Nfa copy = aut;
+			Nfa in_place = revert(std::move(copy));
+			REQUIRE(copy.trans_empty());
+			REQUIRE(in_place.initialstates == result.initialstates);
+			REQUIRE(in_place.finalstates == result.finalstates);
+			REQUIRE(in_place.trans_size() == result.trans_size());
+			for (const Trans& trans : result) { REQUIRE(in_place.has_trans(trans)); }
+		}
+	}
+} // }}}
+
+
+TEST_CASE("Vata2::Nfa operations consuming their input")
+{ // {{{
+	auto same = [](const Nfa& lhs, const Nfa& rhs) {
+		std::unordered_set<Trans> lhs_trans;
+		for (const Trans& trans : lhs) { lhs_trans.insert(trans); }
+		std::unordered_set<Trans> rhs_trans;
+		for (const Trans& trans : rhs) { rhs_trans.insert(trans); }
+
+		return lhs.initialstates == rhs.initialstates &&
+			lhs.finalstates == rhs.finalstates && lhs_trans == rhs_trans;
+	};
+
+	Nfa aut_a;
+	FILL_WITH_AUT_A(aut_a);
+	Nfa aut_b;
+	FILL_WITH_AUT_B(aut_b);
+
+	SECTION("determinize()")
+	{
+		SubsetMap subset_map;
+		State last_state;
+		const Nfa expected = determinize(aut_a);
+		REQUIRE(same(determinize(Nfa(aut_a), &subset_map, &last_state), expected));
+		REQUIRE(subset_map.size() == last_state + 1);
+	}
+
+	SECTION("minimize()")
+	{
+		const Nfa aut = compile_regex("(a|b)*a(a|b){3}");
+		REQUIRE(same(minimize(Nfa(aut)), minimize(aut)));
+		REQUIRE(minimize(Nfa(aut)).num_states() == 16);
+	}
+
+	SECTION("union_norename()")
+	{
+		Nfa aut_c;
+		aut_c.initialstates = {100};
+		aut_c.finalstates = {101};
+		aut_c.add_trans(100, 'a', 101);
+
+		REQUIRE(same(union_norename(Nfa(aut_a), aut_c), union_norename(aut_a, aut_c)));
+	}
+} // }}}
+
+TEST_CASE("Vata2::Nfa::trim()/reduce()")
+{ // {{{
+	Nfa aut;
+
+	// all words over {a, b, c} up to length 5
+	std::vector<Word> words = { { } };
+	for (size_t i = 0; i < words.size(); ++i) {
+		if (words[i].size() == 5) { continue; }
+		for (Symbol symb : {'a', 'b', 'c'}) {
+			words.push_back(words[i]);
+			words.back().push_back(symb);
+		}
+	}
+
+	SECTION("trim() removes useless states")
+	{
+		FILL_WITH_AUT_A(aut);
+		aut.add_trans(11, 'a', 5);
+
+		Nfa result = trim(aut);
+		REQUIRE(result.trans_size() == aut.trans_size() - 4);
+		REQUIRE(!result.has_trans(3, 'b', 9));
+		REQUIRE(!result.has_trans(11, 'a', 5));
+		REQUIRE(result.has_trans(10, 'c', 7));
+		for (const Word& word : words) {
+			REQUIRE(is_in_lang(result, word) == is_in_lang(aut, word));
+		}
+	}
+
+	SECTION("reduce() preserves the language")
+	{
+		FILL_WITH_AUT_B(aut);
+
+		Nfa result = reduce(aut);
+		REQUIRE(get_fwd_reach_states(result).size() < get_fwd_reach_states(aut).size());
+		for (const Word& word : words) {
+			REQUIRE(is_in_lang(result, word) == is_in_lang(aut, word));
+		}
+	}
+
+	SECTION("reduce() merges bisimilar states")
+	{
+		aut.initialstates = {1};
+		aut.finalstates = {4, 5};
+		aut.add_trans(1, 'a', 2);
+		aut.add_trans(1, 'a', 3);
+		aut.add_trans(2, 'b', 4);
+		aut.add_trans(3, 'b', 5);
+
+		Nfa result = reduce(aut);
+		REQUIRE(result.trans_size() == 2);
+		REQUIRE(result.finalstates.size() == 1);
+	}
+
+	SECTION("reduce() up to a depth over-approximates the language")
+	{
+		// a^3
+		aut.initialstates = {1};
+		aut.finalstates = {4};
+		aut.add_trans(1, 'a', 2);
+		aut.add_trans(2, 'a', 3);
+		aut.add_trans(3, 'a', 4);
+
+		Nfa result = reduce(aut, {{"algo", "bisim"}, {"depth", "1"}});
+		REQUIRE(is_in_lang(result, Word(3, 'a')));
+		REQUIRE(is_in_lang(result, Word(5, 'a')));
+		REQUIRE(!is_in_lang(result, Word(1, 'a')));
+
+		REQUIRE(reduce(aut, {{"algo", "bisim"}, {"depth", "3"}}).trans_size() == 3);
+	}
+
+	SECTION("invalid parameters")
+	{
+		CHECK_THROWS_WITH(reduce(aut, {{"algo", "foo"}}),
+			Catch::Contains("unknown value"));
+		CHECK_THROWS_WITH(reduce(aut, {}),
+			Catch::Contains("requires setting the \"algo\" key"));
+	}
+} // }}}
+
+
+TEST_CASE("Vata2::Nfa::canonical_rfsa()")
+{ // {{{
+	auto word = [](const std::string& str) {
+		Word result;
+		for (unsigned char chr : str) { result.push_back(chr); }
+		return result;
+	};
+
+	auto same_lang = [&word](const Nfa& lhs, const Nfa& rhs) {
+		std::vector<std::string> words = {""};
+		for (size_t i = 0; i < words.size(); ++i)
+		{
+			if (is_in_lang(lhs, word(words[i])) != is_in_lang(rhs, word(words[i]))) { return false; }
+			if (words[i].size() < 7) {
+				for (char chr : {'a', 'b'}) { words.push_back(words[i] + chr); }
+			}
+		}
+
+		return true;
+	};
+
+	auto same_aut = [](const Nfa& lhs, const Nfa& rhs) {
+		if (lhs.initialstates != rhs.initialstates || lhs.finalstates != rhs.finalstates ||
+			lhs.trans_size() != rhs.trans_size())
+		{
+			return false;
+		}
+
+		for (const Trans& trans : lhs) {
+			if (!rhs.has_trans(trans)) { return false; }
+		}
+
+		return true;
+	};
+
+	const StringDict dfa = {{"algo", "dfa"}};
+	const StringDict double_rev = {{"algo", "double-reversal"}};
+
+	SECTION("smaller than the minimal DFA")
+	{
+		// the minimal DFA of (a|b)*a(a|b){3} has 16 states
+		const Nfa aut = compile_regex("(a|b)*a(a|b){3}");
+		REQUIRE(minimize(aut).num_states() == 16);
+
+		for (const StringDict& params : {dfa, double_rev})
+		{
+			const Nfa rfsa = canonical_rfsa(aut, params);
+			REQUIRE(rfsa.num_states() == 5);
+			REQUIRE(same_lang(rfsa, aut));
+		}
+	}
+
+	SECTION("canonical form")
+	{
+		const std::vector<std::string> patterns = {"(a|b)*a(a|b)", "(a|b)*(aa|ab)",
+			"(b|a+b)*a+(a|b)", "b*a(b*a)*(a|b)"};
+		const Nfa expected = canonical_rfsa(compile_regex(patterns.front()), dfa);
+		for (const std::string& pattern : patterns)
+		{
+			const Nfa aut = compile_regex(pattern);
+			INFO(pattern);
+			REQUIRE(same_aut(canonical_rfsa(aut, dfa), expected));
+			REQUIRE(same_aut(canonical_rfsa(aut, double_rev), expected));
+			REQUIRE(same_aut(canonical_rfsa(minimize(aut)), expected));
+			REQUIRE(same_aut(canonical_rfsa(revert(revert(aut))), expected));
+		}
+	}
+
+	SECTION("various languages")
+	{
+		for (const char* pattern : {"", "a", "(ab|b)*a?", "a*b*|b*a*", "(a(a|b)b|ba*)*",
+			"((a|b)(a|b))*a"})
+		{
+			const Nfa aut = compile_regex(pattern);
+			const Nfa rfsa = canonical_rfsa(aut, dfa);
+			INFO(pattern);
+			REQUIRE(same_lang(rfsa, aut));
+			REQUIRE(same_aut(rfsa, canonical_rfsa(aut, double_rev)));
+			REQUIRE(rfsa.num_states() <= minimize(aut).num_states());
+		}
+
+		REQUIRE(canonical_rfsa(Nfa(), dfa).num_states() == 0);
+		REQUIRE(canonical_rfsa(Nfa(), double_rev).num_states() == 0);
+	}
+
+	SECTION("invalid parameters")
+	{
+		CHECK_THROWS_WITH(canonical_rfsa(Nfa(), {}), Catch::Contains("requires setting"));
+		CHECK_THROWS_WITH(canonical_rfsa(Nfa(), {{"algo", "foo"}}),
+			Catch::Contains("unknown value"));
+	}
+} // }}}
+
+TEST_CASE("Vata2::Nfa::compile_regex()")
+{ // {{{
+	auto word = [](const std::string& str) {
+		Word result;
+		for (unsigned char chr : str) { result.push_back(chr); }
+		return result;
+	};
+
+	auto matches = [&word](const Nfa& aut, const std::string& str) {
+		return is_in_lang(aut, word(str));
+	};
+
+	SECTION("basic operators")
+	{
+		Nfa aut = compile_regex("a(b|cd)*e?");
+		REQUIRE(aut.initialstates == StateSet({0}));
+		REQUIRE(matches(aut, "a"));
+		REQUIRE(matches(aut, "abcdbe"));
+		REQUIRE(matches(aut, "ae"));
+		REQUIRE(!matches(aut, ""));
+		REQUIRE(!matches(aut, "ac"));
+		REQUIRE(!matches(aut, "aee"));
+
+		// one state per position, no epsilon transitions
+		REQUIRE(get_fwd_reach_states(aut).size() == 6);
+		REQUIRE(matches(compile_regex(""), ""));
+		REQUIRE(matches(compile_regex("(a|)+"), ""));
+		REQUIRE(matches(compile_regex("^(?:ab)+$"), "abab"));
+	}
+
+	SECTION("byte classes")
+	{
+		Nfa aut = compile_regex("[a-c_][^a-z]\\d[[:upper:]x]\\x41.");
+		REQUIRE(matches(aut, "b_0xA\n"));
+		REQUIRE(matches(aut, "_Z9QA\xff"));
+		REQUIRE(!matches(aut, "dZ9QA."));
+		REQUIRE(!matches(aut, "aa9QA."));
+		REQUIRE(!matches(aut, "aZaQA."));
+		REQUIRE(!matches(aut, "aZ9qA."));
+
+		REQUIRE(matches(compile_regex("[]a-]+"), "]-a"));
+		REQUIRE(matches(compile_regex("\\w\\s\\W\\S"), "_ .."));
+		REQUIRE(matches(compile_regex("\\.\\*\\["), ".*["));
+		REQUIRE(!matches(compile_regex("\\."), "a"));
+	}
+
+	SECTION("bounded repetition")
+	{
+		Nfa aut = compile_regex("(ab){2,3}c{2}d{1,}");
+		REQUIRE(matches(aut, "ababccd"));
+		REQUIRE(matches(aut, "abababccddd"));
+		REQUIRE(!matches(aut, "abccd"));
+		REQUIRE(!matches(aut, "ababababccd"));
+		REQUIRE(!matches(aut, "ababcd"));
+		REQUIRE(!matches(aut, "ababcc"));
+
+		REQUIRE(matches(compile_regex("a{0}b"), "b"));
+		REQUIRE(matches(compile_regex("a{,2}"), "a{,2}"));    // not a bound
+		REQUIRE(!matches(compile_regex("a{0,2}?"), "aaa"));
+	}
+
+	SECTION("search")
+	{
+		Nfa aut = compile_regex("GET /[a-z]+", {{"match", "search"}});
+		REQUIRE(matches(aut, "xx GET /index yy"));
+		REQUIRE(!matches(aut, "xx GET / yy"));
+
+		// anchors
+		aut = compile_regex("^GET ", {{"match", "search"}});
+		REQUIRE(matches(aut, "GET /index"));
+		REQUIRE(!matches(aut, "xx GET /index"));
+		aut = compile_regex("foo$", {{"match", "search"}});
+		REQUIRE(matches(aut, "barfoo"));
+		REQUIRE(!matches(aut, "foobar"));
+		aut = compile_regex("^a*$", {{"match", "search"}});
+		REQUIRE(matches(aut, "aaa"));
+		REQUIRE(!matches(aut, "aba"));
+		REQUIRE(matches(compile_regex("^b?", {{"match", "search"}}), "ab"));
+		REQUIRE(matches(compile_regex("b?$", {{"match", "search"}}), "ba"));
+		CHECK_THROWS_WITH(compile_regex("^a|b", {{"match", "search"}}),
+			Catch::Contains("anchors of a single alternative"));
+	}
+
+	SECTION("equivalent expressions give equivalent automata")
+	{
+		Nfa aut = compile_regex("(a|ab)(c|bcd)(d*)");
+		Nfa other = compile_regex("ab?cd*|abbcd+");
+		Nfa smaller = compile_regex("ab?cd*");
+		CharAlphabet alph;
+		REQUIRE(is_incl(aut, other, alph));
+		REQUIRE(is_incl(other, aut, alph));
+		REQUIRE(is_incl(smaller, aut, alph));
+		REQUIRE(!is_incl(aut, smaller, alph));
+	}
+
+	SECTION("invalid expressions")
+	{
+		CHECK_THROWS_WITH(compile_regex("a(b"), Catch::Contains("missing )"));
+		CHECK_THROWS_WITH(compile_regex("ab)"), Catch::Contains("unmatched )"));
+		CHECK_THROWS_WITH(compile_regex("*a"), Catch::Contains("nothing to repeat"));
+		CHECK_THROWS_WITH(compile_regex("[a-"), Catch::Contains("unterminated"));
+		CHECK_THROWS_WITH(compile_regex("[z-a]"), Catch::Contains("invalid range"));
+		CHECK_THROWS_WITH(compile_regex("a{3,2}"), Catch::Contains("invalid bounds"));
+		CHECK_THROWS_WITH(compile_regex("a{1001}"), Catch::Contains("too large"));
+		CHECK_THROWS_WITH(compile_regex("a\\b"), Catch::Contains("unsupported escape"));
+		CHECK_THROWS_WITH(compile_regex("a^b"), Catch::Contains("anchors"));
+		CHECK_THROWS_WITH(compile_regex("[[:foo:]]"), Catch::Contains("unknown"));
+		CHECK_THROWS_WITH(compile_regex("a", {{"match", "foo"}}),
+			Catch::Contains("unknown value"));
 	}
 } // }}}
 
@@ -1702,3 +2209,470 @@ TEST_CASE("Vata2::Nfa::is_prfx_in_lang()")
 		REQUIRE(!is_prfx_in_lang(aut, w));
 	}
 } // }}}
+
+
+TEST_CASE("Vata2::Nfa::Workspace")
+{ // {{{
+	Workspace ws;
+
+	SECTION("operations give the same results with a reused workspace")
+	{
+		Nfa aut_a;
+		FILL_WITH_AUT_A(aut_a);
+		Nfa aut_b;
+		FILL_WITH_AUT_B(aut_b);
+		const std::vector<Word> words = {{ }, {'a'}, {'a', 'a'}, {'b', 'a'},
+			{'c', 'b', 'a', 'a'}, {'a', 'a', 'a', 'a'}, {'a', 'b', 'a', 'a', 'c'}};
+
+		for (size_t round = 0; round < 3; ++round) {
+			for (const Nfa* aut : {&aut_a, &aut_b})
+			{
+				Path cex;
+				Path cex_ws;
+				REQUIRE(is_lang_empty(*aut, &cex) == is_lang_empty(*aut, &cex_ws, &ws));
+				REQUIRE(cex == cex_ws);
+
+				std::vector<State> reach;
+				get_fwd_reach_states(&reach, *aut, &ws);
+				const std::unordered_set<State> reach_set(reach.begin(), reach.end());
+				REQUIRE(reach_set.size() == reach.size());
+				REQUIRE(reach_set == get_fwd_reach_states(*aut));
+
+				for (const Word& word : words)
+				{
+					REQUIRE(is_in_lang(*aut, word) == is_in_lang(*aut, word, &ws));
+					REQUIRE(is_prfx_in_lang(*aut, word) == is_prfx_in_lang(*aut, word, &ws));
+				}
+
+				CharAlphabet alph;
+				REQUIRE(!is_complete(*aut, alph, &ws));
+				Nfa cmpl = *aut;
+				make_complete(&cmpl, alph, 100, &ws);
+				REQUIRE(is_complete(cmpl, alph, &ws));
+				Nfa cmpl_nows = *aut;
+				make_complete(&cmpl_nows, alph, 100);
+				REQUIRE(std::to_string(serialize(cmpl)) == std::to_string(serialize(cmpl_nows)));
+
+				// with prepared symbols
+				std::vector<Symbol> symbols;
+				get_sorted_symbols(&symbols, alph);
+				REQUIRE(symbols.size() == 256);
+				REQUIRE(!is_complete(*aut, symbols, &ws));
+				Nfa cmpl_symbs = *aut;
+				make_complete(&cmpl_symbs, symbols, 100, &ws);
+				REQUIRE(is_complete(cmpl_symbs, symbols, &ws));
+				REQUIRE(std::to_string(serialize(cmpl)) == std::to_string(serialize(cmpl_symbs)));
+			}
+		}
+	}
+
+	SECTION("large state numbers")
+	{
+		const State huge = static_cast<State>(1) << 40;
+		Nfa aut;
+		aut.initialstates = {huge};
+		aut.finalstates = {3};
+		aut.add_trans(huge, 'a', WORKSPACE_DENSE_MAX + 7);
+		aut.add_trans(WORKSPACE_DENSE_MAX + 7, 'b', 1 << 15);
+		aut.add_trans(1 << 15, 'a', huge);
+		aut.add_trans(1 << 15, 'c', 3);
+
+		Path cex;
+		REQUIRE(!is_lang_empty(aut, &cex, &ws));
+		REQUIRE(cex == Path({huge, WORKSPACE_DENSE_MAX + 7, 1 << 15, 3}));
+		REQUIRE(is_in_lang(aut, {'a', 'b', 'a', 'a', 'b', 'c'}, &ws));
+		REQUIRE(!is_in_lang(aut, {'a', 'b', 'a', 'b'}, &ws));
+
+		std::vector<State> reach;
+		get_fwd_reach_states(&reach, aut, &ws);
+		REQUIRE(reach == std::vector<State>({huge, WORKSPACE_DENSE_MAX + 7, 1 << 15, 3}));
+	}
+} // }}}
+
+
+TEST_CASE("Vata2::Nfa::edit_distance()")
+{ // {{{
+	auto word = [](const std::string& str) {
+		Word result;
+		for (unsigned char chr : str) { result.push_back(chr); }
+		return result;
+	};
+
+	const StringDict bitpar = {{"algo", "bitparallel"}};
+	const StringDict product = {{"algo", "product"}};
+
+	SECTION("edits")
+	{
+		for (const StringDict& params : {bitpar, product})
+		{
+			const Nfa aut = compile_regex("abc(de)*");
+			REQUIRE(edit_distance(aut, word("abc"), 3, params) == 0);
+			REQUIRE(edit_distance(aut, word("abd"), 3, params) == 1);
+			REQUIRE(edit_distance(aut, word("ac"), 3, params) == 1);
+			REQUIRE(edit_distance(aut, word("abbc"), 3, params) == 1);
+			REQUIRE(edit_distance(aut, word("abcded"), 3, params) == 1);
+			REQUIRE(edit_distance(aut, word("bacd"), 3, params) == 3);
+			REQUIRE(edit_distance(aut, word(""), 3, params) == 3);
+			REQUIRE(edit_distance(aut, word("xyzw"), 3, params) == 4);
+			REQUIRE(edit_distance(aut, word("xyzw"), 1, params) == 2);
+			REQUIRE(is_in_lang_approx(aut, word("abdde"), 1, params));
+			REQUIRE(!is_in_lang_approx(aut, word("abdd"), 1, params));
+
+			REQUIRE(edit_distance(Nfa(), word(""), 2, params) == 3);
+		}
+	}
+
+	SECTION("search")
+	{
+		for (StringDict params : {bitpar, product})
+		{
+			params["match"] = "search";
+			const Nfa aut = compile_regex("abcd");
+			REQUIRE(edit_distance(aut, word("xxabcdxx"), 3, params) == 0);
+			REQUIRE(edit_distance(aut, word("xxabxdxx"), 3, params) == 1);
+			REQUIRE(edit_distance(aut, word("xxabdxx"), 3, params) == 1);
+			REQUIRE(edit_distance(aut, word("acxxxabc"), 3, params) == 1);
+			REQUIRE(edit_distance(aut, word("x"), 3, params) == 4);
+			REQUIRE(edit_distance(aut, word("x"), 2, params) == 3);
+		}
+	}
+
+	SECTION("the algorithms agree")
+	{
+		std::vector<std::string> words = {""};
+		for (size_t i = 0; i < words.size(); ++i) {
+			if (words[i].size() < 5) {
+				for (char chr : {'a', 'b', 'c'}) { words.push_back(words[i] + chr); }
+			}
+		}
+
+		for (const char* pattern : {"(ab|c)*a", "a(b|c)+b?", "(a|b)*a(a|b)(a|b)", "cab"})
+		{
+			for (const char* match : {"full", "search"})
+			{
+				const Nfa aut = compile_regex(pattern);
+				for (const std::string& str : words)
+				{
+					INFO(pattern << " " << match << " " << str);
+					REQUIRE(edit_distance(aut, word(str), 2, {{"algo", "bitparallel"}, {"match", match}}) ==
+						edit_distance(aut, word(str), 2, {{"algo", "product"}, {"match", match}}));
+				}
+			}
+		}
+	}
+
+	SECTION("large automata")
+	{
+		const Nfa aut = compile_regex("a{100}");
+		REQUIRE(edit_distance(aut, word(std::string(98, 'a') + "b"), 5) == 2);
+		REQUIRE(edit_distance(aut, word(std::string(90, 'a')), 5) == 6);
+		CHECK_THROWS_WITH(edit_distance(aut, word(""), 1, bitpar), Catch::Contains("too many"));
+		CHECK_THROWS_WITH(edit_distance(aut, word(""), 1, {{"algo", "foo"}}),
+			Catch::Contains("unknown value"));
+	}
+} // }}}
+
+
+TEST_CASE("Vata2::Nfa::LazyNfa")
+{ // {{{
+	CharAlphabet alph;
+	auto word = [](const std::string& str) { return Word(str.begin(), str.end()); };
+
+	std::vector<Word> words = {{ }};
+	for (size_t i = 0; words[i].size() < 6; ++i) {
+		for (Symbol symb : {'a', 'b'})
+		{
+			words.push_back(words[i]);
+			words.back().push_back(symb);
+		}
+	}
+
+	const Nfa lhs = compile_regex("(a|b)*ab");
+	const Nfa rhs = compile_regex("a(a|b)*");
+
+	SECTION("operations")
+	{
+		const LazyNfa isect = intersection(lazy(lhs), lazy(rhs));
+		const LazyNfa uni = union_rename(lazy(lhs), lazy(rhs));
+		const LazyNfa cmpl = complement(lazy(lhs), alph);
+		const LazyNfa rev = revert(lazy(rhs));
+		const LazyNfa det = determinize(union_rename(lazy(lhs), lazy(rhs)));
+
+		for (const Word& w : words)
+		{
+			const bool in_lhs = is_in_lang(lhs, w);
+			const bool in_rhs = is_in_lang(rhs, w);
+			REQUIRE(is_in_lang(isect, w) == (in_lhs && in_rhs));
+			REQUIRE(is_in_lang(uni, w) == (in_lhs || in_rhs));
+			REQUIRE(is_in_lang(cmpl, w) == !in_lhs);
+			REQUIRE(is_in_lang(rev, Word(w.rbegin(), w.rend())) == in_rhs);
+			REQUIRE(is_in_lang(det, w) == (in_lhs || in_rhs));
+		}
+
+		REQUIRE(is_in_lang(cmpl, word("xy")));
+		REQUIRE(is_deterministic(materialize(det)));
+
+		// materialized automata have the same languages
+		const Nfa isect_nfa = materialize(isect);
+		const Nfa cmpl_nfa = materialize(cmpl);
+		for (const Word& w : words)
+		{
+			REQUIRE(is_in_lang(isect_nfa, w) == is_in_lang(isect, w));
+			REQUIRE(is_in_lang(cmpl_nfa, w) == is_in_lang(cmpl, w));
+		}
+	}
+
+	SECTION("inclusion by emptiness of a lazy product")
+	{
+		const Nfa smaller = compile_regex("a(a|b)*b");
+		for (const Nfa* bigger : {&lhs, &rhs})
+		{
+			Word cex;
+			const bool incl = is_lang_empty(
+				intersection(lazy(smaller), complement(lazy(*bigger), alph)), &cex);
+			REQUIRE(incl == is_incl(smaller, *bigger, alph));
+			if (!incl)
+			{
+				REQUIRE(is_in_lang(smaller, cex));
+				REQUIRE(!is_in_lang(*bigger, cex));
+			}
+		}
+
+		REQUIRE(!is_lang_empty(intersection(lazy(lhs), lazy(rhs))));
+		REQUIRE(is_lang_empty(intersection(lazy(compile_regex("a*")), lazy(compile_regex("b+")))));
+	}
+
+	SECTION("fusion")
+	{
+		const LazyNfa aut = lazy(lhs);
+		REQUIRE(revert(revert(aut)) == aut);
+
+		const LazyNfa det = determinize(aut);
+		REQUIRE(determinize(det) == det);
+
+		const LazyNfa cmpl = complement(det, alph);
+		REQUIRE(determinize(cmpl) == cmpl);
+
+		const LazyNfa cmpl_cmpl = complement(cmpl, alph);
+		for (const Word& w : words) {
+			REQUIRE(is_in_lang(cmpl_cmpl, w) == is_in_lang(lhs, w));
+		}
+
+		// complements over different alphabets are not fused
+		StringToSymbolMap ssmap = {{"a", 'a'}, {"b", 'b'}};
+		OnTheFlyAlphabet alph_ab(&ssmap);
+		const LazyNfa cmpl_ab = complement(det, alph_ab);
+		const LazyNfa cmpl_ab_cmpl = complement(cmpl_ab, alph);
+		REQUIRE(cmpl_ab_cmpl != det);
+		for (const Word& w : words) {
+			REQUIRE(is_in_lang(cmpl_ab_cmpl, w) == is_in_lang(lhs, w));
+		}
+		REQUIRE(is_in_lang(cmpl_ab_cmpl, word("c")));
+		REQUIRE(is_in_lang(cmpl_ab_cmpl, word("abca")));
+		REQUIRE(!is_in_lang(complement(complement(aut, alph_ab), alph_ab), word("c")));
+
+		// Brzozowski's minimization
+		const Nfa aut_dfa = compile_regex("(a|b)*a(a|b){3}");
+		const Nfa min = materialize(determinize(revert(determinize(revert(lazy(aut_dfa))))));
+		REQUIRE(is_deterministic(min));
+		REQUIRE(get_fwd_reach_states(min).size() == 16);
+		for (const Word& w : words) {
+			REQUIRE(is_in_lang(min, w) == is_in_lang(aut_dfa, w));
+		}
+	}
+
+	SECTION("user-defined nodes are explored on demand")
+	{
+		/// the infinite automaton 0 -a-> 1 -a-> 2 ... with the final state 1000
+		class CounterNode : public LazyNode
+		{
+		public:
+			StateSet initial = {0};
+			std::unordered_map<State, PostSymb> posts = { };
+
+			using LazyNode::post;
+			virtual const StateSet& get_initial() override { return this->initial; }
+			virtual bool has_final(State state) override { return 1000 == state; }
+			virtual const PostSymb& post(State state) override
+			{
+				return this->posts[state] = {{'a', {state + 1}}};
+			}
+		};
+
+		auto counter = std::make_shared<CounterNode>();
+		REQUIRE(!is_in_lang(counter, word("aaaaa")));
+		REQUIRE(counter->posts.size() == 5);
+
+		Word cex;
+		REQUIRE(!is_lang_empty(determinize(intersection(counter, lazy(compile_regex("a*")))), &cex));
+		REQUIRE(cex == Word(1000, 'a'));
+		REQUIRE(counter->posts.size() == 1000);
+	}
+} // }}}
+
+
+TEST_CASE("Vata2::Nfa::SharedStore")
+{ // {{{
+	auto word = [](const std::string& str) { return Word(str.begin(), str.end()); };
+
+	SharedStore store;
+
+	SECTION("common tails are stored once")
+	{
+		std::vector<Nfa> rules;
+		std::vector<SharedNfa> views;
+		size_t total_trans = 0;
+		for (size_t i = 0; i < 50; ++i)
+		{
+			rules.push_back(compile_regex(std::to_string(i) + "x(abc|abd)ef"));
+			views.push_back(store.add(rules.back()));
+			total_trans += rules.back().trans_size();
+		}
+
+		REQUIRE(store.num_node_trans() < total_trans / 2);
+		for (size_t i = 0; i < rules.size(); ++i)
+		{
+			REQUIRE(views[i].num_private_states() == 0);
+			for (const std::string str : {"1xabcef", "1xabdef", "1xabef", "12xabcef", "xabcef"})
+			{
+				REQUIRE(is_in_lang(views[i], word(str)) == is_in_lang(rules[i], word(str)));
+			}
+		}
+
+		// adding an automaton again adds no nodes
+		const size_t num_nodes = store.num_nodes();
+		store.add(rules.front());
+		REQUIRE(store.num_nodes() == num_nodes);
+	}
+
+	SECTION("equal tails reached over the same symbol")
+	{
+		Nfa simple;
+		simple.initialstates = {0};
+		simple.finalstates = {2};
+		simple.add_trans(0, 'a', 1);
+		simple.add_trans(1, 'b', 2);
+		const SharedNfa simple_view = store.add(simple);
+		const size_t num_nodes = store.num_nodes();
+
+		// 0 -a-> {1, 3}, both followed by equal tails
+		Nfa forked;
+		forked.initialstates = {0};
+		forked.finalstates = {2, 4};
+		forked.add_trans(0, 'a', 1);
+		forked.add_trans(0, 'a', 3);
+		forked.add_trans(1, 'b', 2);
+		forked.add_trans(3, 'b', 4);
+		const SharedNfa forked_view = store.add(forked);
+
+		REQUIRE(store.num_nodes() == num_nodes);
+		REQUIRE(forked_view.get_initial() == simple_view.get_initial());
+		REQUIRE(forked_view.get_node(*forked_view.get_initial().begin()).succ.size() == 1);
+		REQUIRE(is_in_lang(forked_view, word("ab")));
+	}
+
+	SECTION("cyclic automata")
+	{
+		for (const std::string pattern : {"(a|b)*ab", "a(a|b)*", "ab(ab)*ba", "(ab|ba)c+d?e", ""})
+		{
+			const Nfa aut = compile_regex(pattern);
+			const SharedNfa view = store.add(aut);
+
+			std::vector<Word> words = {{ }};
+			for (size_t i = 0; words[i].size() < 6; ++i) {
+				for (Symbol symb : {'a', 'b', 'c', 'd', 'e'})
+				{
+					words.push_back(words[i]);
+					words.back().push_back(symb);
+				}
+			}
+
+			const Nfa mat = materialize(lazy(view));
+			for (const Word& w : words)
+			{
+				REQUIRE(is_in_lang(view, w) == is_in_lang(aut, w));
+				REQUIRE(is_in_lang(mat, w) == is_in_lang(aut, w));
+			}
+
+			REQUIRE(is_lang_empty(lazy(view)) == is_lang_empty(aut));
+		}
+	}
+} // }}}
+
+
+TEST_CASE("Vata2::Nfa asynchronous operations")
+{ // {{{
+	Vata2::parallel::ThreadPool& pool = Vata2::parallel::ThreadPool::get();
+	const std::string orig_threads = std::to_string(pool.num_workers() + 1);
+	pool.configure({{"threads", "2"}});
+
+	CharAlphabet alph;
+	std::vector<Word> words = {{ }};
+	for (size_t i = 0; words[i].size() < 7; ++i) {
+		for (Symbol symb : {'a', 'b'})
+		{
+			words.push_back(words[i]);
+			words.back().push_back(symb);
+		}
+	}
+
+	SECTION("results")
+	{
+		const Nfa aut = compile_regex("(a|b)*a(a|b){3}");
+		auto det = determinize_async(aut);
+		auto min = minimize_async(aut);
+		auto incl = is_incl_async(compile_regex("ab"), aut, alph, nullptr, {{"algo", "antichains"}});
+		auto not_incl = is_incl_async(aut, compile_regex("a*"), alph, nullptr, {{"algo", "naive"}});
+
+		const Nfa det_aut = det.get();
+		const Nfa min_aut = min.get();
+		REQUIRE(is_deterministic(det_aut));
+		REQUIRE(min_aut.trans_size() == 32);
+		for (const Word& w : words)
+		{
+			REQUIRE(is_in_lang(det_aut, w) == is_in_lang(aut, w));
+			REQUIRE(is_in_lang(min_aut, w) == is_in_lang(aut, w));
+		}
+
+		REQUIRE(!incl.get());
+		REQUIRE(!not_incl.get());
+		REQUIRE(is_incl_async(compile_regex("ba"), aut, alph, nullptr, {{"algo", "antichains"}}).get() ==
+			is_incl(compile_regex("ba"), aut, alph, {{"algo", "antichains"}}));
+	}
+
+	SECTION("loading")
+	{
+		StringToSymbolMap ssmap;
+		OnTheFlyAlphabet on_the_fly(&ssmap);
+		std::atomic<size_t> reports = { 0 };
+		const Nfa aut = load_async("unit-test-data/nfa-a.vtf", &on_the_fly,
+			[&reports](const Vata2::parallel::Progress&) { ++reports; }).get();
+		REQUIRE(aut.initialstates.size() == 2);
+		REQUIRE(aut.trans_size() == 15);
+		REQUIRE(0 < reports);
+
+		CHECK_THROWS_WITH(load_async("unit-test-data/no-such-file.vtf", &on_the_fly).get(),
+			Catch::Contains("cannot open file"));
+	}
+
+	SECTION("progress and cancellation")
+	{
+		// the first report blocks the operation until it is cancelled, so it
+		// cannot finish before
+		std::atomic<bool> reported = { false };
+		std::atomic<bool> cancelled = { false };
+		auto handle = determinize_async(compile_regex("(a|b)*a(a|b){3}"),
+			[&reported, &cancelled](const Vata2::parallel::Progress&) {
+				reported = true;
+				while (!cancelled) { std::this_thread::yield(); }
+			});
+
+		while (!reported) { std::this_thread::yield(); }
+		handle.cancel();
+		cancelled = true;
+		CHECK_THROWS_AS(handle.get(), Vata2::parallel::Cancelled);
+		REQUIRE(0 < handle.get_progress().worklist);
+	}
+
+	pool.configure({{"threads", orig_threads}});
+} // }}}
@@ -0,0 +1,435 @@
+/* nta-incl.cc -- NTA language inclusion
+ *
+ * Copyright (c) 2018 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <algorithm>
+#include <deque>
+
+// VATA headers
+#include <vata2/nta.hh>
+
+using namespace Vata2::Nta;
+using namespace Vata2::util;
+
+namespace {
+
+/// the bottom-up post of a tuple of sets of states over a symbol
+StateSet post_of_tuple(
+	const Nta&                          aut,
+	Symbol                              symb,
+	const std::vector<const StateSet*>&  sets)
+{ // {{{
+	if (sets.empty()) { return aut.post(StateSet(), symb); }
+
+	StateSet result;
+	for (State st : *sets[0])
+	{
+		for (TransId id : aut.get_trans_by_child(st, 0))
+		{
+			if (aut.get_trans_rec(id).symb != symb) { continue; }
+
+			const StateTuple& children = aut.get_children(id);
+			if (children.size() != sets.size()) { continue; }
+
+			bool all_in = true;
+			for (size_t pos = 1; pos < children.size() && all_in; ++pos)
+			{
+				all_in = haskey(*sets[pos], children[pos]);
+			}
+
+			if (all_in) { result.insert(aut.get_trans_rec(id).tgt); }
+		}
+	}
+
+	return result;
+} // post_of_tuple }}}
+
+
+/// inclusion checking using (upward) antichains
+class InclAntichains
+{ // {{{
+private:
+
+	/// a pair (state of smaller, set of states of bigger) with the transition
+	/// of smaller and the pairs of children it was obtained from
+	struct Pair
+	{ // {{{
+		State st;
+		StateSet set;
+		TransId trans;
+		std::vector<size_t> children;
+		bool alive;
+	}; // Pair }}}
+
+	const Nta& smaller;
+	const Nta& bigger;
+
+	std::vector<Pair> pairs = { };
+	/// alive pairs for every state of smaller
+	std::unordered_map<State, std::vector<size_t>> antichain = { };
+	/// pairs that were taken from the worklist for every state of smaller
+	std::unordered_map<State, std::vector<size_t>> processed = { };
+	std::deque<size_t> worklist = { };
+
+	/// the pair that witnesses non-inclusion (if any)
+	size_t cex_pair = 0;
+	bool found_cex = false;
+
+	InclAntichains(const InclAntichains&);
+	InclAntichains& operator=(const InclAntichains&);
+
+	/// inserts a pair unless it is subsumed by an existing one
+	void insert(State st, StateSet&& set, TransId trans, std::vector<size_t>&& children)
+	{ // {{{
+		std::vector<size_t>& chain = this->antichain[st];
+		for (size_t id : chain)
+		{
+			const StateSet& other = this->pairs[id].set;
+			if (std::includes(set.begin(), set.end(), other.begin(), other.end())) { return; }
+		}
+
+		auto it = std::remove_if(chain.begin(), chain.end(), [&](size_t id) {
+			const StateSet& other = this->pairs[id].set;
+			if (std::includes(other.begin(), other.end(), set.begin(), set.end())) {
+				this->pairs[id].alive = false;
+				return true;
+			}
+			return false;
+		});
+		chain.erase(it, chain.end());
+
+		size_t id = this->pairs.size();
+		chain.push_back(id);
+		this->worklist.push_back(id);
+
+		bool accepted = std::any_of(set.begin(), set.end(),
+			[this](State big_st) { return this->bigger.has_final(big_st); });
+		if (this->smaller.has_final(st) && !accepted && !this->found_cex)
+		{
+			this->found_cex = true;
+			this->cex_pair = id;
+		}
+
+		this->pairs.push_back({st, std::move(set), trans, std::move(children), true});
+	} // insert }}}
+
+	/// combines pair @p id at position @p pos of transition @p trans with
+	/// processed pairs at other positions
+	void combine(TransId trans, size_t pos, size_t id)
+	{ // {{{
+		const StateTuple& children = this->smaller.get_children(trans);
+		const Symbol symb = this->smaller.get_trans_rec(trans).symb;
+
+		// alive processed pairs for every position
+		std::vector<std::vector<size_t>> cands(children.size());
+		for (size_t i = 0; i < children.size(); ++i)
+		{
+			if (i == pos) { cands[i] = {id}; continue; }
+			for (size_t cand : this->processed[children[i]])
+			{
+				if (this->pairs[cand].alive) { cands[i].push_back(cand); }
+			}
+			if (cands[i].empty()) { return; }
+		}
+
+		std::vector<size_t> choice(children.size(), 0);
+		while (!this->found_cex)
+		{
+			std::vector<const StateSet*> sets;
+			std::vector<size_t> chosen;
+			for (size_t i = 0; i < children.size(); ++i)
+			{
+				chosen.push_back(cands[i][choice[i]]);
+				sets.push_back(&this->pairs[chosen.back()].set);
+			}
+
+			StateSet set = post_of_tuple(this->bigger, symb, sets);
+			this->insert(this->smaller.get_trans_rec(trans).tgt, std::move(set), trans,
+				std::move(chosen));
+
+			// the next combination
+			size_t i = 0;
+			for (; i < children.size(); ++i)
+			{
+				if (++choice[i] < cands[i].size()) { break; }
+				choice[i] = 0;
+			}
+			if (i == children.size()) { break; }
+		}
+	} // combine }}}
+
+	Tree build_tree(size_t id) const
+	{ // {{{
+		const Pair& pair = this->pairs[id];
+		Tree result(this->smaller.get_trans_rec(pair.trans).symb);
+		for (size_t child : pair.children) { result.children.push_back(this->build_tree(child)); }
+		return result;
+	} // build_tree }}}
+
+public:
+
+	InclAntichains(const Nta& smaller, const Nta& bigger) :
+		smaller(smaller),
+		bigger(bigger)
+	{ }
+
+	bool run(Tree* cex)
+	{ // {{{
+		for (TransId trans : this->smaller.get_leaf_trans())
+		{
+			const Nta::TransRec& rec = this->smaller.get_trans_rec(trans);
+			this->insert(rec.tgt, this->bigger.post(StateSet(), rec.symb), trans, { });
+		}
+
+		while (!this->found_cex && !this->worklist.empty())
+		{
+			size_t id = this->worklist.front();
+			this->worklist.pop_front();
+			if (!this->pairs[id].alive) { continue; }
+
+			const State st = this->pairs[id].st;
+			this->processed[st].push_back(id);
+
+			// every transition is visited once for every occurrence of st
+			std::vector<TransId> transs = this->smaller.get_trans_by_child(st);
+			std::sort(transs.begin(), transs.end());
+			transs.erase(std::unique(transs.begin(), transs.end()), transs.end());
+			for (TransId trans : transs)
+			{
+				const StateTuple& children = this->smaller.get_children(trans);
+				for (size_t pos = 0; pos < children.size() && !this->found_cex; ++pos)
+				{
+					if (children[pos] == st) { this->combine(trans, pos, id); }
+				}
+			}
+		}
+
+		if (!this->found_cex) { return true; }
+
+		if (nullptr != cex) { *cex = this->build_tree(this->cex_pair); }
+		return false;
+	} // run }}}
+}; // InclAntichains }}}
+
+
+/// inclusion checking using downward antichains: a pair (p, P) of a state of
+/// smaller and a set of states of bigger is included if the language of p is
+/// included in the union of languages of P, which is checked top-down
+class InclDownward
+{ // {{{
+private:
+
+	const Nta& smaller;
+	const Nta& bigger;
+
+	/// maximal sets P of pairs (p, P) that are known not to be included (with
+	/// a tree in the language of p but not of P) for every state p of smaller
+	std::unordered_map<State, std::vector<std::pair<StateSet, Tree>>> non_incl = { };
+	/// minimal sets P of pairs (p, P) that are known to be included
+	std::unordered_map<State, std::vector<StateSet>> incl = { };
+	/// pairs whose check is in progress (they are assumed to be included)
+	std::vector<std::pair<State, const StateSet*>> workset = { };
+
+	InclDownward(const InclDownward&);
+	InclDownward& operator=(const InclDownward&);
+
+	static bool is_subset(const StateSet& lhs, const StateSet& rhs)
+	{ // {{{
+		return lhs.size() <= rhs.size() &&
+			std::includes(rhs.begin(), rhs.end(), lhs.begin(), lhs.end());
+	} // is_subset }}}
+
+	/**
+	 * @brief  Checks whether the children of a transition of smaller are
+	 *         included in the children of transitions of bigger
+	 *
+	 * The product of languages of @p children is included in the union of
+	 * products of languages of @p tuples iff for every assignment of a
+	 * position i to every tuple, the language of children[i] is included in
+	 * the union of languages of the i-th states of the tuples assigned to i.
+	 * Tuples from position @p k on are assigned recursively, with @p sets
+	 * collecting the states assigned to every position; the assignments are
+	 * pruned as soon as some position is included (since the sets only
+	 * grow).  If the check fails, @p witnesses are trees of the children not
+	 * in the languages of @p sets.
+	 */
+	bool expand(
+		const StateTuple&                     children,
+		const std::vector<const StateTuple*>& tuples,
+		size_t                                k,
+		std::vector<StateSet>*                sets,
+		std::vector<Tree>*                    witnesses,
+		bool*                                 assumed)
+	{ // {{{
+		for (size_t i = 0; i < children.size(); ++i)
+		{
+			if (this->is_incl(children[i], (*sets)[i], &(*witnesses)[i], assumed)) { return true; }
+		}
+
+		if (k == tuples.size()) { return false; }
+
+		for (size_t i = 0; i < children.size(); ++i)
+		{
+			const StateSet saved = (*sets)[i];
+			(*sets)[i].insert((*tuples[k])[i]);
+			const bool result = this->expand(children, tuples, k + 1, sets, witnesses, assumed);
+			(*sets)[i] = saved;
+			if (!result) { return false; }
+		}
+
+		return true;
+	} // expand }}}
+
+public:
+
+	InclDownward(const Nta& smaller, const Nta& bigger) :
+		smaller(smaller),
+		bigger(bigger)
+	{ }
+
+	/// Is the language of @p st included in the union of languages of @p
+	/// states?  Sets @p witness to a tree that is not if not; sets @p assumed
+	/// if the result relies on a pair in progress
+	bool is_incl(State st, const StateSet& states, Tree* witness, bool* assumed)
+	{ // {{{
+		assert(nullptr != witness);
+		assert(nullptr != assumed);
+
+		for (const auto& set_tree : this->non_incl[st])
+		{
+			if (is_subset(states, set_tree.first))
+			{
+				*witness = set_tree.second;
+				return false;
+			}
+		}
+
+		for (const StateSet& set : this->incl[st]) {
+			if (is_subset(set, states)) { return true; }
+		}
+
+		for (const auto& pair : this->workset)
+		{
+			if (pair.first == st && is_subset(*pair.second, states))
+			{
+				*assumed = true;
+				return true;
+			}
+		}
+
+		this->workset.push_back({st, &states});
+		bool local_assumed = false;
+		bool result = true;
+		for (TransId trans : this->smaller.get_trans_to(st))
+		{
+			const StateTuple& children = this->smaller.get_children(trans);
+			const Symbol symb = this->smaller.get_trans_rec(trans).symb;
+
+			std::vector<const StateTuple*> tuples;
+			for (State big_st : states)
+			{
+				for (TransId big_trans : this->bigger.get_trans_to(big_st))
+				{
+					const StateTuple& big_children = this->bigger.get_children(big_trans);
+					if (this->bigger.get_trans_rec(big_trans).symb == symb &&
+						big_children.size() == children.size())
+					{
+						tuples.push_back(&big_children);
+					}
+				}
+			}
+
+			std::vector<StateSet> sets(children.size());
+			std::vector<Tree> witnesses(children.size());
+			if (!this->expand(children, tuples, 0, &sets, &witnesses, &local_assumed))
+			{
+				*witness = Tree(symb, witnesses);
+				result = false;
+				break;
+			}
+		}
+
+		this->workset.pop_back();
+
+		// non-inclusion does not depend on pairs assumed to be included, but
+		// inclusion does (until the assumed pair is finished)
+		if (!result)
+		{
+			std::vector<std::pair<StateSet, Tree>>& chain = this->non_incl[st];
+			auto it = std::remove_if(chain.begin(), chain.end(),
+				[&states](const std::pair<StateSet, Tree>& set_tree) {
+					return is_subset(set_tree.first, states);
+				});
+			chain.erase(it, chain.end());
+			chain.push_back({states, *witness});
+		}
+		else if (local_assumed) { *assumed = true; }
+		else
+		{
+			std::vector<StateSet>& chain = this->incl[st];
+			auto it = std::remove_if(chain.begin(), chain.end(),
+				[&states](const StateSet& set) { return is_subset(states, set); });
+			chain.erase(it, chain.end());
+			chain.push_back(states);
+		}
+
+		return result;
+	} // is_incl }}}
+
+	bool run(Tree* cex)
+	{ // {{{
+		for (State st : this->smaller.finalstates)
+		{
+			Tree witness;
+			bool assumed = false;
+			if (!this->is_incl(st, this->bigger.finalstates, &witness, &assumed))
+			{
+				if (nullptr != cex) { *cex = std::move(witness); }
+				return false;
+			}
+		}
+
+		return true;
+	} // run }}}
+}; // InclDownward }}}
+
+} // namespace
+
+
+bool Vata2::Nta::is_incl(
+	const Nta&         smaller,
+	const Nta&         bigger,
+	Tree*              cex,
+	const StringDict&  params)
+{ // {{{
+	if (!haskey(params, "algo")) {
+		throw std::runtime_error(std::to_string(__func__) +
+			" requires setting the \"algo\" key in the \"params\" argument; "
+			"received: " + std::to_string(params));
+	}
+
+	const std::string& str_algo = params.at("algo");
+	if ("antichains" == str_algo || "upward_antichains" == str_algo) {
+		InclAntichains algo(smaller, bigger);
+		return algo.run(cex);
+	} else if ("downward_antichains" == str_algo) {
+		InclDownward algo(smaller, bigger);
+		return algo.run(cex);
+	} else {
+		throw std::runtime_error(std::to_string(__func__) +
+			" received an unknown value of the \"algo\" key: " + str_algo);
+	}
+} // is_incl }}}
@@ -0,0 +1,455 @@
+/* nta.cc -- operations for nondeterministic tree automata
+ *
+ * Copyright (c) 2018 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <algorithm>
+#include <deque>
+
+// VATA headers
+#include <vata2/nta.hh>
+#include <vata2/util.hh>
+
+using namespace Vata2::util;
+using namespace Vata2::Nta;
+
+
+namespace
+{
+	/// builds the tree accepted in @p st from transitions that made states
+	/// reachable in the emptiness check
+	Tree build_witness(
+		const Nta&                                aut,
+		const std::unordered_map<State, TransId>&  witness,
+		State                                     st)
+	{ // {{{
+		TransId id = witness.at(st);
+		Tree result(aut.get_trans_rec(id).symb);
+		for (State child : aut.get_children(id))
+		{
+			result.children.push_back(build_witness(aut, witness, child));
+		}
+
+		return result;
+	} // build_witness }}}
+} // anonymous namespace
+
+
+std::ostream& std::operator<<(std::ostream& os, const Vata2::Nta::Trans& trans)
+{ // {{{
+	std::string result = "(" + std::to_string(trans.children) + ", " +
+		std::to_string(trans.symb) + ", " + std::to_string(trans.tgt) + ")";
+	return os << result;
+} // operator<<(ostream, Trans) }}}
+
+
+std::ostream& std::operator<<(std::ostream& os, const Vata2::Nta::Tree& tree)
+{ // {{{
+	os << std::to_string(tree.symb);
+	if (!tree.children.empty())
+	{
+		os << "(";
+		for (auto it = tree.children.begin(); it != tree.children.end(); ++it)
+		{
+			if (it != tree.children.begin()) { os << ", "; }
+			os << *it;
+		}
+		os << ")";
+	}
+
+	return os;
+} // operator<<(ostream, Tree) }}}
+
+
+void Nta::add_trans(const StateTuple& children, Symbol symb, State tgt)
+{ // {{{
+	TupleId tuple = this->tuples.intern(children);
+	if (!this->trans_set.insert({{tuple, symb}, tgt}).second) { return; }   // already there
+
+	TransId id = static_cast<TransId>(this->trans.size());
+	this->trans.push_back({tuple, symb, tgt});
+
+	this->by_symbol[symb].push_back(id);
+	this->by_tgt[tgt].push_back(id);
+	if (children.empty()) { this->leaves.push_back(id); }
+
+	for (size_t pos = 0; pos < children.size(); ++pos)
+	{
+		this->by_child[children[pos]].push_back(id);
+		this->by_child_pos[{children[pos], pos}].push_back(id);
+	}
+} // add_trans }}}
+
+
+bool Nta::has_trans(const StateTuple& children, Symbol symb, State tgt) const
+{ // {{{
+	TupleId tuple;
+	if (!this->tuples.find(children, &tuple)) { return false; }
+	return haskey(this->trans_set, std::make_pair(std::make_pair(tuple, symb), tgt));
+} // has_trans }}}
+
+
+std::vector<Trans> Nta::get_transitions() const
+{ // {{{
+	std::vector<Trans> result;
+	for (TransId id = 0; id < this->trans.size(); ++id)
+	{
+		result.push_back(this->get_trans(id));
+	}
+
+	return result;
+} // get_transitions }}}
+
+
+StateSet Nta::post(const StateSet& states, Symbol symb) const
+{ // {{{
+	StateSet result;
+	auto all_in = [&states](const StateTuple& tuple) {
+		return std::all_of(tuple.begin(), tuple.end(),
+			[&states](State st) { return haskey(states, st); });
+	};
+
+	// leaves need to be treated separately since they have no children
+	for (TransId id : this->leaves)
+	{
+		if (this->trans[id].symb == symb) { result.insert(this->trans[id].tgt); }
+	}
+
+	for (State st : states)
+	{
+		for (TransId id : this->get_trans_by_child(st, 0))
+		{
+			const TransRec& rec = this->trans[id];
+			if (rec.symb == symb && all_in(this->tuples[rec.tuple]))
+			{
+				result.insert(rec.tgt);
+			}
+		}
+	}
+
+	return result;
+} // post }}}
+
+
+std::vector<TupleId> Nta::pre(State tgt, Symbol symb) const
+{ // {{{
+	std::vector<TupleId> result;
+	for (TransId id : this->get_trans_to(tgt))
+	{
+		if (this->trans[id].symb == symb) { result.push_back(this->trans[id].tuple); }
+	}
+
+	return result;
+} // pre }}}
+
+
+StateSet Vata2::Nta::get_reach_states(const Nta& aut, const Tree& tree)
+{ // {{{
+	std::vector<StateSet> child_states;
+	for (const Tree& child : tree.children)
+	{
+		child_states.push_back(get_reach_states(aut, child));
+		if (child_states.back().empty()) { return { }; }
+	}
+
+	StateSet result;
+	const size_t arity = child_states.size();
+	auto try_trans = [&](TransId id) {
+		const Nta::TransRec& rec = aut.get_trans_rec(id);
+		if (rec.symb != tree.symb) { return; }
+
+		const StateTuple& children = aut.get_children(id);
+		if (children.size() != arity) { return; }
+		for (size_t pos = 0; pos < arity; ++pos)
+		{
+			if (!haskey(child_states[pos], children[pos])) { return; }
+		}
+
+		result.insert(rec.tgt);
+	};
+
+	if (0 == arity)
+	{
+		for (TransId id : aut.get_trans_by_symbol(tree.symb)) { try_trans(id); }
+	}
+	else
+	{
+		for (State st : child_states[0])
+		{
+			for (TransId id : aut.get_trans_by_child(st, 0)) { try_trans(id); }
+		}
+	}
+
+	return result;
+} // get_reach_states }}}
+
+
+bool Vata2::Nta::is_in_lang(const Nta& aut, const Tree& tree)
+{ // {{{
+	for (State st : get_reach_states(aut, tree))
+	{
+		if (aut.has_final(st)) { return true; }
+	}
+
+	return false;
+} // is_in_lang }}}
+
+
+namespace
+{
+	/**
+	 * Computes states accepting some tree bottom-up; every transition has a
+	 * counter of children that are not known to be useful yet, so every
+	 * transition is visited once for every occurrence of a state among its
+	 * children.  Stops at the first final state if @p stop_at_final.
+	 *
+	 * @returns  true if it stopped at a final state (stored into @p final_state)
+	 */
+	bool compute_useful(
+		const Nta&                           aut,
+		bool                                 stop_at_final,
+		std::unordered_map<State, TransId>*  witness,
+		State*                               final_state)
+	{ // {{{
+		assert(nullptr != witness);
+
+		std::vector<size_t> missing(aut.trans_size());
+		for (TransId id = 0; id < aut.trans_size(); ++id)
+		{
+			missing[id] = aut.get_children(id).size();
+		}
+
+		std::deque<State> worklist;
+		auto fire = [&](TransId id) {
+			State tgt = aut.get_trans_rec(id).tgt;
+			if (witness->insert({tgt, id}).second) { worklist.push_back(tgt); }
+		};
+
+		for (TransId id : aut.get_leaf_trans()) { fire(id); }
+
+		while (!worklist.empty())
+		{
+			State st = worklist.front();
+			worklist.pop_front();
+
+			if (aut.has_final(st) && stop_at_final)
+			{
+				if (nullptr != final_state) { *final_state = st; }
+				return true;
+			}
+
+			for (TransId id : aut.get_trans_by_child(st))
+			{
+				assert(missing[id] > 0);
+				if (0 == --missing[id]) { fire(id); }
+			}
+		}
+
+		return false;
+	} // compute_useful }}}
+} // anonymous namespace
+
+
+std::unordered_set<State> Vata2::Nta::get_useful_states(const Nta& aut)
+{ // {{{
+	std::unordered_map<State, TransId> witness;
+	compute_useful(aut, false, &witness, nullptr);
+
+	std::unordered_set<State> result;
+	for (const auto& state_trans : witness) { result.insert(state_trans.first); }
+	return result;
+} // get_useful_states }}}
+
+
+bool Vata2::Nta::is_lang_empty(const Nta& aut, Tree* cex)
+{ // {{{
+	std::unordered_map<State, TransId> witness;
+	State final_state;
+	if (!compute_useful(aut, true, &witness, &final_state)) { return true; }
+
+	if (nullptr != cex) { *cex = build_witness(aut, witness, final_state); }
+	return false;
+} // is_lang_empty }}}
+
+
+Vata2::Parser::ParsedSection Vata2::Nta::serialize(
+	const Nta&                aut,
+	const SymbolToStringMap*  symbol_map,
+	const StateToStringMap*   state_map)
+{ // {{{
+	Vata2::Parser::ParsedSection parsec;
+	parsec.type = Vata2::Nta::TYPE_NTA;
+
+	auto state_namer = [state_map](State st) -> std::string {
+		if (nullptr == state_map) { return "q" + std::to_string(st); }
+
+		auto it = state_map->find(st);
+		if (state_map->end() == it)
+		{
+			throw std::runtime_error("cannot translate state " + std::to_string(st));
+		}
+
+		return it->second;
+	};
+
+	auto symbol_namer = [symbol_map](Symbol sym) -> std::string {
+		if (nullptr == symbol_map) { return "a" + std::to_string(sym); }
+
+		auto it = symbol_map->find(sym);
+		if (symbol_map->end() == it)
+		{
+			throw std::runtime_error("cannot translate symbol " + std::to_string(sym));
+		}
+
+		return it->second;
+	};
+
+	std::vector<std::string> fin_states;
+	for (State st : aut.finalstates) { fin_states.push_back(state_namer(st)); }
+	parsec.dict["Final"] = fin_states;
+
+	for (const Trans& trans : aut.get_transitions())
+	{
+		std::vector<std::string> line;
+		for (State child : trans.children) { line.push_back(state_namer(child)); }
+		line.push_back(symbol_namer(trans.symb));
+		line.push_back(state_namer(trans.tgt));
+		parsec.body.push_back(line);
+	}
+
+	return parsec;
+} // serialize }}}
+
+
+void Vata2::Nta::construct(
+	Nta*                                 aut,
+	const Vata2::Parser::ParsedSection&  parsec,
+	Alphabet*                            alphabet,
+	StringToStateMap*                    state_map)
+{ // {{{
+	assert(nullptr != aut);
+	assert(nullptr != alphabet);
+
+	if (parsec.type != Vata2::Nta::TYPE_NTA) {
+		throw std::runtime_error(std::string(__FUNCTION__) + ": expecting type \"" +
+			Vata2::Nta::TYPE_NTA + "\"");
+	}
+
+	bool remove_state_map = false;
+	if (nullptr == state_map) {
+		state_map = new StringToStateMap();
+		remove_state_map = true;
+	}
+
+	State cnt_state = 0;
+
+	// a lambda for translating state names to identifiers
+	auto get_state_name = [state_map, &cnt_state](const std::string& str) {
+		auto it_insert_pair = state_map->insert({str, cnt_state});
+		if (it_insert_pair.second) { return cnt_state++; }
+		else { return it_insert_pair.first->second; }
+	};
+
+	// a lambda for cleanup
+	auto clean_up = [&]() {
+		if (remove_state_map) { delete state_map; }
+	};
+
+	try
+	{
+		auto it = parsec.dict.find("Final");
+		if (parsec.dict.end() != it)
+		{
+			for (const auto& str : it->second)
+			{
+				aut->add_final(get_state_name(str));
+			}
+		}
+
+		for (const auto& body_line : parsec.body)
+		{
+			if (body_line.size() < 2)
+			{
+				throw std::runtime_error("Invalid transition: " +
+					std::to_string(body_line));
+			}
+
+			StateTuple children;
+			for (size_t i = 0; i + 2 < body_line.size(); ++i)
+			{
+				children.push_back(get_state_name(body_line[i]));
+			}
+
+			Symbol symbol = alphabet->translate_symb(body_line[body_line.size() - 2]);
+			State tgt_state = get_state_name(body_line.back());
+			aut->add_trans(children, symbol, tgt_state);
+		}
+	}
+	catch (std::exception&)
+	{
+		clean_up();
+		throw;
+	}
+
+	// do the dishes and take out garbage
+	clean_up();
+} // construct }}}
+
+
+void Vata2::Nta::construct(
+	Nta*                                 aut,
+	const Vata2::Parser::ParsedSection&  parsec,
+	StringToSymbolMap*                   symbol_map,
+	StringToStateMap*                    state_map)
+{ // {{{
+	assert(nullptr != aut);
+
+	bool remove_symbol_map = false;
+	if (nullptr == symbol_map)
+	{
+		symbol_map = new StringToSymbolMap();
+		remove_symbol_map = true;
+	}
+
+	auto release_res = [&](){ if (remove_symbol_map) delete symbol_map; };
+
+	Vata2::Nfa::OnTheFlyAlphabet alphabet(symbol_map);
+
+	try
+	{
+		construct(aut, parsec, &alphabet, state_map);
+	}
+	catch (std::exception&)
+	{
+		release_res();
+		throw;
+	}
+
+	release_res();
+} // construct(StringToSymbolMap) }}}
+
+
+std::ostream& Vata2::Nta::operator<<(std::ostream& os, const Nta& nta)
+{ // {{{
+	return os << std::to_string(serialize(nta));
+} // Nta::operator<<(ostream) }}}
+
+
+std::ostream& std::operator<<(std::ostream& os, const Vata2::Nta::NtaWrapper& nta_wrap)
+{ // {{{
+	os << "{NTA wrapper|NTA: " << nta_wrap.nta << "|alphabet: " << nta_wrap.alphabet <<
+		"|state_dict: " << std::to_string(nta_wrap.state_dict) << "}";
+	return os;
+} // operator<<(NtaWrapper) }}}
@@ -0,0 +1,65 @@
+/* tests-nta-dispatch.cc -- tests of NTA dispatch functions
+ *
+ * Copyright (c) 2018 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "../3rdparty/catch.hpp"
+
+#include <vata2/nta.hh>
+#include <vata2/vm-dispatch.hh>
+
+using namespace Vata2::VM;
+using namespace Vata2::Nta;
+
+TEST_CASE("Vata2::VM::find_dispatcher(\"NTA\")")
+{
+	SECTION("construct")
+	{
+		Vata2::Parser::ParsedSection parsec;
+		parsec.type = Vata2::Nta::TYPE_NTA;
+		parsec.dict.insert({"Final", {"q2"}});
+		parsec.body = { {"a", "q1"}, {"q1", "q1", "f", "q2"} };
+
+		VMValue res = find_dispatcher(Vata2::Nta::TYPE_NTA)("construct",
+			{{Vata2::TYPE_PARSEC, &parsec}});
+		REQUIRE(Vata2::Nta::TYPE_NTA == res.type);
+		const NtaWrapper* wrap = static_cast<const NtaWrapper*>(res.get_ptr());
+		REQUIRE(wrap->nta.trans_size() == 2);
+		REQUIRE(wrap->nta.has_final(wrap->state_dict.at("q2")));
+
+		VMValue empty = find_dispatcher(Vata2::Nta::TYPE_NTA)("is_empty",
+			{{Vata2::Nta::TYPE_NTA, wrap}});
+		REQUIRE(Vata2::TYPE_BOOL == empty.type);
+		REQUIRE(!*static_cast<const bool*>(empty.get_ptr()));
+		delete static_cast<const bool*>(empty.get_ptr());
+
+		delete wrap->alphabet;
+		delete wrap;
+	}
+
+	SECTION("no parameters")
+	{
+		CHECK_THROWS_WITH(find_dispatcher(Vata2::Nta::TYPE_NTA)("barrel-roll", { }),
+			Catch::Contains("with no arguments"));
+	}
+
+	SECTION("invalid function")
+	{
+		std::string str = "arg1";
+		VMValue res = find_dispatcher(Vata2::Nta::TYPE_NTA)("barrel-roll",
+			{{Vata2::TYPE_STR, &str}});
+		REQUIRE(Vata2::TYPE_NOT_A_VALUE == res.type);
+	}
+}
@@ -0,0 +1,301 @@
+/* tests-nta.cc -- tests of nondeterministic tree automata
+ *
+ * Copyright (c) 2018 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "../3rdparty/catch.hpp"
+
+#include <vata2/nta.hh>
+
+using namespace Vata2::Nta;
+using namespace Vata2::Parser;
+
+// Some common automata {{{
+
+// Automaton A (over leaves a, b and a binary f; trees containing b)
+#define FILL_WITH_AUT_A(x) \
+	x.finalstates = {2}; \
+	x.add_trans({}, 'a', 1); \
+	x.add_trans({}, 'b', 2); \
+	x.add_trans({1, 1}, 'f', 1); \
+	x.add_trans({1, 2}, 'f', 2); \
+	x.add_trans({2, 1}, 'f', 2); \
+	x.add_trans({2, 2}, 'f', 2); \
+
+// Automaton B (all trees)
+#define FILL_WITH_AUT_B(x) \
+	x.finalstates = {1}; \
+	x.add_trans({}, 'a', 1); \
+	x.add_trans({}, 'b', 1); \
+	x.add_trans({1, 1}, 'f', 1); \
+
+// Automaton C (trees containing b, guessing the branch with b)
+#define FILL_WITH_AUT_C(x) \
+	x.finalstates = {4}; \
+	x.add_trans({}, 'a', 3); \
+	x.add_trans({}, 'b', 3); \
+	x.add_trans({}, 'b', 4); \
+	x.add_trans({3, 3}, 'f', 3); \
+	x.add_trans({4, 3}, 'f', 4); \
+	x.add_trans({3, 4}, 'f', 4); \
+
+// }}}
+
+TEST_CASE("Vata2::Nta::Nta::add_trans()/has_trans()")
+{ // {{{
+	Nta aut;
+
+	SECTION("Empty automata have no transitions")
+	{
+		REQUIRE(aut.trans_empty());
+		REQUIRE(!aut.has_trans({1, 2}, 'f', 3));
+	}
+
+	SECTION("If I add a transition, it is in the automaton")
+	{
+		aut.add_trans({1, 2}, 'f', 3);
+
+		REQUIRE(aut.has_trans({1, 2}, 'f', 3));
+		REQUIRE(!aut.has_trans({2, 1}, 'f', 3));
+		REQUIRE(!aut.has_trans({1, 2}, 'g', 3));
+		REQUIRE(aut.trans_size() == 1);
+	}
+
+	SECTION("Tuples are shared and transitions are not duplicated")
+	{
+		FILL_WITH_AUT_A(aut);
+		aut.add_trans({1, 2}, 'g', 1);
+		aut.add_trans({1, 2}, 'f', 2);
+
+		REQUIRE(aut.trans_size() == 7);
+		REQUIRE(aut.get_tuples().size() == 5);
+		REQUIRE(aut.get_transitions().size() == 7);
+		REQUIRE(aut.get_transitions()[2] == Trans({1, 1}, 'f', 1));
+	}
+} // }}}
+
+
+TEST_CASE("Vata2::Nta::Nta indices")
+{ // {{{
+	Nta aut;
+	FILL_WITH_AUT_A(aut);
+
+	auto get_tgts = [&aut](const Nta::TransList& transs) {
+		StateSet result;
+		for (TransId id : transs) { result.insert(aut.get_trans_rec(id).tgt); }
+		return result;
+	};
+
+	REQUIRE(aut.get_leaf_trans().size() == 2);
+	REQUIRE(aut.get_trans_by_symbol('f').size() == 4);
+	REQUIRE(aut.get_trans_by_symbol('g').empty());
+	REQUIRE(aut.get_trans_to(2).size() == 4);
+	REQUIRE(aut.get_trans_by_child(2).size() == 4);   // {2, 2} counted twice
+	REQUIRE(aut.get_trans_by_child(2, 1).size() == 2);
+	REQUIRE(get_tgts(aut.get_trans_by_child(1, 0)) == StateSet({1, 2}));
+	REQUIRE(aut.get_trans_by_child(1, 2).empty());
+
+	REQUIRE(aut.post({}, 'a') == StateSet({1}));
+	REQUIRE(aut.post({1}, 'f') == StateSet({1}));
+	REQUIRE(aut.post({1, 2}, 'f') == StateSet({1, 2}));
+	REQUIRE(aut.post({2}, 'f') == StateSet({2}));
+	REQUIRE(aut.post({1, 2}, 'g').empty());
+
+	std::vector<TupleId> pre = aut.pre(2, 'f');
+	REQUIRE(pre.size() == 3);
+	REQUIRE(aut.get_tuples()[pre[0]] == StateTuple({1, 2}));
+	REQUIRE(aut.pre(1, 'b').empty());
+} // }}}
+
+
+TEST_CASE("Vata2::Nta::is_in_lang()")
+{ // {{{
+	Nta aut;
+	FILL_WITH_AUT_A(aut);
+
+	Tree tree_a('a');
+	Tree tree_b('b');
+
+	REQUIRE(is_in_lang(aut, tree_b));
+	REQUIRE(!is_in_lang(aut, tree_a));
+	REQUIRE(is_in_lang(aut, Tree('f', {tree_a, Tree('f', {tree_b, tree_a})})));
+	REQUIRE(!is_in_lang(aut, Tree('f', {tree_a, Tree('f', {tree_a, tree_a})})));
+	REQUIRE(!is_in_lang(aut, Tree('f', {tree_b})));                // wrong arity
+	REQUIRE(!is_in_lang(aut, Tree('g', {tree_b, tree_b})));        // unknown symbol
+	REQUIRE(get_reach_states(aut, Tree('f', {tree_a, tree_a})) == StateSet({1}));
+} // }}}
+
+
+TEST_CASE("Vata2::Nta::is_lang_empty()")
+{ // {{{
+	Nta aut;
+	Tree cex;
+
+	SECTION("An empty automaton has an empty language")
+	{
+		REQUIRE(is_lang_empty(aut));
+	}
+
+	SECTION("No leaves")
+	{
+		aut.finalstates = {1};
+		aut.add_trans({1, 1}, 'f', 1);
+		REQUIRE(is_lang_empty(aut));
+		REQUIRE(get_useful_states(aut).empty());
+	}
+
+	SECTION("Final states are not useful")
+	{
+		aut.finalstates = {3};
+		aut.add_trans({}, 'a', 1);
+		aut.add_trans({1, 2}, 'f', 3);
+		aut.add_trans({2}, 'g', 2);
+		REQUIRE(is_lang_empty(aut));
+		REQUIRE(get_useful_states(aut) == std::unordered_set<State>({1}));
+	}
+
+	SECTION("A non-empty language has a counterexample")
+	{
+		aut.finalstates = {3};
+		aut.add_trans({}, 'a', 1);
+		aut.add_trans({1}, 'g', 2);
+		aut.add_trans({1, 2}, 'f', 3);
+		REQUIRE(!is_lang_empty(aut, &cex));
+		REQUIRE(cex == Tree('f', {Tree('a'), Tree('g', {Tree('a')})}));
+		REQUIRE(is_in_lang(aut, cex));
+	}
+
+	SECTION("Automaton A")
+	{
+		FILL_WITH_AUT_A(aut);
+		REQUIRE(!is_lang_empty(aut, &cex));
+		REQUIRE(is_in_lang(aut, cex));
+	}
+} // }}}
+
+
+TEST_CASE("Vata2::Nta::is_incl()")
+{ // {{{
+	Nta smaller;
+	Nta bigger;
+	Tree cex;
+
+	const std::vector<StringDict> algos = {
+		{{"algo", "antichains"}},
+		{{"algo", "upward_antichains"}},
+		{{"algo", "downward_antichains"}},
+	};
+
+	SECTION("Trees containing b are included in all trees")
+	{
+		FILL_WITH_AUT_A(smaller);
+		FILL_WITH_AUT_B(bigger);
+		for (const StringDict& params : algos)
+		{
+			REQUIRE(is_incl(smaller, bigger, &cex, params));
+
+			REQUIRE(!is_incl(bigger, smaller, &cex, params));
+			REQUIRE(is_in_lang(bigger, cex));
+			REQUIRE(!is_in_lang(smaller, cex));
+		}
+	}
+
+	SECTION("Deterministic and nondeterministic automata for the same language")
+	{
+		FILL_WITH_AUT_A(smaller);
+		FILL_WITH_AUT_C(bigger);
+		for (const StringDict& params : algos)
+		{
+			REQUIRE(is_incl(smaller, bigger, nullptr, params));
+			REQUIRE(is_incl(bigger, smaller, nullptr, params));
+		}
+	}
+
+	SECTION("A counterexample needs a deeper tree")
+	{
+		FILL_WITH_AUT_C(smaller);
+		// trees with a single b, which is a left child (or the whole tree)
+		bigger.finalstates = {2, 3};
+		bigger.add_trans({}, 'a', 1);
+		bigger.add_trans({}, 'b', 2);
+		bigger.add_trans({1, 1}, 'f', 1);
+		bigger.add_trans({2, 1}, 'f', 3);
+		bigger.add_trans({3, 1}, 'f', 3);
+		bigger.add_trans({1, 3}, 'f', 3);
+
+		for (const StringDict& params : algos)
+		{
+			REQUIRE(!is_incl(smaller, bigger, &cex, params));
+			REQUIRE(is_in_lang(smaller, cex));
+			REQUIRE(!is_in_lang(bigger, cex));
+			REQUIRE(cex.children.size() == 2);
+		}
+	}
+
+	SECTION("invalid parameters")
+	{
+		CHECK_THROWS_WITH(is_incl(smaller, bigger, nullptr, {{"algo", "foo"}}),
+			Catch::Contains("unknown value"));
+	}
+} // }}}
+
+
+TEST_CASE("Vata2::Nta::construct()/serialize()")
+{ // {{{
+	Nta aut;
+	ParsedSection parsec;
+	parsec.type = TYPE_NTA;
+	StringToSymbolMap symbol_map;
+	StringToStateMap state_map;
+
+	SECTION("construct an automaton")
+	{
+		parsec.dict.insert({"Final", {"q2"}});
+		parsec.body = { {"a", "q1"}, {"b", "q2"}, {"q1", "q2", "f", "q2"}, {"q2", "g", "q2"} };
+
+		construct(&aut, parsec, &symbol_map, &state_map);
+
+		REQUIRE(aut.trans_size() == 4);
+		REQUIRE(aut.has_final(state_map["q2"]));
+		REQUIRE(aut.has_trans({state_map["q1"], state_map["q2"]}, symbol_map["f"],
+			state_map["q2"]));
+		REQUIRE(is_in_lang(aut, Tree(symbol_map["g"], {Tree(symbol_map["b"])})));
+	}
+
+	SECTION("invalid calls")
+	{
+		parsec.body = { {"q1"} };
+		CHECK_THROWS_WITH(construct(&aut, parsec), Catch::Contains("Invalid transition"));
+
+		parsec.type = "NFA";
+		CHECK_THROWS_WITH(construct(&aut, parsec), Catch::Contains("expecting type"));
+	}
+
+	SECTION("serialization and construction give the same automaton")
+	{
+		FILL_WITH_AUT_A(aut);
+
+		ParsedSection serialized = serialize(aut);
+		REQUIRE(serialized.type == TYPE_NTA);
+		REQUIRE(serialized.body.size() == aut.trans_size());
+		REQUIRE(serialized.body.front() == std::vector<std::string>({"a97", "q1"}));
+
+		Nta loaded = construct(serialized, &symbol_map, &state_map);
+		REQUIRE(loaded.trans_size() == aut.trans_size());
+
+		Tree tree(symbol_map["a102"], {Tree(symbol_map["a97"]), Tree(symbol_map["a98"])});
+		REQUIRE(is_in_lang(loaded, tree));
+	}
+} // }}}
@@ -0,0 +1,472 @@
+/* parallel.cc -- the process-wide work-stealing thread pool
+ *
+ * Copyright (c) 2018 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// VATA headers
+#include <vata2/parallel.hh>
+#include <vata2/util.hh>
+
+using namespace Vata2::parallel;
+using namespace Vata2::util;
+
+namespace {
+
+/// the pool and the index of the worker running in the current thread
+thread_local ThreadPool* tls_pool = nullptr;
+thread_local size_t tls_index = 0;
+
+/// the job of the asynchronous operation running in the current thread
+thread_local Job* tls_job = nullptr;
+
+/// index of no worker
+const size_t NO_WORKER = static_cast<size_t>(-1);
+
+
+/// the number of threads given by "threads" (including the calling thread)
+size_t parse_threads(const std::string& str)
+{ // {{{
+	size_t threads = 0;
+	try {
+		size_t pos = 0;
+		threads = std::stoul(str, &pos);
+		if (pos != str.size()) { threads = 0; }
+	}
+	catch (const std::exception&) { threads = 0; }
+
+	if (0 == threads) {
+		throw std::runtime_error("invalid number of threads: \"" + str + "\"");
+	}
+
+	return threads;
+} // parse_threads }}}
+
+
+/// the number of workers from VATA_THREADS (or the hardware)
+size_t default_workers()
+{ // {{{
+	const char* env = std::getenv("VATA_THREADS");
+	if (nullptr != env)
+	{
+		try { return parse_threads(env) - 1; }
+		catch (const std::runtime_error& ex) {
+			WARN_PRINT("ignoring VATA_THREADS: " << ex.what());
+		}
+	}
+
+	const size_t hardware = std::thread::hardware_concurrency();
+	return (hardware > 1)? hardware - 1 : 0;
+} // default_workers }}}
+
+
+/// pins the calling thread (worker @p index of @p num_workers)
+void set_affinity(Affinity affinity, size_t index, size_t num_workers)
+{ // {{{
+#ifdef __linux__
+	if (Affinity::NONE == affinity) { return; }
+
+	cpu_set_t allowed;
+	CPU_ZERO(&allowed);
+	if (0 != sched_getaffinity(0, sizeof(allowed), &allowed)) { return; }
+
+	std::vector<int> cpus;
+	for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+		if (CPU_ISSET(cpu, &allowed)) { cpus.push_back(cpu); }
+	}
+	if (cpus.empty()) { return; }
+
+	const size_t slot = (Affinity::COMPACT == affinity)? index % cpus.size() :
+		(index * cpus.size() / num_workers) % cpus.size();
+
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpus[slot], &set);
+	pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+	(void)affinity;
+	(void)index;
+	(void)num_workers;
+#endif
+} // set_affinity }}}
+
+
+/// sets the job of the current thread for the lifetime of the scope
+class JobScope
+{ // {{{
+private:
+
+	Job* saved;
+
+	JobScope(const JobScope&);
+	JobScope& operator=(const JobScope&);
+
+public:
+
+	explicit JobScope(Job* job) : saved(tls_job) { tls_job = job; }
+	~JobScope() { tls_job = this->saved; }
+}; // JobScope }}}
+
+
+/// runs @p task; exceptions of tasks not run through a TaskGroup are lost
+void run_task(const Task& task)
+{ // {{{
+	// a task run while an asynchronous operation waits is not a part of it
+	JobScope scope(nullptr);
+
+	try { task(); }
+	catch (const std::exception& ex) { WARN_PRINT("exception in a task: " << ex.what()); }
+	catch (...) { WARN_PRINT("exception in a task"); }
+} // run_task }}}
+
+} // anonymous namespace
+
+
+ThreadPool::ThreadPool(size_t num_workers)
+{ // {{{
+	this->start(num_workers);
+} // ThreadPool() }}}
+
+
+ThreadPool::~ThreadPool()
+{ // {{{
+	this->shutdown();
+} // ~ThreadPool() }}}
+
+
+ThreadPool& ThreadPool::get()
+{ // {{{
+	static ThreadPool pool(default_workers());
+	return pool;
+} // get }}}
+
+
+void ThreadPool::start(size_t num_workers)
+{ // {{{
+	assert(this->workers.empty());
+
+	{
+		std::lock_guard<std::shared_timed_mutex> lock(this->queues_mtx);
+		assert(this->queues.empty());
+		for (size_t i = 0; i < num_workers; ++i) {
+			this->queues.emplace_back(new Queue());
+		}
+	}
+
+	// set before the workers read it
+	this->num_workers_ = num_workers;
+	for (size_t i = 0; i < num_workers; ++i) {
+		this->workers.emplace_back(&ThreadPool::work, this, i);
+	}
+} // start }}}
+
+
+void ThreadPool::shutdown()
+{ // {{{
+	{
+		std::lock_guard<std::mutex> lock(this->sleep_mtx);
+		this->stop = true;
+	}
+	this->sleep_cv.notify_all();
+
+	// workers are joined before taking queues_mtx, which they take in pop()
+	for (std::thread& worker : this->workers) { worker.join(); }
+	this->workers.clear();
+	this->num_workers_ = 0;
+	this->stop = false;
+
+	// tasks of the workers are kept for the next workers (or run_one());
+	// threads waiting in run_one() only see the vector under queues_mtx
+	std::lock_guard<std::shared_timed_mutex> queues_lock(this->queues_mtx);
+	std::lock_guard<std::mutex> lock(this->shared_queue.mtx);
+	for (auto& queue : this->queues)
+	{
+		for (Task& task : queue->tasks) { this->shared_queue.tasks.push_back(std::move(task)); }
+	}
+
+	this->queues.clear();
+} // shutdown }}}
+
+
+void ThreadPool::configure(const StringDict& params)
+{ // {{{
+	// a worker would join itself
+	assert(this != tls_pool);
+
+	std::lock_guard<std::mutex> lock(this->config_mtx);
+
+	size_t num_workers = this->num_workers();
+	if (haskey(params, "threads")) { num_workers = parse_threads(params.at("threads")) - 1; }
+
+	if (haskey(params, "affinity"))
+	{
+		const std::string& str_affinity = params.at("affinity");
+		if ("none" == str_affinity) { this->affinity = Affinity::NONE; }
+		else if ("compact" == str_affinity) { this->affinity = Affinity::COMPACT; }
+		else if ("scatter" == str_affinity) { this->affinity = Affinity::SCATTER; }
+		else {
+			throw std::runtime_error(std::to_string(__func__) +
+				" received an unknown value of the \"affinity\" key: " + str_affinity);
+		}
+	}
+
+	this->shutdown();
+	this->start(num_workers);
+	if (0 < this->pending) { this->sleep_cv.notify_all(); }
+} // configure }}}
+
+
+void ThreadPool::submit(Task task)
+{ // {{{
+	{
+		std::shared_lock<std::shared_timed_mutex> queues_lock(this->queues_mtx);
+		Queue& queue = (this == tls_pool)? *this->queues[tls_index] : this->shared_queue;
+		std::lock_guard<std::mutex> lock(queue.mtx);
+		queue.tasks.push_back(std::move(task));
+		++this->pending;
+	}
+
+	// taking the lock makes sure that a worker going to sleep sees the task
+	{ std::lock_guard<std::mutex> lock(this->sleep_mtx); }
+	this->sleep_cv.notify_one();
+} // submit }}}
+
+
+bool ThreadPool::pop(Task* task, size_t index)
+{ // {{{
+	assert(nullptr != task);
+
+	auto take = [this, task](Queue& queue, bool back) {
+		std::lock_guard<std::mutex> lock(queue.mtx);
+		if (queue.tasks.empty()) { return false; }
+		if (back) {
+			*task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+		} else {
+			*task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+		}
+
+		--this->pending;
+		return true;
+	};
+
+	// the own deque (LIFO), the shared queue, and then stealing (FIFO)
+	std::shared_lock<std::shared_timed_mutex> queues_lock(this->queues_mtx);
+	const size_t num_queues = this->queues.size();
+	if (NO_WORKER != index && take(*this->queues[index], true)) { return true; }
+	if (take(this->shared_queue, false)) { return true; }
+	for (size_t i = 1; i <= num_queues; ++i)
+	{
+		const size_t victim = (NO_WORKER == index)? i - 1 : (index + i) % num_queues;
+		if (victim != index && take(*this->queues[victim], false)) { return true; }
+	}
+
+	return false;
+} // pop }}}
+
+
+void ThreadPool::work(size_t index)
+{ // {{{
+	tls_pool = this;
+	tls_index = index;
+	set_affinity(this->affinity, index, this->num_workers_);
+
+	Task task;
+	while (true)
+	{
+		if (this->pop(&task, index))
+		{
+			run_task(task);
+			task = nullptr;
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(this->sleep_mtx);
+		this->sleep_cv.wait(lock, [this]() { return this->stop || 0 < this->pending; });
+		if (this->stop) { break; }
+	}
+
+	tls_pool = nullptr;
+} // work }}}
+
+
+bool ThreadPool::run_one()
+{ // {{{
+	Task task;
+	if (!this->pop(&task, (this == tls_pool)? tls_index : NO_WORKER)) { return false; }
+
+	run_task(task);
+	return true;
+} // run_one }}}
+
+
+void TaskGroup::run(Task task)
+{ // {{{
+	++this->unfinished;
+	this->pool.submit([this, task]() {
+		if (!this->cancelled)
+		{
+			try { task(); }
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(this->mtx);
+				if (nullptr == this->exception) { this->exception = std::current_exception(); }
+				this->cancelled = true;
+			}
+		}
+
+		this->finish_one();
+	});
+} // run }}}
+
+
+void TaskGroup::finish_one()
+{ // {{{
+	// under the lock, so that the group cannot be destroyed before notifying
+	std::lock_guard<std::mutex> lock(this->mtx);
+	if (0 == --this->unfinished) { this->done_cv.notify_all(); }
+} // finish_one }}}
+
+
+void TaskGroup::wait_nothrow()
+{ // {{{
+	while (0 < this->unfinished)
+	{
+		// help with queued tasks (of any group) rather than block
+		if (this->pool.run_one()) { continue; }
+
+		std::unique_lock<std::mutex> lock(this->mtx);
+		this->done_cv.wait_for(lock, std::chrono::milliseconds(1),
+			[this]() { return 0 == this->unfinished; });
+	}
+
+	// the last finish_one() may still hold the lock
+	std::lock_guard<std::mutex> lock(this->mtx);
+} // wait_nothrow }}}
+
+
+void TaskGroup::wait()
+{ // {{{
+	this->wait_nothrow();
+
+	std::exception_ptr ex = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(this->mtx);
+		std::swap(ex, this->exception);
+	}
+
+	if (nullptr != ex) { std::rethrow_exception(ex); }
+} // wait }}}
+
+
+size_t Vata2::parallel::get_parallelism(const StringDict& params)
+{ // {{{
+	if (haskey(params, "threads")) { return parse_threads(params.at("threads")); }
+	return ThreadPool::get().num_workers() + 1;
+} // get_parallelism }}}
+
+
+void Vata2::parallel::parallel_for(
+	size_t                              begin,
+	size_t                              end,
+	const std::function<void(size_t)>&  body,
+	const StringDict&                   params)
+{ // {{{
+	if (begin >= end) { return; }
+
+	const size_t size = end - begin;
+	const size_t parallelism = std::min(get_parallelism(params), size);
+	if (1 == parallelism)
+	{
+		for (size_t i = begin; i < end; ++i) { body(i); }
+		return;
+	}
+
+	// chunks are claimed dynamically, so that fast threads take more of them
+	const size_t num_chunks = std::min(size, 4 * parallelism);
+	std::atomic<size_t> next_chunk = { 0 };
+	TaskGroup group;
+	auto worker = [&]() {
+		size_t chunk;
+		while (!group.is_cancelled() && (chunk = next_chunk++) < num_chunks)
+		{
+			const size_t lo = begin + size * chunk / num_chunks;
+			const size_t hi = begin + size * (chunk + 1) / num_chunks;
+			for (size_t i = lo; i < hi; ++i) { body(i); }
+		}
+	};
+
+	for (size_t i = 1; i < parallelism; ++i) { group.run(worker); }
+
+	try { worker(); }
+	catch (...)
+	{
+		group.cancel();
+		throw;
+	}
+
+	group.wait();
+} // parallel_for }}}
+
+
+Progress Job::get_progress() const
+{ // {{{
+	std::lock_guard<std::mutex> lock(this->mtx);
+	return this->progress;
+} // get_progress }}}
+
+
+void Job::report(const Progress& progress)
+{ // {{{
+	if (this->cancelled) { throw Cancelled(); }
+
+	{
+		std::lock_guard<std::mutex> lock(this->mtx);
+		this->progress = progress;
+	}
+
+	if (nullptr == this->callback) { return; }
+
+	const auto now = std::chrono::steady_clock::now();
+	if (now - this->last_report >= this->interval)
+	{
+		this->last_report = now;
+		this->callback(progress);
+	}
+} // report }}}
+
+
+void Vata2::parallel::report_progress(size_t explored, size_t worklist)
+{ // {{{
+	if (nullptr != tls_job) { tls_job->report({explored, worklist}); }
+} // report_progress }}}
+
+
+void Vata2::parallel::submit_job(const std::shared_ptr<Job>& job, Task task)
+{ // {{{
+	ThreadPool::get().submit([job, task]() {
+		JobScope scope(job.get());
+		task();
+	});
+} // submit_job }}}
@@ -15,6 +15,7 @@
  * GNU General Public License for more details.
  */
 
+#include <vata2/parallel.hh>
 #include <vata2/parser.hh>
 #include <vata2/util.hh>
 
@@ -247,6 +248,7 @@ ParsedSection Vata2::Parser::parse_vtf_section(
 		getline(input, line);
 
 		PARSER_DEBUG_PRINT_LN(line);
+		Vata2::parallel::report_progress(result.body.size(), 0);
 
 		if (reading_type) { // we're expecting a @TYPE declaration
 			assert(ch == line[0]);
@@ -0,0 +1,684 @@
+/* regex-aux.hh -- parsing of regular expressions (shared by the compilers)
+ *
+ * Copyright (c) 2018 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _VATA2_REGEX_AUX_HH_
+#define _VATA2_REGEX_AUX_HH_
+
+#include <bitset>
+#include <cctype>
+#include <string>
+#include <vector>
+
+// VATA headers
+#include <vata2/nfa.hh>
+
+namespace Vata2
+{
+namespace regex
+{
+
+/// a set of bytes
+using ByteSet = std::bitset<256>;
+
+/// a node of the syntax tree of a regular expression
+struct Node
+{ // {{{
+	enum Kind { EPSILON, BYTES, CAT, ALT, STAR, PLUS, OPT, REPEAT };
+
+	Kind kind;
+	/// children (CAT, ALT use both, STAR, PLUS, OPT, REPEAT only the left one)
+	size_t left;
+	size_t right;
+	/// the bytes matched (BYTES only)
+	ByteSet bytes;
+	/// the bounds of repetition (REPEAT only)
+	size_t min;
+	size_t max;
+}; // Node }}}
+
+
+/// a recursive-descent parser of regular expressions
+///
+/// Nodes are stored in a vector and every node is created after its
+/// children, so the syntax tree can be processed bottom-up by a single pass
+/// over the vector.  Bounded repetition is expanded, unless the parser is
+/// counting, in which case e{m,n} with n > 1 is kept as a REPEAT node if e
+/// does not contain another REPEAT node.
+class RegexParser
+{ // {{{
+private:
+
+	const std::string& pattern;
+	const bool counting;
+	const size_t repeat_max;
+	size_t pos = 0;
+	size_t depth = 0;
+	/// whether the pattern is an alternative outside of parentheses
+	bool top_alt = false;
+
+	/// the maximum nesting of parentheses (bounds the depth of recursion)
+	static const size_t DEPTH_MAX = 1000;
+	/// the maximum number of nodes (after expanding bounded repetition)
+	static const size_t SIZE_MAX_NODES = 1 << 22;
+
+	RegexParser(const RegexParser&);
+	RegexParser& operator=(const RegexParser&);
+
+	[[noreturn]] void error(const std::string& msg) const
+	{ // {{{
+		throw std::runtime_error("regular expression \"" + this->pattern +
+			"\", position " + std::to_string(this->pos) + ": " + msg);
+	} // error }}}
+
+	bool at_end() const { return this->pos >= this->pattern.size(); }
+	unsigned char peek() const { return this->pattern[this->pos]; }
+
+	size_t add(Node::Kind kind, size_t left = 0, size_t right = 0)
+	{ // {{{
+		this->nodes.push_back({kind, left, right, ByteSet(), 0, 0});
+		return this->nodes.size() - 1;
+	} // add }}}
+
+	size_t add_bytes(const ByteSet& bytes)
+	{ // {{{
+		this->nodes.push_back({Node::BYTES, 0, 0, bytes, 0, 0});
+		return this->nodes.size() - 1;
+	} // add_bytes }}}
+
+	/// copies the subtree rooted in @p node whose nodes start at @p start
+	/// (with fresh positions); returns the root of the copy
+	size_t clone(size_t start, size_t node)
+	{ // {{{
+		const size_t shift = this->nodes.size() - start;
+		if (this->nodes.size() + node - start >= SIZE_MAX_NODES) {
+			this->error("the expression is too large");
+		}
+
+		for (size_t i = start; i <= node; ++i)
+		{
+			Node copy = this->nodes[i];
+			if (Node::EPSILON != copy.kind && Node::BYTES != copy.kind)
+			{
+				copy.left += shift;
+				copy.right += shift;
+			}
+			this->nodes.push_back(copy);
+		}
+
+		return node + shift;
+	} // clone }}}
+
+	/// reads a decimal number (returns false if there is none)
+	bool read_number(size_t* num)
+	{ // {{{
+		if (this->at_end() || !std::isdigit(this->peek())) { return false; }
+
+		*num = 0;
+		while (!this->at_end() && std::isdigit(this->peek()))
+		{
+			*num = *num * 10 + (this->peek() - '0');
+			if (*num > this->repeat_max) { this->error("too large bound of repetition"); }
+			++this->pos;
+		}
+
+		return true;
+	} // read_number }}}
+
+	/// reads the bounds of repetition {m}, {m,}, {m,n}; returns false (and
+	/// does not move) if the text is not a valid bound, which is then taken
+	/// literally
+	bool read_bounds(size_t* min, size_t* max, bool* unbounded)
+	{ // {{{
+		assert('{' == this->peek());
+		const size_t start = this->pos;
+		++this->pos;
+
+		if (!this->read_number(min)) { this->pos = start; return false; }
+
+		*max = *min;
+		*unbounded = false;
+		if (!this->at_end() && ',' == this->peek())
+		{
+			++this->pos;
+			*unbounded = !this->read_number(max);
+		}
+
+		if (this->at_end() || '}' != this->peek()) { this->pos = start; return false; }
+		++this->pos;
+
+		if (!*unbounded && *max < *min) { this->error("invalid bounds of repetition"); }
+		return true;
+	} // read_bounds }}}
+
+	/// checks whether the subtree of @p node starting at @p start can be
+	/// counted
+	bool can_count(size_t start, size_t node) const
+	{ // {{{
+		for (size_t i = start; i <= node; ++i)
+		{
+			if (Node::REPEAT == this->nodes[i].kind) { return false; }
+		}
+
+		return true;
+	} // can_count }}}
+
+	/// expands e{min,max} (or e{min,} if @p unbounded) into e...e(e(e)?)?
+	/// where e is the subtree of @p node starting at @p start
+	size_t repeat(size_t start, size_t node, size_t min, size_t max, bool unbounded)
+	{ // {{{
+		if (this->counting && this->can_count(start, node))
+		{
+			if (!unbounded && max > 1)
+			{
+				this->nodes.push_back({Node::REPEAT, node, 0, ByteSet(), min, max});
+				return this->nodes.size() - 1;
+			}
+
+			if (unbounded && min > 1)
+			{ // e{min,} = e{min}e*
+				size_t tail = this->add(Node::STAR, this->clone(start, node));
+				this->nodes.push_back({Node::REPEAT, node, 0, ByteSet(), min, min});
+				return this->add(Node::CAT, this->nodes.size() - 1, tail);
+			}
+		}
+
+		// the optional tail, built from the inside out
+		size_t tail = 0;
+		bool has_tail = false;
+		if (unbounded)
+		{
+			tail = this->add(Node::STAR, this->clone(start, node));
+			has_tail = true;
+		}
+		else
+		{
+			for (size_t i = min; i < max; ++i)
+			{
+				size_t copy = this->clone(start, node);
+				if (has_tail) { copy = this->add(Node::CAT, copy, tail); }
+				tail = this->add(Node::OPT, copy);
+				has_tail = true;
+			}
+		}
+
+		if (0 == min) { return has_tail? tail : this->add(Node::EPSILON); }
+
+		// the original node is used as the first copy
+		size_t result = node;
+		for (size_t i = 1; i < min; ++i)
+		{
+			result = this->add(Node::CAT, result, this->clone(start, node));
+		}
+
+		return has_tail? this->add(Node::CAT, result, tail) : result;
+	} // repeat }}}
+
+	/// parses a POSIX class name [:name:] (after "[:")
+	ByteSet parse_posix_class()
+	{ // {{{
+		const size_t end = this->pattern.find(":]", this->pos);
+		if (std::string::npos == end) { this->error("unterminated character class name"); }
+		const std::string name = this->pattern.substr(this->pos, end - this->pos);
+		this->pos = end + 2;
+
+		int (*pred)(int) = nullptr;
+		if ("alpha" == name) { pred = isalpha; }
+		else if ("digit" == name) { pred = isdigit; }
+		else if ("alnum" == name) { pred = isalnum; }
+		else if ("space" == name) { pred = isspace; }
+		else if ("upper" == name) { pred = isupper; }
+		else if ("lower" == name) { pred = islower; }
+		else if ("punct" == name) { pred = ispunct; }
+		else if ("xdigit" == name) { pred = isxdigit; }
+		else if ("print" == name) { pred = isprint; }
+		else if ("graph" == name) { pred = isgraph; }
+		else if ("cntrl" == name) { pred = iscntrl; }
+		else if ("blank" == name) { pred = isblank; }
+		else { this->error("unknown character class name \"" + name + "\""); }
+
+		// only ASCII is classified (independently of the locale)
+		ByteSet result;
+		for (int byte = 0; byte < 128; ++byte)
+		{
+			if (pred(byte)) { result.set(byte); }
+		}
+
+		return result;
+	} // parse_posix_class }}}
+
+	/// parses an escape sequence (after the backslash); returns false if it
+	/// denotes a class (stored into @p bytes) rather than a single byte
+	/// (stored into @p byte)
+	bool parse_escape(unsigned char* byte, ByteSet* bytes)
+	{ // {{{
+		if (this->at_end()) { this->error("trailing backslash"); }
+
+		const unsigned char chr = this->peek();
+		++this->pos;
+
+		auto make_class = [bytes](int (*pred)(int), bool negate) {
+			bytes->reset();
+			for (int i = 0; i < 128; ++i)
+			{
+				if (pred(i)) { bytes->set(i); }
+			}
+			if (isalnum == pred) { bytes->set('_'); }
+			if (negate) { bytes->flip(); }
+			return false;
+		};
+
+		switch (chr)
+		{
+			case 'd': return make_class(isdigit, false);
+			case 'D': return make_class(isdigit, true);
+			case 'w': return make_class(isalnum, false);   // with '_'
+			case 'W': return make_class(isalnum, true);
+			case 's': return make_class(isspace, false);
+			case 'S': return make_class(isspace, true);
+			case 'n': *byte = '\n'; return true;
+			case 'r': *byte = '\r'; return true;
+			case 't': *byte = '\t'; return true;
+			case 'f': *byte = '\f'; return true;
+			case 'v': *byte = '\v'; return true;
+			case 'a': *byte = '\a'; return true;
+			case 'e': *byte = 0x1b; return true;
+			case '0': *byte = 0; return true;
+			case 'x':
+			{
+				unsigned value = 0;
+				size_t digits = 0;
+				while (digits < 2 && !this->at_end() && std::isxdigit(this->peek()))
+				{
+					const unsigned char hex = std::tolower(this->peek());
+					value = value * 16 + (std::isdigit(hex)? hex - '0' : hex - 'a' + 10);
+					++digits;
+					++this->pos;
+				}
+				if (0 == digits) { this->error("invalid \\x escape"); }
+				*byte = static_cast<unsigned char>(value);
+				return true;
+			}
+			default:
+				if (std::isalnum(chr)) {
+					--this->pos;
+					this->error(std::string("unsupported escape \\") + static_cast<char>(chr));
+				}
+				*byte = chr;
+				return true;
+		}
+	} // parse_escape }}}
+
+	/// parses a bracket expression (after '[')
+	ByteSet parse_bracket()
+	{ // {{{
+		ByteSet result;
+		bool negate = false;
+		if (!this->at_end() && '^' == this->peek()) { negate = true; ++this->pos; }
+
+		bool first = true;
+		while (true)
+		{
+			if (this->at_end()) { this->error("unterminated bracket expression"); }
+			if (']' == this->peek() && !first) { ++this->pos; break; }
+			first = false;
+
+			// the lower end of a range (or a class)
+			unsigned char low;
+			if (0 == this->pattern.compare(this->pos, 2, "[:"))
+			{
+				this->pos += 2;
+				result |= this->parse_posix_class();
+				continue;
+			}
+			else if ('\\' == this->peek())
+			{
+				++this->pos;
+				ByteSet bytes;
+				if (!this->parse_escape(&low, &bytes)) { result |= bytes; continue; }
+			}
+			else
+			{
+				low = this->peek();
+				++this->pos;
+			}
+
+			// a range?
+			if (this->pos + 1 < this->pattern.size() && '-' == this->peek() &&
+				']' != this->pattern[this->pos + 1])
+			{
+				++this->pos;
+				unsigned char high;
+				if ('\\' == this->peek())
+				{
+					++this->pos;
+					ByteSet bytes;
+					if (!this->parse_escape(&high, &bytes)) { this->error("invalid range"); }
+				}
+				else
+				{
+					high = this->peek();
+					++this->pos;
+				}
+
+				if (high < low) { this->error("invalid range"); }
+				for (unsigned i = low; i <= high; ++i) { result.set(i); }
+			}
+			else
+			{
+				result.set(low);
+			}
+		}
+
+		if (negate) { result.flip(); }
+		return result;
+	} // parse_bracket }}}
+
+	size_t parse_atom()
+	{ // {{{
+		const unsigned char chr = this->peek();
+		++this->pos;
+
+		switch (chr)
+		{
+			case '(':
+			{
+				if (0 == this->pattern.compare(this->pos, 2, "?:")) { this->pos += 2; }
+				if (++this->depth > DEPTH_MAX) { this->error("too deep nesting"); }
+				size_t node = this->parse_alt();
+				--this->depth;
+				if (this->at_end() || ')' != this->peek()) { this->error("missing )"); }
+				++this->pos;
+				return node;
+			}
+			case '[': return this->add_bytes(this->parse_bracket());
+			case '.': return this->add_bytes(ByteSet().set());
+			case '\\':
+			{
+				unsigned char byte;
+				ByteSet bytes;
+				if (this->parse_escape(&byte, &bytes)) { bytes.set(byte); }
+				return this->add_bytes(bytes);
+			}
+			case '*': // fallthrough
+			case '+': // fallthrough
+			case '?':
+				--this->pos;
+				this->error("nothing to repeat");
+			case '^': // fallthrough
+			case '$':
+				--this->pos;
+				this->error("anchors are supported only at the ends of the expression");
+			default:
+				return this->add_bytes(ByteSet().set(chr));
+		}
+	} // parse_atom }}}
+
+	size_t parse_repeat()
+	{ // {{{
+		const size_t start = this->nodes.size();
+		size_t node = this->parse_atom();
+		while (!this->at_end())
+		{
+			const unsigned char chr = this->peek();
+			if ('*' == chr) { node = this->add(Node::STAR, node); }
+			else if ('+' == chr) { node = this->add(Node::PLUS, node); }
+			else if ('?' == chr) { node = this->add(Node::OPT, node); }
+			else if ('{' == chr)
+			{
+				size_t min, max;
+				bool unbounded;
+				if (!this->read_bounds(&min, &max, &unbounded)) { break; }
+				node = this->repeat(start, node, min, max, unbounded);
+				// lazy quantifiers (PCRE) denote the same language
+				if (!this->at_end() && '?' == this->peek()) { ++this->pos; }
+				continue;
+			}
+			else { break; }
+
+			++this->pos;
+			if (!this->at_end() && '?' == this->peek()) { ++this->pos; }
+		}
+
+		return node;
+	} // parse_repeat }}}
+
+	size_t parse_cat()
+	{ // {{{
+		bool empty = true;
+		size_t node = 0;
+		while (!this->at_end() && '|' != this->peek() && ')' != this->peek())
+		{
+			// the final anchor
+			if ('$' == this->peek() && this->pos + 1 == this->pattern.size() && 0 == this->depth)
+			{
+				++this->pos;
+				this->anchored_end = true;
+				break;
+			}
+
+			size_t next = this->parse_repeat();
+			node = empty? next : this->add(Node::CAT, node, next);
+			empty = false;
+		}
+
+		return empty? this->add(Node::EPSILON) : node;
+	} // parse_cat }}}
+
+	size_t parse_alt()
+	{ // {{{
+		size_t node = this->parse_cat();
+		while (!this->at_end() && '|' == this->peek())
+		{
+			++this->pos;
+			if (0 == this->depth) { this->top_alt = true; }
+			node = this->add(Node::ALT, node, this->parse_cat());
+		}
+
+		return node;
+	} // parse_alt }}}
+
+public:
+
+	std::vector<Node> nodes = { };
+
+	/// whether the pattern starts with ^ (ends with $); the anchors apply to
+	/// the whole pattern only if it is not an alternative (outside of
+	/// parentheses)
+	bool anchored_begin = false;
+	bool anchored_end = false;
+
+	/// @p repeat_max bounds m and n in e{m,n}
+	explicit RegexParser(
+		const std::string&  pattern,
+		bool                counting = false,
+		size_t              repeat_max = Vata2::Nfa::REGEX_REPEAT_MAX) :
+		pattern(pattern),
+		counting(counting),
+		repeat_max(repeat_max)
+	{ }
+
+	/// parses the whole pattern; returns the root
+	size_t parse()
+	{ // {{{
+		// the initial anchor
+		if (!this->at_end() && '^' == this->peek())
+		{
+			++this->pos;
+			this->anchored_begin = true;
+		}
+
+		size_t root = this->parse_alt();
+		if (!this->at_end()) { this->error("unmatched )"); }
+		return root;
+	} // parse }}}
+
+	/// checks that the anchors apply to the whole pattern (which matters only
+	/// when searching)
+	void check_anchors() const
+	{ // {{{
+		if ((this->anchored_begin || this->anchored_end) && this->top_alt) {
+			this->error("anchors of a single alternative are not supported in the search mode");
+		}
+	} // check_anchors }}}
+}; // RegexParser }}}
+
+
+/// appends @p src to @p dst (the larger of the two is used as the base)
+inline void merge_into(std::vector<size_t>& dst, std::vector<size_t>& src)
+{ // {{{
+	if (dst.size() < src.size()) { std::swap(dst, src); }
+	dst.insert(dst.end(), src.begin(), src.end());
+	src.clear();
+} // merge_into }}}
+
+
+
+/**
+ * @brief  The sets of the Glushkov construction
+ *
+ * Positions are the indices of BYTES nodes.  Every follow edge remembers
+ * the node that created it (a CAT, STAR, PLUS or REPEAT node), which is
+ * needed to tell the iterations of REPEAT nodes apart.
+ */
+struct Glushkov
+{ // {{{
+	/// an edge of the follow relation
+	struct Edge
+	{ // {{{
+		size_t tgt;
+		size_t creator;
+	}; // Edge }}}
+
+	bool nullable = false;
+	std::vector<size_t> first = { };
+	std::vector<size_t> last = { };
+	std::vector<std::vector<Edge>> follow = { };
+}; // Glushkov }}}
+
+
+/// computes the Glushkov sets of the expression with @p nodes rooted in @p root
+///
+/// Since children precede their parents, the sets are computed in one pass
+/// and the sets of children are moved into their parents.
+inline Glushkov compute_glushkov(const std::vector<Node>& nodes, size_t root)
+{ // {{{
+	std::vector<bool> nullable(nodes.size());
+	std::vector<std::vector<size_t>> first(nodes.size());
+	std::vector<std::vector<size_t>> last(nodes.size());
+
+	Glushkov result;
+	result.follow.resize(nodes.size());
+
+	auto link = [&result](const std::vector<size_t>& from, const std::vector<size_t>& to,
+		size_t creator)
+	{
+		for (size_t src : from)
+		{
+			for (size_t tgt : to) { result.follow[src].push_back({tgt, creator}); }
+		}
+	};
+
+	for (size_t i = 0; i < nodes.size(); ++i)
+	{
+		const Node& node = nodes[i];
+		const size_t lhs = node.left;
+		const size_t rhs = node.right;
+		switch (node.kind)
+		{
+			case Node::EPSILON:
+				nullable[i] = true;
+				break;
+			case Node::BYTES:
+				nullable[i] = false;
+				first[i] = {i};
+				last[i] = {i};
+				break;
+			case Node::CAT:
+				link(last[lhs], first[rhs], i);
+				nullable[i] = nullable[lhs] && nullable[rhs];
+				first[i] = std::move(first[lhs]);
+				if (nullable[lhs]) { merge_into(first[i], first[rhs]); }
+				last[i] = std::move(last[rhs]);
+				if (nullable[rhs]) { merge_into(last[i], last[lhs]); }
+				break;
+			case Node::ALT:
+				nullable[i] = nullable[lhs] || nullable[rhs];
+				first[i] = std::move(first[lhs]);
+				merge_into(first[i], first[rhs]);
+				last[i] = std::move(last[lhs]);
+				merge_into(last[i], last[rhs]);
+				break;
+			case Node::STAR: // fallthrough
+			case Node::PLUS: // fallthrough
+			case Node::OPT: // fallthrough
+			case Node::REPEAT:
+				if (Node::OPT != node.kind) { link(last[lhs], first[lhs], i); }
+				nullable[i] = nullable[lhs] || Node::STAR == node.kind ||
+					Node::OPT == node.kind || (Node::REPEAT == node.kind && 0 == node.min);
+				first[i] = std::move(first[lhs]);
+				last[i] = std::move(last[lhs]);
+				break;
+		}
+	}
+
+	result.nullable = nullable[root];
+	result.first = std::move(first[root]);
+	result.last = std::move(last[root]);
+	return result;
+} // compute_glushkov }}}
+
+
+/// the symbols (bytes) of every position (computed on demand)
+class PositionSymbols
+{ // {{{
+private:
+
+	const std::vector<Node>& nodes;
+	std::vector<std::vector<Vata2::Nfa::Symbol>> symbols = { };
+
+	PositionSymbols(const PositionSymbols&);
+	PositionSymbols& operator=(const PositionSymbols&);
+
+public:
+
+	explicit PositionSymbols(const std::vector<Node>& nodes) :
+		nodes(nodes)
+	{
+		this->symbols.resize(nodes.size());
+	}
+
+	const std::vector<Vata2::Nfa::Symbol>& operator[](size_t pos)
+	{ // {{{
+		std::vector<Vata2::Nfa::Symbol>& result = this->symbols[pos];
+		const ByteSet& bytes = this->nodes[pos].bytes;
+		if (result.empty() && bytes.any())
+		{
+			for (size_t byte = 0; byte < bytes.size(); ++byte)
+			{
+				if (bytes.test(byte)) { result.push_back(byte); }
+			}
+		}
+
+		return result;
+	} // operator[] }}}
+}; // PositionSymbols }}}
+
+// CLOSING NAMESPACES AND GUARDS
+} /* regex */
+} /* Vata2 */
+
+#endif /* _VATA2_REGEX_AUX_HH_ */
@@ -0,0 +1,78 @@
+/* rrt-fixpoint.cc -- iteration of RRT images until a fixpoint is reached
+ *
+ * Copyright (c) 2020 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+// VATA headers
+#include <vata2/rrt.hh>
+
+using namespace Vata2::Rrt;
+using namespace Vata2::util;
+
+using Vata2::Nfa::StringDict;
+
+
+bool Vata2::Rrt::reach_fixpoint(
+	Vata2::Nfa::Nfa*        result,
+	const Rrt&              rrt,
+	const Vata2::Nfa::Nfa&  init,
+	const StringDict&       params,
+	size_t*                 num_iter)
+{ // {{{
+	assert(nullptr != result);
+
+	bool do_reduce = true;
+	if (haskey(params, "reduce")) {
+		const std::string& str_reduce = params.at("reduce");
+		if ("none" == str_reduce) { do_reduce = false; }
+		else if ("bisim" != str_reduce) {
+			throw std::runtime_error(std::to_string(__func__) +
+				" received an unknown value of the \"reduce\" key: " + str_reduce);
+		}
+	}
+
+	const StringDict reduce_params = {{"algo", "bisim"}};
+	StringDict widen_params;
+	if (haskey(params, "widen")) {
+		widen_params = {{"algo", "bisim"}, {"depth", params.at("widen")}};
+	}
+
+	size_t max_iter = 0;
+	if (haskey(params, "max_iter")) { max_iter = std::stoul(params.at("max_iter")); }
+
+	Vata2::Nfa::Nfa iterate = do_reduce? Vata2::Nfa::reduce(init, reduce_params) : init;
+	for (size_t i = 0; ; ++i) {
+		if (nullptr != num_iter) { *num_iter = i; }
+
+		// the image is constructed only as far as needed to find a word that is
+		// not in the current iterate
+		NfaImage image(rrt, iterate);
+		if (is_incl(image, iterate)) {
+			*result = std::move(iterate);
+			return true;
+		}
+
+		if (0 != max_iter && i == max_iter) { break; }
+
+		Vata2::Nfa::Nfa post;
+		image.explore(&post);
+		iterate = Vata2::Nfa::union_rename(iterate, post);
+		if (do_reduce) { iterate = Vata2::Nfa::reduce(iterate, reduce_params); }
+		if (!widen_params.empty()) { iterate = Vata2::Nfa::reduce(iterate, widen_params); }
+	}
+
+	*result = std::move(iterate);
+	return false;
+} // reach_fixpoint }}}
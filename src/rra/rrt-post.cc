@@ -0,0 +1,388 @@
+/* rrt-post.cc -- on-the-fly image of an NFA under an RRT
+ *
+ * Copyright (c) 2020 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <deque>
+#include <unordered_set>
+
+// VATA headers
+#include <vata2/rrt.hh>
+
+using namespace Vata2::Rrt;
+using namespace Vata2::util;
+
+using Vata2::Nfa::Path;
+using Vata2::Nfa::StateSet;
+using Vata2::Nfa::Word;
+
+using GuardType = Trans::Guard::GuardType;
+using UpdateType = Trans::Update::UpdateType;
+using OutputType = Trans::Output::OutputType;
+
+namespace
+{ // {{{
+
+/// evaluates a comparison of @p symb with @p reg_val (which may be unassigned)
+bool eval_reg_cmp(Symbol symb, Symbol reg_val, bool equal)
+{ // {{{
+	if (NO_VALUE == reg_val) { return !equal; }
+	return (symb == reg_val) == equal;
+} // eval_reg_cmp }}}
+
+bool eval_guard(
+	const Trans::Guard&  grd,
+	Symbol               in1,
+	Symbol               in2,
+	const RegValuation&  val)
+{ // {{{
+	switch (grd.type) {
+		case GuardType::IN1_VAR:
+		case GuardType::IN2_VAR:   return true;
+		case GuardType::IN1_EQ:    return eval_reg_cmp(in1, val[grd.val], true);
+		case GuardType::IN2_EQ:    return eval_reg_cmp(in2, val[grd.val], true);
+		case GuardType::IN1_NEQ:   return eval_reg_cmp(in1, val[grd.val], false);
+		case GuardType::IN2_NEQ:   return eval_reg_cmp(in2, val[grd.val], false);
+		case GuardType::IN1_IS:    return in1 == grd.val;
+		case GuardType::IN2_IS:    return in2 == grd.val;
+		case GuardType::IN1_ISNOT: return in1 != grd.val;
+		case GuardType::IN2_ISNOT: return in2 != grd.val;
+		case GuardType::INS_EQ:    return in1 == in2;
+		case GuardType::INS_NEQ:   return in1 != in2;
+		default: assert(false); return false;
+	}
+} // eval_guard }}}
+
+/// the register (or auxiliary memory, if @p aux) accessed by a guard, an
+/// update, or an output (if any)
+template <class Item>
+bool get_register(const Item& item, bool* aux);
+
+template <>
+bool get_register(const Trans::Guard& grd, bool* aux)
+{ // {{{
+	*aux = false;
+	switch (grd.type) {
+		case GuardType::IN1_EQ:
+		case GuardType::IN2_EQ:
+		case GuardType::IN1_NEQ:
+		case GuardType::IN2_NEQ: return true;
+		default: return false;
+	}
+} // get_register(Guard) }}}
+
+template <>
+bool get_register(const Trans::Update& upd, bool* aux)
+{ // {{{
+	switch (upd.type) {
+		case UpdateType::REG_STORE_IN1:
+		case UpdateType::REG_STORE_IN2:
+		case UpdateType::REG_CLEAR: *aux = false; return true;
+		case UpdateType::AUX_STORE_IN1:
+		case UpdateType::AUX_STORE_IN2:
+		case UpdateType::AUX_CLEAR: *aux = true; return true;
+		default: assert(false); return false;
+	}
+} // get_register(Update) }}}
+
+template <>
+bool get_register(const Trans::Output& out, bool* aux)
+{ // {{{
+	switch (out.type) {
+		case OutputType::PUT_REG: *aux = false; return true;
+		case OutputType::PUT_AUX: *aux = true; return true;
+		default: return false;
+	}
+} // get_register(Output) }}}
+
+} // anonymous namespace }}}
+
+
+NfaImage::NfaImage(const Rrt& rrt, const Vata2::Nfa::Nfa& nfa) :
+	rrt(rrt),
+	nfa(nfa)
+{ // {{{
+	// the numbers of registers and auxiliary memories used by the labels
+	auto update_num = [&](const auto& item) {
+		bool aux;
+		if (get_register(item, &aux)) {
+			size_t& num = aux? this->num_aux : this->num_regs;
+			num = std::max(num, static_cast<size_t>(item.val) + 1);
+		}
+	};
+
+	const LabelTable& labels = rrt.get_labels();
+	for (LabelId id = 0; id < labels.size(); ++id) {
+		const Trans::Label& lbl = labels[id];
+		for (const Trans::Guard& grd : lbl.guards) { update_num(grd); }
+		for (const Trans::Update& upd : lbl.updates) { update_num(upd); }
+		update_num(lbl.out1);
+		update_num(lbl.out2);
+	}
+
+	ValuationId empty = this->get_valuation_id(
+		RegValuation(this->num_regs + this->num_aux, NO_VALUE));
+	for (State rrt_init : rrt.initialstates) {
+		for (State nfa_init : nfa.initialstates) {
+			this->initialstates.insert(this->get_state({rrt_init, nfa_init, empty}));
+		}
+	}
+} // NfaImage::NfaImage }}}
+
+
+NfaImage::ValuationId NfaImage::get_valuation_id(const RegValuation& val)
+{ // {{{
+	auto it_ins = this->valuation_ids.insert({val, this->valuations.size()});
+	if (it_ins.second) { this->valuations.push_back(val); }
+	return it_ins.first->second;
+} // get_valuation_id }}}
+
+
+State NfaImage::get_state(const Config& conf)
+{ // {{{
+	auto it_ins = this->config_ids.insert({conf, this->configs.size()});
+	if (it_ins.second) {
+		this->configs.push_back(conf);
+		this->posts.emplace_back();
+		this->expanded.push_back(false);
+	}
+
+	return it_ins.first->second;
+} // get_state }}}
+
+
+bool NfaImage::fire(
+	const Trans::Label&  lbl,
+	Symbol               in1,
+	Symbol               in2,
+	const RegValuation&  val,
+	Symbol*              out,
+	RegValuation*        new_val) const
+{ // {{{
+	assert(nullptr != out);
+	assert(nullptr != new_val);
+
+	for (const Trans::Guard& grd : lbl.guards) {
+		if (!eval_guard(grd, in1, in2, val)) { return false; }
+	}
+
+	Symbol out_symb[2];
+	const Trans::Output* outputs[2] = { &lbl.out1, &lbl.out2 };
+	for (size_t i = 0; i < 2; ++i) {
+		switch (outputs[i]->type) {
+			case OutputType::PUT_REG: out_symb[i] = val[outputs[i]->val]; break;
+			case OutputType::PUT_AUX: out_symb[i] = val[this->num_regs + outputs[i]->val]; break;
+			case OutputType::PUT_IN1: out_symb[i] = in1; break;
+			case OutputType::PUT_IN2: out_symb[i] = in2; break;
+			default: assert(false);
+		}
+
+		if (NO_VALUE == out_symb[i]) { return false; }
+	}
+
+	*new_val = val;
+	for (const Trans::Update& upd : lbl.updates) {
+		switch (upd.type) {
+			case UpdateType::REG_STORE_IN1: (*new_val)[upd.val] = in1; break;
+			case UpdateType::REG_STORE_IN2: (*new_val)[upd.val] = in2; break;
+			case UpdateType::AUX_STORE_IN1: (*new_val)[this->num_regs + upd.val] = in1; break;
+			case UpdateType::AUX_STORE_IN2: (*new_val)[this->num_regs + upd.val] = in2; break;
+			case UpdateType::REG_CLEAR: (*new_val)[upd.val] = NO_VALUE; break;
+			case UpdateType::AUX_CLEAR: (*new_val)[this->num_regs + upd.val] = NO_VALUE; break;
+			default: assert(false);
+		}
+	}
+
+	*out = encode_symbol_pair(out_symb[0], out_symb[1]);
+	return true;
+} // fire }}}
+
+
+const std::vector<NfaImage::SymbTgt>& NfaImage::post(State st)
+{ // {{{
+	assert(st < this->configs.size());
+	if (this->expanded[st]) { return this->posts[st]; }
+
+	// copied since the containers may grow
+	const Config conf = this->configs[st];
+	const Vata2::Nfa::PostSymb* nfa_post = this->nfa.post(conf.nfa_state);
+
+	std::vector<SymbTgt> result;
+	if (nullptr != nfa_post) {
+		RegValuation new_val;
+		for (const auto& symb_tgts : *nfa_post) {
+			const std::pair<Symbol, Symbol> in = decode_symbol_pair(symb_tgts.first);
+			this->rrt.for_each_trans(conf.rrt_state, in.first, [&](LabelId id, State rrt_tgt) {
+				Symbol out;
+				if (!this->fire(this->rrt.get_label(id), in.first, in.second,
+					this->valuations[conf.val], &out, &new_val)) { return; }
+
+				ValuationId val_id = this->get_valuation_id(new_val);
+				for (State nfa_tgt : symb_tgts.second) {
+					result.push_back({out, this->get_state({rrt_tgt, nfa_tgt, val_id})});
+				}
+			});
+		}
+	}
+
+	std::sort(result.begin(), result.end());
+	result.erase(std::unique(result.begin(), result.end()), result.end());
+
+	this->posts[st] = std::move(result);
+	this->expanded[st] = true;
+	return this->posts[st];
+} // post }}}
+
+
+bool Vata2::Rrt::is_lang_empty(NfaImage& image, Path* cex)
+{ // {{{
+	std::deque<State> worklist(image.initialstates.begin(), image.initialstates.end());
+	std::unordered_map<State, State> paths;
+	for (State st : image.initialstates) { paths[st] = st; }
+
+	while (!worklist.empty()) {
+		State st = worklist.front();
+		worklist.pop_front();
+
+		if (image.has_final(st)) {
+			if (nullptr != cex) {
+				cex->clear();
+				cex->push_back(st);
+				while (paths[st] != st) {
+					st = paths[st];
+					cex->push_back(st);
+				}
+
+				std::reverse(cex->begin(), cex->end());
+			}
+
+			return false;
+		}
+
+		for (const NfaImage::SymbTgt& symb_tgt : image.post(st)) {
+			if (paths.insert({symb_tgt.second, st}).second) {
+				worklist.push_back(symb_tgt.second);
+			}
+		}
+	}
+
+	return true;
+} // is_lang_empty(NfaImage) }}}
+
+
+bool Vata2::Rrt::is_incl(NfaImage& image, const Vata2::Nfa::Nfa& bigger, Word* cex)
+{ // {{{
+	using ProdState = std::pair<State, StateSet>;
+	// the predecessor of a product state and the symbol read from it
+	using Pred = std::pair<const ProdState*, Symbol>;
+
+	// all product states (for counterexamples), the antichain of the ones with
+	// minimal sets of states of 'bigger' for every state of the image, and the
+	// ones removed from the antichain (skipped in the worklist)
+	std::unordered_map<ProdState, Pred> processed;
+	std::unordered_map<State, std::vector<const ProdState*>> antichain;
+	std::unordered_set<const ProdState*> subsumed;
+	std::deque<const ProdState*> worklist;
+
+	auto is_subset = [](const StateSet& lhs, const StateSet& rhs) {
+		return lhs.size() <= rhs.size() &&
+			std::includes(rhs.begin(), rhs.end(), lhs.begin(), lhs.end());
+	};
+
+	// a product state (s, S) is subsumed by (s, S') if S' is a subset of S:
+	// every word that is a counterexample from the former is one from the latter
+	auto insert = [&](ProdState&& prod, Pred pred) {
+		std::vector<const ProdState*>& chain = antichain[prod.first];
+		for (const ProdState* other : chain) {
+			if (is_subset(other->second, prod.second)) { return; }
+		}
+
+		auto it_ins = processed.insert({std::move(prod), pred});
+		assert(it_ins.second);
+		const ProdState* inserted = &it_ins.first->first;
+
+		auto it = std::remove_if(chain.begin(), chain.end(),
+			[&](const ProdState* other) {
+				if (!is_subset(inserted->second, other->second)) { return false; }
+				subsumed.insert(other);
+				return true;
+			});
+		chain.erase(it, chain.end());
+		chain.push_back(inserted);
+		worklist.push_back(inserted);
+	};
+
+	for (State st : image.initialstates) {
+		insert({st, bigger.initialstates}, {nullptr, 0});
+	}
+
+	while (!worklist.empty()) {
+		const ProdState* prod = worklist.front();
+		worklist.pop_front();
+		if (haskey(subsumed, prod)) { continue; }
+
+		if (image.has_final(prod->first) &&
+			!std::any_of(prod->second.begin(), prod->second.end(),
+				[&bigger](State st) { return bigger.has_final(st); }))
+		{
+			if (nullptr != cex) {
+				cex->clear();
+				for (Pred pred = processed[*prod]; nullptr != pred.first;
+					pred = processed[*pred.first])
+				{
+					cex->push_back(pred.second);
+				}
+
+				std::reverse(cex->begin(), cex->end());
+			}
+
+			return false;
+		}
+
+		for (const NfaImage::SymbTgt& symb_tgt : image.post(prod->first)) {
+			insert({symb_tgt.second, bigger.post(prod->second, symb_tgt.first)},
+				{prod, symb_tgt.first});
+		}
+	}
+
+	return true;
+} // is_incl(NfaImage) }}}
+
+
+void NfaImage::explore(Vata2::Nfa::Nfa* result)
+{ // {{{
+	assert(nullptr != result);
+
+	*result = Vata2::Nfa::Nfa();
+	result->initialstates = this->initialstates;
+
+	// states are numbered in the order of their discovery, so it suffices to
+	// expand them one by one
+	for (State st = 0; st < this->num_states(); ++st) {
+		if (this->has_final(st)) { result->add_final(st); }
+		for (const SymbTgt& symb_tgt : this->post(st)) {
+			result->add_trans(st, symb_tgt.first, symb_tgt.second);
+		}
+	}
+} // explore }}}
+
+
+Vata2::Nfa::Nfa Vata2::Rrt::post_of_nfa(const Rrt& rrt, const Vata2::Nfa::Nfa& nfa)
+{ // {{{
+	NfaImage image(rrt, nfa);
+	Vata2::Nfa::Nfa result;
+	image.explore(&result);
+	return result;
+} // post_of_nfa }}}
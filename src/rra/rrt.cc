@@ -15,9 +15,13 @@
  * GNU General Public License for more details.
  */
 
+#include <algorithm>
+
 #include <vata2/rrt.hh>
 
 using Vata2::Nfa::Nfa;
+using Vata2::Rrt::LabelId;
+using Vata2::Rrt::LabelTgt;
 
 bool Vata2::Rrt::Trans::Guard::operator==(const Guard& rhs) const
 { // {{{
@@ -42,6 +46,26 @@ bool Vata2::Rrt::Trans::Guard::operator==(const Guard& rhs) const
   }
 } // Guard::operator== }}}
 
+Vata2::Rrt::Trans::Guard Vata2::Rrt::Trans::Guard::normalized() const
+{ // {{{
+  switch (this->type)
+  {
+    case GuardType::IN1_VAR:
+    case GuardType::IN2_VAR:
+    case GuardType::INS_EQ:
+    case GuardType::INS_NEQ: return {this->type, 0};
+    default: return *this;
+  }
+} // Guard::normalized }}}
+
+bool Vata2::Rrt::Trans::Guard::operator<(const Guard& rhs) const
+{ // {{{
+  Guard lhs_norm = this->normalized();
+  Guard rhs_norm = rhs.normalized();
+  if (lhs_norm.type != rhs_norm.type) return lhs_norm.type < rhs_norm.type;
+  return lhs_norm.val < rhs_norm.val;
+} // Guard::operator< }}}
+
 bool Vata2::Rrt::Trans::Output::operator==(const Output& rhs) const
 { // {{{
   if (this->type != rhs.type) return false;
@@ -54,6 +78,15 @@ bool Vata2::Rrt::Trans::Output::operator==(const Output& rhs) const
   }
 } // Output::operator== }}}
 
+Vata2::Rrt::Trans::Output Vata2::Rrt::Trans::Output::normalized() const
+{ // {{{
+  switch (this->type) {
+    case OutputType::PUT_IN1:
+    case OutputType::PUT_IN2: return {this->type, 0};
+    default: return *this;
+  }
+} // Output::normalized }}}
+
 bool Vata2::Rrt::Trans::Update::operator==(const Update& rhs) const
 { // {{{
   if (this->type != rhs.type) return false;
@@ -68,36 +101,109 @@ bool Vata2::Rrt::Trans::Update::operator==(const Update& rhs) const
   }
 } // Update::operator== }}}
 
-bool Vata2::Rrt::Trans::Label::operator==(const Label& rhs) const
+bool Vata2::Rrt::Trans::Update::operator<(const Update& rhs) const
+{ // {{{
+  if (this->type != rhs.type) return this->type < rhs.type;
+  return this->val < rhs.val;
+} // Update::operator< }}}
+
+Vata2::Rrt::Trans::Label Vata2::Rrt::Trans::Label::canonical() const
+{ // {{{
+  Label result;
+  for (const Guard& grd : this->guards) { result.guards.push_back(grd.normalized()); }
+  std::sort(result.guards.begin(), result.guards.end());
+  result.guards.erase(std::unique(result.guards.begin(), result.guards.end()),
+    result.guards.end());
+
+  result.updates = this->updates;
+  std::sort(result.updates.begin(), result.updates.end());
+  result.updates.erase(std::unique(result.updates.begin(), result.updates.end()),
+    result.updates.end());
+
+  result.out1 = this->out1.normalized();
+  result.out2 = this->out2.normalized();
+  return result;
+} // Label::canonical }}}
+
+bool Vata2::Rrt::Trans::Label::get_in1_symbol(Symbol* symb) const
 { // {{{
-  if ((this->out1 != rhs.out1) && (this->out2 != rhs.out2)) return false;
-  // FIXME: this is probably not optimal
+  assert(nullptr != symb);
+
+  bool found = false;
   for (const Guard& grd : this->guards) {
-    if (!util::is_in(grd, rhs.guards)) return false;
-  }
-  for (const Guard& grd : rhs.guards) {
-    if (!util::is_in(grd, this->guards)) return false;
+    if (Guard::GuardType::IN1_IS == grd.type && (!found || grd.val < *symb)) {
+      *symb = grd.val;
+      found = true;
+    }
   }
 
-  for (const Update& upd : this->updates) {
-    if (!util::is_in(upd, rhs.updates)) return false;
+  return found;
+} // Label::get_in1_symbol }}}
+
+bool Vata2::Rrt::Trans::Label::operator==(const Label& rhs) const
+{ // {{{
+  if ((this->out1 != rhs.out1) || (this->out2 != rhs.out2)) return false;
+
+  Label lhs_canon = this->canonical();
+  Label rhs_canon = rhs.canonical();
+  return lhs_canon.guards == rhs_canon.guards && lhs_canon.updates == rhs_canon.updates;
+} // Label::operator== }}}
+
+size_t Vata2::Rrt::LabelHash::operator()(const Trans::Label& lbl) const
+{ // {{{
+  auto hash_item = [](size_t accum, uint8_t type, Symbol val) {
+    accum = Vata2::util::hash_combine(accum, type);
+    return Vata2::util::hash_combine(accum, val);
+  };
+
+  size_t accum = lbl.guards.size();
+  for (const Trans::Guard& grd : lbl.guards) {
+    accum = hash_item(accum, static_cast<uint8_t>(grd.type), grd.val);
   }
-  for (const Update& upd : rhs.updates) {
-    if (!util::is_in(upd, this->updates)) return false;
+
+  accum = Vata2::util::hash_combine(accum, lbl.updates.size());
+  for (const Trans::Update& upd : lbl.updates) {
+    accum = hash_item(accum, static_cast<uint8_t>(upd.type), upd.val);
   }
+
+  accum = hash_item(accum, static_cast<uint8_t>(lbl.out1.type), lbl.out1.val);
+  accum = hash_item(accum, static_cast<uint8_t>(lbl.out2.type), lbl.out2.val);
+  return accum;
+} // LabelHash::operator() }}}
+
+LabelId Vata2::Rrt::LabelTable::intern(const Trans::Label& lbl)
+{ // {{{
+  Trans::Label canon = lbl.canonical();
+  auto it_ins = this->ids.insert({canon, static_cast<LabelId>(this->labels.size())});
+  if (it_ins.second) { this->labels.push_back(std::move(canon)); }
+  return it_ins.first->second;
+} // LabelTable::intern }}}
+
+bool Vata2::Rrt::LabelTable::find(const Trans::Label& lbl, LabelId* id) const
+{ // {{{
+  assert(nullptr != id);
+
+  auto it = this->ids.find(lbl.canonical());
+  if (this->ids.end() == it) return false;
+
+  *id = it->second;
   return true;
-} // Label::operator== }}}
+} // LabelTable::find }}}
 
 void Vata2::Rrt::Rrt::add_trans(
 		State                 src,
 		const Trans::Label&   lbl,
 		State                 tgt)
 { // {{{
-  auto it_inserted = this->transitions.insert({src, { {lbl, tgt} } });
-  if (!it_inserted.second) {
-    // TODO: check whether the transition is not already there
-    PostSymb& post = it_inserted.first->second;
-    post.push_back({lbl, tgt});
+  LabelId id = this->labels.intern(lbl);
+  if (!this->trans_set.insert({src, {id, tgt}}).second) return;   // already there
+
+  StatePost& post = this->transitions[src];
+  Symbol symb;
+  if (this->labels[id].get_in1_symbol(&symb)) {
+    post.in1_symbol[symb].push_back({id, tgt});
+  } else {
+    post.other.push_back({id, tgt});
   }
 } // add_trans }}}
 
@@ -105,19 +211,22 @@ void Vata2::Rrt::Rrt::add_trans(
 bool Vata2::Rrt::Rrt::has_trans(
   State                 src,
   const Trans::Label&   lbl,
-  State                 tgt)
+  State                 tgt) const
 { // {{{
-  auto it = this->transitions.find(src);
-  if (it == this->transitions.end()) return false;
-  for (auto lbl_state : it->second) {
-    if (Trans(src, lbl_state.first, lbl_state.second) == Trans(src, lbl, tgt)) return true;
-  }
-
-  return false;
+  LabelId id;
+  if (!this->labels.find(lbl, &id)) return false;
+  return Vata2::util::haskey(this->trans_set, std::make_pair(src, LabelTgt(id, tgt)));
 } // has_trans }}}
 
 
-Vata2::Nfa::Nfa Vata2::Rrt::post_of_nfa(const Rrt& rrt, const Vata2::Nfa::Nfa& nfa)
+std::vector<Vata2::Rrt::Trans> Vata2::Rrt::Rrt::get_transitions() const
 { // {{{
-  assert(false);
-} // post_of_nfa }}}
+  std::vector<Trans> result;
+  for (const auto& src_lbl_tgt : this->trans_set) {
+    result.push_back({src_lbl_tgt.first, this->labels[src_lbl_tgt.second.first],
+      src_lbl_tgt.second.second});
+  }
+
+  return result;
+} // get_transitions }}}
+
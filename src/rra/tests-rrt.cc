@@ -86,7 +86,64 @@ TEST_CASE("Vata2::Rrt::Rrt::add_trans()/has_trans()")
 
   REQUIRE(rrt.has_trans(trans2));
 
-  WARN_PRINT("Insufficient testing of Vata2::Rrt::Rrt::add_trans()");
+  SECTION("labels are compared in the canonical form")
+  {
+    Trans trans3 = trans2;
+    trans3.lbl.guards = {{GuardType::IN2_VAR, 7},
+                         {GuardType::IN1_VAR, 3},
+                         {GuardType::IN1_VAR, 0}};
+    trans3.lbl.updates = {{UpdateType::REG_STORE_IN1, 1},
+                          {UpdateType::REG_STORE_IN1, 0}};
+    REQUIRE(trans3.lbl == trans1.lbl);
+    REQUIRE(rrt.has_trans(trans3));
+
+    rrt.add_trans(trans3);
+    REQUIRE(rrt.trans_size() == 1);
+    REQUIRE(rrt.get_labels().size() == 1);
+  }
+
+  SECTION("labels with different outputs differ")
+  {
+    Trans trans3 = trans2;
+    trans3.lbl.out1 = {OutputType::PUT_REG, 1};
+    REQUIRE(trans3.lbl != trans1.lbl);
+    REQUIRE(!rrt.has_trans(trans3));
+
+    rrt.add_trans(trans3);
+    REQUIRE(rrt.trans_size() == 2);
+    REQUIRE(rrt.get_labels().size() == 2);
+    REQUIRE(rrt.get_transitions().size() == 2);
+  }
+} // }}}
+
+TEST_CASE("Vata2::Rrt::Rrt::for_each_trans()")
+{ // {{{
+	Rrt rrt;
+
+  Trans::Output out_in1 = {OutputType::PUT_IN1, 0};
+  Trans::Output out_in2 = {OutputType::PUT_IN2, 0};
+  rrt.add_trans(1, {{GuardType::IN1_IS, 'a'}, {GuardType::IN2_IS, 'b'}}, {}, out_in1, out_in2, 2);
+  rrt.add_trans(1, {{GuardType::IN1_IS, 'b'}}, {}, out_in1, out_in2, 3);
+  rrt.add_trans(1, {{GuardType::INS_EQ, 0}}, {}, out_in1, out_in2, 4);
+  rrt.add_trans(2, {{GuardType::IN1_IS, 'a'}}, {}, out_in1, out_in2, 5);
+
+  auto get_tgts = [&rrt](State src, Symbol in1) {
+    std::set<State> result;
+    rrt.for_each_trans(src, in1, [&](LabelId, State tgt) { result.insert(tgt); });
+    return result;
+  };
+
+  REQUIRE(get_tgts(1, 'a') == std::set<State>({2, 4}));
+  REQUIRE(get_tgts(1, 'b') == std::set<State>({3, 4}));
+  REQUIRE(get_tgts(1, 'c') == std::set<State>({4}));
+  REQUIRE(get_tgts(2, 'b').empty());
+  REQUIRE(get_tgts(7, 'a').empty());
+
+  const StatePost* post = rrt.get_post(1);
+  REQUIRE(nullptr != post);
+  REQUIRE(post->in1_symbol.size() == 2);
+  REQUIRE(post->other.size() == 1);
+  REQUIRE(rrt.get_label(post->other.front().first).guards.front().type == GuardType::INS_EQ);
 } // }}}
 
 TEST_CASE("Vata2::Rrt::Rrt::add_initial()/has_initial()")
@@ -109,6 +166,226 @@ TEST_CASE("Vata2::Rrt::Rrt::add_final()/has_final()")
   REQUIRE(!rrt.has_final(4));
 } // }}}
 
+TEST_CASE("Vata2::Rrt::post_of_nfa()")
+{ // {{{
+	Rrt rrt;
+	Vata2::Nfa::Nfa nfa;
+
+  auto sym = encode_symbol_pair;
+  Trans::Output out_in1 = {OutputType::PUT_IN1, 0};
+  Trans::Output out_in2 = {OutputType::PUT_IN2, 0};
+
+  SECTION("symbol pairs")
+  {
+    REQUIRE(decode_symbol_pair(sym('a', 'b')) == std::make_pair<Symbol, Symbol>('a', 'b'));
+    CHECK_THROWS_WITH(sym(static_cast<Symbol>(1) << SYMBOL_PAIR_SHIFT, 0),
+      Catch::Contains("too large"));
+  }
+
+  SECTION("swapping of tapes")
+  {
+    rrt.initialstates = {1};
+    rrt.finalstates = {1};
+    rrt.add_trans(1, {{GuardType::IN1_VAR, 0}}, {}, out_in2, out_in1, 1);
+
+    nfa.initialstates = {1};
+    nfa.finalstates = {3};
+    nfa.add_trans(1, sym('a', 'b'), 2);
+    nfa.add_trans(2, sym('c', 'd'), 3);
+
+    Vata2::Nfa::Nfa result = post_of_nfa(rrt, nfa);
+    REQUIRE(result.trans_size() == 2);
+    REQUIRE(is_in_lang(result, {sym('b', 'a'), sym('d', 'c')}));
+    REQUIRE(!is_in_lang(result, {sym('a', 'b'), sym('c', 'd')}));
+  }
+
+  SECTION("registers")
+  {
+    // remembers the first symbol on tape 1 and then replaces symbols on tape 1
+    // different from it by it; stops at the first occurrence of it
+    rrt.initialstates = {1};
+    rrt.finalstates = {3};
+    rrt.add_trans(1, {}, {{UpdateType::REG_STORE_IN1, 0}}, out_in1, out_in2, 2);
+    rrt.add_trans(2, {{GuardType::IN1_NEQ, 0}}, {}, {OutputType::PUT_REG, 0}, out_in2, 2);
+    rrt.add_trans(2, {{GuardType::IN1_EQ, 0}}, {{UpdateType::REG_CLEAR, 0}},
+      out_in1, out_in2, 3);
+
+    // (a|b, x)*
+    nfa.initialstates = {1};
+    nfa.finalstates = {1};
+    nfa.add_trans(1, sym('a', 'x'), 1);
+    nfa.add_trans(1, sym('b', 'x'), 1);
+
+    Vata2::Nfa::Nfa result = post_of_nfa(rrt, nfa);
+    REQUIRE(is_in_lang(result, {sym('a', 'x'), sym('a', 'x'), sym('a', 'x')}));
+    REQUIRE(is_in_lang(result, {sym('b', 'x'), sym('b', 'x'), sym('b', 'x')}));
+    REQUIRE(!is_in_lang(result, {sym('a', 'x'), sym('b', 'x'), sym('a', 'x')}));
+    REQUIRE(is_in_lang(result, {sym('a', 'x'), sym('a', 'x')}));
+    REQUIRE(!is_in_lang(result, {sym('a', 'x')}));
+
+    NfaImage image(rrt, nfa);
+    REQUIRE(image.initialstates.size() == 1);
+    Vata2::Nfa::Path path;
+    REQUIRE(!is_lang_empty(image, &path));
+    REQUIRE(path.size() == 3);
+    REQUIRE(image.has_final(path.back()));
+    REQUIRE(image.get_valuation(image.get_config(path[1]).val) == RegValuation({'a'}));
+    REQUIRE(image.get_valuation(image.get_config(path[2]).val) == RegValuation({NO_VALUE}));
+    // the empty valuation and the ones storing a and b
+    REQUIRE(image.num_valuations() == 3);
+  }
+
+  SECTION("unassigned registers cannot be output")
+  {
+    rrt.initialstates = {1};
+    rrt.finalstates = {2};
+    rrt.add_trans(1, {}, {}, {OutputType::PUT_AUX, 1}, out_in2, 2);
+
+    nfa.initialstates = {1};
+    nfa.finalstates = {2};
+    nfa.add_trans(1, sym('a', 'b'), 2);
+
+    NfaImage image(rrt, nfa);
+    REQUIRE(is_lang_empty(image));
+    REQUIRE(image.get_valuation(0).size() == 2);
+  }
+
+  SECTION("lazy inclusion")
+  {
+    // replaces a by b on tape 1 until tape 2 has c
+    rrt.initialstates = {1};
+    rrt.finalstates = {1, 2};
+    rrt.add_trans(1, {{GuardType::IN1_IS, 'a'}, {GuardType::IN2_ISNOT, 'c'}}, {},
+      {OutputType::PUT_REG, 0}, out_in2, 1);
+    rrt.add_trans(1, {{GuardType::IN1_IS, 'a'}, {GuardType::IN2_ISNOT, 'c'}},
+      {{UpdateType::AUX_STORE_IN2, 0}}, out_in2, out_in2, 1);
+    rrt.add_trans(1, {{GuardType::IN2_IS, 'c'}}, {}, out_in1, out_in2, 2);
+    rrt.add_trans(2, {}, {}, out_in1, out_in2, 2);
+
+    // (a, b)* (a, c) (a, b)*
+    nfa.initialstates = {1};
+    nfa.finalstates = {2};
+    nfa.add_trans(1, sym('a', 'b'), 1);
+    nfa.add_trans(1, sym('a', 'c'), 2);
+    nfa.add_trans(2, sym('a', 'b'), 2);
+
+    // (b, b)* (a, c) (a, b)*
+    Vata2::Nfa::Nfa bigger;
+    bigger.initialstates = {1};
+    bigger.finalstates = {2};
+    bigger.add_trans(1, sym('b', 'b'), 1);
+    bigger.add_trans(1, sym('a', 'c'), 2);
+    bigger.add_trans(2, sym('a', 'b'), 2);
+
+    NfaImage image(rrt, nfa);
+    Vata2::Nfa::Word cex;
+    REQUIRE(is_incl(image, bigger, &cex));
+
+    bigger.finalstates = {1, 2};
+    REQUIRE(is_incl(image, bigger, &cex));
+
+    bigger.finalstates = {1};
+    REQUIRE(!is_incl(image, bigger, &cex));
+    REQUIRE(cex == Vata2::Nfa::Word({sym('a', 'c')}));
+
+    // a nondeterministic bigger automaton, whose subsets get subsumed
+    bigger.finalstates = {2};
+    bigger.add_trans(1, sym('b', 'b'), 3);
+    bigger.add_trans(3, sym('b', 'b'), 1);
+    bigger.add_trans(3, sym('a', 'c'), 2);
+    const Vata2::Nfa::Nfa post = post_of_nfa(rrt, nfa);
+    Vata2::Nfa::DirectAlphabet alph;
+    REQUIRE(is_incl(image, bigger, &cex));
+    REQUIRE(Vata2::Nfa::is_incl(post, bigger, alph));
+
+    bigger.add_trans(3, sym('b', 'b'), 4);
+    bigger.finalstates = {4};
+    REQUIRE(!is_incl(image, bigger, &cex));
+    REQUIRE(!Vata2::Nfa::is_incl(post, bigger, alph));
+    REQUIRE(Vata2::Nfa::is_in_lang(post, cex));
+    REQUIRE(!Vata2::Nfa::is_in_lang(bigger, cex));
+  }
+} // }}}
+
+TEST_CASE("Vata2::Rrt::reach_fixpoint()")
+{ // {{{
+	Rrt rrt;
+	Vata2::Nfa::Nfa init;
+	Vata2::Nfa::Nfa result;
+
+  // tape 2 always contains b, which is used to output b on tape 1
+  auto sym = [](Symbol symb) { return encode_symbol_pair(symb, 'b'); };
+  auto word = [&sym](const std::string& str) {
+    Vata2::Nfa::Word result;
+    for (char c : str) { result.push_back(sym(c)); }
+    return result;
+  };
+  Trans::Output out_in1 = {OutputType::PUT_IN1, 0};
+  Trans::Output out_in2 = {OutputType::PUT_IN2, 0};
+
+  SECTION("finite state space")
+  {
+    // rewrites one a to b
+    rrt.initialstates = {1};
+    rrt.finalstates = {2};
+    rrt.add_trans(1, {}, {}, out_in1, out_in2, 1);
+    rrt.add_trans(1, {{GuardType::IN1_IS, 'a'}}, {}, out_in2, out_in2, 2);
+    rrt.add_trans(2, {}, {}, out_in1, out_in2, 2);
+
+    // aaa
+    init.initialstates = {1};
+    init.finalstates = {4};
+    init.add_trans(1, sym('a'), 2);
+    init.add_trans(2, sym('a'), 3);
+    init.add_trans(3, sym('a'), 4);
+
+    size_t num_iter;
+    REQUIRE(reach_fixpoint(&result, rrt, init, {}, &num_iter));
+    REQUIRE(num_iter == 3);
+    for (const char* str : {"aaa", "aba", "abb", "bbb"}) {
+      REQUIRE(is_in_lang(result, word(str)));
+    }
+    REQUIRE(!is_in_lang(result, word("bb")));
+
+    // the same result without reductions
+    REQUIRE(reach_fixpoint(&result, rrt, init, {{"reduce", "none"}}));
+    REQUIRE(is_in_lang(result, word("bab")));
+
+    CHECK_THROWS_WITH(reach_fixpoint(&result, rrt, init, {{"reduce", "foo"}}),
+      Catch::Contains("unknown value"));
+  }
+
+  SECTION("widening")
+  {
+    // moves a to the right by one position
+    rrt.initialstates = {1};
+    rrt.finalstates = {3};
+    rrt.add_trans(1, {{GuardType::IN1_IS, 'b'}}, {}, out_in1, out_in2, 1);
+    rrt.add_trans(1, {{GuardType::IN1_IS, 'a'}}, {{UpdateType::REG_STORE_IN1, 0}},
+      out_in2, out_in2, 2);
+    rrt.add_trans(2, {{GuardType::IN1_IS, 'b'}}, {}, {OutputType::PUT_REG, 0}, out_in2, 3);
+    rrt.add_trans(3, {}, {}, out_in1, out_in2, 3);
+
+    // ab*
+    init.initialstates = {1};
+    init.finalstates = {2};
+    init.add_trans(1, sym('a'), 2);
+    init.add_trans(2, sym('b'), 2);
+
+    // b^i a b* for i <= 5
+    REQUIRE(!reach_fixpoint(&result, rrt, init, {{"max_iter", "5"}}));
+    REQUIRE(is_in_lang(result, word("bbbbbab")));
+    REQUIRE(!is_in_lang(result, word("bbbbbbab")));
+
+    // b* a b*
+    REQUIRE(reach_fixpoint(&result, rrt, init, {{"widen", "1"}}));
+    REQUIRE(is_in_lang(result, word("bbbbbbbbab")));
+    REQUIRE(is_in_lang(result, word("a")));
+    REQUIRE(!is_in_lang(result, word("bbb")));
+    REQUIRE(!is_in_lang(result, word("aba")));
+  }
+} // }}}
+
 // TEST_CASE("Vata2::Rrt::serialize() and operator<<()")
 // { // {{{
 	// Rrt rrt;
@@ -1,5 +1,6 @@
 // TODO: add header
 
+#include <vata2/nfa.hh>
 #include <vata2/vm-dispatch.hh>
 
 #include "dispatch-aux.hh"
@@ -26,6 +27,10 @@ namespace
 			return VMValue(Vata2::TYPE_VOID, nullptr);
 		}
 
+		if ("regex" == func_name) { // compiling into an NFA
+			return find_dispatcher(Vata2::Nfa::TYPE_NFA)(func_name, func_args);
+		}
+
 		// we use throw to return result from test_and_call
 		try {
 
@@ -0,0 +1,234 @@
+/* tests-parallel.cc -- tests of the thread pool
+ *
+ * Copyright (c) 2018 Ondrej Lengal <ondra.lengal@gmail.com>
+ *
+ * This file is a part of libvata2.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "../3rdparty/catch.hpp"
+
+#include <algorithm>
+#include <thread>
+
+#include <vata2/parallel.hh>
+
+using namespace Vata2::parallel;
+
+
+TEST_CASE("Vata2::parallel::TaskGroup")
+{ // {{{
+	ThreadPool& pool = ThreadPool::get();
+	const std::string orig_threads = std::to_string(pool.num_workers() + 1);
+
+	for (const std::string threads : {"1", "2", "4"})
+	{
+		pool.configure({{"threads", threads}});
+		REQUIRE(pool.num_workers() + 1 == std::stoul(threads));
+
+		// all tasks are run
+		std::atomic<size_t> sum = { 0 };
+		{
+			TaskGroup group;
+			for (size_t i = 1; i <= 1000; ++i) { group.run([&sum, i]() { sum += i; }); }
+			group.wait();
+			REQUIRE(sum == 500500);
+		}
+
+		// nested groups do not block the workers
+		std::atomic<size_t> cnt = { 0 };
+		{
+			TaskGroup outer;
+			for (size_t i = 0; i < 8; ++i)
+			{
+				outer.run([&cnt]() {
+					TaskGroup inner;
+					for (size_t j = 0; j < 8; ++j) { inner.run([&cnt]() { ++cnt; }); }
+					inner.wait();
+				});
+			}
+			outer.wait();
+			REQUIRE(cnt == 64);
+		}
+
+		// the first exception is rethrown and the group stays usable
+		{
+			TaskGroup group;
+			group.run([]() { throw std::runtime_error("task failed"); });
+			CHECK_THROWS_WITH(group.wait(), "task failed");
+			REQUIRE(group.is_cancelled());
+			group.wait();
+		}
+
+		// tasks of a cancelled group are skipped
+		cnt = 0;
+		{
+			TaskGroup group;
+			group.cancel();
+			for (size_t i = 0; i < 100; ++i) { group.run([&cnt]() { ++cnt; }); }
+			group.wait();
+			REQUIRE(cnt == 0);
+		}
+	}
+
+	pool.configure({{"threads", orig_threads}});
+} // }}}
+
+
+TEST_CASE("Vata2::parallel::parallel_for()")
+{ // {{{
+	for (const std::string threads : {"1", "3", "8"})
+	{
+		std::vector<size_t> visited(10000, 0);
+		parallel_for(0, visited.size(), [&visited](size_t i) { ++visited[i]; },
+			{{"threads", threads}});
+		REQUIRE(std::all_of(visited.begin(), visited.end(),
+			[](size_t cnt) { return 1 == cnt; }));
+
+		// an empty range and a range smaller than the parallelism
+		parallel_for(5, 5, [](size_t) { throw std::runtime_error("unexpected"); },
+			{{"threads", threads}});
+		std::atomic<size_t> sum = { 0 };
+		parallel_for(10, 12, [&sum](size_t i) { sum += i; }, {{"threads", threads}});
+		REQUIRE(sum == 21);
+
+		CHECK_THROWS_WITH(parallel_for(0, 1000, [](size_t i) {
+				if (500 == i) { throw std::runtime_error("body failed"); }
+			}, {{"threads", threads}}),
+			"body failed");
+	}
+
+	CHECK_THROWS_WITH(parallel_for(0, 10, [](size_t) { }, {{"threads", "0"}}),
+		Catch::Contains("invalid number of threads"));
+} // }}}
+
+
+TEST_CASE("Vata2::parallel::ThreadPool::configure()")
+{ // {{{
+	ThreadPool& pool = ThreadPool::get();
+	const std::string orig_threads = std::to_string(pool.num_workers() + 1);
+
+	SECTION("invalid values")
+	{
+		CHECK_THROWS_WITH(pool.configure({{"threads", "many"}}),
+			Catch::Contains("invalid number of threads"));
+		CHECK_THROWS_WITH(pool.configure({{"threads", "2x"}}),
+			Catch::Contains("invalid number of threads"));
+		CHECK_THROWS_WITH(pool.configure({{"affinity", "everywhere"}}),
+			Catch::Contains("unknown value of the \"affinity\" key"));
+	}
+
+	SECTION("pinned workers")
+	{
+		for (const std::string affinity : {"compact", "scatter", "none"})
+		{
+			pool.configure({{"threads", "3"}, {"affinity", affinity}});
+			REQUIRE(2 == pool.num_workers());
+			REQUIRE(3 == get_parallelism({}));
+
+			std::atomic<size_t> cnt = { 0 };
+			parallel_for(0, 100, [&cnt](size_t) { ++cnt; });
+			REQUIRE(cnt == 100);
+		}
+	}
+
+	SECTION("reconfiguration while other threads use the pool")
+	{
+		std::atomic<bool> done = { false };
+		std::atomic<size_t> rounds = { 0 };
+		std::atomic<size_t> wrong = { 0 };
+		std::vector<std::thread> users;
+		for (size_t i = 0; i < 2; ++i)
+		{
+			users.emplace_back([&]() {
+				while (!done)
+				{
+					std::atomic<size_t> cnt = { 0 };
+					parallel_for(0, 1000, [&cnt](size_t) { ++cnt; }, {{"threads", "4"}});
+					if (1000 != cnt) { ++wrong; }
+					++rounds;
+				}
+			});
+		}
+
+		for (size_t i = 0; i < 50; ++i) {
+			pool.configure({{"threads", std::to_string(1 + i % 4)}});
+		}
+
+		// the users also make progress after the last reconfiguration
+		const size_t seen = rounds;
+		while (rounds < seen + 2) { std::this_thread::yield(); }
+		done = true;
+		for (std::thread& user : users) { user.join(); }
+		REQUIRE(0 == wrong);
+	}
+
+	pool.configure({{"threads", orig_threads}});
+} // }}}
+
+
+TEST_CASE("Vata2::parallel::run_async()")
+{ // {{{
+	ThreadPool& pool = ThreadPool::get();
+	const std::string orig_threads = std::to_string(pool.num_workers() + 1);
+
+	for (const std::string threads : {"1", "3"})
+	{
+		pool.configure({{"threads", threads}});
+
+		// results, exceptions, and operations without a result
+		REQUIRE(42 == run_async([]() { return 42; }).get());
+		CHECK_THROWS_WITH(run_async([]() -> int { throw std::runtime_error("op failed"); }).get(),
+			"op failed");
+		bool done = false;
+		run_async([&done]() { done = true; }).get();
+		REQUIRE(done);
+
+		// an operation cancelled before it starts is not run
+		done = false;
+		auto handle = run_async([&done]() { done = true; });
+		handle.cancel();
+		if ("1" == threads) {
+			CHECK_THROWS_AS(handle.get(), Cancelled);
+			REQUIRE(!done);
+		}
+		else {
+			try { handle.get(); } catch (const Cancelled&) { }
+		}
+	}
+
+	// progress is reported until the operation is cancelled
+	pool.configure({{"threads", "2"}});
+	std::atomic<size_t> reports = { 0 };
+	std::atomic<size_t> worklist = { 0 };
+	auto handle = run_async([]() {
+			for (size_t i = 0; ; ++i) { report_progress(i, 7); }
+			return 0;
+		},
+		[&reports, &worklist](const Progress& progress) {
+			worklist = progress.worklist;
+			++reports;
+		},
+		std::chrono::milliseconds(0));
+
+	while (0 == reports) { std::this_thread::yield(); }
+	REQUIRE(!handle.is_ready());
+	REQUIRE(7 == worklist);
+	handle.cancel();
+	CHECK_THROWS_AS(handle.get(), Cancelled);
+	REQUIRE(0 < handle.get_progress().explored);
+
+	// outside of asynchronous operations, reports are ignored
+	report_progress(1, 1);
+
+	pool.configure({{"threads", orig_threads}});
+} // }}}
@@ -3,7 +3,10 @@
 #include <vata2/vm-dispatch.hh>
 
 // Headers of user data types
+#include <vata2/ca.hh>
+#include <vata2/dpa.hh>
 #include <vata2/nfa.hh>
+#include <vata2/nta.hh>
 #include "bool.hh"
 #include "str.hh"
 #include "void.hh"
@@ -41,7 +44,10 @@ VMDispatcherDict dispatch_dict = { };
 const VMInitFunc INIT_FUNCTIONS[] =
 {
 	Vata2::Bool::init,
+	Vata2::Ca::init,
+	Vata2::Dpa::init,
 	Vata2::Nfa::init,
+	Vata2::Nta::init,
 	Vata2::Str::init,
 	Vata2::Parser::init,
 	Vata2::Void::init,